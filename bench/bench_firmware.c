@@ -0,0 +1,390 @@
+// Microbenchmarks dos caminhos quentes do firmware (laço de 10 Hz).
+//
+// Cada caso reproduz o trabalho de uma função de wifi-portal.c usando as
+// mesmas bibliotecas (lib/): montagem do quadro de comandos, leitura do
+// status em rx_cb, PING/PONG, joystick, matriz e desenho/envio do OLED.
+// O custo é o menor tempo de um lote de chamadas em várias repetições,
+// dividido pelo tamanho do lote:
+//   - no Pico, em ciclos do SysTick (clock do processador);
+//   - no PC, em ns (CLOCK_MONOTONIC).
+// A alocação é contada em bytes por chamada (malloc/calloc/realloc via
+// --wrap no PC; no Pico, crescimento do heap medido por mallinfo()).
+//
+// No PC:
+//   rover-bench                          # só imprime
+//   rover-bench --baseline arq [--tolerancia 0.5]
+//                                        # falha (código 1) se regredir
+//   rover-bench --salvar arq             # grava nova referência
+// No Pico (wifi-portal-bench) o relatório sai pela USB a cada 5 s, no mesmo
+// formato do arquivo de referência.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "lib/ssd1306.h"
+#include "lib/cmd_frame.h"
+#include "lib/controle.h"
+#include "lib/proto_texto.h"
+#include "lib/matriz.h"
+#include "lib/rlog.h"
+
+#if PICO_ON_DEVICE
+#include <malloc.h>
+#include "hardware/structs/systick.h"
+#else
+#include <time.h>
+#endif
+
+// Mesmos parâmetros de wifi-portal.c
+#define MAX_SPEED       80.0f
+#define DEADZONE        0.15f
+#define CMD_REDUNDANCIA 3
+#define CMD_PARIDADE_N  4
+#define I2C_ADDR        0x3C
+#define I2C_PORT        i2c1
+#define I2C_SDA         14
+#define I2C_SCL         15
+
+#define REPETICOES      200
+
+// ====== RELÓGIO E ALOCAÇÃO ======
+#if PICO_ON_DEVICE
+#define UNIDADE "ciclos"
+
+// SysTick de 24 bits no clock do processador, contando para baixo
+static void relogio_iniciar(void) {
+  systick_hw->rvr = 0x00ffffff;
+  systick_hw->cvr = 0;
+  systick_hw->csr = 0x5;   // ENABLE | CLKSOURCE (processador)
+}
+
+static inline uint32_t relogio_ler(void) {
+  return systick_hw->cvr;
+}
+
+static inline uint32_t relogio_delta(uint32_t ini, uint32_t fim) {
+  return (ini - fim) & 0x00ffffff;
+}
+
+static size_t alocado(void) {
+  return (size_t)mallinfo().uordblks;
+}
+#else
+#define UNIDADE "ns"
+
+static void relogio_iniciar(void) {}
+
+static inline uint32_t relogio_ler(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+static inline uint32_t relogio_delta(uint32_t ini, uint32_t fim) {
+  return fim - ini;
+}
+
+#ifdef BENCH_CONTA_ALOCACAO
+static size_t bytes_alocados;
+
+void *__real_malloc(size_t n);
+void *__real_calloc(size_t n, size_t tam);
+void *__real_realloc(void *p, size_t n);
+
+void *__wrap_malloc(size_t n) {
+  bytes_alocados += n;
+  return __real_malloc(n);
+}
+
+void *__wrap_calloc(size_t n, size_t tam) {
+  bytes_alocados += n * tam;
+  return __real_calloc(n, tam);
+}
+
+void *__wrap_realloc(void *p, size_t n) {
+  bytes_alocados += n;
+  return __real_realloc(p, n);
+}
+#else
+static size_t bytes_alocados;   // sem --wrap: sempre 0
+#endif
+
+static size_t alocado(void) {
+  return bytes_alocados;
+}
+#endif
+
+// ====== CASOS ======
+// Entradas variam a cada chamada e os resultados vão para `sumidouro`,
+// para o compilador não eliminar o trabalho medido
+static volatile uint32_t sumidouro;
+static uint32_t iteracao;
+
+static ssd1306_t ssd;
+static cmd_stream_t cmd_stream;
+static bool buffer_leds[MATRIZ_PIXELS];
+
+static const uint16_t adc_amostras[8] = { 2048, 2100, 1990, 4095, 0, 3000, 1200, 2048 };
+
+static const bool padrao_normal[5][5] = {
+  {0, 0, 1, 0, 0}, {0, 1, 1, 1, 0}, {1, 1, 1, 1, 1}, {0, 1, 1, 1, 0}, {0, 0, 1, 0, 0},
+};
+static const bool padrao_captura[5][5] = {
+  {1, 0, 0, 0, 1}, {0, 1, 0, 1, 0}, {0, 0, 1, 0, 0}, {0, 1, 0, 1, 0}, {1, 0, 0, 0, 1},
+};
+
+// enviar_comandos_rover: amostra + quadro RVRF + paridade (sem o envio)
+static void caso_comandos(void) {
+  float jx = controle_eixo(adc_amostras[iteracao & 7], DEADZONE);
+  float jy = controle_eixo(adc_amostras[(iteracao + 3) & 7], DEADZONE);
+  cmd_amostra_t a = controle_amostra(jx, jy, MAX_SPEED, 0, (iteracao & 1) ? CMD_FLAG_LUZES : 0);
+  uint8_t quadro[CMD_FRAME_MAX];
+  size_t len = cmd_stream_encode(&cmd_stream, &a, (uint16_t)(iteracao >> 4), quadro, sizeof(quadro));
+  len += cmd_stream_paridade(&cmd_stream, quadro, sizeof(quadro));
+  sumidouro += (uint32_t)len + quadro[5];
+}
+
+// rx_cb com um status do simulador: classificação e campos score/evack
+static void caso_rx_status(void) {
+  static const char *msgs[2] = {
+    "speed=12.3,steering=-45.0,battery=99.0,temp=25.1,mode=0,lights=on,camera=off,score=100,evack=1",
+    "speed=63.9,steering=20.0,battery=84.6,temp=35.0,mode=0,lights=off,camera=off,score=0,evack=5",
+  };
+  const char *msg = msgs[iteracao & 1];
+  if (strncmp(msg, "OFFER", 5) == 0 || strncmp(msg, "PING,", 5) == 0 ||
+      strncmp(msg, "PONG,", 5) == 0 || strcmp(msg, "ACK") == 0)
+    return;
+  proto_status_t st;
+  proto_ler_status(msg, &st);
+  sumidouro += (uint32_t)st.score + st.evack;
+}
+
+// responder_ping: campos seq/t1 e montagem do PONG
+static void caso_rx_ping(void) {
+  static const char *msg = "PING,seq=1234,t1=987654321";
+  uint32_t seq, t1;
+  char pong[80];
+  if (proto_campo_u32(msg, ",seq=", &seq) && proto_campo_u32(msg, ",t1=", &t1))
+    sumidouro += (uint32_t)proto_pong(pong, sizeof(pong), seq, t1, iteracao, iteracao + 7);
+}
+
+// enviar_ping
+static void caso_ping(void) {
+  char ping[48];
+  sumidouro += (uint32_t)proto_ping(ping, sizeof(ping), iteracao, iteracao * 3u);
+}
+
+// ler_joystick (sem o ADC): conversão dos dois eixos com zona morta
+static void caso_joystick(void) {
+  float x = controle_eixo(adc_amostras[iteracao & 7], DEADZONE);
+  float y = controle_eixo(adc_amostras[(iteracao + 5) & 7], DEADZONE);
+  sumidouro += (uint32_t)(int32_t)((x + y) * 1000.0f);
+}
+
+// atualizar_buffer_matriz
+static void caso_matriz(void) {
+  matriz_carregar(buffer_leds, (iteracao & 1) ? padrao_captura : padrao_normal);
+  sumidouro += buffer_leds[iteracao % MATRIZ_PIXELS];
+}
+
+static void caso_ssd_fill(void) {
+  ssd1306_fill(&ssd, iteracao & 1);
+  sumidouro += ssd.ram_buffer[1];
+}
+
+static void caso_ssd_string(void) {
+  ssd1306_draw_string(&ssd, "A: Captura B: Luzes", 0, 52);
+  sumidouro += ssd.ram_buffer[100];
+}
+
+// atualizar_display sem o envio: tela limpa e quatro linhas de texto
+static void caso_ssd_tela(void) {
+  ssd1306_fill(&ssd, 0);
+  ssd1306_draw_string(&ssd, "ROVER CONTROL", 15, 0);
+  ssd1306_draw_string(&ssd, "Status: Conectado", 0, 16);
+  ssd1306_draw_string(&ssd, "Score: 100", 0, 28);
+  ssd1306_draw_string(&ssd, "A: Captura B: Luzes", 0, 52);
+  sumidouro += ssd.ram_buffer[200];
+}
+
+// ssd1306_send_data: 1 KB por I2C (no PC só o custo de CPU do shim)
+static void caso_ssd_envio(void) {
+  ssd1306_send_data(&ssd);
+}
+
+// RLOG num callback: gravação no anel (o que custa no caminho quente)
+static void caso_log(void) {
+  RLOG(RLOG_INFO, RLOG_REDE, "RX %u B de %u.%u.%u.%u:%u", 92u, 127, 0, 0, 1, 8080);
+  rlog_limpar();
+}
+
+// rlog_escoar sem a USB: formatação de um registro com float
+static void caso_log_fmt(void) {
+  static const uintptr_t args[] = { 1234, 0x41a40000u /* 20.5f */, 0xc2340000u /* -45.0f */, 0, 5, 7 };
+  char linha[128];
+  sumidouro += (uint32_t)rlog_formatar(linha, sizeof(linha),
+                                       "TX #%u: speed=%.1f,steering=%.1f,mode=%d,flags=%x,evt=%u",
+                                       6, args);
+}
+
+typedef struct {
+  const char *nome;
+  void (*fn)(void);
+  uint32_t lote;   // chamadas por medida (o SysTick dá a volta em ~126 ms)
+} caso_t;
+
+static const caso_t casos[] = {
+  { "comandos",   caso_comandos,   32 },
+  { "rx_status",  caso_rx_status,  32 },
+  { "rx_ping",    caso_rx_ping,    32 },
+  { "ping",       caso_ping,       32 },
+  { "joystick",   caso_joystick,   32 },
+  { "matriz",     caso_matriz,     32 },
+  { "ssd_fill",   caso_ssd_fill,   8 },
+  { "ssd_string", caso_ssd_string, 8 },
+  { "ssd_tela",   caso_ssd_tela,   4 },
+  { "ssd_envio",  caso_ssd_envio,  1 },
+  { "log",        caso_log,        32 },
+  { "log_fmt",    caso_log_fmt,    32 },
+};
+#define NUM_CASOS (sizeof(casos) / sizeof(casos[0]))
+
+typedef struct {
+  double custo;    // UNIDADE por chamada (melhor lote)
+  double bytes;    // bytes alocados por chamada
+} resultado_t;
+
+static resultado_t medir(const caso_t *c) {
+  uint32_t melhor = UINT32_MAX;
+  size_t antes = alocado();
+  for (int r = 0; r < REPETICOES; r++) {
+    uint32_t ini = relogio_ler();
+    for (uint32_t i = 0; i < c->lote; i++) {
+      c->fn();
+      iteracao++;
+    }
+    uint32_t d = relogio_delta(ini, relogio_ler());
+    if (d < melhor)
+      melhor = d;
+  }
+  resultado_t res = {
+    .custo = (double)melhor / c->lote,
+    .bytes = (double)(alocado() - antes) / ((double)REPETICOES * c->lote),
+  };
+  return res;
+}
+
+static void preparar(void) {
+  relogio_iniciar();
+  i2c_init(I2C_PORT, 400 * 1000);
+  gpio_set_function(I2C_SDA, GPIO_FUNC_I2C);
+  gpio_set_function(I2C_SCL, GPIO_FUNC_I2C);
+  gpio_pull_up(I2C_SDA);
+  gpio_pull_up(I2C_SCL);
+  ssd1306_init(&ssd, WIDTH, HEIGHT, false, I2C_ADDR, I2C_PORT);
+  cmd_stream_init(&cmd_stream, CMD_REDUNDANCIA, CMD_PARIDADE_N);
+}
+
+static void rodar(resultado_t res[NUM_CASOS]) {
+  for (size_t i = 0; i < NUM_CASOS; i++)
+    res[i] = medir(&casos[i]);
+}
+
+static void imprimir(FILE *f, const resultado_t res[NUM_CASOS]) {
+  fprintf(f, "# rover-bench %s/chamada, bytes/chamada\n", UNIDADE);
+  for (size_t i = 0; i < NUM_CASOS; i++)
+    fprintf(f, "%-12s %10.1f %8.1f\n", casos[i].nome, res[i].custo, res[i].bytes);
+}
+
+#if PICO_ON_DEVICE
+int main(void) {
+  stdio_init_all();
+  sleep_ms(2000);
+  preparar();
+  resultado_t res[NUM_CASOS];
+  while (true) {
+    rodar(res);
+    imprimir(stdout, res);
+    sleep_ms(5000);
+  }
+}
+#else
+// Compara com a referência: custo acima de (1 + tolerância) ou qualquer
+// alocação a mais é regressão. Casos ausentes do arquivo só são impressos.
+static int comparar(const char *arquivo, const resultado_t res[NUM_CASOS], double tolerancia) {
+  FILE *f = fopen(arquivo, "r");
+  if (!f) {
+    fprintf(stderr, "rover-bench: não foi possível abrir %s\n", arquivo);
+    return 2;
+  }
+
+  char linha[128], unidade[16] = "";
+  int regressoes = 0;
+  printf("%-12s %10s %10s %7s %8s\n", "caso", UNIDADE, "ref", "delta", "bytes");
+  while (fgets(linha, sizeof(linha), f)) {
+    if (sscanf(linha, "# rover-bench %15[^/]", unidade) == 1) {
+      if (strcmp(unidade, UNIDADE) != 0) {
+        fprintf(stderr, "rover-bench: referência em %s, medida em %s\n", unidade, UNIDADE);
+        fclose(f);
+        return 2;
+      }
+      continue;
+    }
+    char nome[32];
+    double custo_ref, bytes_ref;
+    if (sscanf(linha, "%31s %lf %lf", nome, &custo_ref, &bytes_ref) != 3)
+      continue;
+    for (size_t i = 0; i < NUM_CASOS; i++) {
+      if (strcmp(nome, casos[i].nome) != 0)
+        continue;
+      bool regrediu = res[i].custo > custo_ref * (1.0 + tolerancia) || res[i].bytes > bytes_ref + 0.05;
+      regressoes += regrediu;
+      printf("%-12s %10.1f %10.1f %+6.0f%% %8.1f%s\n", nome, res[i].custo, custo_ref,
+             100.0 * (res[i].custo - custo_ref) / (custo_ref > 0 ? custo_ref : 1),
+             res[i].bytes, regrediu ? "  REGRESSÃO" : "");
+    }
+  }
+  fclose(f);
+
+  if (regressoes)
+    printf("%d caso(s) acima da referência (tolerância %.0f%%)\n", regressoes, tolerancia * 100);
+  return regressoes ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+  const char *referencia = NULL, *salvar = NULL;
+  double tolerancia = 0.5;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+      referencia = argv[++i];
+    else if (strcmp(argv[i], "--salvar") == 0 && i + 1 < argc)
+      salvar = argv[++i];
+    else if (strcmp(argv[i], "--tolerancia") == 0 && i + 1 < argc)
+      tolerancia = atof(argv[++i]);
+    else {
+      fprintf(stderr, "uso: %s [--baseline arq [--tolerancia 0.5]] [--salvar arq]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  preparar();
+  resultado_t res[NUM_CASOS];
+  rodar(res);
+
+  if (salvar) {
+    FILE *f = fopen(salvar, "w");
+    if (!f) {
+      fprintf(stderr, "rover-bench: não foi possível gravar %s\n", salvar);
+      return 2;
+    }
+    imprimir(f, res);
+    fclose(f);
+  }
+  if (referencia)
+    return comparar(referencia, res, tolerancia);
+  imprimir(stdout, res);
+  return 0;
+}
+#endif
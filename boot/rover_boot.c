@@ -0,0 +1,41 @@
+// Seletor de boot do OTA. Roda do início da flash, antes de qualquer
+// imagem: lê o registro de controle, decide o slot (gastando uma tentativa
+// da imagem em teste ou voltando à anterior) e salta para a tabela de
+// vetores do slot. Sem slot válido, fica no BOOTSEL para gravação por USB.
+#include "pico/stdlib.h"
+#include "pico/bootrom.h"
+#include "hardware/flash.h"
+#include "hardware/irq.h"
+#include "hardware/structs/scb.h"
+
+#include "lib/ota.h"
+
+static void __attribute__((noreturn)) saltar(uint32_t offset) {
+  const uint32_t *vetores = (const uint32_t *)(XIP_BASE + offset + OTA_VETORES);
+
+  // Nenhuma interrupção do seletor pode disparar já na imagem
+  irq_set_mask_enabled(0xFFFFFFFFu, false);
+  scb_hw->vtor = (uintptr_t)vetores;
+  __asm volatile(
+    "msr msp, %0\n"
+    "bx %1\n"
+    :: "r"(vetores[0]), "r"(vetores[1]));
+  __builtin_unreachable();
+}
+
+int main(void) {
+  ota_controle_t controle;
+  ota_controle_ler(&controle);
+
+  bool valido[2] = { ota_slot_valido(&controle, 0), ota_slot_valido(&controle, 1) };
+  bool gravar;
+  int slot = ota_boot_decidir(&controle, valido, &gravar);
+
+  // Um núcleo e nenhuma interrupção ligada: a flash está livre
+  if (gravar)
+    ota_controle_gravar(&controle);
+
+  if (slot < 0)
+    reset_usb_boot(0, 0);
+  saltar(OTA_SLOT_OFFSET(slot));
+}
@@ -0,0 +1,30 @@
+# Ligação das imagens do OTA (lib/ota.h): o memmap_default.ld do SDK com a
+# região FLASH trocada pela do seletor de boot ou pela de um slot
+set(ROVER_OTA_MEMMAP ${PICO_SDK_PATH}/src/rp2_common/pico_crt0/rp2040/memmap_default.ld)
+
+function(rover_ota_memmap alvo origem tamanho)
+    file(READ ${ROVER_OTA_MEMMAP} script)
+    set(flash "FLASH(rx) : ORIGIN = ${origem}, LENGTH = ${tamanho}")
+    # SDK 2.1 inclui a região de um arquivo gerado; versões anteriores a escrevem
+    string(REPLACE "INCLUDE \"pico_flash_region.ld\"" "${flash}" script "${script}")
+    string(REGEX REPLACE "FLASH\\(rx\\) : ORIGIN = 0x10000000, LENGTH = [0-9]+[kK]" "${flash}" script "${script}")
+    string(FIND "${script}" "${flash}" achou)
+    if (achou EQUAL -1)
+        message(FATAL_ERROR "Região FLASH não encontrada em ${ROVER_OTA_MEMMAP}")
+    endif()
+    set(saida ${CMAKE_CURRENT_BINARY_DIR}/${alvo}.ld)
+    file(WRITE ${saida} "${script}")
+    pico_set_linker_script(${alvo} ${saida})
+endfunction()
+
+# Imagem do slot 0 (A) ou 1 (B): ligada no endereço do slot e com
+# ROVER_OTA_SLOT para saber qual é o inativo
+function(rover_ota_slot alvo slot)
+    if (slot)
+        rover_ota_memmap(${alvo} 0x10100000 960k)
+    else()
+        rover_ota_memmap(${alvo} 0x10010000 960k)
+    endif()
+    target_compile_definitions(${alvo} PRIVATE ROVER_OTA_SLOT=${slot})
+    target_link_libraries(${alvo} hardware_flash pico_flash)
+endfunction()
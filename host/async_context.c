@@ -0,0 +1,159 @@
+// Laço de eventos do PC no lugar das interrupções do Pico. No firmware o
+// núcleo dorme em __wfe e acorda com a IRQ do cyw43 (rede), a do
+// async_context (workers) e a de GPIO; aqui best_effort_wfe_or_timeout() e
+// sleep_ms() esperam no select dos sockets até o próximo worker de instante
+// e atendem, na ordem: botões simulados, workers vencidos, workers com
+// trabalho pendente e sockets prontos.
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "pico/async_context.h"
+#include "hardware/sync.h"
+#include "host.h"
+
+// Espera máxima por volta: os botões simulados (ROVER_HOST_CAPTURA_MS) não
+// têm socket que acorde o select
+#define HOST_ESPERA_MAX_US 10000u
+
+struct async_context {
+  async_at_time_worker_t *instantes;       // ordenados por next_time
+  async_when_pending_worker_t *pendentes;
+};
+
+static async_context_t contexto_cyw43;
+static bool evento;                        // __sev() desde o último retorno
+static bool atendendo;                     // "IRQ" em andamento: sem reentrada
+
+async_context_t *cyw43_arch_async_context(void) {
+  return &contexto_cyw43;
+}
+
+bool async_context_add_at_time_worker_at(async_context_t *context, async_at_time_worker_t *worker,
+                                         absolute_time_t at) {
+  worker->next_time = at;
+  async_at_time_worker_t **p = &context->instantes;
+  while (*p && (*p)->next_time <= at)
+    p = &(*p)->next;
+  worker->next = *p;
+  *p = worker;
+  return true;
+}
+
+bool async_context_add_at_time_worker_in_ms(async_context_t *context, async_at_time_worker_t *worker,
+                                            uint32_t ms) {
+  return async_context_add_at_time_worker_at(context, worker, make_timeout_time_ms(ms));
+}
+
+bool async_context_remove_at_time_worker(async_context_t *context, async_at_time_worker_t *worker) {
+  for (async_at_time_worker_t **p = &context->instantes; *p; p = &(*p)->next) {
+    if (*p == worker) {
+      *p = worker->next;
+      worker->next = NULL;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool async_context_add_when_pending_worker(async_context_t *context, async_when_pending_worker_t *worker) {
+  worker->next = context->pendentes;
+  context->pendentes = worker;
+  return true;
+}
+
+bool async_context_remove_when_pending_worker(async_context_t *context, async_when_pending_worker_t *worker) {
+  for (async_when_pending_worker_t **p = &context->pendentes; *p; p = &(*p)->next) {
+    if (*p == worker) {
+      *p = worker->next;
+      worker->next = NULL;
+      return true;
+    }
+  }
+  return false;
+}
+
+void async_context_set_work_pending(async_context_t *context, async_when_pending_worker_t *worker) {
+  (void)context;
+  worker->work_pending = true;
+}
+
+void async_context_acquire_lock_blocking(async_context_t *context) { (void)context; }
+void async_context_release_lock(async_context_t *context) { (void)context; }
+
+void __sev(void) {
+  evento = true;
+}
+
+// Roda os workers devidos; retorna quantos rodaram
+static int executar_workers(async_context_t *c) {
+  int n = 0;
+  absolute_time_t agora = get_absolute_time();
+  // Como no SDK, o worker sai da lista antes de rodar e pode se reagendar
+  while (c->instantes && c->instantes->next_time <= agora) {
+    async_at_time_worker_t *w = c->instantes;
+    c->instantes = w->next;
+    w->next = NULL;
+    w->do_work(c, w);
+    n++;
+  }
+  for (async_when_pending_worker_t *w = c->pendentes; w; w = w->next) {
+    if (w->work_pending) {
+      w->work_pending = false;
+      w->do_work(c, w);
+      n++;
+    }
+  }
+  return n;
+}
+
+bool host_atender(absolute_time_t ate) {
+  // Um sleep_ms() dentro de um callback só espera, como uma IRQ que não
+  // interrompe a si mesma
+  if (atendendo) {
+    absolute_time_t agora = get_absolute_time();
+    if (ate > agora)
+      sleep_us(ate - agora);
+    return false;
+  }
+  atendendo = true;
+  host_gpio_poll();
+  int n = executar_workers(&contexto_cyw43);
+
+  absolute_time_t agora = get_absolute_time();
+  absolute_time_t prazo = ate;
+  if (n || evento)
+    prazo = agora;
+  else if (contexto_cyw43.instantes && contexto_cyw43.instantes->next_time < prazo)
+    prazo = contexto_cyw43.instantes->next_time;
+  uint64_t espera = prazo > agora ? prazo - agora : 0;
+  if (espera > HOST_ESPERA_MAX_US)
+    espera = HOST_ESPERA_MAX_US;
+  n += host_net_poll((uint32_t)espera);
+  // Workers pedidos pelos callbacks de rede rodam já, como a IRQ do
+  // contexto logo depois da do cyw43
+  n += executar_workers(&contexto_cyw43);
+  atendendo = false;
+  return n > 0;
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp) {
+  for (;;) {
+    bool atendeu = host_atender(timeout_timestamp);
+    if (evento || atendeu) {
+      evento = false;
+      return false;
+    }
+    if (get_absolute_time() >= timeout_timestamp)
+      return true;
+  }
+}
+
+absolute_time_t make_timeout_time_ms(uint32_t ms) {
+  return get_absolute_time() + (uint64_t)ms * 1000u;
+}
+
+// Como no Pico com o cyw43 em segundo plano, a rede continua durante o sleep
+void sleep_ms(uint32_t ms) {
+  absolute_time_t ate = make_timeout_time_ms(ms);
+  while (get_absolute_time() < ate)
+    host_atender(ate);
+}
@@ -0,0 +1,348 @@
+// Periféricos do Pico no PC: relógio, aleatoriedade, GPIO, ADC, I2C, PWM,
+// PIO, flash e watchdog. Só o que o firmware observa é simulado (tempo,
+// joystick, o botão de captura e a flash); o resto aceita as chamadas e não
+// faz nada.
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "pico/stdlib.h"
+#include "pico/rand.h"
+#include "hardware/adc.h"
+#include "hardware/clocks.h"
+#include "hardware/i2c.h"
+#include "hardware/pwm.h"
+#include "hardware/pio.h"
+#include "hardware/flash.h"
+#include "hardware/watchdog.h"
+#include "pico/flash.h"
+#include "host.h"
+
+// ====== TEMPO ======
+static uint64_t agora_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static uint64_t boot_us;
+
+// Relógio zerado na primeira consulta, como o timer do RP2040 no boot
+uint64_t time_us_64(void) {
+  if (!boot_us)
+    boot_us = agora_us() - 1;
+  return agora_us() - boot_us;
+}
+
+uint32_t time_us_32(void) {
+  return (uint32_t)time_us_64();
+}
+
+absolute_time_t get_absolute_time(void) {
+  return time_us_64();
+}
+
+uint32_t to_ms_since_boot(absolute_time_t t) {
+  return (uint32_t)(t / 1000u);
+}
+
+void sleep_us(uint64_t us) {
+  struct timespec ts = { .tv_sec = (time_t)(us / 1000000u), .tv_nsec = (long)(us % 1000000u) * 1000 };
+  nanosleep(&ts, NULL);
+}
+
+// ====== RELÓGIOS ======
+static uint32_t clk_sys_khz = 125000;
+
+uint32_t clock_get_hz(enum clock_index clk_index) {
+  return clk_index == clk_sys || clk_index == clk_peri ? clk_sys_khz * 1000u
+       : clk_index == clk_usb || clk_index == clk_adc ? 48000000u : 12000000u;
+}
+
+bool set_sys_clock_khz(uint32_t freq_khz, bool required) {
+  (void)required;
+  clk_sys_khz = freq_khz;
+  return true;
+}
+
+bool stdio_init_all(void) {
+  setvbuf(stdout, NULL, _IOLBF, 0);
+  time_us_64();
+  return true;
+}
+
+// ====== ALEATORIEDADE ======
+// xorshift32 semeado pelo relógio e pelo PID (ou ROVER_HOST_SEED para
+// repetir uma execução)
+uint32_t get_rand_32(void) {
+  static uint32_t estado;
+  if (!estado) {
+    const char *semente = getenv("ROVER_HOST_SEED");
+    estado = semente ? (uint32_t)strtoul(semente, NULL, 0)
+                     : (uint32_t)agora_us() ^ ((uint32_t)getpid() << 16);
+    if (!estado)
+      estado = 0x9e3779b9u;
+  }
+  estado ^= estado << 13;
+  estado ^= estado >> 17;
+  estado ^= estado << 5;
+  return estado;
+}
+
+// ====== GPIO ======
+static gpio_irq_callback_t gpio_cb;
+static uint pino_captura;
+static uint32_t captura_intervalo_ms;
+static uint32_t proxima_captura_ms;
+
+void gpio_init(uint gpio) { (void)gpio; }
+void gpio_set_dir(uint gpio, bool out) { (void)gpio; (void)out; }
+void gpio_put(uint gpio, bool value) { (void)gpio; (void)value; }
+bool gpio_get(uint gpio) { (void)gpio; return true; }   // pull-up: solto
+void gpio_pull_up(uint gpio) { (void)gpio; }
+void gpio_set_function(uint gpio, uint fn) { (void)gpio; (void)fn; }
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled) {
+  (void)gpio; (void)events; (void)enabled;
+}
+
+// O primeiro pino registrado com callback é o botão de captura (A); com
+// ROVER_HOST_CAPTURA_MS ele é "pressionado" periodicamente
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled,
+                                        gpio_irq_callback_t callback) {
+  (void)events; (void)enabled;
+  gpio_cb = callback;
+  pino_captura = gpio;
+  const char *intervalo = getenv("ROVER_HOST_CAPTURA_MS");
+  captura_intervalo_ms = intervalo ? (uint32_t)strtoul(intervalo, NULL, 10) : 0;
+  proxima_captura_ms = to_ms_since_boot(get_absolute_time()) + captura_intervalo_ms;
+}
+
+void host_gpio_poll(void) {
+  if (!gpio_cb || !captura_intervalo_ms)
+    return;
+  uint32_t agora = to_ms_since_boot(get_absolute_time());
+  if ((int32_t)(agora - proxima_captura_ms) >= 0) {
+    proxima_captura_ms = agora + captura_intervalo_ms;
+    gpio_cb(pino_captura, GPIO_IRQ_EDGE_FALL);
+  }
+}
+
+// ====== ADC (joystick) ======
+static uint canal_adc;
+static uint16_t eixo_bruto[2] = { 2048, 2048 };
+
+// ROVER_HOST_JOY="x,y" com x, y em -1..1
+void adc_init(void) {
+  const char *joy = getenv("ROVER_HOST_JOY");
+  if (!joy)
+    return;
+  char *fim;
+  float x = strtof(joy, &fim);
+  float y = *fim == ',' ? strtof(fim + 1, NULL) : 0.0f;
+  eixo_bruto[0] = (uint16_t)(2048.0f + (x < -1 ? -1 : x > 1 ? 1 : x) * 2047.0f);
+  eixo_bruto[1] = (uint16_t)(2048.0f + (y < -1 ? -1 : y > 1 ? 1 : y) * 2047.0f);
+}
+
+void adc_gpio_init(uint gpio) { (void)gpio; }
+void adc_select_input(uint input) { canal_adc = input; }
+
+uint16_t adc_read(void) {
+  return canal_adc < 2 ? eixo_bruto[canal_adc] : 0;
+}
+
+// ====== I2C (display) ======
+struct i2c_inst { int id; };
+i2c_inst_t i2c0_inst = { 0 };
+i2c_inst_t i2c1_inst = { 1 };
+uint64_t host_i2c_bytes;
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+  (void)i2c;
+  return baudrate;
+}
+
+uint i2c_set_baudrate(i2c_inst_t *i2c, uint baudrate) {
+  (void)i2c;
+  return baudrate;
+}
+
+// ROVER_HOST_I2C_FALHA=t_ms prende o barramento t ms depois do boot (as
+// escritas estouram o prazo) até o firmware refazer o I2C com i2c_deinit
+static bool i2c_preso;
+static bool i2c_falhou;
+
+void i2c_deinit(i2c_inst_t *i2c) {
+  (void)i2c;
+  if (i2c_preso)
+    printf("[host] I2C solto\n");
+  i2c_preso = false;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+  (void)i2c; (void)addr; (void)src; (void)nostop;
+  host_i2c_bytes += len;
+  return (int)len;
+}
+
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop,
+                         uint timeout_us) {
+  (void)timeout_us;
+  const char *falha = getenv("ROVER_HOST_I2C_FALHA");
+  if (falha && !i2c_falhou && to_ms_since_boot(get_absolute_time()) >= strtoul(falha, NULL, 0)) {
+    i2c_falhou = true;
+    i2c_preso = true;
+    printf("[host] I2C preso (SDA em baixo)\n");
+  }
+  if (i2c_preso)
+    return PICO_ERROR_TIMEOUT;
+  return i2c_write_blocking(i2c, addr, src, len, nostop);
+}
+
+// ====== PWM (LED RGB) ======
+uint pwm_gpio_to_slice_num(uint gpio) { return (gpio >> 1u) & 7u; }
+uint pwm_gpio_to_channel(uint gpio) { return gpio & 1u; }
+void pwm_set_wrap(uint slice, uint16_t wrap) { (void)slice; (void)wrap; }
+void pwm_set_clkdiv(uint slice, float div) { (void)slice; (void)div; }
+void pwm_set_enabled(uint slice, bool enabled) { (void)slice; (void)enabled; }
+void pwm_set_chan_level(uint slice, uint chan, uint16_t level) { (void)slice; (void)chan; (void)level; }
+
+// ====== PIO (matriz WS2812) ======
+struct pio_hw { int id; };
+pio_hw_t pio0_hw = { 0 };
+
+uint pio_add_program(PIO pio, const pio_program_t *program) {
+  (void)pio; (void)program;
+  return 0;
+}
+
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data) {
+  (void)pio; (void)sm; (void)data;
+}
+
+void pio_sm_set_clkdiv(PIO pio, uint sm, float div) {
+  (void)pio; (void)sm; (void)div;
+}
+
+// ====== FLASH ======
+// Apagada (0xFF) antes do main; com ROVER_HOST_FLASH, carregada do arquivo,
+// e cada apagamento ou programação é escrito de volta nele
+uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+static int flash_fd = -1;
+
+__attribute__((constructor))
+static void flash_iniciar(void) {
+  memset(host_flash, 0xFF, sizeof(host_flash));
+  const char *arquivo = getenv("ROVER_HOST_FLASH");
+  if (!arquivo)
+    return;
+  flash_fd = open(arquivo, O_RDWR | O_CREAT, 0644);
+  if (flash_fd < 0) {
+    perror("[host] ROVER_HOST_FLASH");
+    return;
+  }
+  ssize_t n = pread(flash_fd, host_flash, sizeof(host_flash), 0);
+  if (n < (ssize_t)sizeof(host_flash) &&
+      pwrite(flash_fd, host_flash, sizeof(host_flash), 0) != (ssize_t)sizeof(host_flash))
+    perror("[host] ROVER_HOST_FLASH");
+}
+
+static void flash_persistir(uint32_t offset, size_t n) {
+  if (flash_fd >= 0 && pwrite(flash_fd, host_flash + offset, n, offset) != (ssize_t)n)
+    perror("[host] ROVER_HOST_FLASH");
+}
+
+// Desalinhado ou fora da flash é erro de programação: o SDK também não aceita
+static void flash_conferir(uint32_t offset, size_t n, uint32_t alinhamento, const char *funcao) {
+  if (offset % alinhamento || n % alinhamento || offset + n > PICO_FLASH_SIZE_BYTES) {
+    fprintf(stderr, "[host] %s(0x%x, %zu): fora do alinhamento de %u\n", funcao, offset, n, alinhamento);
+    abort();
+  }
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+  flash_conferir(flash_offs, count, FLASH_SECTOR_SIZE, "flash_range_erase");
+  memset(host_flash + flash_offs, 0xFF, count);
+  flash_persistir(flash_offs, count);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count) {
+  flash_conferir(flash_offs, count, FLASH_PAGE_SIZE, "flash_range_program");
+  for (size_t i = 0; i < count; i++)
+    host_flash[flash_offs + i] &= data[i];
+  flash_persistir(flash_offs, count);
+}
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms) {
+  (void)enter_exit_timeout_ms;
+  func(param);
+  return PICO_OK;
+}
+
+// ====== WATCHDOG ======
+// O contador é um SIGALRM armado por watchdog_enable/watchdog_update: um
+// laço travado não o rearma e o processo termina como o RP2040 reiniciaria.
+// Com ROVER_HOST_WATCHDOG=arquivo os registradores de scratch de um reset
+// pelo watchdog passam para a próxima execução (que os consome); sem o
+// arquivo, ou depois de um fim normal, o boot seguinte é como o de energia
+watchdog_hw_t host_watchdog_hw;
+static uint32_t watchdog_ms;
+static bool watchdog_reset;
+
+__attribute__((constructor))
+static void watchdog_iniciar(void) {
+  const char *arquivo = getenv("ROVER_HOST_WATCHDOG");
+  FILE *f = arquivo ? fopen(arquivo, "rb") : NULL;
+  if (!f)
+    return;
+  watchdog_reset = fread((void *)host_watchdog_hw.scratch, sizeof(host_watchdog_hw.scratch), 1, f) == 1;
+  fclose(f);
+  remove(arquivo);
+}
+
+static void watchdog_persistir(void) {
+  const char *arquivo = getenv("ROVER_HOST_WATCHDOG");
+  FILE *f = arquivo ? fopen(arquivo, "wb") : NULL;
+  if (!f)
+    return;
+  fwrite((const void *)host_watchdog_hw.scratch, sizeof(host_watchdog_hw.scratch), 1, f);
+  fclose(f);
+}
+
+static void watchdog_venceu(int sinal) {
+  (void)sinal;
+  static const char msg[] = "[host] watchdog venceu: fim do processo\n";
+  watchdog_persistir();
+  if (write(STDOUT_FILENO, msg, sizeof(msg) - 1) < 0)
+    _exit(1);
+  _exit(1);
+}
+
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug) {
+  (void)pause_on_debug;
+  watchdog_ms = delay_ms;
+  signal(SIGALRM, watchdog_venceu);
+  watchdog_update();
+}
+
+void watchdog_update(void) {
+  struct itimerval t = { .it_value = { .tv_sec = watchdog_ms / 1000u,
+                                       .tv_usec = (suseconds_t)(watchdog_ms % 1000u) * 1000 } };
+  setitimer(ITIMER_REAL, &t, NULL);
+}
+
+bool watchdog_caused_reboot(void) {
+  return watchdog_reset;
+}
+
+void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms) {
+  (void)pc; (void)sp; (void)delay_ms;
+  watchdog_persistir();
+  printf("[host] watchdog_reboot: fim do processo\n");
+  exit(0);
+}
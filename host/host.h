@@ -0,0 +1,19 @@
+#ifndef HOST_H
+#define HOST_H
+
+// Ligações internas do shim de PC (não faz parte da API do SDK)
+#include <stdint.h>
+#include "pico/types.h"
+
+// Dispara os botões simulados pendentes (chamado pelo laço de eventos)
+void host_gpio_poll(void);
+
+// Atende os sockets UDP/TCP prontos, esperando no máximo timeout_us (dorme
+// o prazo inteiro se não houver socket); retorna quantos foram atendidos
+int host_net_poll(uint32_t timeout_us);
+
+// Uma volta do laço de eventos: botões, workers vencidos ou pendentes e
+// sockets, esperando no máximo até `ate`; true se algo foi atendido
+bool host_atender(absolute_time_t ate);
+
+#endif
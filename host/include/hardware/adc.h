@@ -0,0 +1,13 @@
+#ifndef HOST_HARDWARE_ADC_H
+#define HOST_HARDWARE_ADC_H
+
+// ADC simulado: canais 0/1 são os eixos X/Y do joystick, lidos da variável
+// de ambiente ROVER_HOST_JOY="x,y" (-1..1; centro se ausente)
+#include "pico/types.h"
+
+void adc_init(void);
+void adc_gpio_init(uint gpio);
+void adc_select_input(uint input);
+uint16_t adc_read(void);
+
+#endif
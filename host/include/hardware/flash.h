@@ -0,0 +1,19 @@
+#ifndef HOST_HARDWARE_FLASH_H
+#define HOST_HARDWARE_FLASH_H
+
+// Flash QSPI no PC: 2 MB em RAM lidos por XIP_BASE + offset, como no Pico.
+// Programar só zera bits (NOR): sem apagar antes, o conteúdo não confere.
+// Com ROVER_HOST_FLASH=<arquivo> o conteúdo persiste entre execuções.
+#include "pico/types.h"
+
+#define FLASH_PAGE_SIZE        (1u << 8)
+#define FLASH_SECTOR_SIZE      (1u << 12)
+#define PICO_FLASH_SIZE_BYTES  (2u * 1024u * 1024u)
+
+extern uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE ((uintptr_t)host_flash)
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef HOST_HARDWARE_I2C_H
+#define HOST_HARDWARE_I2C_H
+
+// I2C sem barramento: as escritas só são contadas (host_i2c_bytes); com
+// ROVER_HOST_I2C_FALHA o barramento prende até o i2c_deinit
+#include "pico/types.h"
+
+#ifndef PICO_ERROR_TIMEOUT
+#define PICO_ERROR_TIMEOUT (-1)     // pico/error.h
+#endif
+
+typedef struct i2c_inst i2c_inst_t;
+
+extern i2c_inst_t i2c0_inst;
+extern i2c_inst_t i2c1_inst;
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+void i2c_deinit(i2c_inst_t *i2c);
+uint i2c_set_baudrate(i2c_inst_t *i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop,
+                         uint timeout_us);
+
+extern uint64_t host_i2c_bytes;
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef HOST_HARDWARE_IRQ_H
+#define HOST_HARDWARE_IRQ_H
+
+// Sem interrupções reais no PC: os callbacks de GPIO rodam no laço de
+// eventos do shim (veja host/async_context.c)
+#include "pico/types.h"
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef HOST_HARDWARE_PIO_H
+#define HOST_HARDWARE_PIO_H
+
+// PIO sem máquina de estados: os pixels enviados à matriz são descartados
+#include "pico/types.h"
+
+typedef struct pio_hw pio_hw_t;
+typedef pio_hw_t *PIO;
+
+typedef struct pio_program {
+  const uint16_t *instructions;
+  uint8_t length;
+  int8_t origin;
+} pio_program_t;
+
+extern pio_hw_t pio0_hw;
+#define pio0 (&pio0_hw)
+
+uint pio_add_program(PIO pio, const pio_program_t *program);
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
+void pio_sm_set_clkdiv(PIO pio, uint sm, float div);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef HOST_HARDWARE_PWM_H
+#define HOST_HARDWARE_PWM_H
+
+#include "pico/types.h"
+
+uint pwm_gpio_to_slice_num(uint gpio);
+uint pwm_gpio_to_channel(uint gpio);
+void pwm_set_wrap(uint slice, uint16_t wrap);
+void pwm_set_clkdiv(uint slice, float div);
+void pwm_set_enabled(uint slice, bool enabled);
+void pwm_set_chan_level(uint slice, uint chan, uint16_t level);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+// Eventos do núcleo no PC: __sev() marca um evento que faz o próximo (ou o
+// atual) best_effort_wfe_or_timeout() retornar
+#include "pico/types.h"
+
+void __sev(void);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef HOST_HARDWARE_WATCHDOG_H
+#define HOST_HARDWARE_WATCHDOG_H
+
+// Watchdog no PC: o reboot (ou o contador vencido, um SIGALRM) encerra o
+// processo; a flash simulada (ROVER_HOST_FLASH) e os registradores de
+// scratch (ROVER_HOST_WATCHDOG) guardam o estado para a próxima execução
+#include "pico/types.h"
+
+typedef struct {
+  volatile uint32_t scratch[8];
+} watchdog_hw_t;
+
+extern watchdog_hw_t host_watchdog_hw;
+#define watchdog_hw (&host_watchdog_hw)
+
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug);
+void watchdog_update(void);
+bool watchdog_caused_reboot(void);
+void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms);
+
+#endif
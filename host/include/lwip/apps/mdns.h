@@ -0,0 +1,22 @@
+#ifndef HOST_LWIP_APPS_MDNS_H
+#define HOST_LWIP_APPS_MDNS_H
+
+// mDNS no PC só registra o anúncio no stdout (o controlador local é achado
+// pelo DISCOVER em 127.0.0.1)
+#include "lwip/netif.h"
+
+struct mdns_service;
+
+enum mdns_sd_proto { DNSSD_PROTO_UDP = 0, DNSSD_PROTO_TCP = 1 };
+
+typedef void (*service_get_txt_fn_t)(struct mdns_service *service, void *txt_userdata);
+
+void mdns_resp_init(void);
+err_t mdns_resp_add_netif(struct netif *netif, const char *hostname);
+s8_t mdns_resp_add_service(struct netif *netif, const char *name, const char *service,
+                           enum mdns_sd_proto proto, u16_t port,
+                           service_get_txt_fn_t txt_fn, void *txt_userdata);
+err_t mdns_resp_add_service_txtitem(struct mdns_service *service, const char *txt, u8_t txt_len);
+void mdns_resp_announce(struct netif *netif);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef HOST_LWIP_IP4_ADDR_H
+#define HOST_LWIP_IP4_ADDR_H
+
+#include "lwip/arch.h"
+
+// Endereço IPv4 em ordem de rede, como no lwIP
+typedef struct ip4_addr {
+  u32_t addr;
+} ip4_addr_t;
+
+#define IP4_ADDR(ipaddr, a, b, c, d) \
+  ((ipaddr)->addr = host_ip4_make((a), (b), (c), (d)))
+
+u32_t host_ip4_make(u8_t a, u8_t b, u8_t c, u8_t d);
+char *ip4addr_ntoa(const ip4_addr_t *addr);
+
+#endif
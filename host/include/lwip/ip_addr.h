@@ -0,0 +1,20 @@
+#ifndef HOST_LWIP_IP_ADDR_H
+#define HOST_LWIP_IP_ADDR_H
+
+// Só IPv4 (a configuração do firmware não habilita IPv6)
+#include "lwip/ip4_addr.h"
+
+typedef ip4_addr_t ip_addr_t;
+
+extern const ip_addr_t ip_addr_any;
+extern const ip_addr_t ip_addr_broadcast;
+#define IP_ADDR_ANY       (&ip_addr_any)
+#define IP_ADDR_BROADCAST (&ip_addr_broadcast)
+
+#define ip_addr_copy(dest, src) ((dest).addr = (src).addr)
+#define ip_addr_cmp(a, b)       ((a)->addr == (b)->addr)
+
+char *ipaddr_ntoa(const ip_addr_t *addr);
+int ipaddr_aton(const char *cp, ip_addr_t *addr);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef HOST_LWIP_NETIF_H
+#define HOST_LWIP_NETIF_H
+
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+
+struct netif {
+  ip_addr_t ip_addr;
+  ip_addr_t netmask;
+  ip_addr_t gw;
+  u8_t hwaddr[6];
+  const char *hostname;
+};
+
+extern struct netif *netif_default;
+
+void netif_set_addr(struct netif *netif, const ip4_addr_t *ipaddr,
+                    const ip4_addr_t *netmask, const ip4_addr_t *gw);
+#define netif_set_hostname(netif, name) ((netif)->hostname = (name))
+
+// Callbacks de mudança de estado (novo endereço, enlace)
+typedef u16_t netif_nsc_reason_t;
+#define LWIP_NSC_NETIF_ADDED         0x0001
+#define LWIP_NSC_LINK_CHANGED        0x0004
+#define LWIP_NSC_STATUS_CHANGED      0x0008
+#define LWIP_NSC_IPV4_ADDRESS_CHANGED 0x0010
+
+typedef union {
+  struct { u8_t state; } link_changed;
+  struct { u8_t state; } status_changed;
+} netif_ext_callback_args_t;
+
+typedef void (*netif_ext_callback_fn)(struct netif *netif, netif_nsc_reason_t reason,
+                                      const netif_ext_callback_args_t *args);
+
+typedef struct netif_ext_callback {
+  netif_ext_callback_fn callback_fn;
+  struct netif_ext_callback *next;
+} netif_ext_callback_t;
+
+#define NETIF_DECLARE_EXT_CALLBACK(name) static netif_ext_callback_t name;
+void netif_add_ext_callback(netif_ext_callback_t *callback, netif_ext_callback_fn fn);
+
+#endif
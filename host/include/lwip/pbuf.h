@@ -0,0 +1,23 @@
+#ifndef HOST_LWIP_PBUF_H
+#define HOST_LWIP_PBUF_H
+
+// Cada pbuf é um bloco só (cabeçalho e dados); cadeias só por pbuf_cat
+#include "lwip/arch.h"
+
+typedef enum { PBUF_TRANSPORT = 74, PBUF_IP = 54, PBUF_LINK = 14, PBUF_RAW = 0 } pbuf_layer;
+typedef enum { PBUF_RAM = 0x280, PBUF_ROM = 0x01, PBUF_REF = 0x41, PBUF_POOL = 0x182 } pbuf_type;
+
+struct pbuf {
+  struct pbuf *next;
+  void *payload;
+  u16_t tot_len;
+  u16_t len;
+  u16_t type_internal;   // PBUF_RAM (heap do lwIP) ou PBUF_POOL
+};
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type);
+u8_t pbuf_free(struct pbuf *p);
+u16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, u16_t len, u16_t offset);
+void pbuf_cat(struct pbuf *head, struct pbuf *tail);
+
+#endif
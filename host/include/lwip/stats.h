@@ -0,0 +1,40 @@
+#ifndef HOST_LWIP_STATS_H
+#define HOST_LWIP_STATS_H
+
+// Estatísticas de memória do lwIP (MEM_STATS/MEMP_STATS). No PC, host/net.c
+// conta pcbs e pbufs com os mesmos limites do lwipopts.h e recusa alocações
+// acima deles, como o lwIP faria.
+#include "lwip/arch.h"
+
+#define LWIP_STATS  1
+#define MEM_STATS   1
+#define MEMP_STATS  1
+
+typedef u16_t mem_size_t;
+
+typedef enum {
+  MEMP_UDP_PCB,
+  MEMP_TCP_PCB,
+  MEMP_TCP_PCB_LISTEN,
+  MEMP_TCP_SEG,
+  MEMP_PBUF_POOL,
+  MEMP_MAX
+} memp_t;
+
+struct stats_mem {
+  const char *name;
+  u16_t err;
+  mem_size_t avail;
+  mem_size_t used;
+  mem_size_t max;
+  u16_t illegal;
+};
+
+struct stats_ {
+  struct stats_mem mem;
+  struct stats_mem *memp[MEMP_MAX];
+};
+
+extern struct stats_ lwip_stats;
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef HOST_PICO_ASYNC_CONTEXT_H
+#define HOST_PICO_ASYNC_CONTEXT_H
+
+// async_context do Pico SDK no PC: um único contexto (o do cyw43), cujos
+// workers rodam dentro de best_effort_wfe_or_timeout() e sleep_ms() junto
+// com os sockets (host/async_context.c). A trava é um no-op: só há uma
+// thread.
+#include "pico/types.h"
+
+typedef struct async_context async_context_t;
+
+// Worker de instante: roda uma vez em next_time e sai da lista (reagende
+// dentro de do_work para repetir)
+typedef struct async_work_on_timeout {
+  struct async_work_on_timeout *next;
+  void (*do_work)(async_context_t *context, struct async_work_on_timeout *timeout);
+  absolute_time_t next_time;
+  void *user_data;
+} async_at_time_worker_t;
+
+// Worker de evento: roda depois de async_context_set_work_pending()
+typedef struct async_when_pending_worker {
+  struct async_when_pending_worker *next;
+  void (*do_work)(async_context_t *context, struct async_when_pending_worker *worker);
+  bool work_pending;
+  void *user_data;
+} async_when_pending_worker_t;
+
+bool async_context_add_at_time_worker_at(async_context_t *context, async_at_time_worker_t *worker,
+                                         absolute_time_t at);
+bool async_context_add_at_time_worker_in_ms(async_context_t *context, async_at_time_worker_t *worker,
+                                            uint32_t ms);
+bool async_context_remove_at_time_worker(async_context_t *context, async_at_time_worker_t *worker);
+bool async_context_add_when_pending_worker(async_context_t *context, async_when_pending_worker_t *worker);
+bool async_context_remove_when_pending_worker(async_context_t *context, async_when_pending_worker_t *worker);
+void async_context_set_work_pending(async_context_t *context, async_when_pending_worker_t *worker);
+void async_context_acquire_lock_blocking(async_context_t *context);
+void async_context_release_lock(async_context_t *context);
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef HOST_PICO_CYW43_ARCH_H
+#define HOST_PICO_CYW43_ARCH_H
+
+// Wi-Fi do Pico W no PC: o "rádio" é a interface de loopback. As funções
+// de AP/STA só registram a transição. Os sockets (host/net.c), os botões
+// simulados (host/hardware.c) e os workers do contexto são atendidos
+// enquanto o firmware dorme (host/async_context.c) ou em cyw43_arch_poll().
+#include "pico/types.h"
+#include "pico/async_context.h"
+#include "lwip/netif.h"
+
+#define CYW43_ITF_STA 0
+#define CYW43_ITF_AP  1
+
+// cyw43_tcpip_link_status()
+#define CYW43_LINK_DOWN    0
+#define CYW43_LINK_JOIN    1
+#define CYW43_LINK_NOIP    2
+#define CYW43_LINK_UP      3
+#define CYW43_LINK_FAIL    (-1)
+#define CYW43_LINK_NONET   (-2)
+#define CYW43_LINK_BADAUTH (-3)
+
+#define CYW43_AUTH_OPEN         0
+#define CYW43_AUTH_WPA_TKIP_PSK 0x00200002
+#define CYW43_AUTH_WPA2_AES_PSK 0x00400004
+#define CYW43_AUTH_WPA2_MIXED_PSK 0x00400006
+
+// Modos de economia do rádio, na codificação de cyw43_pm_value()
+#define cyw43_pm_value(modo, pm2_ms, li_beacon, li_dtim, li_assoc) \
+  ((li_assoc) << 20 | (li_dtim) << 16 | (li_beacon) << 12 | ((pm2_ms) / 10) << 4 | (modo))
+#define CYW43_NONE_PM          cyw43_pm_value(0, 10, 0, 0, 0)
+#define CYW43_DEFAULT_PM       cyw43_pm_value(2, 200, 1, 1, 10)
+#define CYW43_AGGRESSIVE_PM    cyw43_pm_value(2, 2000, 1, 1, 10)
+#define CYW43_PERFORMANCE_PM   cyw43_pm_value(2, 20, 1, 1, 1)
+
+typedef struct {
+  struct netif netif[2];   // [0] STA, [1] AP
+} cyw43_t;
+
+extern cyw43_t cyw43_state;
+
+// Varredura: só os campos que o firmware lê (o SDK tem outros no meio)
+typedef struct {
+  uint8_t bssid[6];
+  uint8_t ssid_len;
+  uint8_t ssid[32];
+  uint16_t channel;
+  uint8_t auth_mode;        // bit 0 WEP, 1 WPA, 2 WPA2
+  int16_t rssi;
+} cyw43_ev_scan_result_t;
+
+typedef struct {
+  uint32_t ssid_len;
+  uint8_t ssid[32];
+  int8_t scan_type;         // 0 ativa, 1 passiva
+} cyw43_wifi_scan_options_t;
+
+int cyw43_arch_init(void);
+void cyw43_arch_deinit(void);
+void cyw43_arch_poll(void);
+async_context_t *cyw43_arch_async_context(void);
+
+// Uma só thread: a trava do lwIP não tem o que excluir
+static inline void cyw43_arch_lwip_begin(void) {}
+static inline void cyw43_arch_lwip_end(void) {}
+void cyw43_arch_enable_ap_mode(const char *ssid, const char *password, uint32_t auth);
+void cyw43_arch_disable_ap_mode(void);
+void cyw43_arch_enable_sta_mode(void);
+void cyw43_arch_disable_sta_mode(void);
+
+// Associação com as redes de ROVER_HOST_REDES (host/net.c): a senha não é
+// conferida e o enlace cai se a rede sair do ar (lista em @arquivo)
+int cyw43_arch_wifi_connect_timeout_ms(const char *ssid, const char *pw, uint32_t auth, uint32_t timeout);
+int cyw43_arch_wifi_connect_bssid_timeout_ms(const char *ssid, const uint8_t *bssid, const char *pw,
+                                             uint32_t auth, uint32_t timeout);
+int cyw43_arch_wifi_connect_async(const char *ssid, const char *pw, uint32_t auth);
+int cyw43_arch_wifi_connect_bssid_async(const char *ssid, const uint8_t *bssid, const char *pw, uint32_t auth);
+int cyw43_wifi_leave(cyw43_t *self, int itf);
+int cyw43_wifi_get_bssid(cyw43_t *self, uint8_t bssid[6]);
+int cyw43_tcpip_link_status(cyw43_t *self, int itf);
+
+// RSSI da rede associada (ROVER_HOST_RSSI fixa um valor)
+int cyw43_wifi_get_rssi(cyw43_t *self, int32_t *rssi);
+
+// Varredura simulada: depois de ~1 s entrega as redes de ROVER_HOST_REDES
+// ("ssid:rssi:canal:seg,...", seg = aberta|wep|wpa|wpa2|misto) ou uma
+// lista fixa com SSID repetido e rede oculta; -1 se já há uma em curso
+int cyw43_wifi_scan(cyw43_t *self, cyw43_wifi_scan_options_t *opts, void *env,
+                    int (*result_cb)(void *, const cyw43_ev_scan_result_t *));
+bool cyw43_wifi_scan_active(cyw43_t *self);
+
+// Só registra o modo pedido (não há rádio para dormir)
+int cyw43_wifi_pm(cyw43_t *self, uint32_t pm);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef HOST_PICO_FLASH_H
+#define HOST_PICO_FLASH_H
+
+// Sem XIP nem segundo núcleo no PC: a função roda direto
+#include "pico/types.h"
+
+#define PICO_OK 0
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+// Subconjunto de pico/stdlib.h usado pelo firmware: tempo, sleep e stdio.
+// O relógio é CLOCK_MONOTONIC do processo. Como no Pico, a rede e os
+// workers do async_context continuam rodando durante sleep_ms() e
+// best_effort_wfe_or_timeout() (host/async_context.c).
+#include <stdio.h>
+#include "pico/types.h"
+#include "hardware/gpio.h"
+
+absolute_time_t get_absolute_time(void);
+uint32_t to_ms_since_boot(absolute_time_t t);
+uint32_t time_us_32(void);
+uint64_t time_us_64(void);
+absolute_time_t make_timeout_time_ms(uint32_t ms);
+void sleep_ms(uint32_t ms);
+void sleep_us(uint64_t us);
+bool stdio_init_all(void);
+
+// Dorme até um evento (__sev, worker ou socket atendido) ou até o instante;
+// true se o prazo venceu
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef HOST_PICO_TYPES_H
+#define HOST_PICO_TYPES_H
+
+// Tipos básicos do Pico SDK para o build de PC (host/)
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;   // microssegundos desde o boot
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef HOST_WS2812_PIO_H
+#define HOST_WS2812_PIO_H
+
+// Substitui o cabeçalho gerado de ws2812.pio no build de PC
+#include "hardware/pio.h"
+
+#define ws2812_T1 3
+#define ws2812_T2 3
+#define ws2812_T3 4
+
+static const uint16_t ws2812_program_instructions[] = { 0 };
+
+static const struct pio_program ws2812_program = {
+  .instructions = ws2812_program_instructions,
+  .length = 1,
+  .origin = -1,
+};
+
+static inline void ws2812_program_init(PIO pio, uint sm, uint offset, uint pin, float freq, bool rgbw) {
+  (void)pio; (void)sm; (void)offset; (void)pin; (void)freq; (void)rgbw;
+}
+
+#endif
@@ -0,0 +1,884 @@
+// Rede do Pico W no PC: a API raw do lwIP (UDP, TCP, pbuf, netif, mDNS) e o
+// cyw43_arch sobre sockets BSD. Os sockets são atendidos pelo laço de
+// eventos do shim (host/async_context.c) enquanto o firmware dorme, no
+// lugar da IRQ do cyw43; os callbacks rodam na mesma thread do firmware.
+//
+// Variáveis de ambiente:
+//   ROVER_HTTP_PORT   porta do portal no lugar da 80 (padrão 8880)
+//   ROVER_SSID        se definida, o portal recebe um POST /save com
+//   ROVER_PASSWORD    estas credenciais sem precisar de navegador
+//   ROVER_HOST_RSSI   RSSI fixo em cyw43_wifi_get_rssi (padrão: o da rede
+//                     associada na lista de ROVER_HOST_REDES, ou -50)
+//   ROVER_HOST_REDES  redes no ar (ssid:rssi:canal:seg,...) ou @arquivo com
+//                     a lista, relido a cada consulta
+#define _DEFAULT_SOURCE
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+#include "pico/stdlib.h"
+#include "pico/cyw43_arch.h"
+#include "pico/rand.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "lwip/tcp.h"
+#include "lwip/netif.h"
+#include "lwip/apps/mdns.h"
+#include "lwip/stats.h"
+#include "host.h"
+
+// Limites do firmware (perfil ROVER_LWIP_PERFIL): pools, heap e TCP_SND_BUF
+#include "lwipopts.h"
+
+#define HOST_MTU 1500
+
+// ====== ENDEREÇOS ======
+const ip_addr_t ip_addr_any = { 0 };
+const ip_addr_t ip_addr_broadcast = { 0xffffffffu };
+
+u32_t host_ip4_make(u8_t a, u8_t b, u8_t c, u8_t d) {
+  return htonl(((u32_t)a << 24) | ((u32_t)b << 16) | ((u32_t)c << 8) | d);
+}
+
+char *ipaddr_ntoa(const ip_addr_t *addr) {
+  static char buf[INET_ADDRSTRLEN];
+  struct in_addr in = { .s_addr = addr->addr };
+  return (char *)inet_ntop(AF_INET, &in, buf, sizeof(buf));
+}
+
+char *ip4addr_ntoa(const ip4_addr_t *addr) {
+  return ipaddr_ntoa(addr);
+}
+
+int ipaddr_aton(const char *cp, ip_addr_t *addr) {
+  struct in_addr in;
+  if (inet_pton(AF_INET, cp, &in) != 1)
+    return 0;
+  addr->addr = in.s_addr;
+  return 1;
+}
+
+static struct sockaddr_in para_sockaddr(const ip_addr_t *ip, u16_t porta) {
+  struct sockaddr_in sa = { .sin_family = AF_INET, .sin_port = htons(porta) };
+  sa.sin_addr.s_addr = ip ? ip->addr : INADDR_ANY;
+  return sa;
+}
+
+// ====== ESTATÍSTICAS ======
+// Mesmos limites do lwipopts.h
+static struct stats_mem memp_stats[MEMP_MAX] = {
+  [MEMP_UDP_PCB]        = { .name = "UDP_PCB",        .avail = MEMP_NUM_UDP_PCB },
+  [MEMP_TCP_PCB]        = { .name = "TCP_PCB",        .avail = MEMP_NUM_TCP_PCB },
+  [MEMP_TCP_PCB_LISTEN] = { .name = "TCP_PCB_LISTEN", .avail = MEMP_NUM_TCP_PCB_LISTEN },
+  [MEMP_TCP_SEG]        = { .name = "TCP_SEG",        .avail = MEMP_NUM_TCP_SEG },
+  [MEMP_PBUF_POOL]      = { .name = "PBUF_POOL",      .avail = PBUF_POOL_SIZE },
+};
+
+struct stats_ lwip_stats = {
+  .mem = { .name = "MEM", .avail = MEM_SIZE },
+  .memp = {
+    [MEMP_UDP_PCB]        = &memp_stats[MEMP_UDP_PCB],
+    [MEMP_TCP_PCB]        = &memp_stats[MEMP_TCP_PCB],
+    [MEMP_TCP_PCB_LISTEN] = &memp_stats[MEMP_TCP_PCB_LISTEN],
+    [MEMP_TCP_SEG]        = &memp_stats[MEMP_TCP_SEG],
+    [MEMP_PBUF_POOL]      = &memp_stats[MEMP_PBUF_POOL],
+  },
+};
+
+static bool stats_alocar(struct stats_mem *s, u16_t n) {
+  if (s->used + n > s->avail) {
+    s->err++;
+    return false;
+  }
+  s->used += n;
+  if (s->used > s->max)
+    s->max = s->used;
+  return true;
+}
+
+static void stats_liberar(struct stats_mem *s, u16_t n) {
+  s->used -= n;
+}
+
+// Custo aproximado de um pbuf PBUF_RAM no heap do lwIP: cabeçalho do heap,
+// struct pbuf e os cabeçalhos da camada, alinhados a 4
+static u16_t custo_heap(u16_t len) {
+  return (u16_t)((len + PBUF_TRANSPORT + 24 + 3) & ~3u);
+}
+
+static u16_t pbuf_custo_heap(struct pbuf *p) {
+  return custo_heap(p->len);
+}
+
+// ====== PBUF ======
+// PBUF_POOL ocupa um elemento do pool (como a recepção do cyw43); os demais
+// tipos vêm do heap do lwIP
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type) {
+  (void)layer;
+  struct pbuf *p = malloc(sizeof(struct pbuf) + length);
+  if (!p)
+    return NULL;
+  p->next = NULL;
+  p->payload = p + 1;
+  p->tot_len = p->len = length;
+  p->type_internal = type == PBUF_POOL ? PBUF_POOL : PBUF_RAM;
+  bool ok = type == PBUF_POOL ? stats_alocar(lwip_stats.memp[MEMP_PBUF_POOL], 1)
+                              : stats_alocar(&lwip_stats.mem, pbuf_custo_heap(p));
+  if (!ok) {
+    free(p);
+    return NULL;
+  }
+  return p;
+}
+
+// Como no lwIP (referência única), libera a cadeia inteira; NULL é erro,
+// como o LWIP_ASSERT("p != NULL") do pbuf_free original
+u8_t pbuf_free(struct pbuf *p) {
+  assert(p != NULL);
+  u8_t n = 0;
+  while (p) {
+    struct pbuf *prox = p->next;
+    if (p->type_internal == PBUF_POOL)
+      stats_liberar(lwip_stats.memp[MEMP_PBUF_POOL], 1);
+    else
+      stats_liberar(&lwip_stats.mem, pbuf_custo_heap(p));
+    free(p);
+    p = prox;
+    n++;
+  }
+  return n;
+}
+
+void pbuf_cat(struct pbuf *head, struct pbuf *tail) {
+  struct pbuf *p = head;
+  for (; p->next; p = p->next)
+    p->tot_len += tail->tot_len;
+  p->tot_len += tail->tot_len;
+  p->next = tail;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, u16_t len, u16_t offset) {
+  u16_t copiado = 0;
+  for (; p && copiado < len; p = p->next) {
+    if (offset >= p->len) {
+      offset -= p->len;
+      continue;
+    }
+    u16_t n = p->len - offset < len - copiado ? p->len - offset : len - copiado;
+    memcpy((u8_t *)dataptr + copiado, (const u8_t *)p->payload + offset, n);
+    copiado += n;
+    offset = 0;
+  }
+  return copiado;
+}
+
+// ====== UDP ======
+struct udp_pcb {
+  int fd;
+  udp_recv_fn recv;
+  void *arg;
+  struct udp_pcb *prox;
+};
+
+static struct udp_pcb *udp_pcbs;
+
+struct udp_pcb *udp_new(void) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0)
+    return NULL;
+  int um = 1;
+  setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &um, sizeof(um));
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &um, sizeof(um));
+
+  struct udp_pcb *pcb = calloc(1, sizeof(*pcb));
+  if (!pcb || !stats_alocar(lwip_stats.memp[MEMP_UDP_PCB], 1)) {
+    free(pcb);
+    close(fd);
+    return NULL;
+  }
+  pcb->fd = fd;
+  pcb->prox = udp_pcbs;
+  udp_pcbs = pcb;
+  return pcb;
+}
+
+void udp_remove(struct udp_pcb *pcb) {
+  for (struct udp_pcb **pp = &udp_pcbs; *pp; pp = &(*pp)->prox) {
+    if (*pp == pcb) {
+      *pp = pcb->prox;
+      break;
+    }
+  }
+  close(pcb->fd);
+  stats_liberar(lwip_stats.memp[MEMP_UDP_PCB], 1);
+  free(pcb);
+}
+
+err_t udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port) {
+  struct sockaddr_in sa = para_sockaddr(ipaddr, port);
+  if (bind(pcb->fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+    printf("[host] udp_bind(%u): %s\n", port, strerror(errno));
+    return ERR_USE;
+  }
+  return ERR_OK;
+}
+
+void udp_recv(struct udp_pcb *pcb, udp_recv_fn recv, void *recv_arg) {
+  pcb->recv = recv;
+  pcb->arg = recv_arg;
+}
+
+err_t udp_sendto(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip, u16_t dst_port) {
+  struct sockaddr_in sa = para_sockaddr(dst_ip, dst_port);
+  if (sendto(pcb->fd, p->payload, p->len, 0, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+    return errno == ENOBUFS || errno == EAGAIN ? ERR_MEM : ERR_RTE;
+  return ERR_OK;
+}
+
+static void udp_atender(struct udp_pcb *pcb) {
+  u8_t buf[HOST_MTU];
+  struct sockaddr_in origem;
+  socklen_t tam = sizeof(origem);
+  ssize_t n = recvfrom(pcb->fd, buf, sizeof(buf), 0, (struct sockaddr *)&origem, &tam);
+  if (n < 0 || !pcb->recv)
+    return;
+
+  struct pbuf *p = pbuf_alloc(PBUF_RAW, (u16_t)n, PBUF_POOL);
+  if (!p)
+    return;
+  memcpy(p->payload, buf, (size_t)n);
+  ip_addr_t addr = { origem.sin_addr.s_addr };
+  pcb->recv(pcb->arg, pcb, p, &addr, ntohs(origem.sin_port));
+}
+
+// ====== TCP ======
+struct tcp_pcb {
+  int fd;                 // -1 na conexão virtual do ROVER_SSID
+  bool escuta;
+  bool fechado;           // liberado ao fim do poll (pode estar num callback)
+  void *arg;
+  tcp_accept_fn accept;
+  tcp_recv_fn recv;
+  tcp_sent_fn sent;
+  tcp_err_fn err;
+  u32_t enviado;          // bytes entregues ao kernel ainda não avisados por sent
+  u16_t fila_segs;        // segmentos (TCP_SEG) e heap que o lwIP manteria
+  u16_t fila_mem;         // até o ACK, liberados junto com o aviso de sent
+  u32_t janela;           // recepção: entregue sem tcp_recved fecha a janela
+  struct tcp_pcb *prox;
+};
+
+static struct tcp_pcb *tcp_pcbs;
+static bool autoconfig_feita;
+
+static struct tcp_pcb *tcp_alocar(int fd) {
+  struct tcp_pcb *pcb = calloc(1, sizeof(*pcb));
+  if (!pcb || !stats_alocar(lwip_stats.memp[MEMP_TCP_PCB], 1)) {
+    free(pcb);
+    return NULL;
+  }
+  pcb->fd = fd;
+  pcb->janela = TCP_WND;
+  pcb->prox = tcp_pcbs;
+  tcp_pcbs = pcb;
+  return pcb;
+}
+
+struct tcp_pcb *tcp_new(void) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+    return NULL;
+  int um = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &um, sizeof(um));
+  struct tcp_pcb *pcb = tcp_alocar(fd);
+  if (!pcb)
+    close(fd);
+  return pcb;
+}
+
+err_t tcp_bind(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port) {
+  // Portas privilegiadas exigiriam root: o portal vai para ROVER_HTTP_PORT
+  if (port < 1024) {
+    const char *env = getenv("ROVER_HTTP_PORT");
+    u16_t nova = env ? (u16_t)atoi(env) : 8880;
+    printf("[host] porta TCP %u -> %u\n", port, nova);
+    port = nova;
+  }
+  struct sockaddr_in sa = para_sockaddr(ipaddr, port);
+  if (bind(pcb->fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+    printf("[host] tcp_bind(%u): %s\n", port, strerror(errno));
+    return ERR_USE;
+  }
+  return ERR_OK;
+}
+
+struct tcp_pcb *tcp_listen(struct tcp_pcb *pcb) {
+  if (listen(pcb->fd, 4) < 0)
+    return NULL;
+  // Como no lwIP, o pcb em escuta sai de outro pool
+  stats_liberar(lwip_stats.memp[MEMP_TCP_PCB], 1);
+  stats_alocar(lwip_stats.memp[MEMP_TCP_PCB_LISTEN], 1);
+  pcb->escuta = true;
+  return pcb;
+}
+
+void tcp_arg(struct tcp_pcb *pcb, void *arg) { pcb->arg = arg; }
+void tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept) { pcb->accept = accept; }
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv) { pcb->recv = recv; }
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent) { pcb->sent = sent; }
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err) { pcb->err = err; }
+void tcp_recved(struct tcp_pcb *pcb, u16_t len) {
+  pcb->janela = pcb->janela + len > TCP_WND ? TCP_WND : pcb->janela + len;
+}
+
+u16_t tcp_sndbuf(const struct tcp_pcb *pcb) {
+  return pcb->enviado >= TCP_SND_BUF ? 0 : (u16_t)(TCP_SND_BUF - pcb->enviado);
+}
+
+static void tcp_liberar_fila(struct tcp_pcb *pcb) {
+  stats_liberar(lwip_stats.memp[MEMP_TCP_SEG], pcb->fila_segs);
+  stats_liberar(&lwip_stats.mem, pcb->fila_mem);
+  pcb->fila_segs = pcb->fila_mem = 0;
+}
+
+// Sem fila própria: os dados vão direto ao kernel (tcp_output é no-op). A
+// conta de pools é a do pior caso do lwIP: um segmento por chamada (ou por
+// MSS) e, com TCP_WRITE_FLAG_COPY, a cópia no heap, presos até o "ACK"
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags) {
+  if (pcb->fechado)
+    return ERR_CLSD;
+  if (len > tcp_sndbuf(pcb))
+    return ERR_MEM;
+  u16_t segs = (u16_t)((len + TCP_MSS - 1) / TCP_MSS);
+  // Limite por conexão do lwIP: recusa antes de tocar no pool
+  if (pcb->fila_segs + segs > TCP_SND_QUEUELEN)
+    return ERR_MEM;
+  u16_t mem = (apiflags & TCP_WRITE_FLAG_COPY) ? (u16_t)(custo_heap(0) * segs + len) : 0;
+  if (!stats_alocar(lwip_stats.memp[MEMP_TCP_SEG], segs))
+    return ERR_MEM;
+  if (mem && !stats_alocar(&lwip_stats.mem, mem)) {
+    stats_liberar(lwip_stats.memp[MEMP_TCP_SEG], segs);
+    return ERR_MEM;
+  }
+  pcb->fila_segs += segs;
+  pcb->fila_mem += mem;
+  if (pcb->fd >= 0) {
+    const u8_t *dados = dataptr;
+    size_t falta = len;
+    while (falta) {
+      ssize_t n = send(pcb->fd, dados, falta, MSG_NOSIGNAL);
+      if (n < 0)
+        return ERR_CONN;
+      dados += n;
+      falta -= (size_t)n;
+    }
+  }
+  pcb->enviado += len;
+  return ERR_OK;
+}
+
+err_t tcp_output(struct tcp_pcb *pcb) {
+  (void)pcb;
+  return ERR_OK;
+}
+
+err_t tcp_close(struct tcp_pcb *pcb) {
+  if (!pcb->fechado) {
+    if (pcb->fd >= 0)
+      close(pcb->fd);
+    pcb->fd = -1;
+    pcb->fechado = true;
+  }
+  return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb *pcb) {
+  tcp_close(pcb);
+  if (pcb->err)
+    pcb->err(pcb->arg, ERR_ABRT);
+}
+
+// Nova conexão: herda arg do pcb em escuta e passa pelo accept do firmware
+static struct tcp_pcb *tcp_aceitar(struct tcp_pcb *escuta, int fd) {
+  struct tcp_pcb *nova = tcp_alocar(fd);
+  if (!nova) {
+    if (fd >= 0)
+      close(fd);
+    return NULL;
+  }
+  nova->arg = escuta->arg;
+  if (escuta->accept(escuta->arg, nova, ERR_OK) != ERR_OK) {
+    tcp_abort(nova);
+    return NULL;
+  }
+  return nova;
+}
+
+static void tcp_entregar(struct tcp_pcb *pcb, const void *dados, size_t len) {
+  if (!pcb->recv) {
+    tcp_close(pcb);
+    return;
+  }
+  if (!len) {
+    pcb->recv(pcb->arg, pcb, NULL, ERR_OK);   // FIN do outro lado
+    return;
+  }
+  struct pbuf *p = pbuf_alloc(PBUF_RAW, (u16_t)len, PBUF_POOL);
+  if (!p)
+    return;
+  memcpy(p->payload, dados, len);
+  pcb->janela -= len < pcb->janela ? len : pcb->janela;
+  pcb->recv(pcb->arg, pcb, p, ERR_OK);
+}
+
+static void tcp_atender(struct tcp_pcb *pcb) {
+  if (pcb->escuta) {
+    int fd = accept(pcb->fd, NULL, NULL);
+    if (fd >= 0 && pcb->accept)
+      tcp_aceitar(pcb, fd);
+    else if (fd >= 0)
+      close(fd);
+    return;
+  }
+
+  // Só o que cabe na janela de recepção: o resto espera no kernel
+  u8_t buf[TCP_MSS];
+  size_t max = pcb->janela < sizeof(buf) ? pcb->janela : sizeof(buf);
+  ssize_t n = recv(pcb->fd, buf, max, 0);
+  if (n < 0) {
+    // Conexão resetada: como no lwIP, o pcb já não existe quando err é chamado
+    tcp_close(pcb);
+    if (pcb->err)
+      pcb->err(pcb->arg, ERR_RST);
+    return;
+  }
+  tcp_entregar(pcb, buf, (size_t)n);
+}
+
+// Formulário do portal enviado "pelo usuário" a partir de ROVER_SSID
+static void tcp_autoconfig(void) {
+  const char *ssid = getenv("ROVER_SSID");
+  if (autoconfig_feita || !ssid)
+    return;
+
+  for (struct tcp_pcb *pcb = tcp_pcbs; pcb; pcb = pcb->prox) {
+    if (!pcb->escuta || pcb->fechado || !pcb->accept)
+      continue;
+    autoconfig_feita = true;
+
+    const char *senha = getenv("ROVER_PASSWORD");
+    char corpo[128];
+    int len_corpo = snprintf(corpo, sizeof(corpo), "ssid=%s&password=%s", ssid, senha ? senha : "");
+    for (char *c = corpo; *c; c++) {
+      if (*c == ' ')
+        *c = '+';
+    }
+    char req[512];
+    int len = snprintf(req, sizeof(req),
+                       "POST /save HTTP/1.1\r\n"
+                       "Host: 192.168.4.1\r\n"
+                       "Content-Type: application/x-www-form-urlencoded\r\n"
+                       "Content-Length: %d\r\n"
+                       "\r\n"
+                       "%s",
+                       len_corpo, corpo);
+    printf("[host] enviando credenciais de ROVER_SSID ao portal\n");
+    struct tcp_pcb *virtual = tcp_aceitar(pcb, -1);
+    if (virtual && !virtual->fechado)
+      tcp_entregar(virtual, req, (size_t)len);
+    return;
+  }
+}
+
+// Avisa o firmware dos bytes "confirmados" e libera os pcbs fechados
+static void tcp_finalizar(void) {
+  for (struct tcp_pcb *pcb = tcp_pcbs; pcb; pcb = pcb->prox) {
+    while (!pcb->fechado && pcb->sent && pcb->enviado) {
+      u16_t n = pcb->enviado > 0xffff ? 0xffff : (u16_t)pcb->enviado;
+      pcb->enviado -= n;
+      tcp_liberar_fila(pcb);
+      pcb->sent(pcb->arg, pcb, n);
+    }
+    if (!pcb->sent) {
+      pcb->enviado = 0;
+      tcp_liberar_fila(pcb);
+    }
+  }
+  for (struct tcp_pcb **pp = &tcp_pcbs; *pp;) {
+    struct tcp_pcb *pcb = *pp;
+    if (pcb->fechado) {
+      *pp = pcb->prox;
+      stats_liberar(lwip_stats.memp[pcb->escuta ? MEMP_TCP_PCB_LISTEN : MEMP_TCP_PCB], 1);
+      tcp_liberar_fila(pcb);
+      free(pcb);
+    } else {
+      pp = &pcb->prox;
+    }
+  }
+}
+
+// ====== AR SIMULADO (varredura e associação) ======
+// As redes "no ar" vêm de ROVER_HOST_REDES (ou de uma lista fixa com SSID
+// repetido e rede oculta); com "@arquivo", o arquivo é relido a cada
+// consulta e pode mudar com o firmware rodando (mudança de laboratório,
+// queda do AP). O BSSID é a posição na lista.
+#define HOST_VARREDURA_US  1000000u
+#define HOST_ASSOCIAR_US   300000u
+#define HOST_REDES_MAX     16
+#define HOST_REDES_PADRAO  "lab:-48:6:wpa2,lab:-63:11:wpa2,cafe:-71:1:aberta,:-60:6:wpa2,vizinho:-82:6:misto"
+
+static int (*varredura_cb)(void *, const cyw43_ev_scan_result_t *);
+static void *varredura_env;
+static absolute_time_t varredura_fim;
+
+// Associação da STA: SSID/BSSID e, durante a conexão assíncrona, o fim dela
+static bool assoc_ativa;
+static char assoc_ssid[33];
+static uint8_t assoc_bssid[6];
+static absolute_time_t assoc_fim;
+
+static bool redes_de_arquivo(void) {
+  const char *env = getenv("ROVER_HOST_REDES");
+  return env && env[0] == '@';
+}
+
+// Redes no ar agora; retorna quantas
+static int redes_no_ar(cyw43_ev_scan_result_t *redes, int max) {
+  const char *env = getenv("ROVER_HOST_REDES");
+  char lista[512] = "";
+  if (redes_de_arquivo()) {
+    FILE *f = fopen(env + 1, "r");
+    if (f) {
+      size_t n = fread(lista, 1, sizeof(lista) - 1, f);
+      lista[n] = '\0';
+      fclose(f);
+    }
+  } else {
+    snprintf(lista, sizeof(lista), "%s", env ? env : HOST_REDES_PADRAO);
+  }
+  int n = 0;
+  uint8_t pos = 0;
+  for (char *item = strtok(lista, ",\n"); item && n < max; item = strtok(NULL, ",\n"), pos++) {
+    cyw43_ev_scan_result_t *r = &redes[n];
+    memset(r, 0, sizeof(*r));
+    r->bssid[0] = 0x02;
+    r->bssid[5] = pos;
+    char *dois = strchr(item, ':');
+    if (!dois)
+      continue;
+    r->ssid_len = (uint8_t)(dois - item > 32 ? 32 : dois - item);
+    memcpy(r->ssid, item, r->ssid_len);
+    char seg[8] = "";
+    int rssi = 0, canal = 0;
+    sscanf(dois + 1, "%d:%d:%7s", &rssi, &canal, seg);
+    r->rssi = (int16_t)rssi;
+    r->channel = (uint16_t)canal;
+    r->auth_mode = strcmp(seg, "aberta") == 0 ? 0 : strcmp(seg, "wep") == 0 ? 0x01
+                 : strcmp(seg, "wpa") == 0 ? 0x03 : strcmp(seg, "misto") == 0 ? 0x07 : 0x05;
+    n++;
+  }
+  return n;
+}
+
+// A rede associada (mesmo SSID e, se conhecido, BSSID) ainda está no ar
+static const cyw43_ev_scan_result_t *rede_associada(cyw43_ev_scan_result_t *redes, int n) {
+  static const uint8_t sem_bssid[6];
+  for (int i = 0; i < n; i++) {
+    if (strlen(assoc_ssid) == redes[i].ssid_len && memcmp(redes[i].ssid, assoc_ssid, redes[i].ssid_len) == 0 &&
+        (memcmp(assoc_bssid, sem_bssid, 6) == 0 || memcmp(assoc_bssid, redes[i].bssid, 6) == 0))
+      return &redes[i];
+  }
+  return NULL;
+}
+
+int cyw43_wifi_scan(cyw43_t *self, cyw43_wifi_scan_options_t *opts, void *env,
+                    int (*result_cb)(void *, const cyw43_ev_scan_result_t *)) {
+  (void)self; (void)opts;
+  if (varredura_cb)
+    return -1;
+  varredura_cb = result_cb;
+  varredura_env = env;
+  varredura_fim = get_absolute_time() + HOST_VARREDURA_US;
+  return 0;
+}
+
+bool cyw43_wifi_scan_active(cyw43_t *self) {
+  (void)self;
+  return varredura_cb != NULL;
+}
+
+static void varredura_entregar(void) {
+  if (!varredura_cb || get_absolute_time() < varredura_fim)
+    return;
+  cyw43_ev_scan_result_t redes[HOST_REDES_MAX];
+  int n = redes_no_ar(redes, HOST_REDES_MAX);
+  for (int i = 0; i < n; i++)
+    varredura_cb(varredura_env, &redes[i]);
+  varredura_cb = NULL;
+}
+
+// ====== LAÇO DE EVENTOS ======
+int host_net_poll(uint32_t timeout_us) {
+  tcp_autoconfig();
+  varredura_entregar();
+
+  fd_set prontos;
+  FD_ZERO(&prontos);
+  int maior = -1, atendidos = 0;
+  for (struct udp_pcb *u = udp_pcbs; u; u = u->prox) {
+    FD_SET(u->fd, &prontos);
+    maior = u->fd > maior ? u->fd : maior;
+  }
+  for (struct tcp_pcb *t = tcp_pcbs; t; t = t->prox) {
+    if (t->fd < 0 || t->fechado || (!t->escuta && !t->janela))
+      continue;
+    FD_SET(t->fd, &prontos);
+    maior = t->fd > maior ? t->fd : maior;
+  }
+
+  // Sem sockets o select só dorme o prazo (portal ainda não aberto, bench/)
+  struct timeval tv = { .tv_sec = timeout_us / 1000000u, .tv_usec = timeout_us % 1000000u };
+  if (select(maior + 1, maior >= 0 ? &prontos : NULL, NULL, NULL, &tv) > 0) {
+    for (struct udp_pcb *u = udp_pcbs; u; u = u->prox) {
+      if (FD_ISSET(u->fd, &prontos)) {
+        udp_atender(u);
+        atendidos++;
+      }
+    }
+    // Conexões aceitas agora entram no início da lista e não estão em
+    // `prontos`; as fechadas num callback são puladas
+    for (struct tcp_pcb *t = tcp_pcbs; t; t = t->prox) {
+      if (!t->fechado && t->fd >= 0 && FD_ISSET(t->fd, &prontos)) {
+        tcp_atender(t);
+        atendidos++;
+      }
+    }
+  }
+  tcp_finalizar();
+  return atendidos;
+}
+
+// ====== NETIF ======
+cyw43_t cyw43_state;
+struct netif *netif_default = &cyw43_state.netif[0];
+static netif_ext_callback_t *netif_callbacks;
+
+static void netif_avisar(struct netif *netif, netif_nsc_reason_t motivo) {
+  netif_ext_callback_args_t args = { 0 };
+  for (netif_ext_callback_t *cb = netif_callbacks; cb; cb = cb->next)
+    cb->callback_fn(netif, motivo, &args);
+}
+
+void netif_set_addr(struct netif *netif, const ip4_addr_t *ipaddr,
+                    const ip4_addr_t *netmask, const ip4_addr_t *gw) {
+  bool mudou = netif->ip_addr.addr != ipaddr->addr;
+  netif->ip_addr = *ipaddr;
+  netif->netmask = *netmask;
+  netif->gw = *gw;
+  if (mudou)
+    netif_avisar(netif, LWIP_NSC_IPV4_ADDRESS_CHANGED);
+}
+
+void netif_add_ext_callback(netif_ext_callback_t *callback, netif_ext_callback_fn fn) {
+  callback->callback_fn = fn;
+  callback->next = netif_callbacks;
+  netif_callbacks = callback;
+}
+
+// ====== CYW43 ======
+int cyw43_arch_init(void) {
+  // MAC localmente administrado, diferente a cada processo (nome rover-XXXX)
+  static const u8_t prefixo[3] = { 0x2a, 0xcd, 0xc1 };
+  uint32_t r = get_rand_32();
+  for (int i = 0; i < 2; i++) {
+    memcpy(cyw43_state.netif[i].hwaddr, prefixo, sizeof(prefixo));
+    cyw43_state.netif[i].hwaddr[3] = (u8_t)(r >> 16);
+    cyw43_state.netif[i].hwaddr[4] = (u8_t)(r >> 8);
+    cyw43_state.netif[i].hwaddr[5] = (u8_t)r;
+  }
+  printf("[host] cyw43 simulado sobre loopback\n");
+  return 0;
+}
+
+void cyw43_arch_deinit(void) {
+  while (udp_pcbs)
+    udp_remove(udp_pcbs);
+  for (struct tcp_pcb *t = tcp_pcbs; t; t = t->prox)
+    tcp_close(t);
+  tcp_finalizar();
+}
+
+void cyw43_arch_poll(void) {
+  host_atender(get_absolute_time());
+}
+
+void cyw43_arch_enable_ap_mode(const char *ssid, const char *password, uint32_t auth) {
+  (void)password; (void)auth;
+  printf("[host] AP \"%s\" (simulado)\n", ssid);
+}
+
+void cyw43_arch_disable_ap_mode(void) {}
+void cyw43_arch_enable_sta_mode(void) {}
+
+void cyw43_arch_disable_sta_mode(void) {
+  assoc_ativa = false;
+}
+
+// A STA associada recebe 127.0.0.1
+static void associar_ip(void) {
+  ip4_addr_t ip, mascara, gw;
+  IP4_ADDR(&ip, 127, 0, 0, 1);
+  IP4_ADDR(&mascara, 255, 0, 0, 0);
+  IP4_ADDR(&gw, 127, 0, 0, 1);
+  netif_set_addr(&cyw43_state.netif[0], &ip, &mascara, &gw);
+}
+
+// Qualquer senha serve; o SSID precisa estar no ar, a não ser com a lista
+// fixa (rede oculta: ROVER_SSID pode ser qualquer nome)
+static int associar(const char *ssid, const uint8_t *bssid) {
+  cyw43_ev_scan_result_t redes[HOST_REDES_MAX];
+  int n = redes_no_ar(redes, HOST_REDES_MAX);
+  snprintf(assoc_ssid, sizeof(assoc_ssid), "%s", ssid);
+  memset(assoc_bssid, 0, sizeof(assoc_bssid));
+  if (bssid)
+    memcpy(assoc_bssid, bssid, sizeof(assoc_bssid));
+  if (redes_de_arquivo() && !rede_associada(redes, n)) {
+    assoc_ativa = false;
+    printf("[host] \"%s\" fora do ar\n", ssid);
+    return -1;
+  }
+  assoc_ativa = true;
+  associar_ip();
+  printf("[host] conectado a \"%s\" (loopback)\n", ssid);
+  return 0;
+}
+
+int cyw43_arch_wifi_connect_timeout_ms(const char *ssid, const char *pw, uint32_t auth, uint32_t timeout) {
+  (void)pw; (void)auth; (void)timeout;
+  assoc_fim = 0;
+  return associar(ssid, NULL);
+}
+
+int cyw43_arch_wifi_connect_bssid_timeout_ms(const char *ssid, const uint8_t *bssid, const char *pw,
+                                             uint32_t auth, uint32_t timeout) {
+  (void)pw; (void)auth; (void)timeout;
+  assoc_fim = 0;
+  return associar(ssid, bssid);
+}
+
+int cyw43_arch_wifi_connect_bssid_async(const char *ssid, const uint8_t *bssid, const char *pw, uint32_t auth) {
+  (void)pw; (void)auth;
+  snprintf(assoc_ssid, sizeof(assoc_ssid), "%s", ssid);
+  memset(assoc_bssid, 0, sizeof(assoc_bssid));
+  if (bssid)
+    memcpy(assoc_bssid, bssid, sizeof(assoc_bssid));
+  assoc_ativa = true;
+  assoc_fim = get_absolute_time() + HOST_ASSOCIAR_US;
+  return 0;
+}
+
+int cyw43_arch_wifi_connect_async(const char *ssid, const char *pw, uint32_t auth) {
+  return cyw43_arch_wifi_connect_bssid_async(ssid, NULL, pw, auth);
+}
+
+int cyw43_wifi_leave(cyw43_t *self, int itf) {
+  (void)self; (void)itf;
+  assoc_ativa = false;
+  printf("[host] desassociado de \"%s\"\n", assoc_ssid);
+  return 0;
+}
+
+int cyw43_wifi_get_bssid(cyw43_t *self, uint8_t bssid[6]) {
+  (void)self;
+  cyw43_ev_scan_result_t redes[HOST_REDES_MAX];
+  const cyw43_ev_scan_result_t *r = assoc_ativa ? rede_associada(redes, redes_no_ar(redes, HOST_REDES_MAX)) : NULL;
+  memcpy(bssid, r ? r->bssid : assoc_bssid, 6);
+  return assoc_ativa ? 0 : -1;
+}
+
+// Conexão assíncrona termina depois de HOST_ASSOCIAR_US; a rede que some
+// do ar derruba o enlace
+int cyw43_tcpip_link_status(cyw43_t *self, int itf) {
+  (void)self;
+  if (itf != CYW43_ITF_STA || !assoc_ativa)
+    return CYW43_LINK_DOWN;
+  if (assoc_fim && get_absolute_time() < assoc_fim)
+    return CYW43_LINK_JOIN;
+  cyw43_ev_scan_result_t redes[HOST_REDES_MAX];
+  if (redes_de_arquivo() && !rede_associada(redes, redes_no_ar(redes, HOST_REDES_MAX))) {
+    assoc_ativa = false;
+    printf("[host] \"%s\" saiu do ar\n", assoc_ssid);
+    return CYW43_LINK_NONET;
+  }
+  if (assoc_fim) {
+    assoc_fim = 0;
+    associar_ip();
+    printf("[host] conectado a \"%s\" (loopback)\n", assoc_ssid);
+  }
+  return CYW43_LINK_UP;
+}
+
+// ROVER_HOST_RSSI fixa o valor; sem ela, o da rede associada na lista
+int cyw43_wifi_get_rssi(cyw43_t *self, int32_t *rssi) {
+  (void)self;
+  const char *env = getenv("ROVER_HOST_RSSI");
+  cyw43_ev_scan_result_t redes[HOST_REDES_MAX];
+  const cyw43_ev_scan_result_t *r = NULL;
+  if (!env && assoc_ativa)
+    r = rede_associada(redes, redes_no_ar(redes, HOST_REDES_MAX));
+  *rssi = env ? atoi(env) : r ? r->rssi : -50;
+  return 0;
+}
+
+int cyw43_wifi_pm(cyw43_t *self, uint32_t pm) {
+  (void)self;
+  printf("[host] cyw43_wifi_pm(0x%08x)\n", (unsigned)pm);
+  return 0;
+}
+
+// ====== mDNS ======
+struct mdns_service {
+  char txt[64];
+};
+
+void mdns_resp_init(void) {}
+
+err_t mdns_resp_add_netif(struct netif *netif, const char *hostname) {
+  (void)netif;
+  printf("[host] mDNS %s.local (não anunciado)\n", hostname);
+  return ERR_OK;
+}
+
+s8_t mdns_resp_add_service(struct netif *netif, const char *name, const char *service,
+                           enum mdns_sd_proto proto, u16_t port,
+                           service_get_txt_fn_t txt_fn, void *txt_userdata) {
+  (void)netif;
+  struct mdns_service s = { "" };
+  if (txt_fn)
+    txt_fn(&s, txt_userdata);
+  printf("[host] mDNS serviço %s.%s.%s porta %u TXT \"%s\"\n", name, service,
+         proto == DNSSD_PROTO_UDP ? "_udp" : "_tcp", port, s.txt);
+  return 0;
+}
+
+err_t mdns_resp_add_service_txtitem(struct mdns_service *service, const char *txt, u8_t txt_len) {
+  size_t usado = strlen(service->txt);
+  if (usado + txt_len + 2 > sizeof(service->txt))
+    return ERR_MEM;
+  if (usado)
+    service->txt[usado++] = ' ';
+  memcpy(service->txt + usado, txt, txt_len);
+  service->txt[usado + txt_len] = '\0';
+  return ERR_OK;
+}
+
+void mdns_resp_announce(struct netif *netif) {
+  (void)netif;
+}
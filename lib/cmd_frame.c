@@ -0,0 +1,83 @@
+#include <string.h>
+#include "cmd_frame.h"
+
+static inline void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_amostra(uint8_t *p, int16_t speed, int16_t steering, uint8_t mode, uint8_t flags) {
+  put_u16(p, (uint16_t)speed);
+  put_u16(p + 2, (uint16_t)steering);
+  p[4] = mode;
+  p[5] = flags;
+}
+
+static void put_cabecalho(uint8_t *p, uint16_t seq, uint8_t tipo, uint8_t k, uint16_t evt_seq) {
+  memcpy(p, CMD_FRAME_MAGIC, 4);
+  put_u16(p + 4, seq);
+  p[6] = tipo;
+  p[7] = k;
+  put_u16(p + 8, evt_seq);
+}
+
+void cmd_stream_init(cmd_stream_t *cs, uint8_t k, uint8_t n_paridade) {
+  memset(cs, 0, sizeof(*cs));
+  cs->k = k > CMD_HIST_MAX - 1 ? CMD_HIST_MAX - 1 : k;
+  cs->n_paridade = n_paridade;
+}
+
+// Monta um quadro de dados com a amostra atual e as k anteriores.
+// Retorna o tamanho do quadro (0 se o buffer for pequeno demais).
+size_t cmd_stream_encode(cmd_stream_t *cs, const cmd_amostra_t *atual, uint16_t evt_seq,
+                         uint8_t *buf, size_t tam) {
+  uint8_t k = cs->hist_cont < cs->k ? cs->hist_cont : cs->k;
+  size_t len = CMD_FRAME_CABECALHO + CMD_AMOSTRA_BYTES * (1 + k);
+  if (tam < len)
+    return 0;
+
+  uint16_t seq = cs->seq;
+  put_cabecalho(buf, seq, CMD_TIPO_DADOS, k, evt_seq);
+
+  uint8_t *p = buf + CMD_FRAME_CABECALHO;
+  put_amostra(p, atual->speed_x10, atual->steering_x10, atual->mode, atual->flags);
+
+  for (uint8_t i = 1; i <= k; i++) {
+    const cmd_amostra_t *h = &cs->hist[(uint16_t)(seq - i) % CMD_HIST_MAX];
+    p += CMD_AMOSTRA_BYTES;
+    put_amostra(p, (int16_t)(h->speed_x10 - atual->speed_x10),
+                (int16_t)(h->steering_x10 - atual->steering_x10), h->mode, h->flags);
+  }
+
+  // Acumula a amostra (em valores absolutos) no grupo de paridade
+  if (cs->n_paridade) {
+    uint8_t bruto[CMD_AMOSTRA_BYTES];
+    put_amostra(bruto, atual->speed_x10, atual->steering_x10, atual->mode, atual->flags);
+    if (cs->grupo_cont == 0) {
+      cs->grupo_base = seq;
+      memset(cs->paridade, 0, sizeof(cs->paridade));
+    }
+    for (int i = 0; i < CMD_AMOSTRA_BYTES; i++)
+      cs->paridade[i] ^= bruto[i];
+    cs->grupo_cont++;
+  }
+
+  cs->hist[seq % CMD_HIST_MAX] = *atual;
+  if (cs->hist_cont < CMD_HIST_MAX)
+    cs->hist_cont++;
+  cs->seq = seq + 1;
+  return len;
+}
+
+// Se o grupo atual estiver completo, monta o quadro de paridade e
+// reinicia o grupo. Retorna 0 quando não há paridade a enviar.
+size_t cmd_stream_paridade(cmd_stream_t *cs, uint8_t *buf, size_t tam) {
+  size_t len = CMD_FRAME_CABECALHO + CMD_AMOSTRA_BYTES;
+  if (!cs->n_paridade || cs->grupo_cont < cs->n_paridade || tam < len)
+    return 0;
+
+  put_cabecalho(buf, cs->grupo_base, CMD_TIPO_PARIDADE, cs->grupo_cont, 0);
+  memcpy(buf + CMD_FRAME_CABECALHO, cs->paridade, CMD_AMOSTRA_BYTES);
+  cs->grupo_cont = 0;
+  return len;
+}
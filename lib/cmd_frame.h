@@ -0,0 +1,65 @@
+#ifndef CMD_FRAME_H
+#define CMD_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Quadro binário de comandos com redundância para Wi-Fi com perdas.
+//
+// Quadro de dados (little-endian):
+//   0  "RVRF"
+//   4  u16 seq        número de sequência do quadro
+//   6  u8  tipo       CMD_TIPO_DADOS
+//   7  u8  k          número de entradas de histórico que seguem
+//   8  u16 evt_seq    sequência do último evento de botão (captura)
+//  10  amostra atual  (CMD_AMOSTRA_BYTES)
+//  16  k entradas     amostras seq-1 .. seq-k, com velocidade e direção
+//                     codificadas como delta em relação à amostra atual
+//
+// Quadro de paridade (a cada N quadros de dados, opcional):
+//   0  "RVRF", u16 seq_base, u8 CMD_TIPO_PARIDADE, u8 n, u16 0,
+//  10  XOR das n amostras seq_base .. seq_base+n-1
+//
+// Com k >= 1 qualquer rajada de até k quadros perdidos é reconstruída a
+// partir do próximo quadro; a paridade cobre uma perda isolada por grupo
+// mesmo quando o quadro seguinte também se perde.
+
+#define CMD_FRAME_MAGIC       "RVRF"
+#define CMD_FRAME_CABECALHO   10
+#define CMD_AMOSTRA_BYTES     6
+#define CMD_HIST_MAX          8
+#define CMD_FRAME_MAX         (CMD_FRAME_CABECALHO + CMD_AMOSTRA_BYTES * (1 + CMD_HIST_MAX))
+
+#define CMD_TIPO_DADOS        0
+#define CMD_TIPO_PARIDADE     1
+
+// Bits de flags da amostra
+#define CMD_FLAG_LUZES        0x01
+#define CMD_FLAG_CAMERA       0x02
+#define CMD_FLAG_CAPTURA      0x04   // Evento de captura pendente (evt_seq não confirmado)
+
+typedef struct {
+  int16_t speed_x10;     // Velocidade * 10 (-1000..1000)
+  int16_t steering_x10;  // Direção * 10 (-1000..1000)
+  uint8_t mode;
+  uint8_t flags;
+} cmd_amostra_t;
+
+typedef struct {
+  uint16_t seq;                      // Seq do próximo quadro de dados
+  uint8_t k;                         // Entradas de histórico por quadro
+  uint8_t n_paridade;                // Quadros por grupo de paridade (0 = desligado)
+  uint8_t hist_cont;                 // Amostras válidas no histórico
+  cmd_amostra_t hist[CMD_HIST_MAX];  // Anel: hist[seq % CMD_HIST_MAX]
+  uint8_t grupo_cont;                // Quadros acumulados no grupo atual
+  uint16_t grupo_base;               // Seq do primeiro quadro do grupo
+  uint8_t paridade[CMD_AMOSTRA_BYTES];
+} cmd_stream_t;
+
+void cmd_stream_init(cmd_stream_t *cs, uint8_t k, uint8_t n_paridade);
+size_t cmd_stream_encode(cmd_stream_t *cs, const cmd_amostra_t *atual, uint16_t evt_seq,
+                         uint8_t *buf, size_t tam);
+size_t cmd_stream_paridade(cmd_stream_t *cs, uint8_t *buf, size_t tam);
+
+#endif
@@ -0,0 +1,111 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "controle.h"
+
+float controle_eixo(uint16_t bruto, float zona_morta) {
+  float v = ((float)bruto - 2048.0f) / 2048.0f;
+
+  // Zona morta elimina o ruído em torno do centro
+  if (fabsf(v) < zona_morta)
+    return 0.0f;
+
+  // Limita entre -1 e 1 (por segurança)
+  return v > 1.0f ? 1.0f : v < -1.0f ? -1.0f : v;
+}
+
+cmd_amostra_t controle_amostra(float joy_x, float joy_y, float vel_max, uint8_t modo, uint8_t flags) {
+  cmd_amostra_t a = {
+    .speed_x10 = (int16_t)lroundf(joy_y * vel_max * 10.0f),
+    .steering_x10 = (int16_t)lroundf(joy_x * 100.0f * 10.0f),
+    .mode = modo,
+    .flags = flags,
+  };
+  return a;
+}
+
+const char *const controle_nomes_motivo[CONTROLE_NUM_MOTIVOS] = {
+  "nada", "evento", "mudanca", "periodo", "keepalive",
+};
+
+void controle_envio_iniciar(controle_envio_t *e, const controle_envio_cfg_t *cfg) {
+  memset(e, 0, sizeof(*e));
+  e->cfg = *cfg;
+  e->limiar_speed_x10 = (int16_t)lroundf(cfg->limiar * cfg->vel_max * 10.0f);
+  e->limiar_steering_x10 = (int16_t)lroundf(cfg->limiar * 1000.0f);
+}
+
+void controle_envio_parar(controle_envio_t *e) {
+  e->ativo = false;
+}
+
+static bool repouso(const cmd_amostra_t *a) {
+  return a->speed_x10 == 0 && a->steering_x10 == 0;
+}
+
+static bool iguais(const cmd_amostra_t *a, const cmd_amostra_t *b) {
+  return a->speed_x10 == b->speed_x10 && a->steering_x10 == b->steering_x10 &&
+         a->mode == b->mode && a->flags == b->flags;
+}
+
+controle_motivo_t controle_envio_decidir(controle_envio_t *e, const cmd_amostra_t *a,
+                                         uint16_t evt_seq, uint32_t agora_ms) {
+  controle_motivo_t motivo = CONTROLE_NADA;
+  uint32_t decorrido = agora_ms - e->enviado_ms;
+
+  if (!e->ativo) {
+    motivo = CONTROLE_MUDANCA;          // Primeiro quadro do fluxo
+    e->tick_ms = agora_ms;
+  } else {
+    // Quadros do fluxo fixo que já teriam saído
+    while (agora_ms - e->tick_ms >= e->cfg.periodo_ms) {
+      e->tick_ms += e->cfg.periodo_ms;
+      e->fixos++;
+    }
+
+    const cmd_amostra_t *u = &e->enviada;
+    if (evt_seq != e->evt_enviado || a->flags != u->flags || a->mode != u->mode)
+      motivo = CONTROLE_EVENTO;
+    else if (decorrido >= e->cfg.intervalo_min_ms &&
+             (abs(a->speed_x10 - u->speed_x10) >= e->limiar_speed_x10 ||
+              abs(a->steering_x10 - u->steering_x10) >= e->limiar_steering_x10))
+      motivo = CONTROLE_MUDANCA;
+    else if (repouso(a) && iguais(a, u))
+      motivo = decorrido >= e->cfg.keepalive_ms ? CONTROLE_KEEPALIVE : CONTROLE_NADA;
+    else if (decorrido >= e->cfg.periodo_ms)
+      motivo = CONTROLE_PERIODO;
+  }
+
+  if (motivo != CONTROLE_NADA) {
+    e->enviada = *a;
+    e->evt_enviado = evt_seq;
+    e->ativo = true;
+    e->enviado_ms = agora_ms;
+    e->quadros[motivo]++;
+  }
+  return motivo;
+}
+
+uint32_t controle_envio_intervalo_ms(const controle_envio_t *e) {
+  return e->ativo && repouso(&e->enviada) ? e->cfg.keepalive_ms : e->cfg.periodo_ms;
+}
+
+uint32_t controle_envio_espera_ms(const controle_envio_t *e, uint32_t agora_ms) {
+  if (!e->ativo)
+    return 0;
+  uint32_t decorrido = agora_ms - e->enviado_ms;
+  uint32_t intervalo = controle_envio_intervalo_ms(e);
+  return decorrido < intervalo ? intervalo - decorrido : 0;
+}
+
+uint32_t controle_envio_total(const controle_envio_t *e) {
+  uint32_t total = 0;
+  for (int m = CONTROLE_EVENTO; m < CONTROLE_NUM_MOTIVOS; m++)
+    total += e->quadros[m];
+  return total;
+}
+
+uint32_t controle_envio_poupados(const controle_envio_t *e) {
+  uint32_t total = controle_envio_total(e);
+  return e->fixos > total ? e->fixos - total : 0;
+}
@@ -0,0 +1,87 @@
+#ifndef CONTROLE_H
+#define CONTROLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cmd_frame.h"
+
+// Conversão da leitura do joystick em comandos do rover, separada do ADC
+// para rodar igual no Pico e no PC.
+
+// Leitura de 12 bits (0..4095, centro 2048) -> -1..1 com zona morta
+float controle_eixo(uint16_t bruto, float zona_morta);
+
+// Amostra do fluxo de comandos: velocidade vem do eixo Y (±vel_max),
+// direção do eixo X (±100), ambas em décimos de unidade
+cmd_amostra_t controle_amostra(float joy_x, float joy_y, float vel_max, uint8_t modo, uint8_t flags);
+
+// Política de envio do fluxo de comandos. Em vez de um quadro a cada
+// período fixo, o firmware amostra o joystick com frequência e pergunta
+// aqui se a amostra deve sair:
+//
+//   EVENTO     flags, modo ou evento de captura mudaram: sai na hora
+//   MUDANCA    um eixo andou `limiar` do curso desde o último quadro; sai
+//              respeitando `intervalo_min_ms` (mudanças seguidas se fundem
+//              num quadro só, com a amostra mais nova)
+//   PERIODO    joystick fora do centro (ou diferente do último quadro):
+//              a cada `periodo_ms`, como o fluxo fixo
+//   KEEPALIVE  em repouso (centro, igual ao último quadro): a cada
+//              `keepalive_ms`
+//
+// `fixos` conta os quadros que o fluxo fixo a cada periodo_ms teria
+// mandado no mesmo tempo, para medir o que foi poupado.
+
+typedef enum {
+  CONTROLE_NADA,
+  CONTROLE_EVENTO,
+  CONTROLE_MUDANCA,
+  CONTROLE_PERIODO,
+  CONTROLE_KEEPALIVE,
+  CONTROLE_NUM_MOTIVOS
+} controle_motivo_t;
+
+typedef struct {
+  uint16_t periodo_ms;
+  uint16_t keepalive_ms;
+  uint16_t intervalo_min_ms;  // Teto de taxa dos envios por mudança
+  float limiar;               // Fração do curso de um eixo (0..1)
+  float vel_max;              // Escala da velocidade (a mesma de controle_amostra)
+} controle_envio_cfg_t;
+
+typedef struct {
+  controle_envio_cfg_t cfg;
+  int16_t limiar_speed_x10;
+  int16_t limiar_steering_x10;
+  cmd_amostra_t enviada;      // Última amostra transmitida
+  uint16_t evt_enviado;
+  bool ativo;                 // Fluxo em curso (algum quadro já saiu)
+  uint32_t enviado_ms;
+  uint32_t tick_ms;           // Relógio do fluxo fixo equivalente
+  uint32_t fixos;
+  uint32_t quadros[CONTROLE_NUM_MOTIVOS];   // Por motivo (o índice NADA fica em 0)
+} controle_envio_t;
+
+extern const char *const controle_nomes_motivo[CONTROLE_NUM_MOTIVOS];
+
+void controle_envio_iniciar(controle_envio_t *e, const controle_envio_cfg_t *cfg);
+
+// Fluxo interrompido (enlace caiu): a próxima amostra sai na hora
+void controle_envio_parar(controle_envio_t *e);
+
+// Motivo para enviar `a` agora (NADA = segura); com motivo, a amostra conta
+// como enviada
+controle_motivo_t controle_envio_decidir(controle_envio_t *e, const cmd_amostra_t *a,
+                                         uint16_t evt_seq, uint32_t agora_ms);
+
+// Até quando a decisão pode esperar sem amostra nova (ms a partir de agora)
+uint32_t controle_envio_espera_ms(const controle_envio_t *e, uint32_t agora_ms);
+
+// Maior intervalo esperado entre quadros no regime atual (timeout do enlace)
+uint32_t controle_envio_intervalo_ms(const controle_envio_t *e);
+
+uint32_t controle_envio_total(const controle_envio_t *e);
+
+// Quadros que o fluxo fixo teria mandado a mais (0 se mandou menos)
+uint32_t controle_envio_poupados(const controle_envio_t *e);
+
+#endif
@@ -0,0 +1,116 @@
+#include <string.h>
+#include "credenciais.h"
+#include "ota.h"
+#include "hardware/flash.h"
+
+// O registro ocupa as páginas inteiras que o cobrem
+#define CREDENCIAIS_BLOCO \
+  ((sizeof(credenciais_t) + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE * FLASH_PAGE_SIZE)
+
+static const credenciais_t *setor(uint32_t i) {
+  return (const credenciais_t *)(XIP_BASE + CREDENCIAIS_OFFSET + i * CREDENCIAIS_SETOR);
+}
+
+static uint32_t crc_registro(const credenciais_t *c) {
+  return ota_crc32(0, c, offsetof(credenciais_t, crc));
+}
+
+static bool registro_valido(const credenciais_t *c) {
+  return c->magico == CREDENCIAIS_MAGICO && c->n <= CREDENCIAIS_MAX && c->crc == crc_registro(c);
+}
+
+bool credenciais_ler(credenciais_t *c) {
+  const credenciais_t *a = setor(0), *b = setor(1);
+  bool va = registro_valido(a), vb = registro_valido(b);
+
+  if (va && (!vb || (int32_t)(a->seq - b->seq) > 0)) {
+    *c = *a;
+    return true;
+  }
+  if (vb) {
+    *c = *b;
+    return true;
+  }
+  memset(c, 0, sizeof(*c));
+  c->magico = CREDENCIAIS_MAGICO;
+  return false;
+}
+
+void credenciais_gravar(credenciais_t *c) {
+  uint8_t bloco[CREDENCIAIS_BLOCO];
+  c->magico = CREDENCIAIS_MAGICO;
+  c->seq++;
+  c->crc = crc_registro(c);
+
+  memset(bloco, 0xFF, sizeof(bloco));
+  memcpy(bloco, c, sizeof(*c));
+  uint32_t offset = CREDENCIAIS_OFFSET + (c->seq & 1u) * CREDENCIAIS_SETOR;
+  flash_range_erase(offset, CREDENCIAIS_SETOR);
+  flash_range_program(offset, bloco, sizeof(bloco));
+}
+
+const credencial_t *credenciais_buscar(const credenciais_t *c, const char *ssid) {
+  for (uint8_t i = 0; i < c->n; i++) {
+    if (strcmp(c->c[i].ssid, ssid) == 0)
+      return &c->c[i];
+  }
+  return NULL;
+}
+
+void credenciais_salvar(credenciais_t *c, const char *ssid, const char *senha,
+                        uint8_t seguranca, uint8_t prioridade) {
+  credencial_t *cr = (credencial_t *)credenciais_buscar(c, ssid);
+  if (!cr) {
+    if (c->n < CREDENCIAIS_MAX) {
+      cr = &c->c[c->n++];
+    } else {
+      cr = &c->c[0];
+      for (uint8_t i = 1; i < c->n; i++) {
+        const credencial_t *o = &c->c[i];
+        if (o->prioridade < cr->prioridade || (o->prioridade == cr->prioridade && o->usos < cr->usos))
+          cr = &c->c[i];
+      }
+    }
+    memset(cr, 0, sizeof(*cr));
+    strncpy(cr->ssid, ssid, REDES_SSID_MAX);
+  }
+  memset(cr->senha, 0, sizeof(cr->senha));
+  strncpy(cr->senha, senha, CREDENCIAIS_SENHA_MAX);
+  cr->seguranca = seguranca;
+  cr->prioridade = prioridade > CREDENCIAIS_PRIO_MAX ? CREDENCIAIS_PRIO_MAX : prioridade;
+}
+
+void credenciais_usar(credenciais_t *c, uint8_t i) {
+  if (i < c->n && c->c[i].usos < UINT16_MAX)
+    c->c[i].usos++;
+}
+
+int16_t credenciais_pontos(const credencial_t *cr, int16_t rssi) {
+  return (int16_t)(rssi + CREDENCIAIS_PESO_DB * cr->prioridade);
+}
+
+size_t credenciais_candidatas(const credenciais_t *c, const redes_t *r,
+                              credencial_candidata_t *saida, size_t max) {
+  size_t n = 0;
+  for (uint8_t i = 0; i < c->n; i++) {
+    uint8_t j = 0;
+    while (j < r->n && strcmp(r->r[j].ssid, c->c[i].ssid) != 0)
+      j++;
+    if (j == r->n)
+      continue;
+    credencial_candidata_t nova = { i, j, credenciais_pontos(&c->c[i], r->r[j].rssi) };
+
+    // Inserção ordenada por pontos; cheia, a pior cai
+    size_t pos = 0;
+    while (pos < n && saida[pos].pontos >= nova.pontos)
+      pos++;
+    if (pos == max)
+      continue;
+    size_t mover = n < max ? n - pos : max - 1 - pos;
+    memmove(&saida[pos + 1], &saida[pos], mover * sizeof(*saida));
+    saida[pos] = nova;
+    if (n < max)
+      n++;
+  }
+  return n;
+}
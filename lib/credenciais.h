@@ -0,0 +1,76 @@
+#ifndef CREDENCIAIS_H
+#define CREDENCIAIS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "redes.h"
+
+// Redes conhecidas, gravadas na flash: cada rede que conectou pelo portal
+// entra com a segurança vista na varredura e uma prioridade. No boot e na
+// queda do enlace o firmware faz uma varredura e tenta as conhecidas que
+// estão no ar, da melhor para a pior (credenciais_candidatas).
+//
+// Os dois últimos setores da flash guardam o registro em pingue-pongue,
+// como o controle do OTA: vale o de maior seq com CRC correto, e uma queda
+// de energia no meio da gravação deixa o anterior valendo.
+
+#define CREDENCIAIS_MAX        8
+#define CREDENCIAIS_SENHA_MAX  63
+#define CREDENCIAIS_SETOR      4096u
+#define CREDENCIAIS_OFFSET     (2u * 1024u * 1024u - 2u * CREDENCIAIS_SETOR)
+#define CREDENCIAIS_MAGICO     0x4E434652u  // "RFCN"
+#define CREDENCIAIS_PRIO_MAX   9
+#define CREDENCIAIS_PRIO_PADRAO 5
+#define CREDENCIAIS_PESO_DB    4            // dB de RSSI que cada ponto de prioridade vale
+
+typedef struct {
+  char ssid[REDES_SSID_MAX + 1];
+  char senha[CREDENCIAIS_SENHA_MAX + 1];
+  uint8_t seguranca;        // REDES_WEP | REDES_WPA | REDES_WPA2 (0 = aberta)
+  uint8_t prioridade;       // 0 a CREDENCIAIS_PRIO_MAX
+  uint16_t usos;            // conexões verificadas (desempata a substituição)
+} credencial_t;
+
+typedef struct {
+  uint32_t magico;
+  uint32_t seq;
+  uint8_t n;
+  uint8_t reservado[3];
+  credencial_t c[CREDENCIAIS_MAX];
+  uint32_t crc;             // CRC32 dos campos acima
+} credenciais_t;
+
+// Rede conhecida que está no ar
+typedef struct {
+  uint8_t credencial;       // índice em credenciais_t.c
+  uint8_t rede;             // índice em redes_t.r
+  int16_t pontos;           // RSSI + CREDENCIAIS_PESO_DB * prioridade
+} credencial_candidata_t;
+
+// Lê o registro mais novo; sem nenhum válido, zera a lista e retorna false
+bool credenciais_ler(credenciais_t *c);
+
+// Grava `c` com seq + 1 no setor que não guarda o atual (flash livre)
+void credenciais_gravar(credenciais_t *c);
+
+// Inclui ou atualiza a rede (mesmo SSID); cheia, sai a de menor prioridade
+// e, entre essas, a menos usada
+void credenciais_salvar(credenciais_t *c, const char *ssid, const char *senha,
+                        uint8_t seguranca, uint8_t prioridade);
+
+// Conta uma conexão verificada (enlace com IP) à rede `i`, só na RAM: vai
+// para a flash com a próxima gravação
+void credenciais_usar(credenciais_t *c, uint8_t i);
+
+const credencial_t *credenciais_buscar(const credenciais_t *c, const char *ssid);
+
+// Pontos de uma rede conhecida com este RSSI
+int16_t credenciais_pontos(const credencial_t *cr, int16_t rssi);
+
+// Conhecidas presentes em `r`, da maior para a menor pontuação; retorna
+// quantas (até `max`)
+size_t credenciais_candidatas(const credenciais_t *c, const redes_t *r,
+                              credencial_candidata_t *saida, size_t max);
+
+#endif
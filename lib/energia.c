@@ -0,0 +1,98 @@
+#include <math.h>
+#include <string.h>
+#include "energia.h"
+
+// Níveis: { clk_khz, contraste, wifi, leds, amostra_ms }. Os intervalos de
+// amostragem limitam a latência de despertar pelo joystick; os botões
+// acordam na borda (IRQ), sem esse atraso.
+const energia_perfil_t energia_perfis[] = {
+  // Nunca economiza: referência de latência
+  { "desempenho", 0, 0, 200, {
+    [ENERGIA_ATIVO]    = { 125000, 0xFF, ENERGIA_WIFI_LIGADO,    true,  100 },
+    [ENERGIA_OCIOSO]   = { 125000, 0xFF, ENERGIA_WIFI_LIGADO,    true,  100 },
+    [ENERGIA_DORMINDO] = { 125000, 0xFF, ENERGIA_WIFI_LIGADO,    true,  100 },
+  } },
+  // Padrão: rádio sem economia enquanto o operador mexe; OLED esmaecido
+  // depois de 30 s e apagado depois de 2 min
+  { "equilibrado", 30000, 120000, 200, {
+    [ENERGIA_ATIVO]    = { 125000, 0xFF, ENERGIA_WIFI_LIGADO,    true,  100 },
+    [ENERGIA_OCIOSO]   = {  48000, 0x20, ENERGIA_WIFI_PADRAO,    true,  100 },
+    [ENERGIA_DORMINDO] = {  48000, 0,    ENERGIA_WIFI_AGRESSIVO, false, 250 },
+  } },
+  // Bateria: PM2 até no ATIVO (o RTT cresce), tudo apagado cedo
+  { "economia", 10000, 30000, 250, {
+    [ENERGIA_ATIVO]    = { 125000, 0x80, ENERGIA_WIFI_PADRAO,    true,  100 },
+    [ENERGIA_OCIOSO]   = {  48000, 0x10, ENERGIA_WIFI_AGRESSIVO, true,  200 },
+    [ENERGIA_DORMINDO] = {  48000, 0,    ENERGIA_WIFI_AGRESSIVO, false, 500 },
+  } },
+};
+const uint8_t energia_num_perfis = sizeof(energia_perfis) / sizeof(energia_perfis[0]);
+
+const char *const energia_nomes_estado[ENERGIA_NUM_ESTADOS] = { "ativo", "ocioso", "dormindo" };
+
+const energia_perfil_t *energia_perfil(const char *nome) {
+  for (uint8_t i = 0; i < energia_num_perfis; i++) {
+    if (strcmp(energia_perfis[i].nome, nome) == 0)
+      return &energia_perfis[i];
+  }
+  return NULL;
+}
+
+void energia_iniciar(energia_t *e, const energia_perfil_t *perfil, uint32_t agora_ms) {
+  e->perfil = perfil;
+  e->estado = ENERGIA_ATIVO;
+  e->ultima_atividade_ms = agora_ms;
+  e->despertares = 0;
+}
+
+void energia_trocar_perfil(energia_t *e, const energia_perfil_t *perfil, uint32_t agora_ms) {
+  e->perfil = perfil;
+  energia_atividade(e, agora_ms);
+}
+
+bool energia_atividade(energia_t *e, uint32_t agora_ms) {
+  e->ultima_atividade_ms = agora_ms;
+  if (e->estado == ENERGIA_ATIVO)
+    return false;
+  e->estado = ENERGIA_ATIVO;
+  e->despertares++;
+  return true;
+}
+
+// Estado que a inatividade atual pede
+static energia_estado_t estado_por_inatividade(const energia_perfil_t *p, uint32_t parado_ms) {
+  if (p->dormir_ms && parado_ms >= p->dormir_ms)
+    return ENERGIA_DORMINDO;
+  if (p->ocioso_ms && parado_ms >= p->ocioso_ms)
+    return ENERGIA_OCIOSO;
+  return ENERGIA_ATIVO;
+}
+
+bool energia_avaliar(energia_t *e, uint32_t agora_ms) {
+  energia_estado_t novo = estado_por_inatividade(e->perfil, agora_ms - e->ultima_atividade_ms);
+  // Só a atividade faz voltar: a inatividade nunca "acorda"
+  if (novo <= e->estado)
+    return false;
+  e->estado = novo;
+  return true;
+}
+
+bool energia_joystick(const energia_t *e, float x, float y) {
+  float deflexao = fmaxf(fabsf(x), fabsf(y));
+  return deflexao * 1000.0f > (float)e->perfil->limiar_joy;
+}
+
+const energia_nivel_t *energia_nivel(const energia_t *e) {
+  return &e->perfil->nivel[e->estado];
+}
+
+uint32_t energia_proxima_ms(const energia_t *e, uint32_t agora_ms) {
+  uint32_t ms = energia_nivel(e)->amostra_ms;
+  uint32_t parado = agora_ms - e->ultima_atividade_ms;
+  const energia_perfil_t *p = e->perfil;
+  uint32_t prazo = e->estado == ENERGIA_ATIVO ? p->ocioso_ms
+                 : e->estado == ENERGIA_OCIOSO ? p->dormir_ms : 0;
+  if (prazo && prazo > parado && prazo - parado < ms)
+    ms = prazo - parado;
+  return ms ? ms : 1;
+}
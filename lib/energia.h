@@ -0,0 +1,84 @@
+#ifndef ENERGIA_H
+#define ENERGIA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Gerente de energia do controlador: decide, pela inatividade do operador,
+// em que nível o firmware deve rodar. Só a política fica aqui; o firmware
+// aplica cada nível (clk_sys, modo de economia do cyw43, OLED e LEDs).
+//
+//   ATIVO --(ocioso_ms sem atividade)--> OCIOSO --(dormir_ms)--> DORMINDO
+//     ^------------ joystick além do limiar ou borda de botão ------'
+//
+// Fora do ATIVO o joystick é amostrado a cada `amostra_ms` do nível: esse
+// período é a latência de despertar somada pela amostragem; a troca de
+// relógio e do modo do rádio somam o resto (histograma wake_latency_us).
+
+typedef enum {
+  ENERGIA_ATIVO,
+  ENERGIA_OCIOSO,
+  ENERGIA_DORMINDO,
+  ENERGIA_NUM_ESTADOS
+} energia_estado_t;
+
+// Economia do rádio, do menor atraso ao menor consumo (no firmware:
+// CYW43_NONE_PM, CYW43_DEFAULT_PM e CYW43_AGGRESSIVE_PM)
+typedef enum {
+  ENERGIA_WIFI_LIGADO,      // sem economia: recepção imediata
+  ENERGIA_WIFI_PADRAO,      // PM2: dorme entre beacons depois de 200 ms sem tráfego
+  ENERGIA_WIFI_AGRESSIVO,   // modo agressivo do driver: menor consumo, mais atraso
+} energia_wifi_t;
+
+typedef struct {
+  uint32_t clk_khz;         // clk_sys (>= 48 MHz para a USB)
+  uint8_t contraste;        // OLED; 0 = apagado
+  uint8_t wifi;             // energia_wifi_t
+  bool leds;                // LED RGB e matriz acesos
+  uint16_t amostra_ms;      // Leitura do joystick para despertar
+} energia_nivel_t;
+
+typedef struct {
+  const char *nome;
+  uint32_t ocioso_ms;       // Inatividade até OCIOSO (0 = nunca)
+  uint32_t dormir_ms;       // Inatividade até DORMINDO (0 = nunca)
+  uint16_t limiar_joy;      // Deflexão (milésimos de fundo de escala) que conta como atividade
+  energia_nivel_t nivel[ENERGIA_NUM_ESTADOS];
+} energia_perfil_t;
+
+typedef struct {
+  const energia_perfil_t *perfil;
+  energia_estado_t estado;
+  uint32_t ultima_atividade_ms;
+  uint32_t despertares;
+} energia_t;
+
+extern const energia_perfil_t energia_perfis[];
+extern const uint8_t energia_num_perfis;
+extern const char *const energia_nomes_estado[ENERGIA_NUM_ESTADOS];
+
+// Perfil pelo nome ("desempenho", "equilibrado", "economia"); NULL se não existe
+const energia_perfil_t *energia_perfil(const char *nome);
+
+void energia_iniciar(energia_t *e, const energia_perfil_t *perfil, uint32_t agora_ms);
+
+// Troca o perfil mantendo a contagem de inatividade; volta ao ATIVO
+void energia_trocar_perfil(energia_t *e, const energia_perfil_t *perfil, uint32_t agora_ms);
+
+// Atividade do operador; retorna true se saiu do OCIOSO/DORMINDO
+bool energia_atividade(energia_t *e, uint32_t agora_ms);
+
+// Avança por inatividade; retorna true se o estado mudou
+bool energia_avaliar(energia_t *e, uint32_t agora_ms);
+
+// Joystick (x, y em -1..1) além do limiar do perfil
+bool energia_joystick(const energia_t *e, float x, float y);
+
+// Nível do estado atual
+const energia_nivel_t *energia_nivel(const energia_t *e);
+
+// Em quantos ms avaliar de novo: o menor entre a amostragem do joystick e a
+// próxima transição por inatividade
+uint32_t energia_proxima_ms(const energia_t *e, uint32_t agora_ms);
+
+#endif
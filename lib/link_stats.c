@@ -0,0 +1,112 @@
+#include "link_stats.h"
+
+// Diferença entre carimbos de 32 bits tolerante a wrap-around
+static inline int32_t delta_us(uint32_t fim, uint32_t inicio) {
+  return (int32_t)(fim - inicio);
+}
+
+void link_stats_init(link_stats_t *ls) {
+  ls->srtt_us = 0;
+  ls->rttvar_us = 0;
+  ls->rtt_ultimo_us = 0;
+  ls->rtt_min_us = INT32_MAX;
+  ls->offset_us = 0;
+  ls->owd_ida_us = 0;
+  ls->owd_volta_us = 0;
+  ls->amostras = 0;
+  ls->pings_enviados = 0;
+  ls->ping_seq = 0;
+  ls->ping_t1 = 0;
+  ls->ping_pendente = false;
+  ls->filtro_n = 0;
+  ls->filtro_pos = 0;
+}
+
+// Um PING novo substitui o anterior: o PONG atrasado dele não conta mais
+void link_stats_ping_enviado(link_stats_t *ls, uint32_t seq, uint32_t t1) {
+  ls->pings_enviados++;
+  ls->ping_seq = seq;
+  ls->ping_t1 = t1;
+  ls->ping_pendente = true;
+}
+
+// Processa uma troca completa. Retorna false se o PONG não for do PING em
+// voo ou se a amostra for inválida (processamento remoto maior que o RTT).
+bool link_stats_amostra(link_stats_t *ls, uint32_t seq, uint32_t t1, uint32_t t2, uint32_t t3,
+                        uint32_t t4) {
+  if (!ls->ping_pendente || seq != ls->ping_seq || t1 != ls->ping_t1)
+    return false;
+  ls->ping_pendente = false;
+
+  int32_t ida = delta_us(t2, t1);       // Inclui o offset dos relógios
+  int32_t volta = delta_us(t4, t3);     // Inclui -offset
+  int32_t rtt = (int32_t)((uint32_t)ida + (uint32_t)volta);   // Offset se cancela
+
+  if (rtt < 0 || delta_us(t4, t1) < 0)
+    return false;
+
+  ls->rtt_ultimo_us = rtt;
+
+  // Estimador de Jacobson/Karels (RFC 6298): alfa = 1/8, beta = 1/4
+  if (ls->amostras == 0) {
+    ls->srtt_us = rtt;
+    ls->rttvar_us = rtt / 2;
+  } else {
+    int32_t erro = rtt - ls->srtt_us;
+    if (erro < 0) erro = -erro;
+    ls->rttvar_us += (erro - ls->rttvar_us) / 4;
+    ls->srtt_us += (rtt - ls->srtt_us) / 8;
+  }
+
+  // Offset = (ida - volta) / 2 = ida - RTT/2. Os relógios não têm relação
+  // entre si: ida e volta podem estar em qualquer ponto de ±2^31, e a
+  // diferença delas estoura (e dividida por 2 fica ambígua em 2^31). RTT/2
+  // é pequeno, então a conta é feita módulo 2^32, como os carimbos.
+  ls->filtro_rtt_us[ls->filtro_pos] = rtt;
+  ls->filtro_offset_us[ls->filtro_pos] = delta_us((uint32_t)ida, (uint32_t)(rtt / 2));
+  ls->filtro_pos = (uint8_t)((ls->filtro_pos + 1) % LINK_FILTRO_N);
+  if (ls->filtro_n < LINK_FILTRO_N)
+    ls->filtro_n++;
+
+  // O offset mais confiável é o da troca de menor RTT da janela (filtro de
+  // relógio do NTP: nela o erro de assimetria é no máximo RTT/2); no
+  // empate, a mais nova
+  ls->rtt_min_us = INT32_MAX;
+  for (uint8_t i = 1; i <= ls->filtro_n; i++) {
+    uint8_t j = (uint8_t)((ls->filtro_pos + LINK_FILTRO_N - i) % LINK_FILTRO_N);
+    if (ls->filtro_rtt_us[j] < ls->rtt_min_us) {
+      ls->rtt_min_us = ls->filtro_rtt_us[j];
+      ls->offset_us = ls->filtro_offset_us[j];
+    }
+  }
+
+  // Atrasos de ida e volta corrigidos pelo offset estimado (módulo 2^32)
+  ls->owd_ida_us = delta_us((uint32_t)ida, (uint32_t)ls->offset_us);
+  ls->owd_volta_us = (int32_t)((uint32_t)volta + (uint32_t)ls->offset_us);
+
+  ls->amostras++;
+  return true;
+}
+
+// Tempo sem recepção após o qual o enlace é considerado perdido.
+// intervalo_esperado_ms é o espaçamento normal entre pacotes recebidos.
+uint32_t link_stats_timeout_ms(const link_stats_t *ls, uint32_t intervalo_esperado_ms) {
+  if (ls->amostras == 0)
+    return LINK_TIMEOUT_MAX_MS;
+
+  uint32_t timeout = intervalo_esperado_ms +
+                     (uint32_t)(ls->srtt_us + LINK_STATS_K * ls->rttvar_us) / 1000;
+
+  if (timeout < LINK_TIMEOUT_MIN_MS) timeout = LINK_TIMEOUT_MIN_MS;
+  if (timeout > LINK_TIMEOUT_MAX_MS) timeout = LINK_TIMEOUT_MAX_MS;
+  return timeout;
+}
+
+// Porcentagem de PINGs sem PONG correspondente; o PING em voo ainda não
+// está perdido
+uint8_t link_stats_perda_pct(const link_stats_t *ls) {
+  uint32_t enviados = ls->pings_enviados - (ls->ping_pendente ? 1u : 0u);
+  if (enviados == 0 || ls->amostras >= enviados)
+    return 0;
+  return (uint8_t)(100u * (enviados - ls->amostras) / enviados);
+}
@@ -0,0 +1,56 @@
+#ifndef LINK_STATS_H
+#define LINK_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Medição de latência do enlace de controle no estilo NTP.
+//
+// Cada troca PING/PONG carrega quatro carimbos de tempo em microssegundos
+// (relógio de 32 bits de cada lado, com wrap-around):
+//   t1 = envio do PING (relógio local)
+//   t2 = recepção do PING (relógio remoto)
+//   t3 = envio do PONG (relógio remoto)
+//   t4 = recepção do PONG (relógio local)
+//
+// RTT    = (t4 - t1) - (t3 - t2)
+// offset = ((t2 - t1) + (t3 - t4)) / 2     (remoto - local)
+//
+// Só há um PING em voo: o PONG só vira amostra se trouxer o seq e o t1 dele.
+// PONGs atrasados (de um PING já substituído), duplicados ou reinjetados
+// são descartados.
+
+#define LINK_STATS_K            4      // Multiplicador de RTTVAR (RFC 6298)
+#define LINK_TIMEOUT_MIN_MS     500    // Nunca declara perda antes disso
+#define LINK_TIMEOUT_MAX_MS     5000   // Valor usado antes da primeira amostra
+#define LINK_FILTRO_N           8      // Trocas na janela do filtro de relógio (como no NTP)
+
+typedef struct {
+  int32_t srtt_us;          // RTT suavizado
+  int32_t rttvar_us;        // Variação do RTT
+  int32_t rtt_ultimo_us;    // Última amostra de RTT
+  int32_t rtt_min_us;       // Menor RTT da janela
+  int32_t offset_us;        // Offset do relógio remoto (da amostra de menor RTT da janela)
+  int32_t owd_ida_us;       // Atraso estimado local -> remoto
+  int32_t owd_volta_us;     // Atraso estimado remoto -> local
+  uint32_t amostras;        // Número de PONGs válidos
+  uint32_t pings_enviados;
+  uint32_t ping_seq;        // PING em voo (seq e t1 esperados no PONG)
+  uint32_t ping_t1;
+  bool ping_pendente;
+  // Últimas LINK_FILTRO_N trocas (RTT e offset): com a janela, o offset
+  // acompanha o desvio dos cristais em vez de ficar preso a uma troca antiga
+  int32_t filtro_rtt_us[LINK_FILTRO_N];
+  int32_t filtro_offset_us[LINK_FILTRO_N];
+  uint8_t filtro_n;
+  uint8_t filtro_pos;       // Próxima posição a gravar
+} link_stats_t;
+
+void link_stats_init(link_stats_t *ls);
+void link_stats_ping_enviado(link_stats_t *ls, uint32_t seq, uint32_t t1);
+bool link_stats_amostra(link_stats_t *ls, uint32_t seq, uint32_t t1, uint32_t t2, uint32_t t3,
+                        uint32_t t4);
+uint32_t link_stats_timeout_ms(const link_stats_t *ls, uint32_t intervalo_esperado_ms);
+uint8_t link_stats_perda_pct(const link_stats_t *ls);
+
+#endif
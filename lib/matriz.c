@@ -0,0 +1,8 @@
+#include "matriz.h"
+
+void matriz_carregar(bool buffer[MATRIZ_PIXELS], const bool padrao[MATRIZ_LADO][MATRIZ_LADO]) {
+  for (int linha = 0; linha < MATRIZ_LADO; linha++) {
+    for (int coluna = 0; coluna < MATRIZ_LADO; coluna++)
+      buffer[linha * MATRIZ_LADO + coluna] = padrao[linha][coluna];
+  }
+}
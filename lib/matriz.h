@@ -0,0 +1,14 @@
+#ifndef MATRIZ_H
+#define MATRIZ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Matriz WS2812 5x5: buffer liga/desliga por pixel, na ordem de envio
+#define MATRIZ_LADO   5
+#define MATRIZ_PIXELS (MATRIZ_LADO * MATRIZ_LADO)
+
+// Copia um padrão 5x5 (linha, coluna) para o buffer de pixels
+void matriz_carregar(bool buffer[MATRIZ_PIXELS], const bool padrao[MATRIZ_LADO][MATRIZ_LADO]);
+
+#endif
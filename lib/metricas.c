@@ -0,0 +1,299 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "metricas.h"
+
+#if PICO_ON_DEVICE || defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+static const uint32_t limites_us[METRICAS_BALDES - 1] = METRICAS_LIMITES_US;
+
+void metricas_hist_registrar(metricas_hist_t *h, uint32_t valor_us) {
+  uint8_t i = 0;
+  while (i < METRICAS_BALDES - 1 && valor_us > limites_us[i])
+    i++;
+  h->contagem[i]++;
+  h->soma_us += valor_us;
+}
+
+void metricas_heap(uint32_t *usado, uint32_t *pico) {
+  static uint32_t maior;
+  uint32_t agora = 0, reservado = 0;
+#if PICO_ON_DEVICE
+  // newlib: arena = heap obtido por sbrk, uordblks = blocos em uso
+  struct mallinfo mi = mallinfo();
+  agora = (uint32_t)mi.uordblks;
+  reservado = (uint32_t)mi.arena;
+#elif defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  struct mallinfo2 mi = mallinfo2();
+  agora = (uint32_t)mi.uordblks;
+  reservado = (uint32_t)mi.arena;
+#endif
+  if (reservado > maior)
+    maior = reservado;
+  *usado = agora;
+  *pico = maior;
+}
+
+// ====== DESCRIÇÃO DAS MÉTRICAS ======
+typedef enum { CONTADOR, GAUGE } tipo_t;
+
+typedef struct {
+  const char *nome;        // no JSON sem o prefixo "rover_"
+  const char *ajuda;
+  uint8_t tipo;
+  uint8_t com_sinal;
+  uint16_t campo;          // offsetof em metricas_snapshot_t
+} escalar_t;
+
+#define CAMPO(c) (uint16_t)offsetof(metricas_snapshot_t, c)
+
+static const escalar_t escalares[] = {
+  { "uptime_ms",                "Tempo desde o boot",                      CONTADOR, 0, CAMPO(uptime_ms) },
+  { "link_up",                  "1 se o controlador responde",             GAUGE,    0, CAMPO(link_ok) },
+  { "udp_rx_packets_total",     "Datagramas recebidos do controlador",     CONTADOR, 0, CAMPO(cont.udp_rx) },
+  { "udp_rx_bytes_total",       "Bytes recebidos do controlador",          CONTADOR, 0, CAMPO(cont.udp_rx_bytes) },
+  { "udp_tx_packets_total",     "Datagramas enviados",                     CONTADOR, 0, CAMPO(cont.udp_tx) },
+  { "udp_tx_bytes_total",       "Bytes enviados",                          CONTADOR, 0, CAMPO(cont.udp_tx_bytes) },
+  { "udp_tx_errors_total",      "Envios recusados pelo lwIP",              CONTADOR, 0, CAMPO(cont.udp_tx_erros) },
+  { "pings_sent_total",         "PINGs enviados",                          CONTADOR, 0, CAMPO(pings) },
+  { "pongs_total",              "PONGs validos recebidos",                 CONTADOR, 0, CAMPO(pongs) },
+  { "ping_loss_percent",        "Perda de PING/PONG",                      GAUGE,    0, CAMPO(perda_pct) },
+  { "rtt_us",                   "Ultima amostra de RTT",                   GAUGE,    1, CAMPO(rtt_us) },
+  { "srtt_us",                  "RTT suavizado",                           GAUGE,    1, CAMPO(srtt_us) },
+  { "rttvar_us",                "Variacao do RTT",                         GAUGE,    1, CAMPO(rttvar_us) },
+  { "wifi_rssi_dbm",            "RSSI da rede atual",                      GAUGE,    1, CAMPO(rssi_dbm) },
+  { "heap_used_bytes",          "Heap da libc em uso",                     GAUGE,    0, CAMPO(heap_usado) },
+  { "heap_peak_bytes",          "Maior heap reservado",                    GAUGE,    0, CAMPO(heap_pico) },
+  { "lwip_mem_used_bytes",      "Heap do lwIP em uso",                     GAUGE,    0, CAMPO(lwip_mem_usado) },
+  { "lwip_mem_peak_bytes",      "Maior uso do heap do lwIP",               GAUGE,    0, CAMPO(lwip_mem_pico) },
+  { "lwip_mem_size_bytes",      "Tamanho do heap do lwIP (MEM_SIZE)",      GAUGE,    0, CAMPO(lwip_mem_total) },
+  { "lwip_mem_errors_total",    "Alocacoes recusadas pelo heap do lwIP",   CONTADOR, 0, CAMPO(lwip_mem_erros) },
+  { "log_dropped_total",        "Registros de log descartados",            CONTADOR, 0, CAMPO(log_descartados) },
+  { "power_state",              "0 ativo, 1 ocioso, 2 dormindo",           GAUGE,    0, CAMPO(energia_estado) },
+  { "clk_sys_khz",              "Frequencia atual do clk_sys",             GAUGE,    0, CAMPO(clk_sys_khz) },
+  { "reset_reason",             "0 energia, 2 watchdog, 3 tarefa atrasada, 4 pedido", GAUGE, 0, CAMPO(reinicio_motivo) },
+  { "watchdog_resets_total",    "Reinicios por falha desde o ultimo boot limpo", CONTADOR, 0, CAMPO(reinicios_falha) },
+  { "i2c_recoveries_total",     "Recuperacoes do barramento I2C do OLED",  CONTADOR, 0, CAMPO(i2c_recuperacoes) },
+  { "cmd_frames_total",         "Quadros de comando enviados",             CONTADOR, 0, CAMPO(cmd_quadros) },
+  { "cmd_frames_saved_total",   "Quadros poupados frente ao envio fixo",   CONTADOR, 0, CAMPO(cmd_poupados) },
+  { "cmd_event_frames_total",   "Quadros enviados por evento de botao",    CONTADOR, 0, CAMPO(cmd_eventos) },
+  { "cmd_keepalive_frames_total", "Quadros de keepalive em repouso",       CONTADOR, 0, CAMPO(cmd_keepalives) },
+};
+#define NUM_ESCALARES (sizeof(escalares) / sizeof(escalares[0]))
+
+typedef struct {
+  const char *nome;
+  const char *ajuda;
+  uint16_t campo;
+} histograma_t;
+
+static const histograma_t histogramas[] = {
+  { "loop_jitter_us",  "Atraso da tarefa de controle sobre o agendado", CAMPO(cont.laco) },
+  { "cmd_jitter_us",   "Desvio do intervalo entre quadros de comando",  CAMPO(cont.cmd) },
+  { "wake_latency_us", "Do evento de despertar ao nivel ativo",         CAMPO(cont.despertar) },
+  { "button_latency_us", "Do toque no botao ao quadro de comando",    CAMPO(cont.botao) },
+};
+#define NUM_HISTOGRAMAS (sizeof(histogramas) / sizeof(histogramas[0]))
+
+// Campos de cada pool, na ordem de metricas_pool_t
+static const struct {
+  const char *nome;
+  const char *ajuda;
+  uint8_t tipo;
+} campos_pool[] = {
+  { "used",         "Elementos em uso",    GAUGE },
+  { "peak",         "Maior uso",           GAUGE },
+  { "size",         "Tamanho do pool",     GAUGE },
+  { "errors_total", "Alocacoes recusadas", CONTADOR },
+};
+
+// Itens: escalares, histogramas, pools do lwIP e o fechamento do JSON
+#define ITEM_HIST   NUM_ESCALARES
+#define ITEM_POOLS  (ITEM_HIST + NUM_HISTOGRAMAS)
+#define ITEM_FIM    (ITEM_POOLS + 1)
+#define NUM_ITENS   (ITEM_FIM + 1)
+
+#define FEITO ((size_t)-1)
+
+// Anexa com snprintf; `usado` cresce mesmo sem espaço (indica que não coube)
+static void anexar(char *buf, size_t tam, size_t *usado, const char *fmt, ...) {
+  size_t resto = *usado < tam ? tam - *usado : 0;
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(resto ? buf + *usado : NULL, resto, fmt, ap);
+  va_end(ap);
+  if (n > 0)
+    *usado += (size_t)n;
+}
+
+static void cabecalho_prom(char *buf, size_t tam, size_t *u, const char *nome, const char *sufixo,
+                           const char *ajuda, const char *tipo) {
+  anexar(buf, tam, u, "# HELP rover_%s%s %s\n# TYPE rover_%s%s %s\n",
+         nome, sufixo, ajuda, nome, sufixo, tipo);
+}
+
+static size_t gerar_escalar(const metricas_snapshot_t *s, metricas_formato_t f, uint16_t item,
+                            uint16_t sub, char *buf, size_t tam) {
+  const escalar_t *e = &escalares[item];
+  if (sub > 0)
+    return FEITO;
+  const uint8_t *base = (const uint8_t *)s + e->campo;
+  long valor;
+  if (e->com_sinal) {
+    int32_t v;
+    memcpy(&v, base, sizeof(v));
+    valor = (long)v;
+  } else {
+    uint32_t v;
+    memcpy(&v, base, sizeof(v));
+    valor = (long)v;
+  }
+
+  size_t u = 0;
+  if (f == METRICAS_JSON) {
+    anexar(buf, tam, &u, "%s\"%s\":%ld", item == 0 ? "{" : ",", e->nome, valor);
+  } else {
+    cabecalho_prom(buf, tam, &u, e->nome, "", e->ajuda, e->tipo == CONTADOR ? "counter" : "gauge");
+    anexar(buf, tam, &u, "rover_%s %ld\n", e->nome, valor);
+  }
+  return u;
+}
+
+static size_t gerar_histograma(const metricas_snapshot_t *s, metricas_formato_t f, uint16_t item,
+                               uint16_t sub, char *buf, size_t tam) {
+  const histograma_t *h = &histogramas[item - ITEM_HIST];
+  const metricas_hist_t *v = (const metricas_hist_t *)((const uint8_t *)s + h->campo);
+  size_t u = 0;
+
+  if (f == METRICAS_JSON) {
+    switch (sub) {
+      case 0:
+        anexar(buf, tam, &u, ",\"%s\":{\"le\":[", h->nome);
+        for (int i = 0; i < METRICAS_BALDES - 1; i++)
+          anexar(buf, tam, &u, "%s%lu", i ? "," : "", (unsigned long)limites_us[i]);
+        anexar(buf, tam, &u, "]");
+        return u;
+      case 1:
+        anexar(buf, tam, &u, ",\"count\":[");
+        for (int i = 0; i < METRICAS_BALDES; i++)
+          anexar(buf, tam, &u, "%s%lu", i ? "," : "", (unsigned long)v->contagem[i]);
+        anexar(buf, tam, &u, "]");
+        return u;
+      case 2:
+        anexar(buf, tam, &u, ",\"sum\":%llu}", (unsigned long long)v->soma_us);
+        return u;
+      default:
+        return FEITO;
+    }
+  }
+
+  // Prometheus: cabeçalho, baldes acumulados, +Inf, _sum e _count
+  uint32_t acumulado = 0;
+  for (int i = 0; i < METRICAS_BALDES && i < sub; i++)
+    acumulado += v->contagem[i];
+  if (sub == 0) {
+    cabecalho_prom(buf, tam, &u, h->nome, "", h->ajuda, "histogram");
+  } else if (sub < METRICAS_BALDES) {
+    anexar(buf, tam, &u, "rover_%s_bucket{le=\"%lu\"} %lu\n", h->nome,
+           (unsigned long)limites_us[sub - 1], (unsigned long)acumulado);
+  } else if (sub == METRICAS_BALDES) {
+    anexar(buf, tam, &u, "rover_%s_bucket{le=\"+Inf\"} %lu\n", h->nome, (unsigned long)acumulado);
+  } else if (sub == METRICAS_BALDES + 1) {
+    anexar(buf, tam, &u, "rover_%s_sum %llu\n", h->nome, (unsigned long long)v->soma_us);
+  } else if (sub == METRICAS_BALDES + 2) {
+    anexar(buf, tam, &u, "rover_%s_count %lu\n", h->nome, (unsigned long)acumulado);
+  } else {
+    return FEITO;
+  }
+  return u;
+}
+
+static uint32_t campo_pool(const metricas_pool_t *p, int campo) {
+  switch (campo) {
+    case 0: return p->usado;
+    case 1: return p->pico;
+    case 2: return p->total;
+    default: return p->erros;
+  }
+}
+
+static size_t gerar_pools(const metricas_snapshot_t *s, metricas_formato_t f, uint16_t sub,
+                          char *buf, size_t tam) {
+  size_t u = 0;
+  uint16_t n = s->n_pools;
+
+  if (f == METRICAS_JSON) {
+    if (sub == 0) {
+      anexar(buf, tam, &u, ",\"lwip_pools\":{");
+    } else if (sub <= n) {
+      const metricas_pool_t *p = &s->pools[sub - 1];
+      anexar(buf, tam, &u, "%s\"%s\":{\"used\":%lu,\"peak\":%lu,\"size\":%lu,\"errors\":%lu}",
+             sub > 1 ? "," : "", p->nome, (unsigned long)p->usado, (unsigned long)p->pico,
+             (unsigned long)p->total, (unsigned long)p->erros);
+    } else if (sub == n + 1) {
+      anexar(buf, tam, &u, "}");
+    } else {
+      return FEITO;
+    }
+    return u;
+  }
+
+  // Prometheus: um cabeçalho por campo seguido de uma linha por pool
+  uint16_t campo = sub / (n + 1);
+  uint16_t j = sub % (n + 1);
+  if (campo >= sizeof(campos_pool) / sizeof(campos_pool[0]))
+    return FEITO;
+  if (j == 0) {
+    anexar(buf, tam, &u, "# HELP rover_lwip_pool_%s %s\n# TYPE rover_lwip_pool_%s %s\n",
+           campos_pool[campo].nome, campos_pool[campo].ajuda, campos_pool[campo].nome,
+           campos_pool[campo].tipo == CONTADOR ? "counter" : "gauge");
+  } else {
+    const metricas_pool_t *p = &s->pools[j - 1];
+    anexar(buf, tam, &u, "rover_lwip_pool_%s{pool=\"%s\"} %lu\n", campos_pool[campo].nome,
+           p->nome, (unsigned long)campo_pool(p, campo));
+  }
+  return u;
+}
+
+static size_t gerar_item(const metricas_snapshot_t *s, metricas_formato_t f, uint16_t item,
+                         uint16_t sub, char *buf, size_t tam) {
+  if (item < ITEM_HIST)
+    return gerar_escalar(s, f, item, sub, buf, tam);
+  if (item < ITEM_POOLS)
+    return gerar_histograma(s, f, item, sub, buf, tam);
+  if (item == ITEM_POOLS)
+    return gerar_pools(s, f, sub, buf, tam);
+  if (f == METRICAS_JSON && sub == 0) {
+    size_t u = 0;
+    anexar(buf, tam, &u, "}\n");
+    return u;
+  }
+  return FEITO;
+}
+
+size_t metricas_gerar(const metricas_snapshot_t *s, metricas_formato_t formato,
+                      metricas_cursor_t *c, char *buf, size_t tam) {
+  size_t usado = 0;
+  while (c->item < NUM_ITENS) {
+    size_t n = gerar_item(s, formato, c->item, c->sub, buf + usado, tam - usado);
+    if (n == FEITO) {
+      c->item++;
+      c->sub = 0;
+      continue;
+    }
+    if (usado + n >= tam) {
+      // Não coube: fica para o próximo bloco. Num bloco vazio a linha não
+      // cabe nunca; é pulada para a resposta não travar
+      if (usado == 0) {
+        c->sub++;
+        continue;
+      }
+      break;
+    }
+    usado += n;
+    c->sub++;
+  }
+  return usado;
+}
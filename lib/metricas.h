@@ -0,0 +1,105 @@
+#ifndef METRICAS_H
+#define METRICAS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Métricas de execução do firmware, servidas em JSON e no formato texto do
+// Prometheus pelo servidor de status (porta 80 em modo STA).
+//
+// O laço e os callbacks só incrementam contadores em `metricas_t`. Na hora
+// da requisição o firmware tira uma cópia (`metricas_snapshot_t`) com os
+// valores instantâneos (RTT, RSSI, heap, pools do lwIP) e metricas_gerar()
+// produz o corpo aos pedaços, linha a linha, direto no bloco que vai para
+// tcp_write: a resposta inteira nunca existe na memória.
+
+// Limites superiores dos baldes dos histogramas de jitter (us); o último
+// balde (+Inf) fica implícito
+#define METRICAS_LIMITES_US { 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000 }
+#define METRICAS_BALDES     10
+
+#define METRICAS_POOLS      5
+
+typedef struct {
+  uint32_t contagem[METRICAS_BALDES];   // não acumulada; o último é +Inf
+  uint64_t soma_us;
+} metricas_hist_t;
+
+// Contadores acumulados desde o boot
+typedef struct {
+  uint32_t udp_rx;
+  uint32_t udp_rx_bytes;
+  uint32_t udp_tx;
+  uint32_t udp_tx_bytes;
+  uint32_t udp_tx_erros;
+  metricas_hist_t laco;         // atraso de cada execução da tarefa de controle sobre o agendado
+  metricas_hist_t cmd;          // |intervalo entre quadros de comando - nominal|
+  metricas_hist_t despertar;    // do evento (botão, joystick) ao nível ATIVO aplicado
+  metricas_hist_t botao;        // do toque num botão ao quadro de comando que o leva
+} metricas_t;
+
+// Um pool do lwIP (memp)
+typedef struct {
+  const char *nome;
+  uint32_t usado;
+  uint32_t pico;
+  uint32_t total;
+  uint32_t erros;
+} metricas_pool_t;
+
+typedef struct {
+  metricas_t cont;
+  uint32_t uptime_ms;
+  uint32_t link_ok;
+  uint32_t pings;
+  uint32_t pongs;
+  uint32_t perda_pct;
+  int32_t rtt_us;
+  int32_t srtt_us;
+  int32_t rttvar_us;
+  int32_t rssi_dbm;
+  uint32_t heap_usado;
+  uint32_t heap_pico;
+  uint32_t lwip_mem_usado;
+  uint32_t lwip_mem_pico;
+  uint32_t lwip_mem_total;
+  uint32_t lwip_mem_erros;
+  uint32_t log_descartados;
+  uint32_t energia_estado;      // energia_estado_t
+  uint32_t clk_sys_khz;
+  uint32_t reinicio_motivo;     // supervisor_motivo_t do boot atual
+  uint32_t reinicios_falha;     // por watchdog ou tarefa atrasada desde o último boot limpo
+  uint32_t i2c_recuperacoes;
+  uint32_t cmd_quadros;         // Quadros de comando (sem os de paridade)
+  uint32_t cmd_poupados;        // A menos que o envio fixo a cada CMD_INTERVALO_MS
+  uint32_t cmd_eventos;
+  uint32_t cmd_keepalives;
+  metricas_pool_t pools[METRICAS_POOLS];
+  uint8_t n_pools;
+} metricas_snapshot_t;
+
+typedef enum {
+  METRICAS_JSON,
+  METRICAS_PROMETHEUS,
+} metricas_formato_t;
+
+// Posição da geração entre chamadas (zerada no início de cada resposta)
+typedef struct {
+  uint16_t item;
+  uint16_t sub;
+} metricas_cursor_t;
+
+// Conta uma amostra de `valor_us` no balde certo
+void metricas_hist_registrar(metricas_hist_t *h, uint32_t valor_us);
+
+// Heap da libc em uso e maior tamanho já alcançado (bytes)
+void metricas_heap(uint32_t *usado, uint32_t *pico);
+
+// Escreve no buffer quantas linhas inteiras couberem a partir do cursor e o
+// avança; retorna os bytes escritos (0 = resposta completa). Um buffer de
+// 192 bytes comporta qualquer linha.
+size_t metricas_gerar(const metricas_snapshot_t *s, metricas_formato_t formato,
+                      metricas_cursor_t *c, char *buf, size_t tam);
+
+#endif
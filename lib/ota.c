@@ -0,0 +1,185 @@
+#include <string.h>
+#include "ota.h"
+#include "hardware/flash.h"
+
+// Endereços como a imagem os vê (no PC, XIP_BASE aponta para a flash simulada)
+#define OTA_XIP_ENDERECO  0x10000000u
+#define OTA_RAM_INICIO    0x20000000u
+#define OTA_RAM_FIM       0x20042000u
+
+// CRC32 refletido (polinômio 0xEDB88320) meio byte por vez: tabela de 64
+// bytes em vez de 1 KB, ainda muito acima da vazão do Wi-Fi e da flash
+static const uint32_t crc_nibble[16] = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+uint32_t ota_crc32(uint32_t crc, const void *dados, size_t n) {
+  const uint8_t *p = dados;
+  crc = ~crc;
+  while (n--) {
+    crc ^= *p++;
+    crc = (crc >> 4) ^ crc_nibble[crc & 0xF];
+    crc = (crc >> 4) ^ crc_nibble[crc & 0xF];
+  }
+  return ~crc;
+}
+
+static const uint8_t *flash_ptr(uint32_t offset) {
+  return (const uint8_t *)(XIP_BASE + offset);
+}
+
+static bool controle_valido(const ota_controle_t *c) {
+  return c->magico == OTA_MAGICO &&
+         c->crc_registro == ota_crc32(0, c, offsetof(ota_controle_t, crc_registro));
+}
+
+bool ota_controle_ler(ota_controle_t *c) {
+  const ota_controle_t *a = (const ota_controle_t *)flash_ptr(OTA_CONTROLE_OFFSET);
+  const ota_controle_t *b = (const ota_controle_t *)flash_ptr(OTA_CONTROLE_OFFSET + OTA_SETOR);
+  bool va = controle_valido(a), vb = controle_valido(b);
+
+  if (va && (!vb || (int32_t)(a->seq - b->seq) > 0)) {
+    *c = *a;
+    return true;
+  }
+  if (vb) {
+    *c = *b;
+    return true;
+  }
+  memset(c, 0, sizeof(*c));
+  c->magico = OTA_MAGICO;
+  c->slot = 0;
+  c->estado = OTA_CONFIRMADO;
+  return false;
+}
+
+// O setor do registro é o da paridade de seq: o novo nunca apaga o atual,
+// e uma queda de energia no meio deixa o anterior valendo
+void ota_controle_gravar(ota_controle_t *c) {
+  uint8_t pagina[FLASH_PAGE_SIZE];
+  c->magico = OTA_MAGICO;
+  c->seq++;
+  c->crc_registro = ota_crc32(0, c, offsetof(ota_controle_t, crc_registro));
+
+  memset(pagina, 0xFF, sizeof(pagina));
+  memcpy(pagina, c, sizeof(*c));
+  uint32_t offset = OTA_CONTROLE_OFFSET + (c->seq & 1u) * OTA_SETOR;
+  flash_range_erase(offset, OTA_SETOR);
+  flash_range_program(offset, pagina, sizeof(pagina));
+}
+
+int ota_boot_decidir(ota_controle_t *c, const bool valido[2], bool *gravar) {
+  uint8_t s = c->slot & 1u;
+  *gravar = false;
+
+  if (c->estado == OTA_TESTANDO) {
+    if (c->tentativas == 0 || !valido[s]) {
+      // Imagem nova não se confirmou: volta para a anterior
+      s ^= 1u;
+      c->slot = s;
+      c->estado = OTA_CONFIRMADO;
+      c->tentativas = 0;
+    } else {
+      c->tentativas--;
+    }
+    *gravar = true;
+  } else if (!valido[s] && valido[s ^ 1u]) {
+    s ^= 1u;
+    c->slot = s;
+    *gravar = true;
+  }
+  return valido[s] ? s : -1;
+}
+
+bool ota_slot_valido(const ota_controle_t *c, uint8_t slot) {
+  uint32_t offset = OTA_SLOT_OFFSET(slot);
+  const uint8_t *vetores = flash_ptr(offset + OTA_VETORES);
+  uint32_t sp, reset;
+  memcpy(&sp, vetores, sizeof(sp));
+  memcpy(&reset, vetores + 4, sizeof(reset));
+
+  // Pilha na SRAM e reset (Thumb) dentro do próprio slot
+  uint32_t inicio = OTA_XIP_ENDERECO + offset;
+  if (sp < OTA_RAM_INICIO || sp > OTA_RAM_FIM)
+    return false;
+  if (!(reset & 1u) || reset < inicio || reset >= inicio + OTA_SLOT_TAM)
+    return false;
+
+  uint32_t tamanho = c->tamanho[slot];
+  if (!tamanho)
+    return true;   // gravado por UF2: sem CRC conhecido
+  return tamanho <= OTA_SLOT_TAM && ota_crc32(0, flash_ptr(offset), tamanho) == c->crc[slot];
+}
+
+bool ota_receptor_iniciar(ota_receptor_t *r, uint8_t slot, uint32_t tamanho, uint32_t crc) {
+  if (!tamanho || tamanho > OTA_SLOT_TAM)
+    return false;
+  r->slot = slot & 1u;
+  r->tamanho = tamanho;
+  r->crc_esperado = crc;
+  r->recebido = r->gravado = r->crc = 0;
+  r->falha_flash = false;
+  r->enchendo = r->prontos = 0;
+  r->ocupado[0] = r->ocupado[1] = 0;
+  return true;
+}
+
+size_t ota_receber(ota_receptor_t *r, const void *dados, size_t n) {
+  const uint8_t *p = dados;
+  size_t aceitos = 0;
+
+  while (aceitos < n && r->prontos < 2 && r->recebido < r->tamanho) {
+    uint16_t *ocupado = &r->ocupado[r->enchendo];
+    size_t k = n - aceitos;
+    if (k > OTA_SETOR - *ocupado)
+      k = OTA_SETOR - *ocupado;
+    if (k > r->tamanho - r->recebido)
+      k = r->tamanho - r->recebido;
+
+    memcpy(r->buf[r->enchendo] + *ocupado, p + aceitos, k);
+    r->crc = ota_crc32(r->crc, p + aceitos, k);
+    *ocupado += (uint16_t)k;
+    r->recebido += (uint32_t)k;
+    aceitos += k;
+
+    // Setor cheio (ou fim da imagem): fica para a flash, o outro enche
+    if (*ocupado == OTA_SETOR || r->recebido == r->tamanho) {
+      r->prontos++;
+      r->enchendo ^= 1u;
+    }
+  }
+  return aceitos;
+}
+
+bool ota_setor_pronto(const ota_receptor_t *r) {
+  return r->prontos > 0;
+}
+
+bool ota_gravar_setor(ota_receptor_t *r) {
+  if (!r->prontos)
+    return true;
+  // Com os dois cheios, `enchendo` já deu a volta e aponta o mais antigo
+  uint8_t i = r->prontos == 2 ? r->enchendo : r->enchendo ^ 1u;
+  uint32_t offset = OTA_SLOT_OFFSET(r->slot) + r->gravado;
+  uint16_t n = r->ocupado[i];
+
+  memset(r->buf[i] + n, 0xFF, OTA_SETOR - n);   // resto do último setor
+  flash_range_erase(offset, OTA_SETOR);
+  flash_range_program(offset, r->buf[i], OTA_SETOR);
+  bool ok = memcmp(flash_ptr(offset), r->buf[i], OTA_SETOR) == 0;
+
+  r->falha_flash = r->falha_flash || !ok;
+  r->gravado += n;
+  r->ocupado[i] = 0;
+  r->prontos--;
+  return ok;
+}
+
+ota_resultado_t ota_resultado(const ota_receptor_t *r) {
+  if (r->falha_flash)
+    return OTA_ERRO_FLASH;
+  if (r->gravado < r->tamanho)
+    return OTA_INCOMPLETO;
+  return r->crc == r->crc_esperado ? OTA_OK : OTA_ERRO_CRC;
+}
@@ -0,0 +1,118 @@
+#ifndef OTA_H
+#define OTA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Atualização pela rede com dois slots de imagem executados direto da flash
+// (XIP). O seletor de boot (boot/rover_boot.c) fica no início da flash e
+// pula para o slot indicado pelo registro de controle; cada slot tem sua
+// própria imagem, ligada no endereço dele (wifi-portal e wifi-portal-b).
+//
+//   0x000000  seletor de boot (32 KB)
+//   0x008000  registro de controle, dois setores em pingue-pongue
+//   0x010000  slot A (960 KB)
+//   0x100000  slot B (960 KB)
+//   0x1F0000  livre (56 KB)
+//   0x1FE000  redes conhecidas (lib/credenciais.h, 8 KB)
+//
+// O firmware grava a imagem nova no slot inativo enquanto ela chega pelo
+// TCP, um setor de 4 KB por vez (dois buffers: um enche enquanto o outro
+// vai para a flash), com CRC32 incremental e conferência de cada setor
+// gravado. Com a imagem íntegra o registro passa a apontar para o slot
+// novo em TESTANDO: cada boot sem confirmação gasta uma tentativa e, sem
+// tentativas, o seletor volta ao slot anterior.
+//
+// As funções que apagam ou programam a flash precisam rodar com o XIP
+// livre (no firmware, dentro de flash_safe_execute).
+
+#define OTA_SETOR            4096u
+#define OTA_BOOT_TAM         0x008000u
+#define OTA_CONTROLE_OFFSET  0x008000u
+#define OTA_SLOT_OFFSET_A    0x010000u
+#define OTA_SLOT_OFFSET_B    0x100000u
+#define OTA_SLOT_TAM         0x0F0000u
+#define OTA_VETORES          0x100u       // boot2 da imagem antes da tabela de vetores
+#define OTA_TENTATIVAS       3            // boots sem confirmação antes do rollback
+#define OTA_MAGICO           0x4F545652u  // "RVTO"
+#define OTA_TAMANHO_INVALIDO 0xFFFFFFFFu  // slot sendo regravado: nunca é escolhido
+
+#define OTA_SLOT_OFFSET(s)   ((s) ? OTA_SLOT_OFFSET_B : OTA_SLOT_OFFSET_A)
+
+typedef enum {
+  OTA_CONFIRMADO,
+  OTA_TESTANDO,
+} ota_estado_t;
+
+// Registro de controle (um por setor; vale o de maior seq com CRC correto)
+typedef struct {
+  uint32_t magico;
+  uint32_t seq;
+  uint8_t slot;             // slot a executar (0 = A, 1 = B)
+  uint8_t estado;           // ota_estado_t
+  uint8_t tentativas;       // boots restantes em TESTANDO
+  uint8_t reservado;
+  uint32_t tamanho[2];      // bytes da imagem de cada slot (0 = desconhecido, gravado por UF2)
+  uint32_t crc[2];          // CRC32 da imagem de cada slot
+  uint32_t crc_registro;    // CRC32 dos campos acima
+} ota_controle_t;
+
+typedef enum {
+  OTA_INCOMPLETO,
+  OTA_OK,
+  OTA_ERRO_CRC,             // CRC do corpo diferente do anunciado
+  OTA_ERRO_FLASH,           // setor gravado não confere com o recebido
+} ota_resultado_t;
+
+// Recepção de uma imagem para um slot
+typedef struct {
+  uint8_t slot;
+  uint32_t tamanho;         // anunciado (Content-Length)
+  uint32_t crc_esperado;
+  uint32_t recebido;
+  uint32_t gravado;         // bytes já conferidos na flash
+  uint32_t crc;             // CRC32 do que chegou até agora
+  bool falha_flash;
+  uint8_t enchendo;         // buffer que recebe
+  uint8_t prontos;          // setores cheios esperando a flash (0 a 2)
+  uint16_t ocupado[2];
+  uint8_t buf[2][OTA_SETOR];
+} ota_receptor_t;
+
+// CRC32 (IEEE, o mesmo do zlib) incremental: comece com crc = 0
+uint32_t ota_crc32(uint32_t crc, const void *dados, size_t n);
+
+// Lê o registro de controle mais novo; sem nenhum válido, preenche o padrão
+// (slot A confirmado, tamanhos desconhecidos) e retorna false
+bool ota_controle_ler(ota_controle_t *c);
+
+// Grava `c` com seq + 1 no setor que não guarda o atual (flash livre)
+void ota_controle_gravar(ota_controle_t *c);
+
+// Decisão do seletor de boot: rollback sem tentativas ou com o slot
+// inválido, senão gasta uma tentativa; retorna o slot a executar (-1 se
+// nenhum serve) e marca em `gravar` se o registro mudou
+int ota_boot_decidir(ota_controle_t *c, const bool valido[2], bool *gravar);
+
+// Tabela de vetores plausível e, se o tamanho for conhecido, CRC correto
+bool ota_slot_valido(const ota_controle_t *c, uint8_t slot);
+
+// Prepara a recepção; false se o tamanho não cabe no slot
+bool ota_receptor_iniciar(ota_receptor_t *r, uint8_t slot, uint32_t tamanho, uint32_t crc);
+
+// Copia o que couber nos buffers livres; retorna os bytes aceitos (menos
+// que `n` = buffers cheios, tente de novo depois de ota_gravar_setor)
+size_t ota_receber(ota_receptor_t *r, const void *dados, size_t n);
+
+// Há setor cheio esperando a flash
+bool ota_setor_pronto(const ota_receptor_t *r);
+
+// Apaga, programa e confere o próximo setor pronto e libera o buffer
+// (flash livre); false se a conferência falhou
+bool ota_gravar_setor(ota_receptor_t *r);
+
+// Estado da recepção depois de todos os setores gravados
+ota_resultado_t ota_resultado(const ota_receptor_t *r);
+
+#endif
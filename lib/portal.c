@@ -0,0 +1,155 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "portal.h"
+
+// Copia o valor até '&' ou fim, trocando '+' por espaço (URL decode simples)
+static const char *copiar_valor(const char *v, char *destino, size_t tam) {
+  size_t n = 0;
+  for (; *v && *v != '&'; v++) {
+    if (n + 1 < tam)
+      destino[n++] = *v == '+' ? ' ' : *v;
+  }
+  destino[n] = '\0';
+  return v;
+}
+
+void portal_parse_form(const char *corpo, wifi_config_t *config) {
+  const char *p = corpo;
+  while (*p) {
+    const char *igual = strchr(p, '=');
+    const char *fim = strchr(p, '&');
+    if (!igual || (fim && fim < igual)) {
+      // Campo sem valor: pula
+      if (!fim)
+        break;
+      p = fim + 1;
+      continue;
+    }
+
+    size_t nome_len = (size_t)(igual - p);
+    char descarte[1];
+    if (nome_len == 4 && strncmp(p, "ssid", 4) == 0)
+      p = copiar_valor(igual + 1, config->ssid, sizeof(config->ssid));
+    else if (nome_len == 8 && strncmp(p, "password", 8) == 0)
+      p = copiar_valor(igual + 1, config->password, sizeof(config->password));
+    else if (nome_len == 10 && strncmp(p, "prioridade", 10) == 0) {
+      char num[4];
+      p = copiar_valor(igual + 1, num, sizeof(num));
+      config->prioridade = (uint8_t)atoi(num);
+    }
+    else
+      p = copiar_valor(igual + 1, descarte, sizeof(descarte));
+
+    if (*p == '&')
+      p++;
+  }
+  config->received = true;
+}
+
+bool portal_cabecalho(const char *requisicao, const char *nome, char *valor, size_t tam) {
+  size_t nome_len = strlen(nome);
+  // Pula a linha do pedido; os cabeçalhos terminam na linha vazia
+  const char *linha = strstr(requisicao, "\r\n");
+  while (linha && linha[2] != '\r' && linha[2] != '\0') {
+    linha += 2;
+    size_t i = 0;
+    while (i < nome_len && linha[i] && tolower((unsigned char)linha[i]) == tolower((unsigned char)nome[i]))
+      i++;
+    const char *fim = strstr(linha, "\r\n");
+    if (i == nome_len && linha[i] == ':') {
+      const char *v = linha + i + 1;
+      while (*v == ' ' || *v == '\t')
+        v++;
+      size_t n = fim ? (size_t)(fim - v) : strlen(v);
+      while (n && (v[n - 1] == ' ' || v[n - 1] == '\t'))
+        n--;
+      if (n >= tam)
+        n = tam - 1;
+      memcpy(valor, v, n);
+      valor[n] = '\0';
+      return true;
+    }
+    linha = fim;
+  }
+  return false;
+}
+
+// Accept-Encoding com gzip (ou *) sem q=0
+static bool aceita_gzip(const char *v) {
+  while (*v) {
+    while (*v == ' ' || *v == ',')
+      v++;
+    size_t n = strcspn(v, ";,");
+    bool gzip = (n == 4 && strncasecmp(v, "gzip", 4) == 0) || (n == 1 && *v == '*');
+    v += n;
+    bool zero = false;
+    if (*v == ';') {
+      const char *q = strstr(v, "q=");
+      const char *fim = v + strcspn(v, ",");
+      if (q && q < fim)
+        zero = strtod(q + 2, NULL) == 0.0;
+      v = fim;
+    }
+    if (gzip && !zero)
+      return true;
+  }
+  return false;
+}
+
+// If-None-Match: lista de ETags (comparação fraca, W/ ignorado) ou *
+static bool etag_confere(const char *v, const char *etag) {
+  size_t n_etag = strlen(etag);
+  while (*v) {
+    while (*v == ' ' || *v == ',')
+      v++;
+    if (*v == '*')
+      return true;
+    if (strncmp(v, "W/", 2) == 0)
+      v += 2;
+    size_t n = strcspn(v, ", ");
+    if (n == n_etag && strncmp(v, etag, n) == 0)
+      return true;
+    v += n;
+  }
+  return false;
+}
+
+size_t portal_resposta(char *buf, size_t tam, const portal_asset_t *a, const char *requisicao,
+                       bool cache, const uint8_t **corpo, size_t *tam_corpo) {
+  char valor[128];
+  bool gz = portal_cabecalho(requisicao, "Accept-Encoding", valor, sizeof(valor)) && aceita_gzip(valor);
+  const char *etag = gz ? a->etag_gz : a->etag;
+  bool nao_mudou = cache && portal_cabecalho(requisicao, "If-None-Match", valor, sizeof(valor)) &&
+                   etag_confere(valor, etag);
+
+  *corpo = nao_mudou ? NULL : gz ? a->gz : a->corpo;
+  *tam_corpo = nao_mudou ? 0 : gz ? a->tam_gz : a->tam;
+  int n;
+  if (nao_mudou)
+    n = snprintf(buf, tam,
+                 "HTTP/1.1 304 Not Modified\r\n"
+                 "ETag: %s\r\n"
+                 "Cache-Control: no-cache\r\n"
+                 "Vary: Accept-Encoding\r\n"
+                 "Connection: close\r\n"
+                 "\r\n",
+                 etag);
+  else
+    n = snprintf(buf, tam,
+                 "HTTP/1.1 200 OK\r\n"
+                 "Content-Type: %s\r\n"
+                 "Content-Length: %u\r\n"
+                 "%s"
+                 "%s%s%s"
+                 "Cache-Control: %s\r\n"
+                 "Vary: Accept-Encoding\r\n"
+                 "Connection: close\r\n"
+                 "\r\n",
+                 a->tipo, (unsigned)*tam_corpo, gz ? "Content-Encoding: gzip\r\n" : "",
+                 cache ? "ETag: " : "", cache ? etag : "", cache ? "\r\n" : "",
+                 cache ? "no-cache" : "no-store");
+  return (n < 0 || (size_t)n >= tam) ? 0 : (size_t)n;
+}
@@ -0,0 +1,52 @@
+#ifndef PORTAL_H
+#define PORTAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Portal de configuração Wi-Fi: formulário enviado por POST /save
+// ("ssid=...&password=...", codificação application/x-www-form-urlencoded).
+//
+// As páginas (portal/*.html) são minificadas e comprimidas no build por
+// tools/portal_assets.py e ficam na flash com uma ETag forte por
+// representação: o corpo sai em gzip para quem aceita e um If-None-Match
+// que confere responde 304 sem corpo.
+
+typedef struct {
+  char ssid[33];
+  char password[64];
+  uint8_t prioridade;       // campo opcional "prioridade" (0 a 9)
+  bool received;
+} wifi_config_t;
+
+// Página do portal na flash (portal_assets.c, gerado no build)
+typedef struct {
+  const char *tipo;         // Content-Type
+  const uint8_t *corpo;     // minificado
+  uint32_t tam;
+  const uint8_t *gz;        // o mesmo corpo em gzip
+  uint32_t tam_gz;
+  const char *etag;         // com aspas, como vai no cabeçalho
+  const char *etag_gz;
+} portal_asset_t;
+
+extern const portal_asset_t portal_pagina_setup;
+extern const portal_asset_t portal_pagina_sucesso;
+
+// Lê os campos do corpo do formulário; valores longos demais são truncados
+void portal_parse_form(const char *corpo, wifi_config_t *config);
+
+// Monta os cabeçalhos da resposta com a página `a` para `requisicao`: gzip
+// se o Accept-Encoding aceita e, com `cache`, ETag e 304 quando o
+// If-None-Match confere (sem `cache`, no-store). Aponta `corpo`/`tam_corpo`
+// para os bytes a enviar depois dos cabeçalhos (vazio no 304); retorna o
+// tamanho dos cabeçalhos (0 se não couberem)
+size_t portal_resposta(char *buf, size_t tam, const portal_asset_t *a, const char *requisicao,
+                       bool cache, const uint8_t **corpo, size_t *tam_corpo);
+
+// Valor do cabeçalho `nome` (sem diferenciar maiúsculas) nos cabeçalhos de
+// `requisicao`, copiado sem espaços nas pontas; false se não existe
+bool portal_cabecalho(const char *requisicao, const char *nome, char *valor, size_t tam);
+
+#endif
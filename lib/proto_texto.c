@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "proto_texto.h"
+
+bool proto_campo_u32(const char *msg, const char *chave, uint32_t *valor) {
+  const char *pos = strstr(msg, chave);
+  if (!pos)
+    return false;
+  *valor = (uint32_t)strtoul(pos + strlen(chave), NULL, 10);
+  return true;
+}
+
+bool proto_campo_texto(const char *msg, const char *chave, char *buf, size_t tam) {
+  const char *pos = strstr(msg, chave);
+  if (!pos || !tam)
+    return false;
+  pos += strlen(chave);
+  size_t n = strcspn(pos, ",");
+  if (n >= tam)
+    return false;
+  memcpy(buf, pos, n);
+  buf[n] = '\0';
+  return true;
+}
+
+bool proto_ler_status(const char *msg, proto_status_t *st) {
+  const char *score = strstr(msg, "score=");
+  st->tem_score = score != NULL;
+  st->score = score ? (int32_t)atoi(score + 6) : 0;
+  st->tem_evack = proto_campo_u32(msg, ",evack=", &st->evack);
+  return st->tem_score || st->tem_evack;
+}
+
+// snprintf truncado conta como falha: a mensagem nunca sai pela metade
+static size_t resultado(int n, size_t tam) {
+  return (n < 0 || (size_t)n >= tam) ? 0 : (size_t)n;
+}
+
+proto_papel_t proto_ler_papel(const char *msg) {
+  char papel[12];
+  if (!proto_campo_texto(msg, ",role=", papel, sizeof(papel)))
+    return PROTO_PAPEL_NENHUM;
+  return strcmp(papel, "spectator") == 0 ? PROTO_PAPEL_ESPECTADOR : PROTO_PAPEL_DONO;
+}
+
+size_t proto_hello(char *buf, size_t tam, uint32_t sessao_id, const char *token, const char *rover) {
+  int n = snprintf(buf, tam, "HELLO,sid=%08lx", (unsigned long)sessao_id);
+  if (token && *token && n >= 0 && (size_t)n < tam)
+    n += snprintf(buf + n, tam - n, ",token=%s", token);
+  if (rover && *rover && n >= 0 && (size_t)n < tam)
+    n += snprintf(buf + n, tam - n, ",rover=%s", rover);
+  return resultado(n, tam);
+}
+
+size_t proto_tomar(char *buf, size_t tam, const char *token) {
+  return resultado(snprintf(buf, tam, "TAKE,token=%s", token), tam);
+}
+
+size_t proto_descoberta(char *buf, size_t tam, const char *nome, uint16_t porta) {
+  return resultado(snprintf(buf, tam, "DISCOVER,name=%s,port=%u", nome, porta), tam);
+}
+
+size_t proto_ping(char *buf, size_t tam, uint32_t seq, uint32_t t1) {
+  return resultado(snprintf(buf, tam, "PING,seq=%lu,t1=%lu",
+                            (unsigned long)seq, (unsigned long)t1), tam);
+}
+
+size_t proto_pong(char *buf, size_t tam, uint32_t seq, uint32_t t1, uint32_t t2, uint32_t t3) {
+  return resultado(snprintf(buf, tam, "PONG,seq=%lu,t1=%lu,t2=%lu,t3=%lu",
+                            (unsigned long)seq, (unsigned long)t1,
+                            (unsigned long)t2, (unsigned long)t3), tam);
+}
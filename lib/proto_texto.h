@@ -0,0 +1,49 @@
+#ifndef PROTO_TEXTO_H
+#define PROTO_TEXTO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Mensagens de texto do protocolo com o simulador (descoberta, sessão e
+// medição de RTT). Todas são "TIPO,chave=valor,..." sem terminador; as
+// funções de montagem retornam o tamanho escrito (0 se não couber).
+
+#define PROTO_TOKEN_MAX   17    // Token de sessão do ACK (16 hex) + NUL
+
+// Extrai o número que segue `chave` (p.ex. ",seq=") em `msg`
+bool proto_campo_u32(const char *msg, const char *chave, uint32_t *valor);
+
+// Copia o texto que segue `chave` até a próxima vírgula; false se faltar
+// ou não couber em `tam`
+bool proto_campo_texto(const char *msg, const char *chave, char *buf, size_t tam);
+
+// Campos do status do simulador usados pelo firmware
+typedef struct {
+  bool tem_score;
+  int32_t score;
+  bool tem_evack;
+  uint32_t evack;     // evt_seq confirmado
+} proto_status_t;
+
+// Lê "speed=..,...,score=N,evack=M"; retorna false se não houver nenhum dos dois
+bool proto_ler_status(const char *msg, proto_status_t *st);
+
+// Papel no rover, do ACK ou de um LEASE,role=... (troca de dono)
+typedef enum {
+  PROTO_PAPEL_NENHUM,       // mensagem sem role=
+  PROTO_PAPEL_DONO,         // dirige: os comandos valem
+  PROTO_PAPEL_ESPECTADOR,   // só recebe o status; os comandos são descartados
+} proto_papel_t;
+
+proto_papel_t proto_ler_papel(const char *msg);
+
+// "HELLO,sid=<hex>"; com token (do ACK anterior) retoma a sessão, com
+// rover entra num rover já existente. Ambos podem ser NULL
+size_t proto_hello(char *buf, size_t tam, uint32_t sessao_id, const char *token, const char *rover);
+size_t proto_tomar(char *buf, size_t tam, const char *token);
+size_t proto_descoberta(char *buf, size_t tam, const char *nome, uint16_t porta);
+size_t proto_ping(char *buf, size_t tam, uint32_t seq, uint32_t t1);
+size_t proto_pong(char *buf, size_t tam, uint32_t seq, uint32_t t1, uint32_t t2, uint32_t t3);
+
+#endif
@@ -0,0 +1,143 @@
+#include "provisao.h"
+
+const char *const provisao_nomes_estado[PROVISAO_NUM_ESTADOS] = {
+  "varrendo", "conhecida", "ap_subindo", "aguardando", "escoando",
+  "associando", "verificado", "operando", "falha_ap", "falha_rede",
+};
+
+// Prazo de cada estado (0 = sem prazo: só sai por evento)
+static const uint32_t prazos_ms[PROVISAO_NUM_ESTADOS] = {
+  [PROVISAO_VARRENDO]    = PROVISAO_VARREDURA_MS,
+  [PROVISAO_CONHECIDA]   = PROVISAO_CONHECIDA_MS,
+  [PROVISAO_AP_SUBINDO]  = PROVISAO_AP_MS,
+  [PROVISAO_ESCOANDO]    = PROVISAO_ESCOAR_MS,
+  [PROVISAO_ASSOCIANDO]  = PROVISAO_ASSOCIAR_MS,
+  [PROVISAO_VERIFICADO]  = PROVISAO_VERIFICADO_MS,
+  [PROVISAO_FALHA_AP]    = PROVISAO_FALHA_MS,
+  [PROVISAO_FALHA_REDE]  = PROVISAO_FALHA_MS,
+};
+
+static bool mudar(provisao_t *p, provisao_estado_t estado, uint8_t tentativa, uint32_t agora_ms) {
+  p->estado = estado;
+  p->tentativa = tentativa;
+  p->desde_ms = agora_ms;
+  return true;
+}
+
+// Associação recusada ou sem enlace no prazo: próxima candidata (ou
+// tentativa); sem nenhuma, o portal
+static bool falhou(provisao_t *p, uint32_t agora_ms) {
+  if (p->estado == PROVISAO_CONHECIDA) {
+    if (p->tentativa + 1 < p->candidatas)
+      return mudar(p, PROVISAO_CONHECIDA, p->tentativa + 1, agora_ms);
+    return mudar(p, PROVISAO_AP_SUBINDO, 0, agora_ms);
+  }
+  if (p->tentativa + 1 < PROVISAO_TENTATIVAS)
+    return mudar(p, PROVISAO_ASSOCIANDO, p->tentativa + 1, agora_ms);
+  p->falhas++;
+  return mudar(p, PROVISAO_FALHA_REDE, 0, agora_ms);
+}
+
+void provisao_iniciar(provisao_t *p, uint8_t conhecidas, uint32_t agora_ms) {
+  p->candidatas = 0;
+  p->falhas = 0;
+  p->conhecida = false;
+  mudar(p, conhecidas ? PROVISAO_VARRENDO : PROVISAO_AP_SUBINDO, 0, agora_ms);
+}
+
+bool provisao_evento(provisao_t *p, provisao_evento_t ev, uint32_t agora_ms) {
+  switch (p->estado) {
+  case PROVISAO_VARRENDO:
+    if (ev == PROVISAO_EV_BOTAO)
+      return mudar(p, PROVISAO_AP_SUBINDO, 0, agora_ms);
+    break;
+
+  case PROVISAO_CONHECIDA:
+    if (ev == PROVISAO_EV_ENLACE) {
+      p->conhecida = true;
+      return mudar(p, PROVISAO_VERIFICADO, p->tentativa, agora_ms);
+    }
+    if (ev == PROVISAO_EV_ENLACE_FALHA)
+      return falhou(p, agora_ms);
+    if (ev == PROVISAO_EV_BOTAO)
+      return mudar(p, PROVISAO_AP_SUBINDO, 0, agora_ms);
+    break;
+
+  case PROVISAO_AP_SUBINDO:
+    if (ev == PROVISAO_EV_AP_PRONTO)
+      return mudar(p, PROVISAO_AGUARDANDO, 0, agora_ms);
+    if (ev == PROVISAO_EV_AP_FALHA)
+      return mudar(p, PROVISAO_FALHA_AP, 0, agora_ms);
+    break;
+
+  case PROVISAO_AGUARDANDO:
+    if (ev == PROVISAO_EV_CREDENCIAIS)
+      return mudar(p, PROVISAO_ESCOANDO, 0, agora_ms);
+    break;
+
+  case PROVISAO_ESCOANDO:
+    if (ev == PROVISAO_EV_ENTREGUE)
+      return mudar(p, PROVISAO_ASSOCIANDO, 0, agora_ms);
+    break;
+
+  case PROVISAO_ASSOCIANDO:
+    if (ev == PROVISAO_EV_ENLACE) {
+      p->conhecida = false;
+      return mudar(p, PROVISAO_VERIFICADO, p->tentativa, agora_ms);
+    }
+    if (ev == PROVISAO_EV_ENLACE_FALHA)
+      return falhou(p, agora_ms);
+    break;
+
+  case PROVISAO_FALHA_AP:
+  case PROVISAO_FALHA_REDE:
+    if (ev == PROVISAO_EV_BOTAO)
+      return mudar(p, PROVISAO_AP_SUBINDO, 0, agora_ms);
+    break;
+
+  default:
+    break;
+  }
+  return false;
+}
+
+bool provisao_varredura(provisao_t *p, uint8_t candidatas, uint32_t agora_ms) {
+  if (p->estado != PROVISAO_VARRENDO)
+    return false;
+  p->candidatas = candidatas;
+  return mudar(p, candidatas ? PROVISAO_CONHECIDA : PROVISAO_AP_SUBINDO, 0, agora_ms);
+}
+
+bool provisao_avaliar(provisao_t *p, uint32_t agora_ms) {
+  uint32_t prazo = prazos_ms[p->estado];
+  if (!prazo || agora_ms - p->desde_ms < prazo)
+    return false;
+
+  switch (p->estado) {
+  case PROVISAO_VARRENDO:
+    return mudar(p, PROVISAO_AP_SUBINDO, 0, agora_ms);
+  case PROVISAO_CONHECIDA:
+  case PROVISAO_ASSOCIANDO:
+    return falhou(p, agora_ms);
+  case PROVISAO_AP_SUBINDO:
+    return mudar(p, PROVISAO_FALHA_AP, 0, agora_ms);
+  case PROVISAO_ESCOANDO:
+    // Navegador sumiu sem confirmar: associa assim mesmo
+    return mudar(p, PROVISAO_ASSOCIANDO, 0, agora_ms);
+  case PROVISAO_VERIFICADO:
+    return mudar(p, PROVISAO_OPERANDO, 0, agora_ms);
+  case PROVISAO_FALHA_AP:
+  case PROVISAO_FALHA_REDE:
+    return mudar(p, PROVISAO_AP_SUBINDO, 0, agora_ms);
+  default:
+    return false;
+  }
+}
+
+uint32_t provisao_proxima_ms(const provisao_t *p, uint32_t agora_ms) {
+  uint32_t prazo = prazos_ms[p->estado];
+  if (!prazo)
+    return UINT32_MAX;
+  uint32_t decorrido = agora_ms - p->desde_ms;
+  return decorrido < prazo ? prazo - decorrido : 0;
+}
@@ -0,0 +1,83 @@
+#ifndef PROVISAO_H
+#define PROVISAO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Provisionamento da rede: do boot até o rover em operação, sem laços de
+// espera. Só a política fica aqui; o firmware executa a entrada de cada
+// estado (sobe o AP, associa, salva a rede, desenha a tela) e devolve os
+// eventos da rede e dos botões.
+//
+//   VARRENDO --> CONHECIDA (uma candidata por vez) --enlace-------------.
+//       |            | nenhuma conectou (ou botão)                      |
+//       v            v                                                  v
+//   AP_SUBINDO --> AGUARDANDO --> ESCOANDO --> ASSOCIANDO --enlace--> VERIFICADO --> OPERANDO
+//       |   ^                                      | PROVISAO_TENTATIVAS falhas
+//       |   '-------------- FALHA_REDE <-----------'
+//       '--> FALHA_AP --(prazo ou botão)--> AP_SUBINDO
+//
+// Os estados de falha voltam sozinhos ao AP depois de mostrar o erro (ou na
+// hora, com o botão): nunca é preciso reiniciar o rover.
+
+#define PROVISAO_TENTATIVAS      3       // Associações à rede do formulário
+#define PROVISAO_VARREDURA_MS    10000   // Varredura que não termina
+#define PROVISAO_CONHECIDA_MS    10000   // Por candidata conhecida
+#define PROVISAO_AP_MS           5000    // AP e servidor HTTP subindo
+#define PROVISAO_ESCOAR_MS       5000    // Página de sucesso sem confirmação de entrega
+#define PROVISAO_ASSOCIAR_MS     15000   // Por tentativa
+#define PROVISAO_VERIFICADO_MS   3000    // IP no display antes de operar
+#define PROVISAO_FALHA_MS        10000   // Erro no display antes de reabrir o AP
+
+typedef enum {
+  PROVISAO_VARRENDO,        // boot com redes conhecidas: varredura em STA
+  PROVISAO_CONHECIDA,       // associando à candidata `tentativa`
+  PROVISAO_AP_SUBINDO,      // AP, IP fixo e servidor HTTP
+  PROVISAO_AGUARDANDO,      // portal no ar esperando o formulário
+  PROVISAO_ESCOANDO,        // formulário recebido: a página de sucesso sai antes do AP cair
+  PROVISAO_ASSOCIANDO,      // associando à rede do formulário (tentativa `tentativa`)
+  PROVISAO_VERIFICADO,      // enlace com IP: rede salva, IP no display
+  PROVISAO_OPERANDO,        // fim: o firmware sobe o controle
+  PROVISAO_FALHA_AP,        // AP ou servidor não subiu
+  PROVISAO_FALHA_REDE,      // as tentativas acabaram
+  PROVISAO_NUM_ESTADOS
+} provisao_estado_t;
+
+typedef enum {
+  PROVISAO_EV_AP_PRONTO,    // AP e servidor HTTP no ar
+  PROVISAO_EV_AP_FALHA,     // servidor HTTP não subiu
+  PROVISAO_EV_CREDENCIAIS,  // formulário chegou
+  PROVISAO_EV_ENTREGUE,     // resposta do formulário confirmada (ou a conexão acabou)
+  PROVISAO_EV_ENLACE,       // STA associada e com IP
+  PROVISAO_EV_ENLACE_FALHA, // associação recusada (senha, rede fora do ar)
+  PROVISAO_EV_BOTAO,        // operador pediu o portal (ou a nova tentativa) já
+} provisao_evento_t;
+
+typedef struct {
+  provisao_estado_t estado;
+  uint32_t desde_ms;        // Entrada no estado
+  uint8_t tentativa;        // Candidata (CONHECIDA) ou tentativa (ASSOCIANDO); a que conectou no VERIFICADO
+  uint8_t candidatas;       // Conhecidas no ar (CONHECIDA)
+  uint8_t falhas;           // Ciclos do portal que terminaram em FALHA_REDE
+  bool conhecida;           // VERIFICADO por rede conhecida (nada a salvar)
+} provisao_t;
+
+extern const char *const provisao_nomes_estado[PROVISAO_NUM_ESTADOS];
+
+// Começa pela varredura se há redes conhecidas, senão pelo AP
+void provisao_iniciar(provisao_t *p, uint8_t conhecidas, uint32_t agora_ms);
+
+// Evento da rede ou do operador; retorna true se houve transição (também
+// para o mesmo estado, numa nova tentativa): o firmware executa a entrada
+bool provisao_evento(provisao_t *p, provisao_evento_t ev, uint32_t agora_ms);
+
+// Varredura terminou (VARRENDO) com `candidatas` conhecidas no ar
+bool provisao_varredura(provisao_t *p, uint8_t candidatas, uint32_t agora_ms);
+
+// Prazos do estado; retorna true se houve transição
+bool provisao_avaliar(provisao_t *p, uint32_t agora_ms);
+
+// Em quantos ms avaliar de novo (UINT32_MAX = só com evento)
+uint32_t provisao_proxima_ms(const provisao_t *p, uint32_t agora_ms);
+
+#endif
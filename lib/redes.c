@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <string.h>
+#include "redes.h"
+
+void redes_limpar(redes_t *t) {
+  t->n = 0;
+}
+
+const rede_t *redes_buscar(const redes_t *t, const char *ssid) {
+  for (uint8_t i = 0; i < t->n; i++) {
+    if (strcmp(t->r[i].ssid, ssid) == 0)
+      return &t->r[i];
+  }
+  return NULL;
+}
+
+void redes_adicionar(redes_t *t, const uint8_t *ssid, size_t ssid_len, const uint8_t bssid[6],
+                     int16_t rssi, uint8_t canal, uint8_t seguranca) {
+  if (ssid_len > REDES_SSID_MAX)
+    ssid_len = REDES_SSID_MAX;
+  // SSID vazio ou só de zeros: rede oculta
+  size_t n = 0;
+  while (n < ssid_len && ssid[n])
+    n++;
+  if (!n)
+    return;
+
+  rede_t nova = { .rssi = rssi, .canal = canal, .seguranca = seguranca };
+  memcpy(nova.ssid, ssid, n);
+  memcpy(nova.bssid, bssid, sizeof(nova.bssid));
+  nova.ssid[n] = '\0';
+
+  // Já vista: só fica se este BSSID for mais forte, e sai da posição antiga
+  uint8_t i = 0;
+  while (i < t->n && strcmp(t->r[i].ssid, nova.ssid) != 0)
+    i++;
+  if (i < t->n) {
+    if (t->r[i].rssi >= rssi)
+      return;
+    memmove(&t->r[i], &t->r[i + 1], (size_t)(t->n - i - 1) * sizeof(rede_t));
+    t->n--;
+  }
+
+  // Inserção ordenada; cheia, a mais fraca cai (ou a nova nem entra)
+  uint8_t pos = 0;
+  while (pos < t->n && t->r[pos].rssi >= rssi)
+    pos++;
+  if (pos == REDES_MAX)
+    return;
+  uint8_t mover = t->n < REDES_MAX ? t->n - pos : REDES_MAX - 1 - pos;
+  memmove(&t->r[pos + 1], &t->r[pos], (size_t)mover * sizeof(rede_t));
+  t->r[pos] = nova;
+  if (t->n < REDES_MAX)
+    t->n++;
+}
+
+const char *redes_seguranca_nome(uint8_t seguranca) {
+  if ((seguranca & REDES_WPA2) && (seguranca & REDES_WPA))
+    return "wpa/wpa2";
+  if (seguranca & REDES_WPA2)
+    return "wpa2";
+  if (seguranca & REDES_WPA)
+    return "wpa";
+  if (seguranca & REDES_WEP)
+    return "wep";
+  return "aberta";
+}
+
+// SSID como string JSON: aspas e barras escapadas, controles em \u00XX
+static size_t json_texto(char *buf, size_t tam, const char *s) {
+  size_t u = 0;
+  for (; *s; s++) {
+    unsigned char c = (unsigned char)*s;
+    char esc[7];
+    size_t k;
+    if (c == '"' || c == '\\')
+      k = (size_t)snprintf(esc, sizeof(esc), "\\%c", c);
+    else if (c < 0x20)
+      k = (size_t)snprintf(esc, sizeof(esc), "\\u%04x", c);
+    else {
+      esc[0] = (char)c;
+      k = 1;
+    }
+    if (u + k >= tam)
+      return tam;
+    memcpy(buf + u, esc, k);
+    u += k;
+  }
+  return u;
+}
+
+size_t redes_json(const redes_t *t, bool varrendo, uint32_t idade_ms, char *buf, size_t tam) {
+  int n = snprintf(buf, tam, "{\"scanning\":%s,\"age_ms\":%lu,\"networks\":[",
+                   varrendo ? "true" : "false", (unsigned long)idade_ms);
+  if (n < 0 || (size_t)n >= tam)
+    return 0;
+  size_t u = (size_t)n;
+  for (uint8_t i = 0; i < t->n; i++) {
+    const rede_t *r = &t->r[i];
+    n = snprintf(buf + u, tam - u, "%s{\"ssid\":\"", i ? "," : "");
+    if (n < 0 || (size_t)n >= tam - u)
+      return 0;
+    u += (size_t)n;
+    size_t k = json_texto(buf + u, tam - u, r->ssid);
+    if (k >= tam - u)
+      return 0;
+    u += k;
+    n = snprintf(buf + u, tam - u, "\",\"rssi\":%d,\"channel\":%u,\"security\":\"%s\"}",
+                 r->rssi, r->canal, redes_seguranca_nome(r->seguranca));
+    if (n < 0 || (size_t)n >= tam - u)
+      return 0;
+    u += (size_t)n;
+  }
+  n = snprintf(buf + u, tam - u, "]}");
+  if (n < 0 || (size_t)n >= tam - u)
+    return 0;
+  return u + (size_t)n;
+}
@@ -0,0 +1,51 @@
+#ifndef REDES_H
+#define REDES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Redes vistas na varredura do portal. Os resultados do cyw43 chegam um por
+// BSSID e canal; a tabela guarda um SSID por linha (o BSSID mais forte),
+// ordenada por RSSI decrescente e limitada a REDES_MAX (sai a mais fraca).
+// Redes ocultas (SSID vazio) não entram: essas o usuário digita.
+
+#define REDES_MAX      16
+#define REDES_SSID_MAX 32
+
+// Bits de segurança como o cyw43 informa na varredura (auth_mode)
+#define REDES_WEP      0x01u
+#define REDES_WPA      0x02u
+#define REDES_WPA2     0x04u
+
+typedef struct {
+  char ssid[REDES_SSID_MAX + 1];
+  uint8_t bssid[6];         // do ponto de acesso mais forte
+  int16_t rssi;             // dBm
+  uint8_t canal;
+  uint8_t seguranca;        // REDES_WEP | REDES_WPA | REDES_WPA2
+} rede_t;
+
+typedef struct {
+  rede_t r[REDES_MAX];
+  uint8_t n;
+} redes_t;
+
+void redes_limpar(redes_t *t);
+
+// Inclui um resultado (`ssid` sem terminador, como no quadro do rádio);
+// mesmo SSID fica com o RSSI mais forte
+void redes_adicionar(redes_t *t, const uint8_t *ssid, size_t ssid_len, const uint8_t bssid[6],
+                     int16_t rssi, uint8_t canal, uint8_t seguranca);
+
+// Linha do SSID ou NULL
+const rede_t *redes_buscar(const redes_t *t, const char *ssid);
+
+// "aberta", "wep", "wpa", "wpa2" ou "wpa/wpa2"
+const char *redes_seguranca_nome(uint8_t seguranca);
+
+// JSON {"scanning":..,"age_ms":..,"networks":[{"ssid","rssi","channel","security"}]};
+// retorna o tamanho (0 se não couber)
+size_t redes_json(const redes_t *t, bool varrendo, uint32_t idade_ms, char *buf, size_t tam);
+
+#endif
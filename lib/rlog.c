@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rlog.h"
+#include "pico/stdlib.h"
+
+// Vários produtores (laço principal, IRQ de GPIO, callbacks do cyw43) e um
+// consumidor (rlog_escoar no laço). O M0+ não tem LDREX/STREX: só a reserva
+// do índice é feita com as interrupções desligadas (poucos ciclos); a
+// cópia do registro é feita fora da trava e publicada pelo campo `pronto`.
+#if PICO_ON_DEVICE
+#include "hardware/sync.h"
+#define TRAVAR()      save_and_disable_interrupts()
+#define LIBERAR(s)    restore_interrupts(s)
+#else
+#define TRAVAR()      0u
+#define LIBERAR(s)    ((void)(s))
+#endif
+
+typedef struct {
+  const char *fmt;
+  uint32_t ts;                     // time_us_32() na gravação
+  uint8_t nivel;
+  uint8_t modulo;
+  uint8_t n;
+  uint8_t pronto;                  // 1 = registro completo, pode formatar
+  uintptr_t args[RLOG_MAX_ARGS];
+} rlog_registro_t;
+
+static rlog_registro_t anel[RLOG_REGISTROS];
+static uint32_t cabeca;            // próximo a reservar
+static uint32_t lido;              // próximo a formatar
+static uint32_t descartados;
+
+uint8_t rlog_limite[RLOG_NUM_MODULOS] = {
+#define RLOG_PADRAO(nome, rotulo) [nome] = RLOG_INFO,
+  RLOG_MODULOS(RLOG_PADRAO)
+#undef RLOG_PADRAO
+};
+
+static const char *const nomes_modulos[RLOG_NUM_MODULOS] = {
+#define RLOG_NOME(nome, rotulo) [nome] = rotulo,
+  RLOG_MODULOS(RLOG_NOME)
+#undef RLOG_NOME
+};
+
+static const char *const nomes_niveis[] = { "erro", "aviso", "info", "debug" };
+
+void rlog_gravar(uint8_t nivel, uint8_t modulo, const char *fmt, uint8_t n, const uintptr_t *args) {
+  uint32_t s = TRAVAR();
+  if (cabeca - lido >= RLOG_REGISTROS) {
+    // Anel cheio: perde o mais novo, nunca bloqueia
+    descartados++;
+    LIBERAR(s);
+    return;
+  }
+  rlog_registro_t *r = &anel[cabeca++ & (RLOG_REGISTROS - 1)];
+  LIBERAR(s);
+
+  r->fmt = fmt;
+  r->ts = time_us_32();
+  r->nivel = nivel;
+  r->modulo = modulo;
+  r->n = n > RLOG_MAX_ARGS ? RLOG_MAX_ARGS : n;
+  for (uint8_t i = 0; i < r->n; i++)
+    r->args[i] = args[i];
+  __atomic_store_n(&r->pronto, 1, __ATOMIC_RELEASE);
+}
+
+bool rlog_pendente(void) {
+  return lido != cabeca;
+}
+
+uint32_t rlog_descartados(void) {
+  return descartados;
+}
+
+void rlog_limpar(void) {
+  while (lido != cabeca && anel[lido & (RLOG_REGISTROS - 1)].pronto) {
+    anel[lido & (RLOG_REGISTROS - 1)].pronto = 0;
+    lido++;
+  }
+}
+
+// Formata uma conversão de cada vez com o tipo certo; só os argumentos
+// gravados são consumidos (os que faltarem saem como 0)
+size_t rlog_formatar(char *buf, size_t tam, const char *fmt, uint8_t n, const uintptr_t *args) {
+  size_t usado = 0;
+  uint8_t prox = 0;
+  if (!tam)
+    return 0;
+  buf[0] = '\0';
+
+  while (*fmt && usado + 1 < tam) {
+    if (*fmt != '%') {
+      buf[usado++] = *fmt++;
+      buf[usado] = '\0';
+      continue;
+    }
+    if (fmt[1] == '%') {
+      buf[usado++] = '%';
+      buf[usado] = '\0';
+      fmt += 2;
+      continue;
+    }
+
+    // Especificação: flags, largura, precisão, modificador e conversão
+    const char *ini = fmt++;
+    while (*fmt && strchr("-+ #0123456789.", *fmt))
+      fmt++;
+    int longos = 0;
+    while (*fmt == 'l' || *fmt == 'h' || *fmt == 'z') {
+      longos += *fmt == 'l';
+      fmt++;
+    }
+    char conv = *fmt ? *fmt++ : '\0';
+
+    char spec[24];
+    size_t len = (size_t)(fmt - ini);
+    if (len >= sizeof(spec))
+      len = sizeof(spec) - 1;
+    memcpy(spec, ini, len);
+    spec[len] = '\0';
+
+    uintptr_t v = prox < n ? args[prox] : 0;
+    prox++;
+    char *dest = buf + usado;
+    size_t resto = tam - usado;
+    int escrito;
+    switch (conv) {
+      case 'd': case 'i':
+        escrito = longos > 1 ? snprintf(dest, resto, spec, (long long)(intptr_t)v)
+                : longos     ? snprintf(dest, resto, spec, (long)(intptr_t)v)
+                             : snprintf(dest, resto, spec, (int)(intptr_t)v);
+        break;
+      case 'u': case 'x': case 'X': case 'o': case 'c':
+        escrito = longos > 1 ? snprintf(dest, resto, spec, (unsigned long long)v)
+                : longos     ? snprintf(dest, resto, spec, (unsigned long)v)
+                             : snprintf(dest, resto, spec, (unsigned)v);
+        break;
+      case 'f': case 'e': case 'g': case 'E': case 'G': {
+        union { uint32_t u; float f; } c = { .u = (uint32_t)v };
+        escrito = snprintf(dest, resto, spec, (double)c.f);
+        break;
+      }
+      case 's':
+        escrito = snprintf(dest, resto, spec, v ? (const char *)v : "(null)");
+        break;
+      case 'p':
+        escrito = snprintf(dest, resto, spec, (void *)v);
+        break;
+      default:
+        escrito = snprintf(dest, resto, "%s", spec);
+        prox--;
+        break;
+    }
+    if (escrito < 0)
+      break;
+    usado += (size_t)escrito < resto ? (size_t)escrito : resto - 1;
+  }
+  return usado;
+}
+
+int rlog_escoar(size_t max_bytes) {
+  int saidas = 0;
+  size_t bytes = 0;
+  static uint32_t descartes_avisados;
+
+  if (descartados != descartes_avisados) {
+    bytes += (size_t)printf("[log] %lu registros descartados (anel cheio)\n",
+                            (unsigned long)(descartados - descartes_avisados));
+    descartes_avisados = descartados;
+  }
+
+  while (lido != cabeca && bytes < max_bytes) {
+    rlog_registro_t *r = &anel[lido & (RLOG_REGISTROS - 1)];
+    if (!__atomic_load_n(&r->pronto, __ATOMIC_ACQUIRE))
+      break;   // reservado mas ainda sendo escrito (IRQ interrompida)
+
+    char linha[192];
+    size_t n = (size_t)snprintf(linha, sizeof(linha), "[%7lu.%03lu] %c %s: ",
+                                (unsigned long)(r->ts / 1000000u),
+                                (unsigned long)(r->ts / 1000u % 1000u),
+                                "EAID"[r->nivel & 3], nomes_modulos[r->modulo]);
+    n += rlog_formatar(linha + n, sizeof(linha) - n, r->fmt, r->n, r->args);
+    fputs(linha, stdout);
+    putchar('\n');
+    bytes += n + 1;
+
+    r->pronto = 0;
+    lido++;
+    saidas++;
+  }
+  return saidas;
+}
+
+static int nivel_por_nome(const char *s, size_t len) {
+  for (int i = 0; i < (int)(sizeof(nomes_niveis) / sizeof(nomes_niveis[0])); i++) {
+    if (strlen(nomes_niveis[i]) == len && strncmp(s, nomes_niveis[i], len) == 0)
+      return i;
+  }
+  if (len == 1 && s[0] >= '0' && s[0] <= '3')
+    return s[0] - '0';
+  return -1;
+}
+
+bool rlog_config(const char *spec) {
+  bool ok = true;
+  while (*spec) {
+    const char *fim = strchr(spec, ',');
+    size_t len = fim ? (size_t)(fim - spec) : strlen(spec);
+    const char *igual = memchr(spec, '=', len);
+
+    int nivel = igual ? nivel_por_nome(igual + 1, len - (size_t)(igual + 1 - spec)) : -1;
+    size_t nome_len = igual ? (size_t)(igual - spec) : 0;
+    bool achou = false;
+    if (nivel >= 0) {
+      for (int m = 0; m < RLOG_NUM_MODULOS; m++) {
+        if ((nome_len == 1 && spec[0] == '*') ||
+            (strlen(nomes_modulos[m]) == nome_len && strncmp(spec, nomes_modulos[m], nome_len) == 0)) {
+          rlog_limite[m] = (uint8_t)nivel;
+          achou = true;
+        }
+      }
+    }
+    ok = ok && achou;
+
+    if (!fim)
+      break;
+    spec = fim + 1;
+  }
+  return ok;
+}
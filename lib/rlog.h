@@ -0,0 +1,98 @@
+#ifndef RLOG_H
+#define RLOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Log adiado do firmware. Nos caminhos quentes (callbacks de UDP/TCP,
+// IRQ de GPIO, laço de 10 Hz) RLOG() só grava num anel o ponteiro da string
+// de formato (que vive na flash e serve de ID), o instante e até
+// RLOG_MAX_ARGS argumentos brutos: dezenas de ciclos, sem printf. A
+// formatação acontece depois, no laço principal, em rlog_escoar(), com um
+// limite de bytes por chamada para a USB não travar o laço.
+//
+// Argumentos:
+//   inteiros       direto (convertidos para uintptr_t)
+//   RLOG_F(x)      float (%f, %.1f...)
+//   RLOG_S(p)      string que continue válida até ser formatada (literal,
+//                  buffer global); nunca buffers temporários
+//   RLOG_SEGREDO(p) senhas e afins: o valor não entra no anel, sai "***"
+//   RLOG_IP(a)     ip_addr_t* como 4 argumentos, para "%u.%u.%u.%u"
+//
+// Filtro em tempo de execução por módulo e nível (rlog_config), aplicado
+// antes de gravar: um RLOG desligado custa uma comparação.
+
+#define RLOG_MAX_ARGS 6
+
+#ifndef RLOG_REGISTROS
+#define RLOG_REGISTROS 64          // potência de 2
+#endif
+
+// Níveis (menor = mais importante)
+#define RLOG_ERRO   0
+#define RLOG_AVISO  1
+#define RLOG_INFO   2
+#define RLOG_DEBUG  3
+
+// Módulos: X(nome, "rótulo")
+#define RLOG_MODULOS(X) \
+  X(RLOG_SISTEMA, "sistema") \
+  X(RLOG_REDE,    "rede") \
+  X(RLOG_LINK,    "link") \
+  X(RLOG_PORTAL,  "portal") \
+  X(RLOG_BOTOES,  "botoes") \
+  X(RLOG_COMANDOS, "comandos") \
+  X(RLOG_ENERGIA,  "energia")
+
+#define RLOG_ENUM(nome, rotulo) nome,
+enum { RLOG_MODULOS(RLOG_ENUM) RLOG_NUM_MODULOS };
+#undef RLOG_ENUM
+
+// Nível máximo gravado por módulo (RLOG_INFO por padrão)
+extern uint8_t rlog_limite[RLOG_NUM_MODULOS];
+
+void rlog_gravar(uint8_t nivel, uint8_t modulo, const char *fmt, uint8_t n, const uintptr_t *args);
+
+// Formata e imprime registros pendentes até `max_bytes` de saída; retorna
+// quantos registros saíram
+int rlog_escoar(size_t max_bytes);
+
+// Formata um registro no buffer (usado por rlog_escoar); retorna o tamanho
+size_t rlog_formatar(char *buf, size_t tam, const char *fmt, uint8_t n, const uintptr_t *args);
+
+// Ajusta níveis a partir de "modulo=nivel,..." (p.ex. "rede=debug,*=aviso");
+// retorna false se algum item não for reconhecido
+bool rlog_config(const char *spec);
+
+// Há registros esperando formatação (o laço só dorme sem pendências)
+bool rlog_pendente(void);
+
+// Registros descartados por anel cheio (acumulado)
+uint32_t rlog_descartados(void);
+
+// Descarta os registros pendentes sem formatar (bench/)
+void rlog_limpar(void);
+
+static inline uintptr_t rlog_f32(float x) {
+  union { float f; uint32_t u; } c = { .f = x };
+  return (uintptr_t)c.u;
+}
+
+#define RLOG_F(x)        rlog_f32((float)(x))
+#define RLOG_S(p)        ((uintptr_t)(const char *)(p))
+#define RLOG_SEGREDO(p)  ((void)(p), (uintptr_t)"***")
+#define RLOG_IP(a)       ((const uint8_t *)&(a)->addr)[0], ((const uint8_t *)&(a)->addr)[1], \
+                         ((const uint8_t *)&(a)->addr)[2], ((const uint8_t *)&(a)->addr)[3]
+
+#define RLOG_CONTA_(_1, _2, _3, _4, _5, _6, _7, N, ...) N
+#define RLOG_CONTA(...) RLOG_CONTA_(__VA_ARGS__, 7, 6, 5, 4, 3, 2, 1, 0)
+
+#define RLOG(nivel, modulo, fmt, ...) \
+  do { \
+    if ((nivel) <= rlog_limite[modulo]) \
+      rlog_gravar((nivel), (modulo), (fmt), RLOG_CONTA(0, ##__VA_ARGS__) - 1, \
+                  (const uintptr_t[RLOG_MAX_ARGS + 1]){ 0, ##__VA_ARGS__ } + 1); \
+  } while (0)
+
+#endif
@@ -11,9 +11,21 @@ void ssd1306_init(ssd1306_t *ssd, uint8_t width, uint8_t height, bool external_v
   ssd->ram_buffer = calloc(ssd->bufsize, sizeof(uint8_t));
   ssd->ram_buffer[0] = 0x40;
   ssd->port_buffer[0] = 0x80;
+  ssd->falha = false;
+}
+
+// Depois da primeira falha nada mais vai para o barramento: quem desenha
+// confere ssd->falha e recupera o I2C antes de tentar de novo
+static void ssd1306_write(ssd1306_t *ssd, const uint8_t *src, size_t len) {
+  if (ssd->falha)
+    return;
+  int r = i2c_write_timeout_us(ssd->i2c_port, ssd->address, src, len, false, SSD1306_TIMEOUT_US);
+  if (r != (int)len)
+    ssd->falha = true;
 }
 
 void ssd1306_config(ssd1306_t *ssd) {
+  ssd->falha = false;
   ssd1306_command(ssd, SET_DISP | 0x00);
   ssd1306_command(ssd, SET_MEM_ADDR);
   ssd1306_command(ssd, 0x01);
@@ -43,13 +55,22 @@ void ssd1306_config(ssd1306_t *ssd) {
 
 void ssd1306_command(ssd1306_t *ssd, uint8_t command) {
   ssd->port_buffer[1] = command;
-  i2c_write_blocking(
-    ssd->i2c_port,
-    ssd->address,
-    ssd->port_buffer,
-    2,
-    false
-  );
+  ssd1306_write(ssd, ssd->port_buffer, 2);
+}
+
+void ssd1306_contrast(ssd1306_t *ssd, uint8_t value) {
+  ssd1306_command(ssd, SET_CONTRAST);
+  ssd1306_command(ssd, value);
+}
+
+// Desligado, o painel e a bomba de carga param; a RAM do display é mantida
+void ssd1306_power(ssd1306_t *ssd, bool on) {
+  if (!on)
+    ssd1306_command(ssd, SET_DISP | 0x00);
+  ssd1306_command(ssd, SET_CHARGE_PUMP);
+  ssd1306_command(ssd, on ? 0x14 : 0x10);
+  if (on)
+    ssd1306_command(ssd, SET_DISP | 0x01);
 }
 
 void ssd1306_send_data(ssd1306_t *ssd) {
@@ -59,13 +80,7 @@ void ssd1306_send_data(ssd1306_t *ssd) {
   ssd1306_command(ssd, SET_PAGE_ADDR);
   ssd1306_command(ssd, 0);
   ssd1306_command(ssd, ssd->pages - 1);
-  i2c_write_blocking(
-    ssd->i2c_port,
-    ssd->address,
-    ssd->ram_buffer,
-    ssd->bufsize,
-    false
-  );
+  ssd1306_write(ssd, ssd->ram_buffer, ssd->bufsize);
 }
 
 void ssd1306_pixel(ssd1306_t *ssd, uint8_t x, uint8_t y, bool value) {
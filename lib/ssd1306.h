@@ -5,6 +5,11 @@
 #define WIDTH 128
 #define HEIGHT 64
 
+// Prazo de cada escrita I2C: o buffer inteiro (1025 bytes) leva ~23 ms a
+// 400 kHz; um barramento preso (SDA segurado em baixo) estoura o prazo em
+// vez de travar o chamador
+#define SSD1306_TIMEOUT_US 50000
+
 typedef enum {
   SET_CONTRAST = 0x81,
   SET_ENTIRE_ON = 0xA4,
@@ -32,12 +37,15 @@ typedef struct {
   uint8_t *ram_buffer;
   size_t bufsize;
   uint8_t port_buffer[2];
+  bool falha;               // escrita sem ACK ou fora do prazo: as seguintes são puladas até ssd1306_config
 } ssd1306_t;
 
 void ssd1306_init(ssd1306_t *ssd, uint8_t width, uint8_t height, bool external_vcc, uint8_t address, i2c_inst_t *i2c);
 void ssd1306_config(ssd1306_t *ssd);
 void ssd1306_command(ssd1306_t *ssd, uint8_t command);
 void ssd1306_send_data(ssd1306_t *ssd);
+void ssd1306_contrast(ssd1306_t *ssd, uint8_t value);
+void ssd1306_power(ssd1306_t *ssd, bool on);
 
 void ssd1306_pixel(ssd1306_t *ssd, uint8_t x, uint8_t y, bool value);
 void ssd1306_fill(ssd1306_t *ssd, bool value);
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <string.h>
+#include "supervisor.h"
+#include "trace.h"
+
+const char *const supervisor_nomes_tarefa[SUPERVISOR_NUM_TAREFAS] = { "laco", "controle", "rede" };
+
+const char *const supervisor_nomes_motivo[SUPERVISOR_NUM_MOTIVOS] = {
+  "energia", "executando", "watchdog", "tarefa atrasada", "pedido",
+};
+
+// Rótulos das zonas do trace (a mesma lista de lib/trace.h)
+#define ZONA_ROTULO(nome, id, rotulo) [id] = rotulo,
+static const char *const rotulos[] = { TRACE_IDS(ZONA_ROTULO) };
+#undef ZONA_ROTULO
+
+void supervisor_iniciar(supervisor_t *s) {
+  memset(s, 0, sizeof(*s));
+}
+
+void supervisor_registrar(supervisor_t *s, supervisor_tarefa_t t, uint32_t prazo_ms, uint32_t agora_ms) {
+  s->prazo_ms[t] = prazo_ms;
+  s->batida_ms[t] = agora_ms;
+}
+
+void supervisor_batimento(supervisor_t *s, supervisor_tarefa_t t, uint32_t agora_ms) {
+  s->batida_ms[t] = agora_ms;
+}
+
+uint8_t supervisor_atrasadas(const supervisor_t *s, uint32_t agora_ms) {
+  uint8_t atrasadas = 0;
+  for (uint8_t t = 0; t < SUPERVISOR_NUM_TAREFAS; t++) {
+    if (s->prazo_ms[t] && agora_ms - s->batida_ms[t] > s->prazo_ms[t])
+      atrasadas |= (uint8_t)(1u << t);
+  }
+  return atrasadas;
+}
+
+void supervisor_codificar(const supervisor_falha_t *f, uint32_t reg[SUPERVISOR_REGISTROS]) {
+  reg[0] = SUPERVISOR_MAGICO;
+  reg[1] = f->motivo | (uint32_t)f->atrasadas << 8 | (uint32_t)f->reinicios << 16;
+  reg[2] = f->uptime_ms;
+  reg[3] = f->trilha;
+}
+
+bool supervisor_decodificar(const uint32_t reg[SUPERVISOR_REGISTROS], supervisor_falha_t *f) {
+  memset(f, 0, sizeof(*f));
+  if (reg[0] != SUPERVISOR_MAGICO || (uint8_t)reg[1] >= SUPERVISOR_NUM_MOTIVOS)
+    return false;
+  f->motivo = (uint8_t)reg[1];
+  f->atrasadas = (uint8_t)(reg[1] >> 8);
+  f->reinicios = (uint8_t)(reg[1] >> 16);
+  f->uptime_ms = reg[2];
+  f->trilha = reg[3];
+  return true;
+}
+
+void supervisor_classificar(supervisor_falha_t *f, bool por_watchdog) {
+  if (f->motivo == SUPERVISOR_EXECUTANDO)
+    f->motivo = por_watchdog ? SUPERVISOR_WATCHDOG : SUPERVISOR_ENERGIA;
+  // Reset sem registro (RAM do scratch perdida) também pode ser o watchdog
+  if (f->motivo == SUPERVISOR_ENERGIA && por_watchdog)
+    f->motivo = SUPERVISOR_WATCHDOG;
+
+  if (f->motivo == SUPERVISOR_WATCHDOG || f->motivo == SUPERVISOR_ATRASO) {
+    if (f->reinicios < 255)
+      f->reinicios++;
+  } else {
+    f->reinicios = 0;
+  }
+}
+
+size_t supervisor_descrever(const supervisor_falha_t *f, char *buf, size_t tam) {
+  int n = snprintf(buf, tam, "%s", supervisor_nomes_motivo[f->motivo]);
+  if (f->atrasadas) {
+    const char *sep = " (";
+    for (uint8_t t = 0; t < SUPERVISOR_NUM_TAREFAS; t++) {
+      if (f->atrasadas & (1u << t)) {
+        n += snprintf(buf + n, n < (int)tam ? tam - n : 0, "%s%s", sep, supervisor_nomes_tarefa[t]);
+        sep = ", ";
+      }
+    }
+    n += snprintf(buf + n, n < (int)tam ? tam - n : 0, ")");
+  }
+  if (f->motivo == SUPERVISOR_ENERGIA || f->motivo == SUPERVISOR_PEDIDO)
+    return n < (int)tam ? (size_t)n : tam - 1;
+
+  n += snprintf(buf + n, n < (int)tam ? tam - n : 0, " apos %lu ms", (unsigned long)f->uptime_ms);
+  const char *sep = "; trilha: ";
+  for (uint8_t i = 0; i < SUPERVISOR_TRILHA; i++) {
+    uint8_t zona = (uint8_t)(f->trilha >> (8 * i));
+    if (!zona)
+      break;
+    const char *rotulo = zona < sizeof(rotulos) / sizeof(rotulos[0]) && rotulos[zona] ? rotulos[zona] : "?";
+    n += snprintf(buf + n, n < (int)tam ? tam - n : 0, "%s%s", sep, rotulo);
+    sep = " < ";
+  }
+  return n < (int)tam ? (size_t)n : tam - 1;
+}
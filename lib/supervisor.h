@@ -0,0 +1,91 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Supervisor de saúde: cada tarefa registrada bate dentro do seu prazo e o
+// firmware só alimenta o watchdog do RP2040 quando nenhuma está atrasada.
+// Uma tarefa atrasada reinicia o rover na hora (sem esperar o watchdog);
+// se o próprio supervisor parar, o watchdog reinicia sozinho.
+//
+// O motivo vai para os registradores de scratch 0 a 3 do watchdog, que
+// sobrevivem ao reset (o SDK usa os de 4 a 7 no watchdog_reboot):
+//
+//   0  SUPERVISOR_MAGICO
+//   1  motivo | tarefas atrasadas << 8 | reinícios << 16
+//   2  uptime (ms) na última passada do supervisor
+//   3  trilha: as quatro últimas zonas (ids do lib/trace.h), a mais nova
+//      no byte baixo, gravadas na entrada de cada zona
+//
+// No boot seguinte o firmware lê o registro, relata e começa outro com
+// motivo EXECUTANDO: se ele ainda estiver lá depois de um reset do
+// watchdog, foi travamento (o laço ou o contexto pararam sem ninguém ver).
+
+#define SUPERVISOR_MAGICO      0x56505553u  // "SUPV"
+#define SUPERVISOR_REGISTROS   4
+#define SUPERVISOR_TRILHA      4            // zonas na trilha
+#define SUPERVISOR_REG_UPTIME  2
+#define SUPERVISOR_REG_TRILHA  3
+
+typedef enum {
+  SUPERVISOR_LACO,          // laço principal (display, log, provisionamento)
+  SUPERVISOR_CONTROLE,      // tarefa do enlace
+  SUPERVISOR_REDE,          // cyw43 respondendo (RSSI)
+  SUPERVISOR_NUM_TAREFAS
+} supervisor_tarefa_t;
+
+typedef enum {
+  SUPERVISOR_ENERGIA,       // boot limpo: energia, botão de reset ou gravação
+  SUPERVISOR_EXECUTANDO,    // no registro enquanto o firmware roda
+  SUPERVISOR_WATCHDOG,      // o watchdog venceu: travamento
+  SUPERVISOR_ATRASO,        // tarefa sem batimento no prazo
+  SUPERVISOR_PEDIDO,        // reinício pedido (OTA)
+  SUPERVISOR_NUM_MOTIVOS
+} supervisor_motivo_t;
+
+typedef struct {
+  uint32_t prazo_ms[SUPERVISOR_NUM_TAREFAS];    // 0 = não registrada
+  uint32_t batida_ms[SUPERVISOR_NUM_TAREFAS];
+} supervisor_t;
+
+// Registro de falha (decodificado dos registradores de scratch)
+typedef struct {
+  uint8_t motivo;           // supervisor_motivo_t
+  uint8_t atrasadas;        // bit por supervisor_tarefa_t
+  uint8_t reinicios;        // reinícios por falha desde o último boot limpo (satura em 255)
+  uint32_t uptime_ms;
+  uint32_t trilha;
+} supervisor_falha_t;
+
+extern const char *const supervisor_nomes_tarefa[SUPERVISOR_NUM_TAREFAS];
+extern const char *const supervisor_nomes_motivo[SUPERVISOR_NUM_MOTIVOS];
+
+void supervisor_iniciar(supervisor_t *s);
+
+// Passa a cobrar a tarefa (a primeira batida conta de agora)
+void supervisor_registrar(supervisor_t *s, supervisor_tarefa_t t, uint32_t prazo_ms, uint32_t agora_ms);
+
+void supervisor_batimento(supervisor_t *s, supervisor_tarefa_t t, uint32_t agora_ms);
+
+// Tarefas registradas fora do prazo (bit por tarefa; 0 = todas saudáveis)
+uint8_t supervisor_atrasadas(const supervisor_t *s, uint32_t agora_ms);
+
+// Registro <-> registradores de scratch
+void supervisor_codificar(const supervisor_falha_t *f, uint32_t reg[SUPERVISOR_REGISTROS]);
+bool supervisor_decodificar(const uint32_t reg[SUPERVISOR_REGISTROS], supervisor_falha_t *f);
+
+// Motivo do boot atual a partir do registro anterior (sem registro válido:
+// `f` zerado) e de quem causou o reset
+void supervisor_classificar(supervisor_falha_t *f, bool por_watchdog);
+
+// Zona nova na trilha
+static inline uint32_t supervisor_trilha(uint32_t trilha, uint8_t zona) {
+  return (trilha << 8) | zona;
+}
+
+// "watchdog (laco) apos 81234 ms; trilha: atualizar_display < tarefa_enlace"
+size_t supervisor_descrever(const supervisor_falha_t *f, char *buf, size_t tam);
+
+#endif
@@ -0,0 +1,89 @@
+#include <string.h>
+#include "trace.h"
+
+#if ROVER_TRACE
+#include "pico/stdlib.h"
+
+// rx_cb roda no contexto de interrupção do cyw43 (threadsafe_background):
+// no Pico a gravação é protegida desligando as interrupções por alguns
+// ciclos; no PC tudo roda na mesma thread
+#if PICO_ON_DEVICE
+#include "hardware/sync.h"
+#define TRAVAR()      save_and_disable_interrupts()
+#define LIBERAR(s)    restore_interrupts(s)
+#else
+#define TRAVAR()      0u
+#define LIBERAR(s)    ((void)(s))
+#endif
+
+typedef struct {
+  uint32_t ts;
+  uint8_t tipo;
+  uint8_t id;
+  uint16_t valor;
+} trace_registro_t;
+
+static trace_registro_t anel[TRACE_REGISTROS];
+static uint32_t cabeca;      // próximo a gravar (contagem total)
+static uint32_t lido;        // próximo a drenar
+static uint32_t perdidos;
+static uint16_t seq;
+
+void trace_registrar(uint8_t tipo, uint8_t id, uint16_t valor) {
+  uint32_t s = TRAVAR();
+  trace_registro_t *r = &anel[cabeca++ & (TRACE_REGISTROS - 1)];
+  r->ts = time_us_32();
+  r->tipo = tipo;
+  r->id = id;
+  r->valor = valor;
+  if (cabeca - lido > TRACE_REGISTROS) {
+    lido++;
+    perdidos++;
+  }
+  LIBERAR(s);
+}
+
+static void put_u16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+  put_u16(p, (uint16_t)v);
+  put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+size_t trace_drenar(uint8_t *buf, size_t tam) {
+  if (tam < TRACE_CABECALHO + TRACE_REGISTRO_BYTES)
+    return 0;
+
+  uint32_t s = TRAVAR();
+  uint32_t n = cabeca - lido;
+  uint32_t cabe = (uint32_t)((tam - TRACE_CABECALHO) / TRACE_REGISTRO_BYTES);
+  if (n > cabe)
+    n = cabe;
+  if (!n) {
+    LIBERAR(s);
+    return 0;
+  }
+
+  uint8_t *p = buf + TRACE_CABECALHO;
+  for (uint32_t i = 0; i < n; i++, p += TRACE_REGISTRO_BYTES) {
+    const trace_registro_t *r = &anel[(lido + i) & (TRACE_REGISTROS - 1)];
+    put_u32(p, r->ts);
+    p[4] = r->tipo;
+    p[5] = r->id;
+    put_u16(p + 6, r->valor);
+  }
+  lido += n;
+  uint32_t perdidos_ate_agora = perdidos;
+  LIBERAR(s);
+
+  memcpy(buf, "RVRT", 4);
+  put_u16(buf + 4, seq++);
+  put_u16(buf + 6, (uint16_t)n);
+  put_u32(buf + 8, perdidos_ate_agora);
+  put_u32(buf + 12, time_us_32());
+  return TRACE_CABECALHO + n * TRACE_REGISTRO_BYTES;
+}
+#endif
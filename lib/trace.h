@@ -0,0 +1,67 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Rastreamento leve do firmware: zonas de início/fim e contadores gravados
+// como registros binários de 8 bytes num anel estático em RAM (o mais
+// antigo é sobrescrito). O anel é drenado em pacotes RVRT, sem bloquear,
+// e tools/trace2chrome.py converte para o formato de trace do Chrome.
+//
+// Só existe com ROVER_TRACE=1 (opção ROVER_TRACE do CMake); sem ela as
+// macros somem e o custo é zero.
+//
+// Pacote RVRT (little-endian):
+//   0  "RVRT"
+//   4  u16 seq        número do pacote
+//   6  u16 n          registros que seguem
+//   8  u32 perdidos   registros sobrescritos antes de drenar (acumulado)
+//  12  u32 t_envio    time_us_32() na montagem
+//  16  n x { u32 ts (us), u8 tipo, u8 id, u16 valor }
+
+// Zonas e contadores: X(nome, id, "rótulo"). A ferramenta de conversão lê
+// esta lista direto do cabeçalho.
+#define TRACE_IDS(X) \
+  X(TRACE_ENLACE,    1, "tarefa_enlace") \
+  X(TRACE_DISPLAY,   2, "atualizar_display") \
+  X(TRACE_LEDS,      3, "definir_leds") \
+  X(TRACE_RX,        4, "rx_cb") \
+  X(TRACE_HTTP,      5, "tcp_server_recv") \
+  X(TRACE_COMANDOS,  6, "enviar_comandos_rover") \
+  X(TRACE_FLASH,     7, "ota_gravar_setor") \
+  X(TRACE_CONT_RX,  32, "datagramas_rx") \
+  X(TRACE_CONT_SRTT, 33, "srtt_ms")
+
+#define TRACE_ENUM(nome, id, rotulo) nome = id,
+enum { TRACE_IDS(TRACE_ENUM) };
+#undef TRACE_ENUM
+
+#define TRACE_TIPO_INICIO   0
+#define TRACE_TIPO_FIM      1
+#define TRACE_TIPO_CONTADOR 2
+
+#ifndef TRACE_REGISTROS
+#define TRACE_REGISTROS 512              // potência de 2 (4 KB de RAM)
+#endif
+#define TRACE_CABECALHO 16
+#define TRACE_REGISTRO_BYTES 8
+#define TRACE_PACOTE_MAX (TRACE_CABECALHO + 170 * TRACE_REGISTRO_BYTES)   // cabe num datagrama
+
+#if ROVER_TRACE
+void trace_registrar(uint8_t tipo, uint8_t id, uint16_t valor);
+
+// Monta um pacote RVRT com os registros ainda não drenados (até caber em
+// `tam`); retorna 0 se não houver nada novo
+size_t trace_drenar(uint8_t *buf, size_t tam);
+
+#define TRACE_INICIO(zona)        trace_registrar(TRACE_TIPO_INICIO, (zona), 0)
+#define TRACE_FIM(zona)           trace_registrar(TRACE_TIPO_FIM, (zona), 0)
+#define TRACE_CONTADOR(id, valor) trace_registrar(TRACE_TIPO_CONTADOR, (id), (uint16_t)(valor))
+#else
+#define TRACE_INICIO(zona)        ((void)0)
+#define TRACE_FIM(zona)           ((void)0)
+#define TRACE_CONTADOR(id, valor) ((void)0)
+#endif
+
+#endif
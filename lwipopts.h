@@ -19,25 +19,48 @@
 #define MEM_LIBC_MALLOC             0
 #endif
 #define MEM_ALIGNMENT               4
-#define MEM_SIZE                    4000
+
+// Perfis de dimensionamento (opção ROVER_LWIP_PERFIL do CMake). Os valores
+// saem do pico de uso medido com tools/lwip_stress.py no build de PC, mais
+// folga; o shim de host/ usa os mesmos limites.
+#if ROVER_LWIP_PERFIL_CONTROLE
+// Controle UDP de baixa latência: só o portal (uma página de 2,5 KB) e o
+// servidor de status usam TCP. Cada pbuf do pool ocupa ~1,5 KB: os 16 a
+// menos pagam os anéis maiores de trace e de log (lib/CMakeLists.txt)
+#define MEM_SIZE                    6000
+#define MEMP_NUM_TCP_SEG            12
+#define MEMP_NUM_TCP_PCB            4
+#define MEMP_NUM_TCP_PCB_LISTEN     2
+#define PBUF_POOL_SIZE              8
+#define TCP_WND                     (2 * TCP_MSS)
+#define TCP_SND_BUF                 (2 * TCP_MSS)
+#else
+// Portal (padrão): rajadas de conexões do navegador e do captive portal
+#define MEM_SIZE                    10000
 #define MEMP_NUM_TCP_SEG            32
-#define MEMP_NUM_ARP_QUEUE          10
+#define MEMP_NUM_TCP_PCB            8
+#define MEMP_NUM_TCP_PCB_LISTEN     4
 #define PBUF_POOL_SIZE              24
+#define TCP_WND                     (8 * TCP_MSS)
+#define TCP_SND_BUF                 (8 * TCP_MSS)
+#endif
+#define MEMP_NUM_ARP_QUEUE          10
 #define LWIP_ARP                    1
 #define LWIP_ETHERNET               1
 #define LWIP_ICMP                   1
 #define LWIP_RAW                    1
-#define TCP_WND                     (8 * TCP_MSS)
 #define TCP_MSS                     1460
-#define TCP_SND_BUF                 (8 * TCP_MSS)
 #define TCP_SND_QUEUELEN            ((4 * (TCP_SND_BUF) + (TCP_MSS - 1)) / (TCP_MSS))
 #define LWIP_NETIF_STATUS_CALLBACK  1
 #define LWIP_NETIF_LINK_CALLBACK    1
 #define LWIP_NETIF_HOSTNAME         1
 #define LWIP_NETCONN                0
-#define MEM_STATS                   0
+// Uso do heap e dos pools do lwIP (contadores e picos), sempre compilados;
+// exportados pelo servidor de status (/metrics)
+#define LWIP_STATS                  1
+#define MEM_STATS                   1
 #define SYS_STATS                   0
-#define MEMP_STATS                  0
+#define MEMP_STATS                  1
 #define LINK_STATS                  0
 // #define ETH_PAD_SIZE                2
 #define LWIP_CHKSUM_ALGORITHM       3
@@ -51,9 +74,18 @@
 #define DHCP_DOES_ARP_CHECK         0
 #define LWIP_DHCP_DOES_ACD_CHECK    0
 
+// mDNS (anúncio _rover._udp) e detecção de mudança de endereço para redescoberta
+#define LWIP_MDNS_RESPONDER         1
+#define LWIP_IGMP                   1
+#define LWIP_NUM_NETIF_CLIENT_DATA  1
+#define LWIP_NETIF_EXT_STATUS_CALLBACK 1
+#define MDNS_RESP_USENETIF_EXTCALLBACK 1
+#define MDNS_MAX_SERVICES           1
+#define MEMP_NUM_UDP_PCB            6
+#define MEMP_NUM_SYS_TIMEOUT        (LWIP_NUM_SYS_TIMEOUT_INTERNAL + 4)
+
 #ifndef NDEBUG
 #define LWIP_DEBUG                  1
-#define LWIP_STATS                  1
 #define LWIP_STATS_DISPLAY          1
 #endif
 
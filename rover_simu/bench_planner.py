@@ -0,0 +1,126 @@
+"""Benchmark: planejamento do modo autônomo (A* x D* Lite).
+
+Para mundos com N obstáculos, sorteia pares (rover, alvo) e mede na mesma
+grade de ocupação do simulador:
+
+  - A*: busca completa do zero;
+  - D* Lite, busca inicial (equivale a um A* reverso);
+  - replanejamento quando o rover anda alguns passos pelo caminho:
+    A* do zero x correção incremental do D* Lite;
+  - replanejamento quando uma rocha nova cai no caminho logo à frente do
+    rover: A* do zero x correção incremental do D* Lite.
+
+Confere que o D* Lite chega ao mesmo custo do A* em todos os casos e
+imprime o tempo por replanejamento e a qualidade dos caminhos (custo /
+distância em linha reta).
+
+Uso:
+    python bench_planner.py                       # 15, 60, 200 obstáculos
+    python bench_planner.py --obstacles 30 --pairs 500
+"""
+import argparse
+import math
+import random
+import time
+
+from rover import WORLD_WIDTH, WORLD_HEIGHT, ROVER_RADIUS, PLANNER_CELL, PLANNER_MARGIN
+from planner import OccupancyGrid, DStarLite, astar, COST_STRAIGHT
+
+ADVANCE_CELLS = 6   # Células andadas antes do replanejamento por movimento
+ROCK_AHEAD = 8      # Distância (células) da rocha nova à frente do rover, como a tecla O
+
+
+def make_grid(n_obstacles, rng):
+    grid = OccupancyGrid(WORLD_WIDTH, WORLD_HEIGHT, PLANNER_CELL, ROVER_RADIUS + PLANNER_MARGIN)
+    for _ in range(n_obstacles):
+        grid.add_obstacle(rng.randint(100, WORLD_WIDTH - 100), rng.randint(100, WORLD_HEIGHT - 100),
+                          rng.randint(20, 50))
+    return grid
+
+
+def timed(fn):
+    start = time.perf_counter()
+    result = fn()
+    return result, (time.perf_counter() - start) * 1000.0
+
+
+def mean(values):
+    return sum(values) / len(values) if values else 0.0
+
+
+def p99(values):
+    s = sorted(values)
+    return s[min(len(s) - 1, int(0.99 * len(s)))] if s else 0.0
+
+
+def run_case(n_obstacles, pairs, rng):
+    grid = make_grid(n_obstacles, rng)
+    t = {"astar": [], "dstar": [], "move_astar": [], "move_dstar": [], "rock_astar": [], "rock_dstar": []}
+    ratios = []
+    solved = 0
+
+    while solved < pairs:
+        start = grid.nearest_free(grid.cell_of(rng.uniform(0, WORLD_WIDTH), rng.uniform(0, WORLD_HEIGHT)))
+        goal = grid.nearest_free(grid.cell_of(rng.uniform(0, WORLD_WIDTH), rng.uniform(0, WORLD_HEIGHT)))
+        if start is None or goal is None or start == goal:
+            continue
+        (path, cost, _), ms = timed(lambda: astar(grid, start, goal))
+        if path is None or len(path) <= 2 * ADVANCE_CELLS:
+            continue
+        solved += 1
+        t["astar"].append(ms)
+        ratios.append(cost / (COST_STRAIGHT * math.hypot(goal[0] - start[0], goal[1] - start[1])))
+
+        planner = DStarLite(grid, start, goal)
+        _, ms = timed(planner.compute)
+        t["dstar"].append(ms)
+        assert planner.path_cost() == cost
+
+        # O rover anda pelo caminho: só a chave muda no D* Lite
+        moved = path[ADVANCE_CELLS]
+        (_, cost, _), ms = timed(lambda: astar(grid, moved, goal))
+        t["move_astar"].append(ms)
+        planner.move_start(moved)
+        _, ms = timed(planner.compute)
+        t["move_dstar"].append(ms)
+        assert planner.path_cost() == cost
+
+        # Uma rocha cai no caminho à frente do rover (desfeita em seguida)
+        saved = bytes(grid.blocked)
+        cx, cy = grid.center(path[min(len(path) - 1, ADVANCE_CELLS + ROCK_AHEAD)])
+        changed = grid.add_obstacle(cx, cy, 20)
+        if grid.is_free(*moved) and grid.is_free(*goal):
+            (_, cost, _), ms = timed(lambda: astar(grid, moved, goal))
+            t["rock_astar"].append(ms)
+            _, ms = timed(lambda: (planner.cells_changed(changed), planner.compute()))
+            t["rock_dstar"].append(ms)
+            assert planner.path_cost() == cost
+        grid.blocked[:] = saved
+        grid.snap_cache.clear()
+
+    return t, ratios
+
+
+def main():
+    parser = argparse.ArgumentParser(description="A* x D* Lite na grade de ocupação do simulador")
+    parser.add_argument("--obstacles", type=int, nargs="*", default=[15, 60, 200])
+    parser.add_argument("--pairs", type=int, default=200, help="pares (rover, alvo) por mundo")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    cols = int(math.ceil(WORLD_WIDTH / PLANNER_CELL))
+    rows = int(math.ceil(WORLD_HEIGHT / PLANNER_CELL))
+    print(f"Grade {cols}x{rows} ({PLANNER_CELL} px), {args.pairs} pares por mundo; "
+          f"tempo médio / p99 em ms")
+    print(f"{'obstáculos':>10} {'A*':>13} {'D* inicial':>13} {'andou A*':>13} {'andou D*':>13} "
+          f"{'rocha A*':>13} {'rocha D*':>13} {'caminho/reta':>13}")
+    for n in args.obstacles:
+        t, ratios = run_case(n, args.pairs, rng)
+        cols_out = " ".join(f"{mean(t[k]):>6.2f}/{p99(t[k]):<6.2f}"
+                            for k in ("astar", "dstar", "move_astar", "move_dstar", "rock_astar", "rock_dstar"))
+        print(f"{n:>10} {cols_out} {mean(ratios):>6.3f}/{max(ratios):<6.3f}")
+
+
+if __name__ == "__main__":
+    main()
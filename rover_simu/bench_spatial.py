@@ -0,0 +1,179 @@
+"""Benchmark: varredura completa x grade espacial nas consultas do rover.
+
+Reproduz, para R rovers em posições aleatórias, as consultas feitas a cada
+passo da física (colisão, desvio do semi-autônomo, desvio do autônomo e
+captura/alvo entre POIs) nas duas versões:
+
+  - força bruta: o laço original sobre todos os obstáculos/POIs com sqrt
+    e `poi in captured_poi` em lista;
+  - grade: SpatialHash com distâncias ao quadrado e conjunto de capturados.
+
+Confere que as duas dão o mesmo resultado e imprime o custo por passo.
+
+Uso:
+    python bench_spatial.py                       # 15..5000 obstáculos, 50 rovers
+    python bench_spatial.py --obstacles 2000 --rovers 200 --poi 500
+"""
+import argparse
+import math
+import random
+import time
+
+from rover import ROVER_RADIUS, CAPTURE_DISTANCE
+from spatial import SpatialHash
+
+WIDTH, HEIGHT = 1024, 768
+STEP_BUDGET_MS = 1000.0 / 60
+
+
+# ---------------------------------------------------------------------------
+# Versão original (varredura completa)
+# ---------------------------------------------------------------------------
+def brute_collision(obstacles, x, y):
+    for ox, oy, size in obstacles:
+        dist = math.sqrt((ox - x)**2 + (oy - y)**2)
+        if dist < (ROVER_RADIUS + size/2):
+            return True
+    return False
+
+
+def brute_semi_auto(obstacles, x, y):
+    min_distance = float('inf')
+    closest = None
+    for ox, oy, size in obstacles:
+        dist = math.sqrt((ox - x)**2 + (oy - y)**2)
+        if dist < min_distance:
+            min_distance = dist
+            closest = (ox, oy, size)
+    return closest if min_distance < 100 else None
+
+
+def brute_autonomous(obstacles, x, y):
+    min_dist = float('inf')
+    closest = None
+    for ox, oy, size in obstacles:
+        o_dist = math.sqrt((ox - x)**2 + (oy - y)**2) - size
+        if o_dist < min_dist:
+            min_dist = o_dist
+            closest = (ox, oy, size)
+    return closest if min_dist < 80 else None
+
+
+def brute_target(poi, captured, x, y):
+    min_distance = float('inf')
+    closest = None
+    for p in poi:
+        if p in captured:
+            continue
+        dist = math.sqrt((p[0] - x)**2 + (p[1] - y)**2)
+        if dist < min_distance:
+            min_distance = dist
+            closest = p
+    return closest
+
+
+def brute_capture(poi, captured, x, y):
+    for p in poi:
+        if p in captured:
+            continue
+        if math.sqrt((p[0] - x)**2 + (p[1] - y)**2) < CAPTURE_DISTANCE:
+            return True
+    return False
+
+
+# ---------------------------------------------------------------------------
+# Versão com grade (mesmas consultas de rover.py)
+# ---------------------------------------------------------------------------
+def grid_autonomous(index, x, y):
+    min_dist = float('inf')
+    closest = None
+    for ox, oy, radius, obstacle in index.candidates(x, y, 80 + index.max_radius):
+        dx = ox - x
+        dy = oy - y
+        d2 = dx * dx + dy * dy
+        reach = 80 + radius + radius
+        if d2 < reach * reach:
+            o_dist = math.sqrt(d2) - radius - radius
+            if o_dist < min_dist:
+                min_dist = o_dist
+                closest = obstacle
+    return closest
+
+
+def run_case(n_obstacles, n_rovers, n_poi, rounds, rng):
+    obstacles = [(rng.randint(100, WIDTH - 100), rng.randint(100, HEIGHT - 100), rng.randint(20, 50))
+                 for _ in range(n_obstacles)]
+    poi = [(rng.randint(100, WIDTH - 100), rng.randint(100, HEIGHT - 100)) for _ in range(n_poi)]
+    captured_list = poi[::2]
+    captured_set = set(captured_list)
+    rovers = [(rng.uniform(32, WIDTH - 32), rng.uniform(32, HEIGHT - 32)) for _ in range(n_rovers)]
+
+    obstacle_index = SpatialHash(64)
+    for o in obstacles:
+        obstacle_index.insert(o, o[0], o[1], o[2] / 2)
+    free_index = SpatialHash(64)
+    for p in poi:
+        if p not in captured_set:
+            free_index.insert(p, p[0], p[1])
+
+    # Mesmo resultado nas duas versões
+    for x, y in rovers:
+        assert brute_collision(obstacles, x, y) == obstacle_index.any_within(x, y, ROVER_RADIUS, pad=True)
+        semi = obstacle_index.nearest(x, y, 100)
+        assert brute_semi_auto(obstacles, x, y) == (semi[1] if semi else None)
+        assert brute_autonomous(obstacles, x, y) == grid_autonomous(obstacle_index, x, y)
+        target = free_index.nearest(x, y)
+        bt = brute_target(poi, captured_list, x, y)
+        assert (bt is None) == (target is None)
+        if bt is not None:
+            assert math.isclose((bt[0] - x)**2 + (bt[1] - y)**2, target[0])
+        assert brute_capture(poi, captured_list, x, y) == \
+            (free_index.nearest(x, y, CAPTURE_DISTANCE) is not None)
+
+    def brute_step():
+        for x, y in rovers:
+            brute_collision(obstacles, x, y)
+            brute_semi_auto(obstacles, x, y)
+            brute_autonomous(obstacles, x, y)
+            brute_target(poi, captured_list, x, y)
+            brute_capture(poi, captured_list, x, y)
+
+    def grid_step():
+        for x, y in rovers:
+            obstacle_index.any_within(x, y, ROVER_RADIUS, pad=True)
+            obstacle_index.nearest(x, y, 100)
+            grid_autonomous(obstacle_index, x, y)
+            free_index.nearest(x, y)
+            free_index.nearest(x, y, CAPTURE_DISTANCE)
+
+    def timed(fn):
+        best = float('inf')
+        for _ in range(rounds):
+            start = time.perf_counter()
+            fn()
+            best = min(best, time.perf_counter() - start)
+        return best * 1000.0
+
+    return timed(brute_step), timed(grid_step)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Varredura completa x grade espacial")
+    parser.add_argument("--obstacles", type=int, nargs="*", default=[15, 200, 1000, 2000, 5000])
+    parser.add_argument("--rovers", type=int, default=50)
+    parser.add_argument("--poi", type=int, default=200)
+    parser.add_argument("--rounds", type=int, default=5, help="repetições (vale a melhor)")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    print(f"{args.rovers} rovers, {args.poi} POIs (metade capturados); custo das consultas por passo")
+    print(f"{'obstáculos':>10} {'força bruta':>13} {'grade':>10} {'ganho':>7}  60 Hz?")
+    for n in args.obstacles:
+        brute_ms, grid_ms = run_case(n, args.rovers, args.poi, args.rounds, rng)
+        ok = "sim" if grid_ms < STEP_BUDGET_MS else "não"
+        print(f"{n:>10} {brute_ms:>10.2f} ms {grid_ms:>7.2f} ms {brute_ms / grid_ms:>6.1f}x  {ok}")
+
+
+if __name__ == "__main__":
+    main()
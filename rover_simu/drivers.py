@@ -0,0 +1,68 @@
+"""Drivers de entrada para execuções sem Pico W (CI e benchmarks).
+
+ScriptDriver aplica comandos programados em tempo simulado:
+
+    # t(s)   rover     comando (mesmo formato do protocolo de texto)
+    0.0      rover-1   mode=2,lights=on
+    4.5      rover-2   speed=60,steering=-30
+    9.0      rover-2   capture=1
+
+ReplayDriver reinjeta no servidor da frota os datagramas recebidos (RX)
+de um log gravado com --record, nos mesmos instantes relativos. O log é o
+binário de session_log (com índice para começar de um instante) ou o texto
+antigo, uma linha por datagrama:
+
+    <t(s)> <ip>:<porta> <payload em hex>
+
+Os dois avançam junto com o passo fixo da física (advance(sim_time)) e não
+usam o relógio de parede, então a mesma entrada produz a mesma simulação.
+"""
+from fleet import apply_text_command
+from session_log import RX, open_reader
+
+
+class ScriptDriver:
+    def __init__(self, path, world):
+        self.world = world
+        self.events = []
+        with open(path, encoding="utf-8") as f:
+            for lineno, line in enumerate(f, 1):
+                line = line.split("#", 1)[0].strip()
+                if not line:
+                    continue
+                parts = line.split(None, 2)
+                if len(parts) != 3:
+                    raise ValueError(f"{path}:{lineno}: esperado '<t> <rover> <comando>'")
+                self.events.append((float(parts[0]), parts[1], parts[2]))
+        self.events.sort(key=lambda e: e[0])
+        self.index = 0
+
+    def done(self):
+        return self.index >= len(self.events)
+
+    def advance(self, sim_time):
+        while self.index < len(self.events) and self.events[self.index][0] <= sim_time:
+            _, name, command = self.events[self.index]
+            self.index += 1
+            rover = self.world.rover_by_name(name, create=True)
+            apply_text_command(rover, command, self.world.log)
+
+
+class ReplayDriver:
+    def __init__(self, path, server, start=0.0):
+        self.server = server
+        log = open_reader(path)
+        # A partir de `start` pelo índice, deslocado para o replay começar em 0
+        self.packets = [(t - start, addr, data)
+                        for t, _, addr, data in log.records(start or None, kinds=(RX,))]
+        self.index = 0
+
+    def done(self):
+        return self.index >= len(self.packets)
+
+    def advance(self, sim_time):
+        while self.index < len(self.packets) and self.packets[self.index][0] <= sim_time:
+            t, addr, data = self.packets[self.index]
+            self.index += 1
+            # Carimbo de recepção derivado do tempo gravado (determinístico)
+            self.server.process(data, addr, int(t * 1e6) & 0xFFFFFFFF)
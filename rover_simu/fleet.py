@@ -0,0 +1,742 @@
+"""Servidor UDP do simulador com suporte a frotas de rovers.
+
+Cada controlador (Pico W ou cliente simulado) ganha uma sessão própria,
+identificada pelo endereço de origem e pelo ID de sessão enviado no HELLO,
+com seu rover, estatísticas de enlace e decodificador de comandos.
+
+Vários controladores podem dividir um rover (`HELLO,rover=<nome>`): um só
+dirige, com uma concessão (lease) renovada por qualquer pacote dele, e os
+demais são espectadores, que recebem o status mas têm os comandos
+descartados. O ACK entrega um token de sessão, exigido para tomar o rover
+(`TAKE`), devolvê-lo (`RELEASE`) e retomar a sessão de outro endereço
+(`HELLO,token=`). O status dos espectadores sai em leque: codificado uma vez
+por rover a cada SPECTATOR_INTERVAL e enviado a todos.
+
+O socket é não-bloqueante e atendido por um selector em uma única thread de
+rede, sem lock global: cada datagrama é lido e respondido no mesmo laço e
+envios feitos pela thread principal usam sendto diretamente (atômico em UDP).
+"""
+import collections
+import hashlib
+import os
+import selectors
+import socket
+import struct
+import threading
+import time
+
+from protocol import (LinkStats, CommandStreamDecoder, CMD_HEADER, CMD_MAGIC, CMD_TYPE_DATA,
+                      PING_INTERVAL, make_pong, now_us, parse_fields)
+from rover import MAX_SPEED
+
+# Intervalo esperado entre pacotes do Pico W: em repouso ele só manda o
+# keepalive e o PING, a cada 1 s (CMD_KEEPALIVE_MS); tolera um perdido
+CMD_INTERVAL = 2.0
+# Timeout do enlace antes da primeira medida de RTT (o movimento para bem
+# antes, pelo watchdog do fluxo de comandos em motion.py)
+HELLO_TIMEOUT = 5
+# Status enviado mesmo sem receber pacotes (s)
+STATUS_IDLE_INTERVAL = 2.0
+# Sessões sem nenhum pacote por este tempo são removidas (s)
+SESSION_EXPIRE = 30.0
+# Concessão de quem dirige: sem pacote dele por este tempo, o rover fica
+# livre para o próximo que entrar (s; dois keepalives do firmware)
+LEASE_TIME = 3.0
+# Período do status em leque para os espectadores (s)
+SPECTATOR_INTERVAL = 0.1
+
+# Papéis de uma sessão no rover
+DRIVER = "driver"
+SPECTATOR = "spectator"
+
+# Estruturas de dados para o protocolo binário legado (RVRC/RVRS)
+JOYSTICK_FORMAT = "ff???x"  # x, y, button, button_a, button_b, padding
+JOYSTICK_SIZE = struct.calcsize(JOYSTICK_FORMAT)
+
+ROVER_FORMAT = "ffffB??x"  # speed, steering, battery, temperature, mode, lights, camera, padding
+ROVER_SIZE = struct.calcsize(ROVER_FORMAT)
+
+
+class Session:
+    """Um controlador conectado e o rover que ele comanda"""
+
+    def __init__(self, address, session_id, rover, now):
+        self.address = address
+        self.session_id = session_id
+        self.rover = rover
+
+        # Qualidade do enlace medida por PING/PONG (RTT, jitter, offset)
+        self.link_stats = LinkStats()
+        self.last_ping_time = 0
+
+        # Fluxo de comandos redundante (quadros RVRF) e confirmação de eventos
+        self.cmd_decoder = CommandStreamDecoder()
+        self.last_event_seq = None   # Último evento de captura processado (evack)
+
+        # Arbitragem: token do ACK e papel no rover
+        self.token = None
+        self.role = DRIVER
+        self.spawned = False         # O rover foi criado para esta sessão
+        self.rejected = 0            # Comandos descartados (espectador)
+
+        self.created = now
+        self.last_packet_time = now
+        self.last_status_time = 0
+        self.packets_in = 0
+        self.packets_out = 0
+
+    @property
+    def key(self):
+        return (self.address[0], self.address[1], self.session_id)
+
+    def link_timeout(self):
+        """Timeout adaptativo do enlace: intervalo de comandos + SRTT + K·RTTVAR"""
+        if self.link_stats.samples == 0:
+            return HELLO_TIMEOUT
+        return self.link_stats.timeout(CMD_INTERVAL)
+
+    def link_ok(self, now):
+        return now - self.last_packet_time <= self.link_timeout()
+
+
+class FleetServer:
+    """Servidor UDP não-bloqueante que hospeda um rover por sessão
+
+    Com port=None o servidor fica offline: não abre socket nem thread, os
+    datagramas são injetados com handle_datagram() (replay) e as respostas
+    descartadas. O relógio (clock) pode ser o tempo simulado, o que torna
+    timeouts e expiração de sessões determinísticos.
+    """
+
+    def __init__(self, bind_ip, port, spawn_rover, release_rover=None,
+                 log=print, verbose=True, message_hook=None, clock=time.time, record=None,
+                 find_rover=None):
+        self.spawn_rover = spawn_rover          # (session) -> Rover
+        self.release_rover = release_rover      # (rover) -> None, ao expirar a sessão
+        self.find_rover = find_rover            # (nome) -> Rover ou None, para HELLO,rover=
+        self.log = log if verbose else (lambda msg: None)
+        self.message_hook = message_hook        # (session, texto) -> None, log da UI
+        self.clock = clock
+        self.record = record                    # Gravador do log de sessão (session_log)
+        self.record_start = clock()
+
+        self.sock = None
+        self.selector = None
+        self.port = port
+        if port is not None:
+            self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+            self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+            # Buffer grande para absorver rajadas de centenas de clientes
+            self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 4 * 1024 * 1024)
+            self.sock.bind((bind_ip, port))
+            self.sock.setblocking(False)
+            self.port = self.sock.getsockname()[1]
+
+            self.selector = selectors.DefaultSelector()
+            self.selector.register(self.sock, selectors.EVENT_READ)
+
+        self.sessions = {}           # endereço -> Session
+        self.text_status = True      # Status em texto (True) ou binário RVRS (False)
+
+        # Arbitragem dos rovers divididos
+        self.drivers = {}            # rover -> Session que dirige
+        self.spectators = {}         # rover -> [Session] espectadoras
+        self.tokens = {}             # token -> Session
+        # Tokens derivados de uma chave do servidor; offline a chave é fixa
+        # e os tokens se repetem entre execuções (modo determinístico)
+        self.token_key = os.urandom(16) if port is not None else b"rover"
+        self.tokens_issued = 0
+        self.last_fanout = 0.0
+
+        # Contadores do servidor
+        self.rx_packets = 0
+        self.tx_packets = 0
+        self.tx_dropped = 0
+        self.rejected = 0            # Comandos de espectadores descartados
+        self.status_encodes = 0      # Status em leque: codificações
+        self.fanout_packets = 0      # e envios
+        self.proc_time_total = 0.0   # Tempo gasto processando datagramas (s)
+        self.proc_samples = collections.deque(maxlen=100000)   # Por datagrama (s)
+
+        self.running = False
+        self.thread = None
+
+    # ------------------------------------------------------------------
+    # Ciclo de vida
+    # ------------------------------------------------------------------
+    def start(self):
+        self.running = True
+        if self.sock is None:
+            return
+        self.thread = threading.Thread(target=self.run, daemon=True)
+        self.thread.start()
+
+    def stop(self):
+        self.running = False
+        if self.thread:
+            self.thread.join(timeout=1.0)
+        if self.sock is not None:
+            self.selector.close()
+            self.sock.close()
+
+    def run(self):
+        """Laço de rede: espera datagramas no selector e atende timers"""
+        self.log("Thread de recepção iniciada. Aguardando pacotes UDP...")
+        while self.running:
+            try:
+                events = self.selector.select(timeout=0.05)
+            except (OSError, ValueError):
+                break
+            if events:
+                self.drain()
+            self.service_timers(self.clock())
+
+    def drain(self):
+        """Lê todos os datagramas pendentes no socket"""
+        while True:
+            try:
+                data, addr = self.sock.recvfrom(2048)
+            except (BlockingIOError, InterruptedError):
+                return
+            except OSError as e:
+                if self.running:
+                    self.log(f"Erro ao receber dados: {e}")
+                return
+            # Carimbo de recepção (t2 de um PING, t4 de um PONG)
+            self.process(data, addr, now_us())
+
+    def process(self, data, addr, t_rx):
+        """Processa um datagrama medindo o tempo gasto (métrica de latência)"""
+        if self.record:
+            self.record.rx(self.clock() - self.record_start, addr, data)
+        start = time.perf_counter()
+        try:
+            self.handle_datagram(data, addr, t_rx)
+        except Exception as e:
+            self.log(f"Erro ao processar pacote de {addr}: {e}")
+        elapsed = time.perf_counter() - start
+        self.proc_time_total += elapsed
+        self.proc_samples.append(elapsed)
+
+    def send(self, payload, address):
+        """Envia sem bloquear; descarta se o buffer do socket estiver cheio"""
+        if self.record:
+            self.record.tx(self.clock() - self.record_start, address, payload)
+        if self.sock is None:
+            self.tx_packets += 1   # Offline: a resposta é só contabilizada
+            return True
+        try:
+            self.sock.sendto(payload, address)
+            self.tx_packets += 1
+            return True
+        except (BlockingIOError, InterruptedError):
+            self.tx_dropped += 1
+        except OSError as e:
+            self.tx_dropped += 1
+            if self.running:
+                self.log(f"Erro ao enviar para {address}: {e}")
+        return False
+
+    # ------------------------------------------------------------------
+    # Sessões
+    # ------------------------------------------------------------------
+    def rovers(self):
+        return [s.rover for s in list(self.sessions.values())]
+
+    def session_for_rover(self, rover):
+        """Sessão que dirige o rover (ou a primeira que o assiste)"""
+        driver = self.drivers.get(rover)
+        if driver is not None:
+            return driver
+        for s in list(self.sessions.values()):
+            if s.rover is rover:
+                return s
+        return None
+
+    def open_session(self, addr, session_id, join=None):
+        """Cria (ou recria, se o ID mudou) a sessão de um endereço
+
+        join é o rover pedido no HELLO (None = um rover próprio).
+        """
+        old = self.sessions.get(addr)
+        if old is not None:
+            if session_id is None or old.session_id == session_id:
+                return old
+            # Mesmo endereço, sessão nova: o controlador reiniciou
+            self.log(f"{addr[0]}:{addr[1]} reiniciou (sessão {old.session_id} -> {session_id})")
+            self.close_session(old)
+
+        session = Session(addr, session_id, None, self.clock())
+        if join is not None:
+            session.rover = join
+            session.role = SPECTATOR
+        else:
+            session.rover = self.spawn_rover(session)
+            session.spawned = True
+        self.sessions[addr] = session
+        if self.drivers.get(session.rover) is None and session.role == DRIVER:
+            self.drivers[session.rover] = session
+        self.log(f"Nova sessão {session_id} de {addr[0]}:{addr[1]} -> {session.rover.name}")
+        return session
+
+    def close_session(self, session):
+        if self.sessions.get(session.address) is session:
+            del self.sessions[session.address]
+        if session.token is not None:
+            self.tokens.pop(session.token, None)
+        rover = session.rover
+        self.unwatch(session)
+        if self.drivers.get(rover) is session:
+            del self.drivers[rover]
+            self.promote(rover, self.clock())
+        # O rover some com a última sessão que o usa
+        if self.release_rover and not any(s.rover is rover for s in self.sessions.values()):
+            self.release_rover(rover)
+
+    def issue_token(self, session):
+        """Token de sessão entregue no ACK (o mesmo enquanto a sessão durar)"""
+        if session.token is None:
+            self.tokens_issued += 1
+            seed = f"{session.session_id}:{session.address}:{self.tokens_issued}".encode()
+            session.token = hashlib.blake2s(seed, key=self.token_key, digest_size=8).hexdigest()
+            self.tokens[session.token] = session
+        return session.token
+
+    def resume_session(self, token, addr):
+        """HELLO,token= de outro endereço: a sessão (e o papel) mudam para ele"""
+        session = self.tokens.get(token)
+        if session is None or session.address == addr:
+            return session
+        old = self.sessions.get(addr)
+        if old is not None:
+            self.close_session(old)
+        self.sessions.pop(session.address, None)
+        self.log(f"Sessão {session.session_id} retomada de {session.address[0]}:{session.address[1]} "
+                 f"em {addr[0]}:{addr[1]}")
+        session.address = addr
+        self.sessions[addr] = session
+        return session
+
+    # ------------------------------------------------------------------
+    # Arbitragem: quem dirige e quem assiste
+    # ------------------------------------------------------------------
+    def lease_valid(self, session, now):
+        return now - session.last_packet_time <= LEASE_TIME
+
+    def watch(self, session):
+        watchers = self.spectators.setdefault(session.rover, [])
+        if session not in watchers:
+            watchers.append(session)
+
+    def unwatch(self, session):
+        watchers = self.spectators.get(session.rover)
+        if watchers and session in watchers:
+            watchers.remove(session)
+            if not watchers:
+                del self.spectators[session.rover]
+
+    def set_role(self, session, role, by=None, notify=True):
+        """Muda o papel e avisa o controlador (LEASE,...)
+
+        O movimento não é largado na troca: sem quadros do novo dono, o
+        watchdog do fluxo (motion.py) freia o rover.
+        """
+        rover = session.rover
+        if role == DRIVER:
+            self.unwatch(session)
+            self.drivers[rover] = session
+            session.cmd_decoder.reset()
+        else:
+            if self.drivers.get(rover) is session:
+                del self.drivers[rover]
+            self.watch(session)
+        session.role = role
+        if not notify:
+            return
+        msg = f"LEASE,role={role},rover={rover.name},lease={int(LEASE_TIME * 1000)}"
+        if by is not None:
+            msg += f",by={by.session_id}"
+        self.send(msg.encode('utf-8'), session.address)
+        self.message(session, f"TX: {msg}")
+
+    def take(self, session, force, notify=True):
+        """Tenta dirigir o rover da sessão; force tira o dono atual"""
+        if session.role == DRIVER:
+            return True
+        now = self.clock()
+        holder = self.drivers.get(session.rover)
+        if holder is not None and not force and self.lease_valid(holder, now):
+            return False
+        if holder is not None:
+            self.set_role(holder, SPECTATOR, by=session)
+            self.log(f"{session.rover.name}: sessão {session.session_id} tomou o rover "
+                     f"de {holder.session_id}")
+        self.set_role(session, DRIVER, notify=notify)
+        return True
+
+    def promote(self, rover, now):
+        """Passa o rover sem dono (ou de dono calado além do lease) ao espectador
+        ativo mais antigo; retorna a sessão promovida ou None"""
+        heirs = [s for s in self.spectators.get(rover, ()) if self.lease_valid(s, now)]
+        if not heirs:
+            return None
+        heir = min(heirs, key=lambda s: s.created)
+        holder = self.drivers.get(rover)
+        if holder is not None:
+            self.set_role(holder, SPECTATOR, by=heir)
+        self.set_role(heir, DRIVER)
+        self.log(f"{rover.name}: lease livre, sessão {heir.session_id} passa a dirigir")
+        return heir
+
+    def handle_arbitration(self, session, msg):
+        """TAKE,token=... e RELEASE,token=... (o token do ACK)"""
+        if parse_fields(msg).get("token") != session.token or session.token is None:
+            self.log(f"{msg.split(',', 1)[0]} de {session.address[0]} com token inválido")
+            self.send(b"LEASE,error=token", session.address)
+            return
+        if msg.startswith("TAKE"):
+            self.take(session, force=True)
+        elif session.role == DRIVER:
+            self.set_role(session, SPECTATOR)
+
+    def fanout_status(self):
+        """Status em leque: uma codificação por rover, um envio por espectador"""
+        for rover, watchers in list(self.spectators.items()):
+            payload = self.encode_status(rover)
+            self.status_encodes += 1
+            for session in list(watchers):
+                if self.send(payload, session.address):
+                    session.packets_out += 1
+                    self.fanout_packets += 1
+
+    def service_timers(self, now):
+        """PINGs periódicos, status sem tráfego, leque, lease e expiração de sessões"""
+        for session in list(self.sessions.values()):
+            if now - session.last_packet_time > SESSION_EXPIRE:
+                self.log(f"Sessão {session.session_id} de {session.address[0]} expirou")
+                self.close_session(session)
+                continue
+            if now - session.last_ping_time >= PING_INTERVAL:
+                session.last_ping_time = now
+                self.send(session.link_stats.next_ping().encode('utf-8'), session.address)
+            if session.role == DRIVER and now - session.last_packet_time > STATUS_IDLE_INTERVAL and \
+                    now - session.last_status_time > STATUS_IDLE_INTERVAL:
+                self.send_status(session)
+        # Dono calado além do lease: o rover não fica sem ninguém dirigindo
+        for rover, holder in list(self.drivers.items()):
+            if rover in self.spectators and not self.lease_valid(holder, now):
+                self.promote(rover, now)
+        if self.spectators and now - self.last_fanout >= SPECTATOR_INTERVAL:
+            self.last_fanout = now
+            self.fanout_status()
+
+    # ------------------------------------------------------------------
+    # Protocolo
+    # ------------------------------------------------------------------
+    def handle_datagram(self, data, addr, t_rx):
+        self.rx_packets += 1
+
+        # Quadros de comando binários (com redundância) têm tratamento próprio
+        if data[:4] == CMD_MAGIC:
+            session = self.open_session(addr, None)
+            self.mark_received(session)
+            if self.accept_command(session):
+                self.handle_command_frame(session, data)
+            return
+
+        # Remover caracteres nulos antes de decodificar
+        text = data.replace(b'\x00', b'')
+        msg = text.decode('utf-8', errors='ignore')
+
+        # PING/PONG são tratados antes de qualquer log para não somar o
+        # custo do processamento ao RTT medido
+        if msg.startswith("PING,"):
+            pong = make_pong(msg, t_rx)
+            session = self.open_session(addr, None)
+            self.mark_received(session)
+            if pong:
+                self.send(pong.encode('utf-8'), addr)
+            return
+        if msg.startswith("PONG,"):
+            session = self.sessions.get(addr)
+            if session:
+                self.mark_received(session)
+                session.link_stats.handle_pong(msg, t_rx)
+            return
+
+        # Descoberta: um rover anuncia-se em broadcast e trava no
+        # primeiro controlador que responder OFFER
+        if msg.startswith("DISCOVER"):
+            fields = parse_fields(msg)
+            try:
+                reply_port = int(fields.get("port", addr[1]))
+            except ValueError:
+                reply_port = addr[1]
+            self.send(f"OFFER,port={self.port}".encode('utf-8'), (addr[0], reply_port))
+            self.log(f"DISCOVER de {fields.get('name', addr[0])} ({addr[0]}). OFFER enviado")
+            return
+
+        if msg == "HELLO" or msg.startswith("HELLO,"):
+            self.handle_hello(msg, addr)
+            return
+
+        if msg.startswith("TAKE,") or msg.startswith("RELEASE,"):
+            session = self.sessions.get(addr)
+            if session:
+                self.mark_received(session)
+                self.handle_arbitration(session, msg)
+            return
+
+        session = self.open_session(addr, None)
+        self.mark_received(session)
+        if not self.accept_command(session):
+            return
+
+        # Protocolo binário legado com cabeçalho RVRC
+        if data[:4] == b'RVRC':
+            self.handle_rvrc(session, data)
+            return
+
+        self.handle_text_command(session, msg)
+
+    def handle_hello(self, msg, addr):
+        """HELLO,sid=<hex>[,token=<t>][,rover=<nome>][,role=spectator][,take=1]"""
+        fields = parse_fields(msg)
+        session_id = fields.get("sid")
+        resumed = self.resume_session(fields["token"], addr) if "token" in fields else None
+        if resumed is not None and (session_id is None or resumed.session_id == session_id):
+            session = resumed
+            is_new = False
+        else:
+            join = None
+            if "rover" in fields and self.find_rover:
+                join = self.find_rover(fields["rover"])
+                if join is None:
+                    self.log(f"HELLO de {addr[0]} pede rover {fields['rover']} inexistente; rover próprio")
+            is_new = addr not in self.sessions or \
+                (session_id is not None and self.sessions[addr].session_id != session_id)
+            session = self.open_session(addr, session_id, join)
+        if is_new:
+            # Nova sessão: reinicia o fluxo de comandos e os eventos
+            session.cmd_decoder.reset()
+            session.last_event_seq = None
+        self.mark_received(session)
+
+        # Quem entra num rover dividido dirige se o rover estiver livre (ou
+        # pedir take=1); senão assiste
+        if is_new and session.role == SPECTATOR:
+            if fields.get("role") == SPECTATOR or \
+                    not self.take(session, fields.get("take") == "1", notify=False):
+                self.watch(session)
+
+        token = self.issue_token(session)
+        self.send(f"ACK,token={token},rover={session.rover.name},role={session.role},"
+                  f"lease={int(LEASE_TIME * 1000)}".encode('utf-8'), addr)
+        self.log(f"HELLO recebido de {addr[0]}:{addr[1]}. ACK enviado ({session.role} de {session.rover.name})")
+        self.message(session, "RX: HELLO (estabelecendo conexão)")
+
+    def accept_command(self, session):
+        """Só quem dirige comanda; o dono sem lease perde a vez para quem pedir"""
+        if session.role == DRIVER:
+            return True
+        session.rejected += 1
+        self.rejected += 1
+        return False
+
+    def mark_received(self, session):
+        session.packets_in += 1
+        session.last_packet_time = self.clock()
+
+    def message(self, session, text):
+        if self.message_hook:
+            self.message_hook(session, text)
+
+    def handle_command_frame(self, session, data):
+        """Processa um quadro RVRF: reconstrói perdas e aplica o comando mais recente"""
+        rover = session.rover
+        decoder = session.cmd_decoder
+        resets = decoder.resets
+        delivered = decoder.feed(data)
+        if decoder.resets != resets:
+            session.last_event_seq = None
+
+        latest = None
+        for seq, sample, origin in delivered:
+            if origin == "paridade":
+                self.log(f"{rover.name}: quadro #{seq} reconstruído pela paridade")
+                continue
+            if origin == "historico":
+                self.log(f"{rover.name}: quadro #{seq} recuperado do histórico")
+            latest = sample
+
+        if latest is not None:
+            # Velocidade e direção vão para a referência do rover (rampas e
+            # failsafe em motion.py), não direto para a física
+            ls = session.link_stats
+            owd = ls.owd_down_us / 1e6 if ls.samples else 0.0
+            rover.motion.command(latest.speed / 100.0, latest.steering / 100.0, self.clock(), owd)
+            rover.rover_mode = latest.mode
+            rover.rover_lights = latest.lights
+            rover.rover_camera = latest.camera
+
+            # Evento de captura: processado uma única vez por número de sequência
+            evt_seq = decoder.evt_seq
+            if latest.capture and evt_seq != session.last_event_seq:
+                session.last_event_seq = evt_seq
+                rover.capture_requested = True
+                self.log(f"🟢 {rover.name}: comando de CAPTURA recebido! (evento {evt_seq})")
+            elif session.last_event_seq is None:
+                session.last_event_seq = evt_seq
+
+            self.message(session, f"RX #{decoder.last_seq}: v={latest.speed:.1f} d={latest.steering:.1f}")
+
+        # Responde com o estado (inclui evack para confirmar eventos) só aos
+        # quadros de dados: o de paridade não traz amostra nova
+        if len(data) >= CMD_HEADER.size and CMD_HEADER.unpack_from(data)[2] == CMD_TYPE_DATA:
+            self.send_status(session)
+
+    def handle_text_command(self, session, text_data):
+        """Comandos em texto legado: key1=value1,key2=value2,..."""
+        rover = session.rover
+        self.log(f"Mensagem de texto: {text_data}")
+        self.message(session, f"RX: {text_data}")
+
+        apply_text_command(rover, text_data, self.log)
+
+        self.send_status(session)
+
+    def handle_rvrc(self, session, data):
+        """Protocolo binário legado: RVRC + joystick + rover"""
+        rover = session.rover
+        if len(data) >= 4 + ROVER_SIZE and len(data) < 4 + JOYSTICK_SIZE + ROVER_SIZE:
+            try:
+                # Extrai apenas os dados do rover (usado em pacotes de teste)
+                rover_data = struct.unpack(ROVER_FORMAT, data[4:4+ROVER_SIZE])
+                apply_rover_data(rover, rover_data)
+            except struct.error as e:
+                self.log(f"Erro ao desempacotar dados do rover (pacote de teste): {e}")
+        elif len(data) >= 4 + JOYSTICK_SIZE + ROVER_SIZE:
+            try:
+                joystick_data = struct.unpack(JOYSTICK_FORMAT, data[4:4+JOYSTICK_SIZE])
+                rover_data = struct.unpack(ROVER_FORMAT, data[4+JOYSTICK_SIZE:4+JOYSTICK_SIZE+ROVER_SIZE])
+                apply_controller_data(rover, joystick_data, rover_data)
+            except struct.error as e:
+                self.log(f"Erro ao desempacotar dados completos: {e}")
+        else:
+            self.log(f"Pacote RVRC muito pequeno: {len(data)} bytes")
+            return
+        self.send_status(session)
+
+    # ------------------------------------------------------------------
+    # Status para o controlador
+    # ------------------------------------------------------------------
+    def send_status(self, session):
+        session.last_status_time = self.clock()
+        if self.text_status:
+            payload = encode_status_text(session.rover, session.last_event_seq).encode('utf-8')
+        else:
+            payload = encode_status_binary(session.rover)
+        if self.send(payload, session.address):
+            session.packets_out += 1
+
+    def encode_status(self, rover):
+        """Status sem evack (o dos espectadores)"""
+        if self.text_status:
+            return encode_status_text(rover).encode('utf-8')
+        return encode_status_binary(rover)
+
+
+def encode_status_text(rover, evack=None):
+    """Estado do rover em texto simples (inclui evack quando há evento processado)"""
+    msg = (
+        f"speed={rover.rover_speed * 100.0 / MAX_SPEED:.1f},"
+        f"steering={rover.rover_steering * 100.0:.1f},"
+        f"battery={rover.rover_battery:.1f},"
+        f"temp={rover.rover_temperature:.1f},"
+        f"mode={rover.rover_mode},"
+        f"lights={'on' if rover.rover_lights else 'off'},"
+        f"camera={'on' if rover.rover_camera else 'off'},"
+        f"score={rover.capture_score}"
+    )
+    if evack is not None:
+        msg += f",evack={evack}"
+    return msg
+
+
+def encode_status_binary(rover):
+    """Estado do rover no protocolo binário (RVRS)"""
+    return b'RVRS' + struct.pack(
+        ROVER_FORMAT,
+        rover.rover_speed * 100.0 / MAX_SPEED,  # Normaliza para -100 a 100
+        rover.rover_steering * 100.0,           # Normaliza para -100 a 100
+        rover.rover_battery,
+        rover.rover_temperature,
+        rover.rover_mode,
+        rover.rover_lights,
+        rover.rover_camera
+    )
+
+
+def apply_text_command(rover, text_data, log=print):
+    """Aplica ao rover um comando em texto (key1=value1,key2=value2,...)"""
+    if "=" in text_data:
+        values = {}
+        try:
+            pairs = text_data.split(",")
+            for pair in pairs:
+                if "=" in pair:
+                    key, value = pair.split("=", 1)
+                    key = key.strip()
+                    value = value.strip()
+
+                    if key in ["speed", "steering", "battery", "temperature"]:
+                        values[key] = float(value)
+                    elif key in ["mode"]:
+                        values[key] = int(value)
+                    elif key in ["lights", "camera"]:
+                        values[key] = value.lower() in ["true", "1", "yes", "on"]
+                    # Verifica o comando de captura
+                    elif key == "capture" and value in ["1", "true", "yes", "on"]:
+                        rover.capture_requested = True
+                        log("🟢 Comando de CAPTURA recebido!")
+
+            # Atualiza o estado do rover com base nos valores extraídos
+            if "speed" in values or "steering" in values:
+                rover.motion.release()
+            if "speed" in values:
+                rover.rover_speed = values["speed"] / 100.0 * MAX_SPEED
+            if "steering" in values:
+                rover.rover_steering = values["steering"] / 100.0
+            if "mode" in values:
+                rover.rover_mode = values["mode"]
+            if "lights" in values:
+                rover.rover_lights = values["lights"]
+            if "camera" in values:
+                rover.rover_camera = values["camera"]
+        except Exception as e:
+            log(f"Erro ao extrair valores do texto: {e}")
+
+
+def apply_rover_data(rover, rover_data):
+    """Atualiza o estado do rover com base apenas nos dados do rover (sem joystick)"""
+    speed, steering, battery, temperature, mode, lights, camera = rover_data[0:7]
+    rover.motion.release()
+    rover.rover_speed = speed / 100.0 * MAX_SPEED
+    rover.rover_steering = steering / 100.0
+    rover.rover_mode = mode
+    rover.rover_lights = lights
+    rover.rover_camera = camera
+
+
+def apply_controller_data(rover, joystick_data, rover_data):
+    """Atualiza o estado do rover com base nos dados do controlador"""
+    # No modo manual, usa o joystick para controlar o rover
+    if rover.rover_mode == 0:
+        rover.motion.release()
+        rover.rover_speed = rover_data[0] / 100.0 * MAX_SPEED  # Normaliza para a velocidade máxima
+        rover.rover_steering = rover_data[1] / 100.0  # -1.0 a 1.0
+
+    # Atualiza o modo de operação, luzes e câmera
+    rover.rover_mode = rover_data[4]
+    rover.rover_lights = rover_data[5]
+    rover.rover_camera = rover_data[6]
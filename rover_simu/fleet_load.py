@@ -0,0 +1,256 @@
+"""Gerador de carga para o simulador: centenas de firmwares simulados.
+
+Cada cliente segue o mesmo ciclo do wifi-portal.c: DISCOVER até receber
+OFFER, HELLO com ID de sessão até o ACK e então quadros RVRF a 10 Hz (com
+histórico e paridade), PINGs a 1 Hz, respostas PONG e capturas ocasionais
+confirmadas por evack. Todos os sockets são atendidos por um único selector.
+Com --watch, todos entram no mesmo rover: um dirige e os demais assistem
+(só PING e status em leque), para medir o custo do leque de status.
+
+Uso:
+    python rover_simulation.py --headless --port 8080
+    python fleet_load.py --clients 200 --duration 30 --loss 0.1
+    python fleet_load.py --clients 300 --watch rover-1
+"""
+import argparse
+import random
+import selectors
+import socket
+import time
+
+from protocol import (LinkStats, encode_command_frame, encode_parity_frame, make_pong,
+                      now_us, parse_fields, CMD_FLAG_CAPTURE, CMD_FLAG_LIGHTS)
+
+DISCOVER_INTERVAL = 0.5
+HELLO_INTERVAL = 1.0
+PING_INTERVAL = 1.0
+CMD_REDUNDANCY = 3
+CMD_PARITY_N = 4
+
+
+class FakeFirmware:
+    """Um cliente com a máquina de estados do firmware"""
+
+    def __init__(self, index, server, args, selector):
+        self.index = index
+        self.server = server
+        self.args = args
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind((args.bind, 0))
+        self.sock.setblocking(False)
+        selector.register(self.sock, selectors.EVENT_READ, self)
+
+        self.session_id = random.getrandbits(32)
+        self.state = "discover"
+        self.controller = None
+        self.next_send = time.time() + random.random() * DISCOVER_INTERVAL
+        self.next_ping = 0
+        self.connected_at = None
+        self.started_at = time.time()
+        self.spectator = False
+
+        self.link_stats = LinkStats()
+        self.seq = 0
+        self.history = []
+        self.parity_group = []
+        self.evt_seq = 0
+        self.evt_ack = 0
+        self.evt_sent_at = {}
+
+        self.tx = 0
+        self.rx = 0
+        self.status_rx = 0
+        self.dropped = 0
+        self.capture_latency = []
+
+    def send(self, payload, addr):
+        # Perda simulada no sentido cliente -> simulador
+        if self.args.loss and random.random() < self.args.loss:
+            self.dropped += 1
+            return
+        try:
+            self.sock.sendto(payload, addr)
+            self.tx += 1
+        except BlockingIOError:
+            self.dropped += 1
+
+    def tick(self, now):
+        if self.state == "discover":
+            if now >= self.next_send:
+                port = self.sock.getsockname()[1]
+                self.send(f"DISCOVER,name=load-{self.index:04d},port={port}".encode(), self.server)
+                self.next_send = now + DISCOVER_INTERVAL
+        elif self.state == "hello":
+            if now >= self.next_send:
+                hello = f"HELLO,sid={self.session_id:08x}"
+                if self.args.watch:
+                    hello += f",rover={self.args.watch}"
+                self.send(hello.encode(), self.controller)
+                self.next_send = now + HELLO_INTERVAL
+        else:
+            if now >= self.next_send and not self.spectator:
+                self.send_command(now)
+                self.next_send += 1.0 / self.args.rate
+                if self.next_send < now:
+                    self.next_send = now + 1.0 / self.args.rate
+            if now >= self.next_ping:
+                self.send(self.link_stats.next_ping().encode(), self.controller)
+                self.next_ping = now + PING_INTERVAL
+
+    def send_command(self, now):
+        # Captura ocasional: o evento fica pendente até o evack
+        if self.evt_ack == self.evt_seq and random.random() < self.args.capture_rate / self.args.rate:
+            self.evt_seq = (self.evt_seq + 1) & 0xFFFF
+            self.evt_sent_at[self.evt_seq] = now
+
+        t = now + self.index
+        flags = CMD_FLAG_LIGHTS if self.index % 2 else 0
+        if self.evt_ack != self.evt_seq:
+            flags |= CMD_FLAG_CAPTURE
+        sample = (int(600 * abs(((t * 0.1) % 2) - 1)), int(400 * ((t * 0.37) % 2 - 1)), 0, flags)
+
+        frame = encode_command_frame(self.seq, sample, self.history[:CMD_REDUNDANCY], self.evt_seq)
+        self.send(frame, self.controller)
+
+        if not self.parity_group:
+            self.parity_base = self.seq
+        self.parity_group.append(sample)
+        if len(self.parity_group) == CMD_PARITY_N:
+            self.send(encode_parity_frame(self.parity_base, self.parity_group), self.controller)
+            self.parity_group = []
+
+        self.history.insert(0, sample)
+        del self.history[8:]
+        self.seq = (self.seq + 1) & 0xFFFF
+
+    def on_datagram(self, data, addr, t_rx):
+        self.rx += 1
+        msg = data.decode("utf-8", errors="ignore")
+
+        if msg.startswith("OFFER"):
+            if self.state == "discover":
+                port = int(parse_fields(msg).get("port", addr[1]))
+                self.controller = (addr[0], port)
+                self.state = "hello"
+                self.next_send = 0
+            return
+        if msg == "ACK" or msg.startswith("ACK,") or msg.startswith("LEASE,"):
+            role = parse_fields(msg).get("role")
+            if role:
+                self.spectator = role == "spectator"
+            if self.state == "hello" and not msg.startswith("LEASE,"):
+                self.state = "run"
+                self.connected_at = time.time()
+                self.next_send = self.connected_at
+                self.next_ping = self.connected_at + random.random() * PING_INTERVAL
+            return
+        if msg.startswith("PING,"):
+            pong = make_pong(msg, t_rx)
+            if pong:
+                self.send(pong.encode(), addr)
+            return
+        if msg.startswith("PONG,"):
+            self.link_stats.handle_pong(msg, t_rx)
+            return
+
+        # Status do rover (texto)
+        self.status_rx += 1
+        fields = parse_fields("STATUS," + msg)
+        if "evack" in fields:
+            try:
+                ack = int(fields["evack"])
+            except ValueError:
+                return
+            if ack == self.evt_seq and self.evt_ack != self.evt_seq:
+                self.evt_ack = ack
+                sent = self.evt_sent_at.pop(ack, None)
+                if sent is not None:
+                    self.capture_latency.append(time.time() - sent)
+
+
+def percentile(values, p):
+    if not values:
+        return float("nan")
+    values = sorted(values)
+    return values[min(len(values) - 1, int(p / 100.0 * len(values)))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Gerador de carga para o simulador de rovers")
+    parser.add_argument("--host", default="127.0.0.1", help="endereço do simulador (alvo do DISCOVER)")
+    parser.add_argument("--port", type=int, default=8080, help="porta UDP do simulador")
+    parser.add_argument("--bind", default="0.0.0.0", help="endereço local dos clientes")
+    parser.add_argument("--clients", type=int, default=100, help="número de firmwares simulados")
+    parser.add_argument("--duration", type=float, default=20.0, help="duração do teste (s)")
+    parser.add_argument("--rate", type=float, default=10.0, help="quadros de comando por segundo")
+    parser.add_argument("--loss", type=float, default=0.0, help="perda simulada no envio (0..1)")
+    parser.add_argument("--capture-rate", type=float, default=0.2,
+                        help="capturas por segundo por cliente")
+    parser.add_argument("--ramp", type=float, default=2.0, help="tempo para iniciar todos os clientes (s)")
+    parser.add_argument("--watch", help="todos entram neste rover (um dirige, os outros assistem)")
+    args = parser.parse_args()
+
+    selector = selectors.DefaultSelector()
+    server = (args.host, args.port)
+    clients = []
+    start = time.time()
+    end = start + args.duration
+    print(f"Iniciando {args.clients} clientes contra {args.host}:{args.port} por {args.duration:.0f} s")
+
+    try:
+        while True:
+            now = time.time()
+            if now >= end:
+                break
+
+            # Entrada gradual dos clientes
+            target = args.clients if args.ramp <= 0 else \
+                min(args.clients, int(args.clients * (now - start) / args.ramp) + 1)
+            while len(clients) < target:
+                clients.append(FakeFirmware(len(clients), server, args, selector))
+
+            for key, _ in selector.select(timeout=0.005):
+                client = key.data
+                while True:
+                    try:
+                        data, addr = client.sock.recvfrom(2048)
+                    except (BlockingIOError, InterruptedError):
+                        break
+                    client.on_datagram(data, addr, now_us())
+
+            now = time.time()
+            for client in clients:
+                client.tick(now)
+    except KeyboardInterrupt:
+        pass
+
+    elapsed = time.time() - start
+    connected = [c for c in clients if c.connected_at]
+    setup = [c.connected_at - c.started_at for c in connected]
+    rtts = [c.link_stats.srtt_us / 1000.0 for c in clients if c.link_stats.samples]
+    captures = [lat * 1000.0 for c in clients for lat in c.capture_latency]
+    tx = sum(c.tx for c in clients)
+    rx = sum(c.rx for c in clients)
+
+    print("===== Resultado =====")
+    print(f"Clientes conectados: {len(connected)}/{len(clients)} "
+          f"(conexão p50 {percentile(setup, 50)*1000:.0f} ms, p99 {percentile(setup, 99)*1000:.0f} ms)")
+    print(f"Pacotes: {tx} enviados ({tx/elapsed:.0f}/s), {rx} recebidos ({rx/elapsed:.0f}/s), "
+          f"{sum(c.dropped for c in clients)} descartados")
+    print(f"Status recebidos: {sum(c.status_rx for c in clients)}")
+    watchers = [c for c in clients if c.spectator]
+    if watchers:
+        per = sum(c.status_rx for c in watchers) / len(watchers) / elapsed
+        print(f"Espectadores: {len(watchers)}, {per:.1f} status/s cada")
+    print(f"RTT (SRTT por cliente): p50 {percentile(rtts, 50):.2f} ms, p99 {percentile(rtts, 99):.2f} ms, "
+          f"max {max(rtts) if rtts else float('nan'):.2f} ms")
+    print(f"Capturas confirmadas: {len(captures)} "
+          f"(evack p50 {percentile(captures, 50):.0f} ms, p99 {percentile(captures, 99):.0f} ms)")
+
+    for c in clients:
+        c.sock.close()
+    selector.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,207 @@
+"""Estágio de comando do movimento: failsafe, rampas e latência.
+
+Os quadros de comando (RVRF) chegam a ~10 Hz e a física roda a 60 Hz. Em
+vez de saltar para cada amostra, o rover segue uma referência:
+
+- entre amostras a referência é extrapolada pela inclinação das duas
+  últimas, no máximo pelo intervalo entre elas (e então mantida), para o
+  movimento não andar em degraus quando a taxa de comandos cai;
+- a velocidade segue a referência com aceleração e jerk limitados (rampa
+  em S) e a direção com taxa limitada;
+- um watchdog do fluxo, derivado do intervalo medido entre amostras
+  (média e variação, como o RTO do TCP), freia o rover até parar quando os
+  comandos somem, muito antes do timeout do enlace (HELLO_TIMEOUT).
+
+Em repouso (amostra zerada) o firmware só manda um keepalive por segundo:
+esses intervalos não entram na média e não armam o watchdog, que não teria
+o que parar.
+
+A latência de ponta a ponta (joystick -> movimento) é medida a cada degrau
+de comando: atraso de ida estimado pelo PING/PONG mais o tempo até a
+velocidade aplicada cobrir metade do degrau.
+
+Velocidade e direção ficam normalizadas em -1..1 (fração de MAX_SPEED) e o
+tempo em segundos no relógio do servidor (o simulado no modo determinístico).
+"""
+import collections
+import math
+
+# Fluxo de comandos
+NOMINAL_INTERVAL = 0.1     # s; CMD_INTERVALO_MS do firmware, até a primeira medida
+INTERVAL_GAIN = 1 / 8      # Média móvel do intervalo (como o SRTT)
+VAR_GAIN = 1 / 4           # e da variação (como o RTTVAR)
+WATCHDOG_INTERVALS = 3     # Quadros seguidos perdidos que o histórico do RVRF ainda cobre
+WATCHDOG_K = 4
+WATCHDOG_MIN = 0.15        # s
+WATCHDOG_MAX = 1.0         # s
+
+# Rampas (fração de MAX_SPEED por s e por s²; direção em fração por s)
+MAX_ACCEL = 4.0            # 0 -> 100% em ~0,35 s
+MAX_JERK = 40.0
+FAILSAFE_ACCEL = 8.0       # Frenagem do failsafe
+FAILSAFE_JERK = 80.0
+STEER_RATE = 4.0
+
+# Medida de latência
+STEP_THRESHOLD = 0.2       # Degrau de velocidade que abre uma medida
+STEP_SETTLE = 0.5          # Fração do degrau que conta como resposta
+LATENCY_SAMPLES = 1000
+
+
+def clamp(value, low=-1.0, high=1.0):
+    return max(low, min(value, high))
+
+
+def ramp(value, rate, target, max_rate, max_jerk, dt):
+    """Segue `target` com taxa e jerk limitados; retorna (valor, taxa)
+
+    A taxa desejada é a maior que ainda zera no alvo freando com o jerk
+    máximo (erro = taxa² / 2·jerk), então não há overshoot.
+    """
+    err = target - value
+    desired = math.copysign(min(max_rate, math.sqrt(2.0 * max_jerk * abs(err))), err)
+    rate += clamp(desired - rate, -max_jerk * dt, max_jerk * dt)
+    new = value + rate * dt
+    if (target - new) * err <= 0:
+        return target, 0.0          # Chegou (ou cruzaria): encaixa no alvo
+    return new, rate
+
+
+def slew(value, target, max_step):
+    return value + clamp(target - value, -max_step, max_step)
+
+
+class MotionController:
+    """Referência de movimento de um rover comandado por fluxo
+
+    command() roda na thread de rede a cada quadro; step() no passo da
+    física. Sem fluxo (last None) o rover é do teclado, do roteiro ou do
+    modo autônomo e o controlador só acompanha o estado aplicado.
+    """
+
+    def __init__(self):
+        self.speed = 0.0
+        self.accel = 0.0
+        self.steering = 0.0
+        self.last = None            # (t, speed, steering) da amostra mais nova
+        self.prev = None            # e da anterior (extrapolação)
+        self.interval = NOMINAL_INTERVAL
+        self.interval_var = 0.0
+        self.failsafe = False
+        self.failsafes = 0
+        self.samples = 0
+        self.pending = None         # Degrau em medida: (origem, início, alvo)
+        self.latency = collections.deque(maxlen=LATENCY_SAMPLES)   # s
+
+    @property
+    def active(self):
+        return self.last is not None
+
+    def release(self, speed=0.0, steering=0.0):
+        """Comando direto (teclado, roteiro, texto): larga o fluxo"""
+        self.last = self.prev = None
+        self.pending = None
+        self.failsafe = False
+        self.sync(speed, steering)
+
+    def sync(self, speed, steering):
+        """Estado aplicado por outro caminho; a próxima rampa parte dele"""
+        self.speed = speed
+        self.accel = 0.0
+        self.steering = steering
+
+    def watchdog(self):
+        """Tempo (s) sem amostra antes do failsafe"""
+        t = WATCHDOG_INTERVALS * self.interval + WATCHDOG_K * self.interval_var
+        return clamp(t, WATCHDOG_MIN, WATCHDOG_MAX)
+
+    def command(self, speed, steering, now, owd=0.0):
+        """Amostra nova do fluxo recebida em `now`
+
+        owd é o atraso de ida estimado do controlador até aqui (s): a
+        amostra saiu do joystick em now - owd.
+        """
+        last = self.last
+        if last is not None:
+            gap = now - last[0]
+            # Até WATCHDOG_MAX o intervalo conta (o fluxo pode ter ficado mais
+            # lento); além disso foi queda, e o watchdog não se acostuma a ela
+            moving = last[1] != 0.0 or last[2] != 0.0
+            if moving and 0 < gap <= WATCHDOG_MAX:
+                self.interval_var += (abs(gap - self.interval) - self.interval_var) * VAR_GAIN
+                self.interval += (gap - self.interval) * INTERVAL_GAIN
+            if gap > WATCHDOG_MAX or self.failsafe:
+                last = None         # Fluxo retomado: nada a extrapolar
+        self.prev = last
+        self.last = (now, clamp(speed), clamp(steering))
+        self.failsafe = False
+        self.samples += 1
+
+        # Degrau: mede até a velocidade aplicada responder
+        target = self.last[1]
+        pending = self.pending
+        if pending is not None and abs(target - pending[2]) < STEP_THRESHOLD:
+            return
+        self.pending = (now - owd, self.speed, target) if abs(target - self.speed) >= STEP_THRESHOLD else None
+
+    def reference(self, last, now):
+        """Referência no instante `now`: a amostra `last`, extrapolada"""
+        t, speed, steering = last
+        prev = self.prev
+        if prev is not None and t > prev[0]:
+            span = t - prev[0]
+            ahead = min(now - t, span, self.interval)
+            # Eixo no centro é ordem de parar: não passa do zero
+            if ahead > 0:
+                if speed:
+                    speed += (speed - prev[1]) / span * ahead
+                if steering:
+                    steering += (steering - prev[2]) / span * ahead
+        return clamp(speed), clamp(steering)
+
+    def step(self, dt, now):
+        """Avança um passo da física; retorna (speed, steering) a aplicar
+
+        Retorna None se o fluxo foi largado (release() na thread de rede)
+        depois de o chamador ver active.
+        """
+        last = self.last
+        if last is None:
+            return None
+        t, speed, steering = last
+        if (speed or steering) and now - t > self.watchdog():
+            if not self.failsafe:
+                self.failsafe = True
+                self.failsafes += 1
+                self.pending = None
+            target_speed, target_steering = 0.0, 0.0
+            max_accel, max_jerk = FAILSAFE_ACCEL, FAILSAFE_JERK
+        else:
+            target_speed, target_steering = self.reference(last, now)
+            max_accel, max_jerk = MAX_ACCEL, MAX_JERK
+
+        self.speed, self.accel = ramp(self.speed, self.accel, target_speed, max_accel, max_jerk, dt)
+        self.steering = slew(self.steering, target_steering, STEER_RATE * dt)
+
+        pending = self.pending
+        if pending is not None:
+            origin, start, target = pending
+            if (self.speed - start) / (target - start) >= STEP_SETTLE:
+                self.latency.append(now - origin)
+                self.pending = None
+        return self.speed, self.steering
+
+
+def latency_summary(controllers):
+    """Percentis da latência joystick -> movimento (ms) de vários rovers"""
+    values = sorted(v for c in controllers for v in c.latency)
+
+    def pct(p):
+        return values[min(len(values) - 1, int(p / 100.0 * len(values)))] * 1000.0 if values else 0.0
+
+    return {
+        "count": len(values),
+        "p50": round(pct(50), 1),
+        "p99": round(pct(99), 1),
+        "max": round(values[-1] * 1000.0, 1) if values else 0.0,
+    }
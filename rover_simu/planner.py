@@ -0,0 +1,370 @@
+"""Planejamento de caminho para o modo autônomo.
+
+OccupancyGrid rasteriza os obstáculos numa grade de células, com o raio de
+cada rocha inflado pelo raio do rover: um caminho livre na grade é um
+caminho sem colisão para o centro do rover.
+
+astar() é a busca A* clássica (lista aberta em heap binário, heurística
+octil, 8 vizinhos sem cortar quinas). DStarLite é a versão incremental
+(Koenig & Likhachev, "D* Lite", versão otimizada): a busca é feita do alvo
+para o rover, então quando o rover anda ou células mudam só a parte afetada
+é recalculada. A primeira busca de um alvo novo equivale a um A* reverso.
+
+compute() aceita um limite de expansões, para que o trabalho de um
+planejamento longo seja dividido entre vários passos da simulação.
+"""
+import heapq
+import math
+from collections import deque
+
+INF = float("inf")
+
+# Custos inteiros (10 por célula reta, 14 na diagonal): com float, chaves que
+# deveriam empatar diferem no último bit e o D* Lite para antes da hora
+COST_STRAIGHT = 10
+COST_DIAGONAL = 14
+
+# Vizinhança 8-conexa: (dx, dy, custo)
+NEIGHBORS = ((1, 0, COST_STRAIGHT), (-1, 0, COST_STRAIGHT), (0, 1, COST_STRAIGHT), (0, -1, COST_STRAIGHT),
+             (1, 1, COST_DIAGONAL), (1, -1, COST_DIAGONAL), (-1, 1, COST_DIAGONAL), (-1, -1, COST_DIAGONAL))
+
+
+def octile(a, b):
+    dx = abs(a[0] - b[0])
+    dy = abs(a[1] - b[1])
+    return COST_STRAIGHT * (dx + dy) + (COST_DIAGONAL - 2 * COST_STRAIGHT) * min(dx, dy)
+
+
+class OccupancyGrid:
+    def __init__(self, width, height, cell, inflate):
+        self.cell = cell
+        self.inflate = inflate
+        self.cols = int(math.ceil(width / cell))
+        self.rows = int(math.ceil(height / cell))
+        self.blocked = bytearray(self.cols * self.rows)
+        self.snap_cache = {}     # célula -> nearest_free(célula); limpo quando o mapa muda
+
+    def add_obstacle(self, ox, oy, size):
+        """Marca as células cujo centro está dentro do raio inflado; retorna as alteradas"""
+        r = size / 2 + self.inflate
+        c = self.cell
+        changed = []
+        cx0 = max(0, int((ox - r) // c))
+        cx1 = min(self.cols - 1, int((ox + r) // c))
+        cy0 = max(0, int((oy - r) // c))
+        cy1 = min(self.rows - 1, int((oy + r) // c))
+        r2 = r * r
+        self.snap_cache.clear()
+        for cy in range(cy0, cy1 + 1):
+            py = (cy + 0.5) * c - oy
+            for cx in range(cx0, cx1 + 1):
+                px = (cx + 0.5) * c - ox
+                if px * px + py * py <= r2:
+                    i = cy * self.cols + cx
+                    if not self.blocked[i]:
+                        self.blocked[i] = 1
+                        changed.append((cx, cy))
+        return changed
+
+    def in_bounds(self, cx, cy):
+        return 0 <= cx < self.cols and 0 <= cy < self.rows
+
+    def is_free(self, cx, cy):
+        return 0 <= cx < self.cols and 0 <= cy < self.rows and not self.blocked[cy * self.cols + cx]
+
+    def cell_of(self, x, y):
+        return (min(self.cols - 1, max(0, int(x // self.cell))),
+                min(self.rows - 1, max(0, int(y // self.cell))))
+
+    def center(self, cell):
+        return ((cell[0] + 0.5) * self.cell, (cell[1] + 0.5) * self.cell)
+
+    def successors(self, u):
+        """Vizinhos livres de u com o custo da aresta (diagonais não cortam quinas)"""
+        x, y = u
+        cols = self.cols
+        blocked = self.blocked
+        out = []
+        if blocked[y * cols + x]:
+            return out          # Célula bloqueada não tem arestas
+        for dx, dy, cost in NEIGHBORS:
+            nx = x + dx
+            ny = y + dy
+            if not (0 <= nx < cols and 0 <= ny < self.rows) or blocked[ny * cols + nx]:
+                continue
+            if dx and dy and (blocked[y * cols + nx] or blocked[ny * cols + x]):
+                continue
+            out.append(((nx, ny), cost))
+        return out
+
+    def nearest_free(self, cell, max_ring=6):
+        """Célula livre mais próxima (por anéis), ou None"""
+        if self.is_free(*cell):
+            return cell
+        try:
+            return self.snap_cache[cell]
+        except KeyError:
+            found = self.snap_cache[cell] = self._search_free(cell, max_ring)
+            return found
+
+    def _search_free(self, cell, max_ring):
+        x, y = cell
+        for ring in range(1, max_ring + 1):
+            best = None
+            best_d = INF
+            for cx in range(x - ring, x + ring + 1):
+                for cy in (y - ring, y + ring) if abs(cx - x) != ring else range(y - ring, y + ring + 1):
+                    if self.is_free(cx, cy):
+                        d = (cx - x) ** 2 + (cy - y) ** 2
+                        if d < best_d:
+                            best, best_d = (cx, cy), d
+            if best:
+                return best
+        return None
+
+    def line_of_sight(self, a, b):
+        """True se o segmento entre os centros de a e b só passa por células livres"""
+        x0, y0 = a
+        x1, y1 = b
+        dx = abs(x1 - x0)
+        dy = abs(y1 - y0)
+        sx = 1 if x1 > x0 else -1
+        sy = 1 if y1 > y0 else -1
+        err = dx - dy
+        while True:
+            if not self.is_free(x0, y0):
+                return False
+            if x0 == x1 and y0 == y1:
+                return True
+            e2 = 2 * err
+            if e2 > -dy and e2 < dx:
+                # Passo diagonal: as duas células laterais também precisam estar livres
+                if not self.is_free(x0 + sx, y0) or not self.is_free(x0, y0 + sy):
+                    return False
+            if e2 > -dy:
+                err -= dy
+                x0 += sx
+            if e2 < dx:
+                err += dx
+                y0 += sy
+
+
+def astar(grid, start, goal):
+    """A* de start a goal; retorna (caminho [células], custo, expansões)"""
+    if not grid.is_free(*start) or not grid.is_free(*goal):
+        return None, INF, 0
+    g = {start: 0}
+    parent = {start: None}
+    open_list = [(octile(start, goal), 0, start)]
+    closed = set()
+    expansions = 0
+    while open_list:
+        _, gu, u = heapq.heappop(open_list)
+        if u in closed:
+            continue
+        if u == goal:
+            path = []
+            while u is not None:
+                path.append(u)
+                u = parent[u]
+            path.reverse()
+            return path, gu, expansions
+        closed.add(u)
+        expansions += 1
+        for v, cost in grid.successors(u):
+            gv = gu + cost
+            if gv < g.get(v, INF):
+                g[v] = gv
+                parent[v] = u
+                heapq.heappush(open_list, (gv + octile(v, goal), gv, v))
+    return None, INF, expansions
+
+
+class DStarLite:
+    """D* Lite com lista aberta em heap binário e remoção preguiçosa"""
+
+    def __init__(self, grid, start, goal):
+        self.grid = grid
+        self.start = start
+        self.last = start
+        self.goal = goal
+        self.km = 0
+        self.g = {}
+        self.rhs = {goal: 0}
+        self.open = []          # heap de (k1, k2, célula)
+        self.open_key = {}      # célula -> chave atual (entradas diferentes são obsoletas)
+        self.expansions = 0
+        self._push(goal)
+
+    def _key(self, s):
+        m = min(self.g.get(s, INF), self.rhs.get(s, INF))
+        return (m + octile(self.start, s) + self.km, m)
+
+    def _push(self, s):
+        k = self._key(s)
+        self.open_key[s] = k
+        heapq.heappush(self.open, (k[0], k[1], s))
+
+    def _update_vertex(self, u):
+        if self.g.get(u, INF) != self.rhs.get(u, INF):
+            self._push(u)
+        else:
+            self.open_key.pop(u, None)
+
+    def _recompute_rhs(self, u):
+        if u == self.goal:
+            return
+        g = self.g
+        best = INF
+        for v, cost in self.grid.successors(u):
+            c = cost + g.get(v, INF)
+            if c < best:
+                best = c
+        self.rhs[u] = best
+
+    def compute(self, max_expansions=None):
+        """Expande até o caminho do rover estar correto; False se o limite acabou antes"""
+        g = self.g
+        rhs = self.rhs
+        open_list = self.open
+        open_key = self.open_key
+        successors = self.grid.successors
+        done = 0
+        while open_list:
+            k1, k2, u = open_list[0]
+            if open_key.get(u) != (k1, k2):
+                heapq.heappop(open_list)          # Entrada obsoleta
+                continue
+            start_key = self._key(self.start)
+            rhs_start = rhs.get(self.start, INF)
+            if (k1, k2) >= start_key and rhs_start <= g.get(self.start, INF):
+                return True
+            if max_expansions is not None and done >= max_expansions:
+                return False
+            heapq.heappop(open_list)
+            done += 1
+            self.expansions += 1
+
+            k_new = self._key(u)
+            gu = g.get(u, INF)
+            ru = rhs.get(u, INF)
+            if (k1, k2) < k_new:
+                open_key[u] = k_new
+                heapq.heappush(open_list, (k_new[0], k_new[1], u))
+            elif gu > ru:
+                g[u] = ru
+                del open_key[u]
+                for s, cost in successors(u):
+                    if s != self.goal and cost + ru < rhs.get(s, INF):
+                        rhs[s] = cost + ru
+                        self._update_vertex(s)
+            else:
+                g[u] = INF
+                self._recompute_rhs(u)
+                self._update_vertex(u)
+                for s, cost in successors(u):
+                    if s != self.goal and rhs.get(s, INF) == cost + gu:
+                        self._recompute_rhs(s)
+                        self._update_vertex(s)
+        return True
+
+    def move_start(self, start):
+        """O rover mudou de célula: só ajusta km, sem refazer a busca"""
+        if start != self.start:
+            self.km += octile(self.last, start)
+            self.last = start
+            self.start = start
+
+    def cells_changed(self, cells):
+        """Células passaram a ser bloqueadas/livres: corrige as arestas afetadas"""
+        touched = set()
+        for cx, cy in cells:
+            for dx in (-1, 0, 1):
+                for dy in (-1, 0, 1):
+                    touched.add((cx + dx, cy + dy))
+        grid = self.grid
+        for u in touched:
+            if not grid.in_bounds(*u):
+                continue
+            if not grid.is_free(*u):
+                # Célula bloqueada: sem arestas, custo infinito até o alvo
+                if u != self.goal:
+                    self.rhs[u] = INF
+                self.g[u] = self.g.get(u, INF)
+            else:
+                self._recompute_rhs(u)
+            self._update_vertex(u)
+
+    def path_cost(self):
+        """Custo do caminho em unidades de COST_STRAIGHT (inf se não há caminho)"""
+        # Ao terminar compute() o rhs do rover é o custo correto (g pode ficar inf)
+        return self.rhs.get(self.start, INF)
+
+    def next_cell(self, u):
+        """Próxima célula a partir de u seguindo o gradiente de g"""
+        best = None
+        best_c = INF
+        g = self.g
+        for v, cost in self.grid.successors(u):
+            c = cost + g.get(v, INF)
+            if c < best_c:
+                best, best_c = v, c
+        return best
+
+    def path(self, limit=400):
+        """Caminho completo do rover ao alvo (lista de células) ou None"""
+        if self.path_cost() == INF:
+            return None
+        u = self.start
+        path = [u]
+        while u != self.goal and len(path) < limit:
+            u = self.next_cell(u)
+            if u is None:
+                return None
+            path.append(u)
+        return path
+
+
+class PlannerStats:
+    """Amostras de tempo de planejamento e qualidade dos caminhos (métricas)"""
+
+    def __init__(self, maxlen=100000):
+        self.plan_ms = deque(maxlen=maxlen)      # Busca completa de um alvo novo (somando passos)
+        self.repair_ms = deque(maxlen=maxlen)    # Correções incrementais (rover andou / mapa mudou)
+        self.ratios = deque(maxlen=maxlen)       # Custo do caminho / distância em linha reta
+        self.plan_expansions = 0
+        self.repair_expansions = 0
+        self.unreachable = 0
+
+    def record_plan(self, ms, expansions, ratio):
+        self.plan_ms.append(ms)
+        self.plan_expansions += expansions
+        if ratio is not None:
+            self.ratios.append(ratio)
+
+    def record_repair(self, ms, expansions):
+        self.repair_ms.append(ms)
+        self.repair_expansions += expansions
+
+    def summary(self):
+        def describe(samples):
+            s = sorted(samples)
+            if not s:
+                return {"count": 0, "mean": 0.0, "p50": 0.0, "p99": 0.0, "max": 0.0}
+            return {
+                "count": len(s),
+                "mean": round(sum(s) / len(s), 3),
+                "p50": round(s[len(s) // 2], 3),
+                "p99": round(s[min(len(s) - 1, int(0.99 * len(s)))], 3),
+                "max": round(s[-1], 3),
+            }
+        ratios = sorted(self.ratios)
+        return {
+            "plan_ms": describe(self.plan_ms),
+            "repair_ms": describe(self.repair_ms),
+            "plan_expansions": self.plan_expansions,
+            "repair_expansions": self.repair_expansions,
+            "unreachable": self.unreachable,
+            "path_ratio_mean": round(sum(ratios) / len(ratios), 3) if ratios else 0.0,
+            "path_ratio_max": round(ratios[-1], 3) if ratios else 0.0,
+        }
@@ -0,0 +1,330 @@
+"""Formatos de mensagem e estatísticas do enlace de controle Pico W <-> simulador.
+
+Espelha as estruturas do firmware (lib/link_stats.c) para que os dois lados
+calculem RTT, atrasos de ida/volta e offset de relógio da mesma forma.
+"""
+import struct
+import time
+from collections import deque, namedtuple
+
+# Constantes do estimador (iguais às do firmware)
+LINK_STATS_K = 4            # Multiplicador de RTTVAR (RFC 6298)
+LINK_FILTER_N = 8           # Trocas na janela do filtro de relógio (como no NTP)
+LINK_TIMEOUT_MIN = 0.5      # s; nunca declara perda antes disso
+LINK_TIMEOUT_MAX = 5.0      # s; usado antes da primeira amostra
+PING_INTERVAL = 1.0         # s entre PINGs enviados pelo simulador
+
+
+def now_us():
+    """Relógio local em microssegundos, truncado para 32 bits como no Pico"""
+    return (time.monotonic_ns() // 1000) & 0xFFFFFFFF
+
+
+def to_int32(value):
+    """Inteiro módulo 2^32 com sinal, como um int32_t"""
+    return ((value + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+
+
+def delta_us(end, start):
+    """Diferença entre carimbos de 32 bits tolerante a wrap-around"""
+    return to_int32(end - start)
+
+
+def div_c(a, b):
+    """Divisão inteira truncada para zero, como em C (// arredonda para baixo)"""
+    q = abs(a) // abs(b)
+    return q if (a < 0) == (b < 0) else -q
+
+
+def parse_fields(msg):
+    """Converte 'TIPO,k1=v1,k2=v2' em um dicionário {k1: v1, ...}"""
+    fields = {}
+    for pair in msg.split(",")[1:]:
+        if "=" in pair:
+            key, value = pair.split("=", 1)
+            fields[key.strip()] = value.strip()
+    return fields
+
+
+def format_ping(seq, t1):
+    return f"PING,seq={seq},t1={t1}"
+
+
+def format_pong(seq, t1, t2, t3):
+    return f"PONG,seq={seq},t1={t1},t2={t2},t3={t3}"
+
+
+class LinkStats:
+    """Estimador de RTT/offset no estilo NTP a partir dos quatro carimbos
+
+    t1 = envio do PING (local), t2 = recepção do PING (remoto),
+    t3 = envio do PONG (remoto), t4 = recepção do PONG (local)
+
+    Só o PONG do PING em voo (mesmos seq e t1) vira amostra: atrasados,
+    duplicados ou reinjetados por um replay são descartados.
+    """
+
+    def __init__(self):
+        self.srtt_us = 0
+        self.rttvar_us = 0
+        self.rtt_last_us = 0
+        self.rtt_min_us = None      # Menor RTT da janela
+        self.clock_filter = deque(maxlen=LINK_FILTER_N)   # (rtt, offset) das últimas trocas
+        self.offset_us = 0          # remoto - local
+        self.owd_up_us = 0          # local -> remoto
+        self.owd_down_us = 0        # remoto -> local
+        self.samples = 0
+        self.pings_sent = 0
+        self.ping_seq = 0
+        self.pending = None         # (seq, t1) do PING em voo
+
+    def next_ping(self):
+        """Gera o próximo PING e contabiliza o envio; substitui o que estava em voo"""
+        self.ping_seq += 1
+        self.pings_sent += 1
+        self.pending = (self.ping_seq, now_us())
+        return format_ping(*self.pending)
+
+    def sample(self, t1, t2, t3, t4):
+        """Processa uma troca completa; retorna False se a amostra for inválida"""
+        up = delta_us(t2, t1)
+        down = delta_us(t4, t3)
+        rtt = to_int32(up + down)      # O offset se cancela
+        if rtt < 0 or delta_us(t4, t1) < 0:
+            return False
+
+        self.rtt_last_us = rtt
+
+        # Estimador de Jacobson/Karels: alfa = 1/8, beta = 1/4 (aritmética
+        # inteira de lib/link_stats.c, para os dois lados darem o mesmo valor)
+        if self.samples == 0:
+            self.srtt_us = rtt
+            self.rttvar_us = div_c(rtt, 2)
+        else:
+            self.rttvar_us += div_c(abs(rtt - self.srtt_us) - self.rttvar_us, 4)
+            self.srtt_us += div_c(rtt - self.srtt_us, 8)
+
+        # Offset da troca de menor RTT das últimas LINK_FILTER_N (filtro de
+        # relógio do NTP; no empate, a mais nova): ida - RTT/2, módulo 2^32
+        # como no firmware. A janela deixa o offset acompanhar o desvio dos
+        # cristais
+        self.clock_filter.append((rtt, delta_us(up, div_c(rtt, 2))))
+        self.rtt_min_us = None
+        for rtt_f, offset_f in reversed(self.clock_filter):
+            if self.rtt_min_us is None or rtt_f < self.rtt_min_us:
+                self.rtt_min_us, self.offset_us = rtt_f, offset_f
+
+        self.owd_up_us = delta_us(up, self.offset_us)
+        self.owd_down_us = to_int32(down + self.offset_us)
+        self.samples += 1
+        return True
+
+    def handle_pong(self, msg, t4):
+        """Atualiza as estatísticas a partir de um PONG recebido"""
+        f = parse_fields(msg)
+        try:
+            seq, t1, t2, t3 = int(f["seq"]), int(f["t1"]), int(f["t2"]), int(f["t3"])
+        except (KeyError, ValueError):
+            return False
+        if self.pending != (seq, t1):
+            return False
+        self.pending = None
+        return self.sample(t1, t2, t3, t4)
+
+    def timeout(self, expected_interval):
+        """Tempo (s) sem recepção após o qual o enlace é considerado perdido"""
+        if self.samples == 0:
+            return LINK_TIMEOUT_MAX
+        t = expected_interval + (self.srtt_us + LINK_STATS_K * self.rttvar_us) / 1e6
+        return max(LINK_TIMEOUT_MIN, min(t, LINK_TIMEOUT_MAX))
+
+    def loss_pct(self):
+        """Porcentagem de PINGs sem PONG correspondente (o PING em voo não conta)"""
+        sent = self.pings_sent - (self.pending is not None)
+        if sent == 0 or self.samples >= sent:
+            return 0
+        return 100 * (sent - self.samples) // sent
+
+
+def make_pong(msg, t2):
+    """Monta a resposta a um PING recebido em t2 (relógio local)"""
+    f = parse_fields(msg)
+    try:
+        return format_pong(int(f["seq"]), int(f["t1"]), t2, now_us())
+    except (KeyError, ValueError):
+        return None
+
+
+# ---------------------------------------------------------------------------
+# Fluxo de comandos com redundância (lib/cmd_frame.h no firmware)
+# ---------------------------------------------------------------------------
+CMD_MAGIC = b"RVRF"
+CMD_HEADER = struct.Struct("<4sHBBH")   # magic, seq, tipo, k, evt_seq
+CMD_SAMPLE = struct.Struct("<hhBB")     # speed_x10, steering_x10, mode, flags
+CMD_TYPE_DATA = 0
+CMD_TYPE_PARITY = 1
+
+CMD_FLAG_LIGHTS = 0x01
+CMD_FLAG_CAMERA = 0x02
+CMD_FLAG_CAPTURE = 0x04
+
+CommandSample = namedtuple("CommandSample", "speed steering mode lights camera capture")
+
+
+def seq_diff(a, b):
+    """a - b para números de sequência de 16 bits"""
+    return ((a - b + 0x8000) & 0xFFFF) - 0x8000
+
+
+def decode_sample(raw):
+    speed, steering, mode, flags = CMD_SAMPLE.unpack(raw)
+    return CommandSample(speed / 10.0, steering / 10.0, mode,
+                         bool(flags & CMD_FLAG_LIGHTS), bool(flags & CMD_FLAG_CAMERA),
+                         bool(flags & CMD_FLAG_CAPTURE))
+
+
+def xor_bytes(a, b):
+    return bytes(x ^ y for x, y in zip(a, b))
+
+
+class CommandStreamDecoder:
+    """Reconstrói o fluxo de comandos a partir de quadros RVRF
+
+    Cada quadro de dados traz a amostra atual e as k anteriores (como delta),
+    de modo que rajadas de até k perdas são recuperadas pelo próximo quadro.
+    Quadros de paridade (XOR de um grupo) recuperam uma perda por grupo.
+    """
+
+    WINDOW = 64     # Quadros mantidos para reconstrução por paridade
+
+    def __init__(self):
+        self.reset()
+        self.frames = 0             # Quadros de dados recebidos
+        self.recovered_hist = 0     # Amostras recuperadas pelo histórico
+        self.recovered_parity = 0   # Amostras recuperadas pela paridade
+        self.lost = 0               # Amostras definitivamente perdidas
+        self.resets = 0
+
+    def reset(self):
+        self.last_seq = None
+        self.samples = {}           # seq -> amostra bruta (6 bytes)
+        self.missing = set()
+        self.evt_seq = 0
+
+    def feed(self, data):
+        """Processa um datagrama RVRF
+
+        Retorna uma lista de (seq, CommandSample, origem) em ordem de seq, com
+        origem em {"atual", "historico", "paridade"}. Amostras recuperadas pela
+        paridade chegam atrasadas (seq já superado) e servem só à estatística.
+        """
+        if len(data) < CMD_HEADER.size + CMD_SAMPLE.size or data[:4] != CMD_MAGIC:
+            return []
+        _, seq, kind, k, evt_seq = CMD_HEADER.unpack_from(data)
+        body = data[CMD_HEADER.size:]
+
+        if kind == CMD_TYPE_PARITY:
+            return self._feed_parity(seq, k, body[:CMD_SAMPLE.size])
+        if kind != CMD_TYPE_DATA or len(body) < CMD_SAMPLE.size * (1 + k):
+            return []
+
+        # Reinício do firmware ou salto grande: começa um fluxo novo
+        if self.last_seq is not None and abs(seq_diff(seq, self.last_seq)) > self.WINDOW:
+            self.resets += 1
+            self.reset()
+
+        current = body[:CMD_SAMPLE.size]
+        cur_speed, cur_steer, _, _ = CMD_SAMPLE.unpack(current)
+        candidates = {seq: current}
+        for i in range(1, k + 1):
+            d_speed, d_steer, mode, flags = CMD_SAMPLE.unpack_from(body, CMD_SAMPLE.size * i)
+            candidates[(seq - i) & 0xFFFF] = CMD_SAMPLE.pack(
+                cur_speed + d_speed, cur_steer + d_steer, mode, flags)
+
+        self.frames += 1
+        delivered = []
+
+        if self.last_seq is None:
+            self.samples.update(candidates)
+            self.last_seq = seq
+            self.evt_seq = evt_seq
+            return [(seq, decode_sample(current), "atual")]
+
+        ahead = seq_diff(seq, self.last_seq)
+        if ahead <= 0:
+            # Quadro atrasado/duplicado: só preenche lacunas antigas
+            for q, raw in candidates.items():
+                if q in self.missing:
+                    self.missing.discard(q)
+                    self.samples[q] = raw
+                    self.recovered_hist += 1
+            return []
+
+        for i in range(1, ahead + 1):
+            q = (self.last_seq + i) & 0xFFFF
+            raw = candidates.get(q)
+            if raw is None:
+                self.missing.add(q)
+                continue
+            self.samples[q] = raw
+            origin = "atual" if q == seq else "historico"
+            if origin == "historico":
+                self.recovered_hist += 1
+            delivered.append((q, decode_sample(raw), origin))
+
+        # Amostras do histórico que preenchem lacunas antigas
+        for q, raw in candidates.items():
+            if q in self.missing:
+                self.missing.discard(q)
+                self.samples[q] = raw
+                self.recovered_hist += 1
+
+        self.last_seq = seq
+        self.evt_seq = evt_seq
+        self._prune()
+        return delivered
+
+    def _feed_parity(self, base, n, parity):
+        members = [(base + i) & 0xFFFF for i in range(n)]
+        absent = [q for q in members if q not in self.samples]
+        if len(absent) != 1 or absent[0] not in self.missing:
+            return []
+        raw = parity
+        for q in members:
+            if q != absent[0]:
+                raw = xor_bytes(raw, self.samples[q])
+        q = absent[0]
+        self.missing.discard(q)
+        self.samples[q] = raw
+        self.recovered_parity += 1
+        return [(q, decode_sample(raw), "paridade")]
+
+    def _prune(self):
+        for q in list(self.samples):
+            if seq_diff(self.last_seq, q) > self.WINDOW:
+                del self.samples[q]
+        for q in list(self.missing):
+            if seq_diff(self.last_seq, q) > self.WINDOW:
+                self.missing.discard(q)
+                self.lost += 1
+
+
+def encode_command_frame(seq, sample, history, evt_seq):
+    """Monta um quadro RVRF (usado por clientes de teste e pelo replay)
+
+    sample e cada item de history são tuplas (speed_x10, steering_x10, mode, flags);
+    history[0] é a amostra seq-1.
+    """
+    out = bytearray(CMD_HEADER.pack(CMD_MAGIC, seq & 0xFFFF, CMD_TYPE_DATA, len(history), evt_seq & 0xFFFF))
+    out += CMD_SAMPLE.pack(*sample)
+    for h in history:
+        out += CMD_SAMPLE.pack(h[0] - sample[0], h[1] - sample[1], h[2], h[3])
+    return bytes(out)
+
+
+def encode_parity_frame(base, raws):
+    """Monta o quadro de paridade para as amostras brutas de um grupo"""
+    parity = bytes(CMD_SAMPLE.size)
+    for raw in raws:
+        parity = xor_bytes(parity, CMD_SAMPLE.pack(*raw))
+    return CMD_HEADER.pack(CMD_MAGIC, base & 0xFFFF, CMD_TYPE_PARITY, len(raws), 0) + parity
@@ -0,0 +1,437 @@
+"""Estado e física de um rover simulado.
+
+Cada rover conectado ao simulador tem sua própria instância; o mundo
+(obstáculos e pontos de interesse) é compartilhado entre todos.
+
+A física avança em passos fixos (um passo = 1/60 s de tempo simulado), e
+toda aleatoriedade e todo tempo vêm do mundo (world.rng e world.sim_time),
+de modo que uma simulação com a mesma semente se repete exatamente.
+
+Obstáculos e pontos são consultados pelos índices espaciais do mundo
+(world.obstacle_index, world.free_poi_index), nunca por varredura completa.
+
+No modo autônomo o rover segue um caminho planejado na grade de ocupação
+do mundo (world.occupancy, ver planner.py) em vez de mirar direto no alvo.
+
+Comandado por um fluxo de quadros (RVRF), o rover não salta para cada
+amostra: velocidade e direção vêm do MotionController (motion.py), com
+rampas e failsafe, no relógio do servidor da frota (world.server.clock()).
+"""
+import math
+import time
+
+from planner import DStarLite, COST_STRAIGHT
+from motion import MotionController
+
+# Dimensões do mundo (iguais às da janela)
+WORLD_WIDTH = 1024
+WORLD_HEIGHT = 768
+
+# Constantes de simulação
+STEP_SECONDS = 1.0 / 60  # Duração de um passo da física (PHYSICS_DT do simulador)
+TERRAIN_ROUGHNESS = 0.1  # Quanto maior, mais difícil o terreno
+MAX_SPEED = 5.0          # Velocidade máxima do rover (pixels/passo)
+BATTERY_DRAIN_RATE = 0.01  # Taxa de drenagem da bateria por passo
+TEMPERATURE_BASE = 25.0    # Temperatura base em °C
+TEMPERATURE_VARIANCE = 10.0 # Variação máxima de temperatura
+CAPTURE_DISTANCE = 50     # Distância máxima para capturar um ponto
+ROVER_RADIUS = 32         # Metade do tamanho do sprite do rover
+
+# Planejador do modo autônomo: grade de ocupação com células de 16 px e
+# rochas infladas pelo raio do rover mais uma folga
+PLANNER_CELL = 16
+PLANNER_MARGIN = 4
+PLANNER_EXPANSIONS = 600  # Expansões por rover por passo (o resto fica para o próximo)
+PATH_LOOKAHEAD = 8        # Células à frente consideradas ao escolher o waypoint
+ARRIVE_DISTANCE = 30      # Distância ao alvo que conta como chegada
+
+# Modos de operação do rover
+MODE_MANUAL = 0
+MODE_SEMI_AUTO = 1
+MODE_AUTONOMOUS = 2
+
+
+class Rover:
+    """Um rover no mundo simulado"""
+
+    def __init__(self, name, x, y):
+        self.name = name
+
+        # Estado do rover
+        self.rover_x = x
+        self.rover_y = y
+        self.rover_angle = 0
+        self.rover_speed = 0
+        self.rover_steering = 0
+        self.rover_battery = 100.0
+        self.rover_temperature = TEMPERATURE_BASE
+        self.rover_mode = MODE_MANUAL
+        self.rover_lights = False
+        self.rover_camera = False
+
+        # Referência de movimento do fluxo de comandos (failsafe e rampas)
+        self.motion = MotionController()
+
+        # Trajetória do rover (para desenhar o rastro)
+        self.trajectory = []
+        self.max_trajectory_points = 100
+
+        # Captura de pontos de interesse
+        self.capture_requested = False
+        self.capture_score = 0
+        self.capture_animation_time = 0
+        self.capture_animation_pos = None
+
+        # Variáveis para modo autônomo
+        self.autonomous_target = None
+        self.autonomous_path = []      # Células do caminho atual (planner.path())
+        self.path_index = {}           # Célula -> posição em autonomous_path
+        self.path_stale = True
+        self.waypoint = None           # Ponto a seguir, escolhido em waypoint_from
+        self.waypoint_from = None
+        self.planner = None            # DStarLite do alvo atual
+        self.plan_pending = False      # Busca inicial ainda dividida entre passos
+        self.plan_ms = 0.0
+        self.plan_expansions = 0
+        self.poi_version = -1          # Última versão dos pontos vista pelo rover
+
+    def update(self, world):
+        """Avança a física do rover em um passo fixo"""
+        # Processa pedido de captura de pontos
+        if self.capture_requested:
+            self.try_capture_poi(world)
+            self.capture_requested = False
+
+        # Fluxo de comandos: velocidade e direção seguem a referência; os
+        # modos manual e semi-autônomo partem dela
+        motion = self.motion
+        applied = None
+        if motion.active and self.rover_mode != MODE_AUTONOMOUS:
+            failsafe = motion.failsafe
+            applied = motion.step(STEP_SECONDS, world.server.clock())
+        if applied is not None:
+            self.rover_speed = applied[0] * MAX_SPEED
+            self.rover_steering = applied[1]
+            if motion.failsafe and not failsafe:
+                world.log(f"⚠️ {self.name}: sem comandos há {motion.watchdog() * 1000:.0f} ms, "
+                          f"parando (failsafe)")
+
+        # Atualiza o rover com base no modo atual
+        if self.rover_mode == MODE_MANUAL:
+            # Modo manual - controle direto
+            self.update_manual_mode(world)
+        elif self.rover_mode == MODE_SEMI_AUTO:
+            # Modo semi-autônomo - assistência ao controle
+            self.update_semi_auto_mode(world)
+        elif self.rover_mode == MODE_AUTONOMOUS:
+            # Modo autônomo - navegação automatizada
+            self.update_autonomous_mode(world)
+
+        # Sem fluxo (teclado, roteiro, autônomo) a rampa parte do estado aplicado
+        if not motion.active or self.rover_mode == MODE_AUTONOMOUS:
+            motion.sync(self.rover_speed / MAX_SPEED, self.rover_steering)
+
+        # Atualiza a posição do rover com base na velocidade e direção
+        delta_angle = self.rover_steering * 2.0  # Fator de conversão para ângulo
+
+        self.rover_angle += delta_angle
+        rad_angle = math.radians(self.rover_angle)
+
+        # Calcula o movimento com base no ângulo e velocidade
+        dx = math.sin(rad_angle) * self.rover_speed
+        dy = -math.cos(rad_angle) * self.rover_speed
+
+        # Atualiza a posição
+        new_x = self.rover_x + dx
+        new_y = self.rover_y + dy
+
+        # Verifica colisões com obstáculos
+        if not self.check_collision(world, new_x, new_y):
+            self.rover_x = new_x
+            self.rover_y = new_y
+
+            # Limita a posição ao tamanho do mundo
+            self.rover_x = max(ROVER_RADIUS, min(self.rover_x, WORLD_WIDTH - ROVER_RADIUS))
+            self.rover_y = max(ROVER_RADIUS, min(self.rover_y, WORLD_HEIGHT - ROVER_RADIUS))
+
+        # Atualiza a trajetória
+        if abs(self.rover_speed) > 0.1:
+            self.trajectory.append((self.rover_x, self.rover_y))
+            if len(self.trajectory) > self.max_trajectory_points:
+                self.trajectory.pop(0)
+
+        # Atualiza a bateria
+        self.rover_battery -= abs(self.rover_speed) * BATTERY_DRAIN_RATE
+        self.rover_battery = max(0.0, min(self.rover_battery, 100.0))
+
+        # Atualiza a temperatura com variações realistas
+        temp_change = (world.rng.random() - 0.5) * 0.2  # Pequena variação aleatória
+        temp_change += abs(self.rover_speed) * 0.02  # Temperatura aumenta com velocidade
+        self.rover_temperature += temp_change
+        self.rover_temperature = max(TEMPERATURE_BASE - 5, min(self.rover_temperature, TEMPERATURE_BASE + TEMPERATURE_VARIANCE))
+
+        # Atualiza o tempo da animação de captura
+        if self.capture_animation_time > 0:
+            if world.sim_time - self.capture_animation_time > 2.0:  # Animação dura 2 segundos
+                self.capture_animation_time = 0
+                self.capture_animation_pos = None
+
+    def try_capture_poi(self, world):
+        """Tenta capturar o ponto de interesse não capturado mais próximo"""
+        found = world.free_poi_index.nearest(self.rover_x, self.rover_y, CAPTURE_DISTANCE)
+        if found is None:
+            return
+
+        # Captura apenas um ponto por vez
+        poi = found[1]
+        world.capture_poi(poi)
+        self.capture_score += 100  # Adiciona pontos ao score
+
+        # Inicia a animação de captura
+        self.capture_animation_time = world.sim_time
+        self.capture_animation_pos = poi
+
+        world.log(f"🟢 {self.name}: ponto capturado em {poi}! Score: {self.capture_score}")
+
+        # Se ainda tiver poucos pontos, adiciona mais
+        if world.free_poi_index.count < 2:
+            world.add_new_poi()
+
+    def update_manual_mode(self, world):
+        """Atualiza no modo manual"""
+        # Já tratado pela entrada do joystick
+        pass
+
+    def update_semi_auto_mode(self, world):
+        """Atualiza no modo semi-autônomo"""
+        # Assistência para evitar obstáculos: o mais próximo a menos de 100 px
+        found = world.obstacle_index.nearest(self.rover_x, self.rover_y, 100)
+
+        # Se há um obstáculo próximo, ajusta a direção para evitá-lo
+        if found is not None:
+            min_distance = math.sqrt(found[0])
+            ox, oy, _ = found[1]
+
+            # Calcula ângulo para o obstáculo
+            angle_to_obstacle = math.degrees(math.atan2(ox - self.rover_x, -(oy - self.rover_y))) % 360
+
+            # Calcula a diferença de ângulo
+            angle_diff = (angle_to_obstacle - self.rover_angle) % 360
+            if angle_diff > 180:
+                angle_diff -= 360
+
+            # Aplica uma força repulsiva proporcional à proximidade
+            repulsion = 1.0 - min_distance / 100.0
+            steering_adjust = -math.copysign(repulsion, angle_diff)
+
+            # Limita o ajuste de direção
+            self.rover_steering = max(-1.0, min(1.0, self.rover_steering + steering_adjust * 0.2))
+
+            # Reduz a velocidade perto de obstáculos
+            self.rover_speed *= (0.8 + 0.2 * (min_distance / 100.0))
+
+    def update_autonomous_mode(self, world):
+        """Atualiza no modo autônomo"""
+        # No modo autônomo, o rover busca pontos de interesse por conta própria
+
+        # Pontos surgiram ou foram capturados: reavalia o alvo (o caminho é
+        # replanejado se o mais próximo mudou)
+        if world.poi_version != self.poi_version:
+            self.poi_version = world.poi_version
+            found = world.free_poi_index.nearest(self.rover_x, self.rover_y)
+            if found is not None and found[1] != self.autonomous_target:
+                self.autonomous_target = found[1]
+                world.log(f"{self.name}: novo alvo: {found[1]}")
+
+        # Se não temos um alvo, seleciona o ponto de interesse mais próximo não visitado
+        if not self.autonomous_target:
+            found = world.free_poi_index.nearest(self.rover_x, self.rover_y)
+
+            # Se encontrou um POI não visitado, define como alvo
+            if found is not None:
+                self.autonomous_target = found[1]
+                world.log(f"{self.name}: novo alvo: {found[1]}")
+            elif world.poi:
+                # Se todos os POIs foram visitados, seleciona um aleatório
+                self.autonomous_target = world.rng.choice(world.poi)
+
+        # Se temos um alvo, navegamos até ele
+        if self.autonomous_target:
+            tx, ty = self.autonomous_target
+
+            # Calcula a distância até o alvo
+            dist = math.sqrt((tx - self.rover_x)**2 + (ty - self.rover_y)**2)
+
+            # Alvo colado numa rocha: o caminho termina na célula livre mais
+            # próxima, e basta estar dentro do raio de captura
+            at_goal = self.planner is not None and self.planner.start == self.planner.goal
+
+            # Se chegamos ao alvo, tenta capturá-lo
+            if dist < ARRIVE_DISTANCE or (at_goal and dist < CAPTURE_DISTANCE):
+                # Se o alvo ainda não foi capturado, solicita captura
+                if self.autonomous_target not in world.captured_poi:
+                    self.capture_requested = True
+
+                world.log(f"{self.name}: alvo alcançado: {self.autonomous_target}")
+                self.autonomous_target = None
+                return
+
+            waypoint = self.follow_path(world, tx, ty)
+            if waypoint is not None:
+                # O caminho já contorna os obstáculos: basta mirar no waypoint
+                self.steer_towards(*waypoint)
+            else:
+                # Sem caminho (planejamento em andamento ou alvo inalcançável):
+                # mira no alvo com o desvio reativo do modo semi-autônomo
+                self.steer_towards(tx, ty)
+                self.avoid_obstacles(world)
+        else:
+            # Sem alvo, desacelera
+            self.rover_speed *= 0.9
+
+    def follow_path(self, world, tx, ty):
+        """Planeja/corrige o caminho até (tx, ty) e retorna o waypoint a seguir, ou None"""
+        grid = world.occupancy
+        start = grid.nearest_free(grid.cell_of(self.rover_x, self.rover_y))
+        goal = grid.nearest_free(grid.cell_of(tx, ty))
+        if start is None or goal is None:
+            return None
+
+        planner = self.planner
+        if planner is None or planner.goal != goal:
+            # Alvo novo: busca completa, dividida entre passos se for longa
+            planner = self.planner = DStarLite(grid, start, goal)
+            self.plan_pending = True
+            self.plan_ms = 0.0
+            self.plan_expansions = 0
+            self.path_stale = True
+        elif planner.start != start:
+            planner.move_start(start)
+
+        before = planner.expansions
+        budget = world.take_planner_budget(PLANNER_EXPANSIONS)
+        t0 = time.perf_counter()
+        done = planner.compute(budget)
+        elapsed_ms = (time.perf_counter() - t0) * 1000.0
+        expanded = planner.expansions - before
+        world.return_planner_budget(budget - expanded)
+
+        if self.plan_pending:
+            self.plan_ms += elapsed_ms
+            self.plan_expansions += expanded
+            if not done:
+                return None
+            self.plan_pending = False
+            cost = planner.path_cost()
+            if cost == math.inf:
+                world.planner_stats.unreachable += 1
+                ratio = None
+            else:
+                straight = math.sqrt((goal[0] - start[0])**2 + (goal[1] - start[1])**2) * COST_STRAIGHT
+                ratio = cost / straight if straight > 0 else None
+            world.planner_stats.record_plan(self.plan_ms, self.plan_expansions, ratio)
+        elif not done:
+            return None
+        elif expanded:
+            world.planner_stats.record_repair(elapsed_ms, expanded)
+            self.path_stale = True
+
+        if planner.path_cost() == math.inf:
+            return None
+
+        # Posição no caminho; fora dele (desvio, mapa mudou) o caminho é refeito
+        index = self.path_index.get(start)
+        if self.path_stale or index is None:
+            self.autonomous_path = planner.path() or []
+            self.path_index = {cell: i for i, cell in enumerate(self.autonomous_path)}
+            self.path_stale = False
+            self.waypoint_from = None
+            index = self.path_index.get(start)
+            if index is None:
+                return None
+
+        # O waypoint só muda quando o rover troca de célula
+        if self.waypoint_from != start:
+            self.waypoint_from = start
+            self.waypoint = self.pick_waypoint(grid, index, tx, ty)
+        return self.waypoint
+
+    def pick_waypoint(self, grid, index, tx, ty):
+        """A célula mais adiante do caminho visível em linha reta (o alvo, no fim)"""
+        path = self.autonomous_path
+        end = len(path) - 1
+        if index == end:
+            return (tx, ty)
+        start = path[index]
+        for i in range(min(end, index + PATH_LOOKAHEAD), index, -1):
+            if grid.line_of_sight(start, path[i]):
+                return (tx, ty) if i == end else grid.center(path[i])
+        return grid.center(path[index + 1])
+
+    def steer_towards(self, tx, ty):
+        """Ajusta direção e velocidade para seguir até (tx, ty)"""
+        # Calcula o ângulo para o alvo
+        target_angle = math.degrees(math.atan2(tx - self.rover_x, -(ty - self.rover_y))) % 360
+
+        # Calcula a diferença de ângulo
+        angle_diff = (target_angle - self.rover_angle) % 360
+        if angle_diff > 180:
+            angle_diff -= 360
+
+        # Ajusta a direção para apontar para o alvo
+        self.rover_steering = max(-1.0, min(1.0, angle_diff / 90.0))
+
+        # Ajusta a velocidade com base na distância e ângulo
+        speed_factor = 1.0 - min(1.0, abs(angle_diff) / 90.0) * 0.8
+        self.rover_speed = MAX_SPEED * speed_factor * 0.8
+
+    def avoid_obstacles(self, world):
+        """Desvio reativo: afasta-se do obstáculo de menor (distância - tamanho)"""
+        # Considera só os obstáculos que podem ficar abaixo de 80 px
+        min_obstacle_dist = float('inf')
+        closest_obstacle = None
+
+        index = world.obstacle_index
+        rx, ry = self.rover_x, self.rover_y
+        for ox, oy, radius, obstacle in index.candidates(rx, ry, 80 + index.max_radius):
+            dx = ox - rx
+            dy = oy - ry
+            d2 = dx * dx + dy * dy
+            reach = 80 + radius + radius      # 80 + tamanho
+            if d2 < reach * reach:
+                o_dist = math.sqrt(d2) - radius - radius
+                if o_dist < min_obstacle_dist:
+                    min_obstacle_dist = o_dist
+                    closest_obstacle = obstacle
+
+        if min_obstacle_dist < 80:
+            # Há um obstáculo próximo, ajusta a rota
+            ox, oy, _ = closest_obstacle
+
+            # Calcula ângulo para o obstáculo
+            obstacle_angle = math.degrees(math.atan2(ox - self.rover_x, -(oy - self.rover_y))) % 360
+
+            # Calcula a diferença de ângulo
+            obstacle_diff = (obstacle_angle - self.rover_angle) % 360
+            if obstacle_diff > 180:
+                obstacle_diff -= 360
+
+            # Aplica uma força repulsiva proporcional à proximidade
+            repulsion = 1.0 - min_obstacle_dist / 80.0
+            avoid_dir = -math.copysign(repulsion, obstacle_diff)
+
+            # Combina com a direção para o alvo
+            self.rover_steering = max(-1.0, min(1.0, self.rover_steering + avoid_dir))
+
+            # Reduz a velocidade perto de obstáculos
+            self.rover_speed *= (0.5 + 0.5 * (min_obstacle_dist / 80.0))
+
+    def obstacles_changed(self, cells):
+        """O mapa mudou: o D* Lite corrige só o trecho afetado do caminho"""
+        if self.planner is not None:
+            self.planner.cells_changed(cells)
+            self.path_stale = True
+
+    def check_collision(self, world, x, y):
+        """Verifica se há colisão com obstáculos (distância < soma dos raios)"""
+        return world.obstacle_index.any_within(x, y, ROVER_RADIUS, pad=True)
@@ -1,7 +1,7 @@
 import pygame
-import socket
-import struct
-import threading
+import argparse
+import hashlib
+import json
 import time
 import random
 import math
@@ -9,6 +9,15 @@ import sys
 import os
 from pygame.locals import *
 
+from fleet import FleetServer, JOYSTICK_FORMAT, JOYSTICK_SIZE, ROVER_FORMAT, ROVER_SIZE
+from fleet import apply_controller_data
+from drivers import ScriptDriver, ReplayDriver
+from session_log import open_writer
+from spatial import SpatialHash
+from planner import OccupancyGrid, PlannerStats
+from motion import latency_summary
+from rover import Rover, MAX_SPEED, CAPTURE_DISTANCE, ROVER_RADIUS, PLANNER_CELL, PLANNER_MARGIN, MODE_MANUAL, MODE_SEMI_AUTO, MODE_AUTONOMOUS
+
 # Configurações da janela
 WINDOW_WIDTH = 1024
 WINDOW_HEIGHT = 768
@@ -17,127 +26,116 @@ TITLE = "Rover Simulator - BitDogLab"
 # Configurações de rede
 UDP_IP = "0.0.0.0"  # Escuta em todas as interfaces
 UDP_PORT = 8080     # Porta para receber dados do Pico W
-PICO_PORT = 8081    # Porta para enviar dados para o Pico W
-LINK_OK = False
-LAST_RX = 0
-HELLO_TIMEOUT = 5    # s; se 5 s sem HELLO, link cai
+
+# Taxa de desenho (quadros por segundo) e passo fixo da física (s).
+# A física sempre avança em passos de PHYSICS_DT, independente da renderização.
+FPS = 60
+PHYSICS_DT = 1.0 / 60
+# Duração padrão do modo determinístico (s de tempo simulado)
+DETERMINISTIC_DURATION = 60.0
+# Lado da célula dos índices espaciais (~ tamanho do rover)
+SPATIAL_CELL = 64
+# Expansões de planejamento por passo somando todos os rovers
+PLANNER_STEP_BUDGET = 4000
+# Intervalo entre relatórios da frota no modo headless (s)
+HEADLESS_REPORT_INTERVAL = 5.0
 
 
 # SIMPLIFICAÇÃO: Implementação mais robusta de comunicação para resolver problemas
 # Use uma comunicação básica para estabelecer conexão, depois tentar o protocolo completo
 USAR_PROTOCOLO_SIMPLES = True
 
-# Estruturas de dados para o protocolo completo (quando USAR_PROTOCOLO_SIMPLES=False)
-JOYSTICK_FORMAT = "ff???x"  # x, y, button, button_a, button_b, padding
-JOYSTICK_SIZE = struct.calcsize(JOYSTICK_FORMAT)
-
-ROVER_FORMAT = "ffffB??x"  # speed, steering, battery, temperature, mode, lights, camera, padding
-ROVER_SIZE = struct.calcsize(ROVER_FORMAT)
-
 print(f"Formato JOYSTICK: {JOYSTICK_FORMAT}, Tamanho: {JOYSTICK_SIZE} bytes")
 print(f"Formato ROVER: {ROVER_FORMAT}, Tamanho: {ROVER_SIZE} bytes")
 
-# Constantes de simulação
-TERRAIN_ROUGHNESS = 0.1  # Quanto maior, mais difícil o terreno
-MAX_SPEED = 5.0          # Velocidade máxima do rover (pixels/frame)
-BATTERY_DRAIN_RATE = 0.01  # Taxa de drenagem da bateria por frame
-TEMPERATURE_BASE = 25.0    # Temperatura base em °C
-TEMPERATURE_VARIANCE = 10.0 # Variação máxima de temperatura
-CAPTURE_DISTANCE = 50     # Distância máxima para capturar um ponto
-
-# Modos de operação do rover
-MODE_MANUAL = 0
-MODE_SEMI_AUTO = 1
-MODE_AUTONOMOUS = 2
-
 # Classe principal do simulador do rover
 class RoverSimulator:
-    def __init__(self):
-        # Inicializa o pygame
-        pygame.init()
-        pygame.display.set_caption(TITLE)
-        
-        # Configura a janela
-        self.screen = pygame.display.set_mode((WINDOW_WIDTH, WINDOW_HEIGHT))
-        self.clock = pygame.time.Clock()
-        self.font = pygame.font.SysFont('Arial', 18)
-        self.big_font = pygame.font.SysFont('Arial', 24, bold=True)
-        
-        # Carrega imagens e recursos
-        self.load_assets()
-        
-        # Inicializa o estado do rover
-        self.rover_x = WINDOW_WIDTH // 2
-        self.rover_y = WINDOW_HEIGHT // 2
-        self.rover_angle = 0
-        self.rover_speed = 0
-        self.rover_steering = 0
-        self.rover_battery = 100.0
-        self.rover_temperature = TEMPERATURE_BASE
-        self.rover_mode = MODE_MANUAL
-        self.rover_lights = False
-        self.rover_camera = False
-        
+    def __init__(self, headless=False, port=UDP_PORT, verbose=True, seed=None, record=None,
+                 obstacles=15):
+        # port=None: sem rede (modo determinístico); datagramas vêm do replay
+        self.headless = headless
+        self.offline = port is None
+
+        # Toda aleatoriedade do mundo vem deste gerador: com a mesma semente
+        # obstáculos, pontos e física se repetem exatamente
+        self.seed = seed
+        self.rng = random.Random(seed)
+        self.sim_time = 0.0
+        self.steps = 0
+        self.drivers = []
+
+        if not headless:
+            # Inicializa o pygame
+            pygame.init()
+            pygame.display.set_caption(TITLE)
+
+            # Configura a janela
+            self.screen = pygame.display.set_mode((WINDOW_WIDTH, WINDOW_HEIGHT))
+            self.clock = pygame.time.Clock()
+            self.font = pygame.font.SysFont('Arial', 18)
+            self.big_font = pygame.font.SysFont('Arial', 24, bold=True)
+
+            # Carrega imagens e recursos
+            self.load_assets()
+
         # Variáveis para o terreno
         self.terrain_offset_x = 0
         self.terrain_offset_y = 0
-        
-        # Trajetória do rover (para desenhar o rastro)
-        self.trajectory = []
-        self.max_trajectory_points = 100
-        
-        # Obstáculos no mapa
-        self.obstacles = self.generate_obstacles(15)  # Gera 15 obstáculos aleatórios
-        
-        # Pontos de interesse no mapa
-        self.poi = self.generate_poi(5)  # Gera 5 pontos de interesse
-        
-        # NOVO: Lista para rastrear pontos capturados
-        self.captured_poi = []
-        self.capture_requested = False
-        self.capture_score = 0
-        self.capture_animation_time = 0
-        self.capture_animation_pos = None
-        
-        # Configurações de rede
-        self.udp_socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-        self.udp_socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
-        self.udp_socket.bind((UDP_IP, UDP_PORT))
-        
-        # NOVO: Configura um timeout para o socket para não bloquear
-        self.udp_socket.settimeout(0.01)  # Timeout curto para permitir saída limpa
-        
-        # Endereço do Pico W (definido manualmente)
-        # Inicialmente None, será atualizado automaticamente quando receber dados
-        self.pico_address = None
-        
-        # Flag para indicar conexão
-        self.connected = False
-        print(f"Aguardando conexão do Pico W. Descoberta automática de endereço ativada.")
-        
-        # Thread para receber dados
-        self.running = True
-        self.receive_thread = threading.Thread(target=self.receive_data)
-        self.receive_thread.daemon = True
-        self.receive_thread.start()
-        
-        # Timestamp do último pacote recebido
-        self.last_packet_time = time.time()
-        
-        # Variáveis para modo autônomo
-        self.autonomous_target = None
-        self.autonomous_path = []
-        
+
+        # Obstáculos no mapa, indexados numa grade para consultas por raio
+        self.obstacles = self.generate_obstacles(obstacles)
+        self.obstacle_index = SpatialHash(SPATIAL_CELL)
+        for obstacle in self.obstacles:
+            self.obstacle_index.insert(obstacle, obstacle[0], obstacle[1], obstacle[2] / 2)
+
+        # Grade de ocupação para o planejador do modo autônomo
+        self.occupancy = OccupancyGrid(WINDOW_WIDTH, WINDOW_HEIGHT, PLANNER_CELL,
+                                       ROVER_RADIUS + PLANNER_MARGIN)
+        for x, y, size in self.obstacles:
+            self.occupancy.add_obstacle(x, y, size)
+        self.planner_stats = PlannerStats()
+        self.planner_budget = PLANNER_STEP_BUDGET
+
+        # Pontos de interesse no mapa (compartilhados por toda a frota).
+        # poi_index tem todos os pontos; free_poi_index só os não capturados.
+        self.poi = []
+        self.captured_poi = set()
+        self.poi_version = 0     # Muda a cada ponto novo/capturado (rovers reavaliam o alvo)
+        self.poi_index = SpatialHash(SPATIAL_CELL)
+        self.free_poi_index = SpatialHash(SPATIAL_CELL)
+        for poi in self.generate_poi(5):  # Gera 5 pontos de interesse
+            self.add_poi(poi)
+
+        # Rovers da frota. Com janela, um rover local existe desde o início
+        # (controlado pelo teclado) e é assumido pelo primeiro Pico W que
+        # se conectar; os demais controladores ganham rovers novos.
+        self.rovers = []
+        self.local_rover = None
+        if not headless:
+            self.local_rover = Rover("rover-1", WINDOW_WIDTH // 2, WINDOW_HEIGHT // 2)
+            self.rovers.append(self.local_rover)
+        self.rovers_created = len(self.rovers)
+        self.focus_rover = self.local_rover   # Rover exibido no painel (TAB alterna)
+        self.lost_sessions = set()            # Sessões já avisadas de perda de enlace
+
         # Flag para pausar a simulação
         self.paused = False
-        
+
         # NOVO: Log das últimas mensagens recebidas para depuração
         self.message_log = []
         self.max_log_entries = 5
-        
-        # NOVO: Lock para proteger o socket e variáveis compartilhadas
-        self.socket_lock = threading.Lock()
-        
+
+        # Servidor UDP da frota: socket não-bloqueante, uma sessão por controlador
+        self.running = True
+        self.server = FleetServer(UDP_IP, port, self.spawn_rover, self.release_rover,
+                                  log=print, verbose=verbose, message_hook=self.on_session_message,
+                                  clock=self.sim_clock if self.offline else time.time, record=record,
+                                  find_rover=self.rover_by_name)
+        self.server.text_status = USAR_PROTOCOLO_SIMPLES
+        if not self.offline:
+            print(f"Aguardando conexão do Pico W. Descoberta automática de endereço ativada.")
+        self.server.start()
+
     def load_assets(self):
         """Carrega as imagens e recursos necessários"""
         # Carrega a imagem do rover (ou cria uma imagem básica)
@@ -151,652 +149,249 @@ class RoverSimulator:
             pygame.draw.rect(self.rover_img, (50, 50, 200), (20, 5, 24, 15))
             pygame.draw.circle(self.rover_img, (30, 30, 30), (20, 50), 10)
             pygame.draw.circle(self.rover_img, (30, 30, 30), (44, 50), 10)
-        
+
         # Imagens para obstáculos e pontos de interesse
         self.rock_img = pygame.Surface((40, 40), pygame.SRCALPHA)
         pygame.draw.circle(self.rock_img, (120, 120, 120), (20, 20), 15)
-        
+        self.rock_cache = {}
+
         self.poi_img = pygame.Surface((30, 30), pygame.SRCALPHA)
         pygame.draw.circle(self.poi_img, (50, 200, 50), (15, 15), 10)
-        
+
         # NOVO: Imagem para pontos capturados
         self.captured_poi_img = pygame.Surface((30, 30), pygame.SRCALPHA)
         pygame.draw.circle(self.captured_poi_img, (100, 100, 100), (15, 15), 8)
         pygame.draw.circle(self.captured_poi_img, (200, 200, 200), (15, 15), 5)
-        
+
         # Imagem para câmera
         self.camera_view = pygame.Surface((320, 240))
         self.camera_view.fill((20, 20, 20))
-        
+
         # Ícones para luzes, bateria, etc.
         self.light_on_img = pygame.Surface((20, 20), pygame.SRCALPHA)
         pygame.draw.circle(self.light_on_img, (255, 255, 100), (10, 10), 8)
-        
+
         self.light_off_img = pygame.Surface((20, 20), pygame.SRCALPHA)
         pygame.draw.circle(self.light_off_img, (100, 100, 100), (10, 10), 8)
-        
+
     def generate_obstacles(self, count):
         """Gera obstáculos aleatórios no mapa"""
         obstacles = []
         for _ in range(count):
-            x = random.randint(100, WINDOW_WIDTH - 100)
-            y = random.randint(100, WINDOW_HEIGHT - 100)
-            size = random.randint(20, 50)
+            x = self.rng.randint(100, WINDOW_WIDTH - 100)
+            y = self.rng.randint(100, WINDOW_HEIGHT - 100)
+            size = self.rng.randint(20, 50)
             obstacles.append((x, y, size))
         return obstacles
-    
+
     def generate_poi(self, count):
         """Gera pontos de interesse aleatórios no mapa"""
         points = []
         for _ in range(count):
-            x = random.randint(100, WINDOW_WIDTH - 100)
-            y = random.randint(100, WINDOW_HEIGHT - 100)
+            x = self.rng.randint(100, WINDOW_WIDTH - 100)
+            y = self.rng.randint(100, WINDOW_HEIGHT - 100)
             points.append((x, y))
         return points
-        
-    def receive_data(self):
-        """Thread para receber dados do Pico W"""
-        global LINK_OK, LAST_RX  # Declara as variáveis globais
-        print("Thread de recepção iniciada. Aguardando pacotes UDP...")
-        
-        while self.running:
-            try:
-                # CORREÇÃO: Proteja o acesso ao socket com lock
-                with self.socket_lock:
-                    if not self.running:
-                        break
-                    
-                    try:
-                        data, addr = self.udp_socket.recvfrom(1024)
-                    except socket.timeout:
-                        # Timeout normal do socket
-                        continue
-                    except Exception as e:
-                        if self.running:  # Ignora erros se estamos encerrando
-                            print(f"Erro ao receber dados: {e}")
-                        continue
-                
-                # Remover caracteres nulos antes de decodificar
-                data = data.replace(b'\x00', b'')
-                
-                # Tenta decodificar como texto, ignorando caracteres problemáticos
-                try:
-                    msg = data.decode('utf-8', errors='ignore')
-                    # CORREÇÃO: Remove caracteres nulos da string
-                    msg = msg.replace('\x00', '')
-                except:
-                    msg = "<não-decodificável>"
-                
-                print(f"Recebido pacote de {addr[0]}:{addr[1]} com {len(data)} bytes")
-
-                if msg == "HELLO":
-                    # Descoberta do Pico W - responde imediatamente com ACK
-                    pico_address = (addr[0], PICO_PORT)
-                    
-                    # CORREÇÃO: Proteja o acesso ao socket
-                    with self.socket_lock:
-                        if self.running:
-                            self.udp_socket.sendto(b"ACK", pico_address)
-                    
-                    LINK_OK = True
-                    LAST_RX = time.time()
-                    
-                    # Atualiza o endereço e o estado de conexão
-                    self.pico_address = pico_address
-                    self.connected = True
-                    self.last_packet_time = time.time()
-                    
-                    print(f"HELLO recebido de {addr[0]}. ACK enviado para {pico_address}")
-                    self.add_to_message_log("RX: HELLO (estabelecendo conexão)")
-                    continue
-                
-                # Atualiza o endereço do Pico W automaticamente
-                if self.pico_address is None or addr[0] != self.pico_address[0]:
-                    print(f"Endereço do Pico W detectado: {addr[0]}:{PICO_PORT}")
-                    self.pico_address = (addr[0], PICO_PORT)
-                
-                # Atualiza estado de conexão e timestamp
-                self.connected = True
-                self.last_packet_time = time.time()
-                LAST_RX = time.time()  # Atualiza variável global também
-                LINK_OK = True          # Marca link como ativo
-                
-                # SIMPLIFICAÇÃO: Tenta decodificar como texto simples primeiro
-                try:
-                    text_data = msg
-                    print(f"Mensagem de texto: {text_data}")
-                    
-                    # Adiciona ao log
-                    self.add_to_message_log(f"RX: {text_data}")
-                    
-                    # Tenta extrair valores do texto (formato: key1=value1,key2=value2,...)
-                    if "," in text_data and "=" in text_data:
-                        values = {}
-                        try:
-                            pairs = text_data.split(",")
-                            for pair in pairs:
-                                if "=" in pair:
-                                    key, value = pair.split("=", 1)
-                                    key = key.strip()
-                                    value = value.strip()
-                                    
-                                    if key in ["speed", "steering", "battery", "temperature"]:
-                                        values[key] = float(value)
-                                    elif key in ["mode"]:
-                                        values[key] = int(value)
-                                    elif key in ["lights", "camera"]:
-                                        values[key] = value.lower() in ["true", "1", "yes", "on"]
-                                    # NOVO: Verifica o comando de captura
-                                    elif key == "capture" and value in ["1", "true", "yes", "on"]:
-                                        self.capture_requested = True
-                                        print("🟢 Comando de CAPTURA recebido!")
-                            
-                            # Atualiza o estado do rover com base nos valores extraídos
-                            if "speed" in values:
-                                self.rover_speed = values["speed"] / 100.0 * MAX_SPEED
-                            if "steering" in values:
-                                self.rover_steering = values["steering"] / 100.0
-                            if "mode" in values:
-                                self.rover_mode = values["mode"]
-                            if "lights" in values:
-                                self.rover_lights = values["lights"]
-                            if "camera" in values:
-                                self.rover_camera = values["camera"]
-                            
-                            print(f"Atualizado estado do rover com: {values}")
-                        except Exception as e:
-                            print(f"Erro ao extrair valores do texto: {e}")
-                    
-                    # Envia resposta de estado como texto se estiver usando protocolo simples
-                    if USAR_PROTOCOLO_SIMPLES:
-                        self.send_status_text()
-                    else:
-                        self.send_status()
-                
-                except Exception as e:
-                    print(f"Erro ao processar mensagem: {e}")
-                
-                # Tenta processá-lo como um pacote binário se tiver pelo menos um cabeçalho
-                if len(data) >= 4:
-                    header = data[0:4]
-                    print(f"Cabeçalho: {header}")
-                    
-                    if header == b'RVRC':
-                        print("Cabeçalho RVRC detectado!")
-                        
-                        # Informações de debug para diagnóstico
-                        print(f"DEBUG - Tamanho do pacote recebido: {len(data)} bytes")
-                        
-                        # Primeiro, verifica se temos apenas dados do rover (pacote de teste)
-                        if len(data) >= 4 + ROVER_SIZE and len(data) < 4 + JOYSTICK_SIZE + ROVER_SIZE:
-                            try:
-                                # Extrai apenas os dados do rover (usado em pacotes de teste)
-                                rover_data = struct.unpack(ROVER_FORMAT, data[4:4+ROVER_SIZE])
-                                print(f"Dados do rover recebidos (pacote de teste): speed={rover_data[0]:.2f}, mode={rover_data[4]}")
-                                
-                                # Atualiza o rover com os dados básicos
-                                self.update_from_rover_only(rover_data)
-                                
-                                # Envia dados de status de volta para o Pico W
-                                if USAR_PROTOCOLO_SIMPLES:
-                                    self.send_status_text()
-                                else:
-                                    self.send_status()
-                            except struct.error as e:
-                                print(f"Erro ao desempacotar dados do rover (pacote de teste): {e}")
-                        
-                        # Verifica se temos dados completos
-                        elif len(data) >= 4 + JOYSTICK_SIZE + ROVER_SIZE:
-                            try:
-                                # Extrai os dados do joystick
-                                joystick_data = struct.unpack(JOYSTICK_FORMAT, data[4:4+JOYSTICK_SIZE])
-                                
-                                # Extrai os dados do rover
-                                rover_data = struct.unpack(ROVER_FORMAT, data[4+JOYSTICK_SIZE:4+JOYSTICK_SIZE+ROVER_SIZE])
-                                
-                                # Mostra os dados do joystick para depuração
-                                print(f"Dados do joystick: x={joystick_data[0]:.2f}, y={joystick_data[1]:.2f}")
-                                print(f"Dados do rover: speed={rover_data[0]:.2f}, steering={rover_data[1]:.2f}, mode={rover_data[4]}")
-                                
-                                # Atualiza o estado do rover com base nos dados recebidos
-                                self.update_from_controller(joystick_data, rover_data)
-                                
-                                # Envia dados de status de volta para o Pico W
-                                if USAR_PROTOCOLO_SIMPLES:
-                                    self.send_status_text()
-                                else:
-                                    self.send_status()
-                            except struct.error as e:
-                                print(f"Erro ao desempacotar dados completos: {e}")
-                        else:
-                            print(f"Pacote RVRC muito pequeno: {len(data)} bytes")
-                    else:
-                        print(f"Cabeçalho desconhecido: {header}")
-                
-            except socket.timeout:
-                # Timeout é normal para um socket não-bloqueante
-                pass
-            except Exception as e:
-                if self.running:  # Ignora erros se estamos encerrando
-                    print(f"Erro na thread de recepção: {e}")
-            
-            # Envia pacotes de status periodicamente mesmo sem receber pacotes
-            current_time = time.time()
-            if current_time - self.last_packet_time > 2.0 and self.connected and self.pico_address and self.running:
-                if USAR_PROTOCOLO_SIMPLES:
-                    self.send_status_text()
-                else:
-                    self.send_status()
-                
-            time.sleep(0.01)  # Pequeno atraso para não sobrecarregar a CPU
-    
+
+    def log(self, message):
+        """Mensagens do mundo e dos rovers (capturas, alvos)"""
+        self.server.log(message)
+
+    def sim_clock(self):
+        return self.sim_time
+
+    def rover_by_name(self, name, create=False):
+        """Rover com o nome dado; cria um novo se create=True e não existir"""
+        for rover in self.rovers:
+            if rover.name == name:
+                return rover
+        if not create:
+            return None
+        rover = Rover(name, *self.free_position())
+        self.rovers.append(rover)
+        if self.focus_rover is None:
+            self.focus_rover = rover
+        return rover
+
+    def spawn_rover(self, session):
+        """Cria o rover de uma sessão nova (chamado pela thread de rede)"""
+        # O primeiro controlador assume o rover local
+        if self.local_rover is not None and self.server_session(self.local_rover) is None:
+            return self.local_rover
+
+        self.rovers_created += 1
+        rover = Rover(f"rover-{self.rovers_created}", *self.free_position())
+        self.rovers.append(rover)
+        if self.focus_rover is None:
+            self.focus_rover = rover
+        return rover
+
+    def release_rover(self, rover):
+        """Remove o rover de uma sessão expirada (o rover local permanece)"""
+        if rover is self.local_rover:
+            return
+        try:
+            self.rovers.remove(rover)
+        except ValueError:
+            pass
+        if self.focus_rover is rover:
+            self.focus_rover = self.rovers[0] if self.rovers else None
+
+    def server_session(self, rover):
+        server = getattr(self, "server", None)
+        return server.session_for_rover(rover) if server else None
+
+    def free_position(self):
+        """Posição aleatória sem colisão com obstáculos"""
+        probe = Rover("", 0, 0)
+        for _ in range(100):
+            x = self.rng.randint(50, WINDOW_WIDTH - 50)
+            y = self.rng.randint(50, WINDOW_HEIGHT - 50)
+            if not probe.check_collision(self, x, y):
+                return x, y
+        return WINDOW_WIDTH // 2, WINDOW_HEIGHT // 2
+
+    def on_session_message(self, session, message):
+        """Só as mensagens do rover em foco vão para o log da tela"""
+        if not self.headless and session.rover is self.focus_rover:
+            self.add_to_message_log(message)
+
     def add_to_message_log(self, message):
         """Adiciona uma mensagem ao log para depuração"""
         # CORREÇÃO: Garante que a mensagem não tenha caracteres nulos
         message = message.replace('\x00', '')
-        
+
         # Limita o tamanho da mensagem para evitar problemas
         if len(message) > 100:
             message = message[:97] + "..."
-        
+
         self.message_log.append(message)
         if len(self.message_log) > self.max_log_entries:
             self.message_log.pop(0)
-    
-    def update_from_rover_only(self, rover_data):
-        """Atualiza o estado do rover com base apenas nos dados do rover (sem joystick)"""
-        # Extrai os dados do rover
-        speed, steering, battery, temperature, mode, lights, camera = rover_data[0:7]
-        
-        # Atualiza os valores do rover
-        self.rover_speed = speed / 100.0 * MAX_SPEED
-        self.rover_steering = steering / 100.0
-        self.rover_mode = mode
-        self.rover_lights = lights
-        self.rover_camera = camera
-        
-        # Para melhor depuração
-        print(f"Atualizando rover com: velocidade={self.rover_speed:.2f}, direção={self.rover_steering:.2f}")
-        print(f"Modo={self.rover_mode}, Luzes={self.rover_lights}, Câmera={self.rover_camera}")
-    
-    def update_from_controller(self, joystick_data, rover_data):
-        """Atualiza o estado do rover com base nos dados do controlador"""
-        # Extrai dados do joystick (ignorando o padding)
-        joy_x, joy_y, joy_btn, btn_a, btn_b = joystick_data[0:5]
-        
-        # No modo manual, usa o joystick para controlar o rover
-        if self.rover_mode == MODE_MANUAL:
-            # Atualiza velocidade e direção com base no joystick
-            self.rover_speed = rover_data[0] / 100.0 * MAX_SPEED  # Normaliza para a velocidade máxima
-            self.rover_steering = rover_data[1] / 100.0  # -1.0 a 1.0
-        
-        # Atualiza o modo de operação
-        self.rover_mode = rover_data[4]
-        
-        # Atualiza status de luzes e câmera
-        self.rover_lights = rover_data[5]
-        self.rover_camera = rover_data[6]
-    
-    def send_status_text(self):
-        """Envia dados de status para o Pico W em formato de texto simples"""
-        if not self.pico_address or not self.running:
-            return
-        
-        # Cria uma mensagem de texto com o estado atual
-        msg = (
-            f"speed={self.rover_speed * 100.0 / MAX_SPEED:.1f},"
-            f"steering={self.rover_steering * 100.0:.1f},"
-            f"battery={self.rover_battery:.1f},"
-            f"temp={self.rover_temperature:.1f},"
-            f"mode={self.rover_mode},"
-            f"lights={'on' if self.rover_lights else 'off'},"
-            f"camera={'on' if self.rover_camera else 'off'},"
-            f"score={self.capture_score}"
-        )
-        
-        # Envia a mensagem
-        try:
-            # CORREÇÃO: Protege o acesso ao socket com lock
-            with self.socket_lock:
-                if self.running:
-                    self.udp_socket.sendto(msg.encode('utf-8'), self.pico_address)
-            self.add_to_message_log(f"TX: {msg[:30]}...")
-        except Exception as e:
-            print(f"Erro ao enviar status de texto: {e}")
-    
-    def send_status(self):
-        """Envia dados de status para o Pico W usando o protocolo binário"""
-        if not self.pico_address or not self.running:
-            return
-        
-        # Prepara o pacote com os dados do rover
-        header = b'RVRS'
-        rover_data = struct.pack(
-            ROVER_FORMAT,
-            self.rover_speed * 100.0 / MAX_SPEED,  # Normaliza para -100 a 100
-            self.rover_steering * 100.0,           # Normaliza para -100 a 100
-            self.rover_battery,
-            self.rover_temperature,
-            self.rover_mode,
-            self.rover_lights,
-            self.rover_camera
-            # O padding 'x' no formato não precisa de um valor
-        )
-        
-        # Envia o pacote
-        try:
-            # CORREÇÃO: Protege o acesso ao socket com lock
-            with self.socket_lock:
-                if self.running:
-                    self.udp_socket.sendto(header + rover_data, self.pico_address)
-            # Não exibimos mensagens para cada envio para não sobrecarregar o console
-        except Exception as e:
-            print(f"Erro ao enviar dados de status: {e}")
-    
-    def update(self):
-        """Atualiza o estado da simulação"""
-        if self.paused:
-            return
-            
-        # NOVO: Processa pedido de captura de pontos
-        if self.capture_requested:
-            self.try_capture_poi()
-            self.capture_requested = False
-            
-        # Atualiza o rover com base no modo atual
-        if self.rover_mode == MODE_MANUAL:
-            # Modo manual - controle direto
-            self.update_manual_mode()
-        elif self.rover_mode == MODE_SEMI_AUTO:
-            # Modo semi-autônomo - assistência ao controle
-            self.update_semi_auto_mode()
-        elif self.rover_mode == MODE_AUTONOMOUS:
-            # Modo autônomo - navegação automatizada
-            self.update_autonomous_mode()
-        
-        # Atualiza a posição do rover com base na velocidade e direção
-        delta_angle = self.rover_steering * 2.0  # Fator de conversão para ângulo
-        
-        self.rover_angle += delta_angle
-        rad_angle = math.radians(self.rover_angle)
-        
-        # Calcula o movimento com base no ângulo e velocidade
-        dx = math.sin(rad_angle) * self.rover_speed
-        dy = -math.cos(rad_angle) * self.rover_speed
-        
-        # Atualiza a posição
-        new_x = self.rover_x + dx
-        new_y = self.rover_y + dy
-        
-        # Verifica colisões com obstáculos
-        if not self.check_collision(new_x, new_y):
-            self.rover_x = new_x
-            self.rover_y = new_y
-            
-            # Limita a posição ao tamanho da janela
-            self.rover_x = max(32, min(self.rover_x, WINDOW_WIDTH - 32))
-            self.rover_y = max(32, min(self.rover_y, WINDOW_HEIGHT - 32))
-        
-        # Atualiza a trajetória
-        if abs(self.rover_speed) > 0.1:
-            self.trajectory.append((self.rover_x, self.rover_y))
-            if len(self.trajectory) > self.max_trajectory_points:
-                self.trajectory.pop(0)
-        
-        # Atualiza a bateria
-        self.rover_battery -= abs(self.rover_speed) * BATTERY_DRAIN_RATE
-        self.rover_battery = max(0.0, min(self.rover_battery, 100.0))
-        
-        # Atualiza a temperatura com variações realistas
-        temp_change = (random.random() - 0.5) * 0.2  # Pequena variação aleatória
-        temp_change += abs(self.rover_speed) * 0.02  # Temperatura aumenta com velocidade
-        self.rover_temperature += temp_change
-        self.rover_temperature = max(TEMPERATURE_BASE - 5, min(self.rover_temperature, TEMPERATURE_BASE + TEMPERATURE_VARIANCE))
-        
-        # Verifica se perdemos a conexão
-        current_time = time.time()
-        if self.connected and current_time - self.last_packet_time > 5.0:
-            print("⚠️ Sem comunicação com o Pico W nos últimos 5 segundos")
-            # Não desativamos a flag connected para continuar tentando enviar pacotes
-            
-        # NOVO: Atualiza o tempo da animação de captura
-        if self.capture_animation_time > 0:
-            if time.time() - self.capture_animation_time > 2.0:  # Animação dura 2 segundos
-                self.capture_animation_time = 0
-                self.capture_animation_pos = None
-    
-    # NOVO: Função para tentar capturar um ponto de interesse
-    def try_capture_poi(self):
-        """Tenta capturar um ponto de interesse próximo ao rover"""
-        for poi in self.poi[:]:  # Cria uma cópia para poder modificar durante o loop
-            # Verifica se o ponto já foi capturado
-            if poi in self.captured_poi:
-                continue
-                
-            # Calcula a distância entre o rover e o ponto
-            dist = math.sqrt((poi[0] - self.rover_x)**2 + (poi[1] - self.rover_y)**2)
-            
-            # Se o rover estiver próximo o suficiente, captura o ponto
-            if dist < CAPTURE_DISTANCE:
-                self.captured_poi.append(poi)
-                self.capture_score += 100  # Adiciona pontos ao score
-                
-                # Inicia a animação de captura
-                self.capture_animation_time = time.time()
-                self.capture_animation_pos = poi
-                
-                print(f"🟢 Ponto capturado em {poi}! Score: {self.capture_score}")
-                
-                # Se ainda tiver poucos pontos, adiciona mais
-                if len(self.poi) - len(self.captured_poi) < 2:
-                    self.add_new_poi()
-                
-                # Encerra após a primeira captura (captura apenas um ponto por vez)
-                break
-    
+
     # NOVO: Função para adicionar novos pontos de interesse
     def add_new_poi(self):
         """Adiciona novos pontos de interesse ao mapa"""
         # Adiciona um ponto em uma posição aleatória
         for _ in range(2):  # Adiciona 2 novos pontos
-            while True:
-                x = random.randint(100, WINDOW_WIDTH - 100)
-                y = random.randint(100, WINDOW_HEIGHT - 100)
+            for _ in range(1000):   # Mundos muito cheios podem não ter vaga
+                x = self.rng.randint(100, WINDOW_WIDTH - 100)
+                y = self.rng.randint(100, WINDOW_HEIGHT - 100)
                 new_poi = (x, y)
-                
-                # Verifica se o ponto está longe de obstáculos
+
+                # Verifica se o ponto está longe de obstáculos (distância < tamanho + 50)
                 valid = True
-                for ox, oy, size in self.obstacles:
-                    if math.sqrt((ox - x)**2 + (oy - y)**2) < size + 50:
+                index = self.obstacle_index
+                for ox, oy, _, (_, _, size) in index.candidates(x, y, 50 + index.max_radius):
+                    if (ox - x)**2 + (oy - y)**2 < (size + 50)**2:
                         valid = False
                         break
-                
+
                 # Verifica se está longe de outros pontos
-                for px, py in self.poi:
-                    if math.sqrt((px - x)**2 + (py - y)**2) < 100:
-                        valid = False
-                        break
-                
+                if valid and self.poi_index.any_within(x, y, 100):
+                    valid = False
+
                 # Se a posição for válida, adiciona o ponto
                 if valid:
-                    self.poi.append(new_poi)
-                    print(f"Novo ponto de interesse adicionado em {new_poi}")
+                    self.add_poi(new_poi)
+                    self.log(f"Novo ponto de interesse adicionado em {new_poi}")
                     break
-    
-    def update_manual_mode(self):
-        """Atualiza no modo manual"""
-        # Já tratado pela entrada do joystick
-        pass
-    
-    def update_semi_auto_mode(self):
-        """Atualiza no modo semi-autônomo"""
-        # Assistência para evitar obstáculos
-        min_distance = float('inf')
-        closest_obstacle = None
-        
-        # Encontra o obstáculo mais próximo
-        for ox, oy, size in self.obstacles:
-            dist = math.sqrt((ox - self.rover_x)**2 + (oy - self.rover_y)**2)
-            if dist < min_distance:
-                min_distance = dist
-                closest_obstacle = (ox, oy, size)
-        
-        # Se há um obstáculo próximo, ajusta a direção para evitá-lo
-        if min_distance < 100:
-            ox, oy, _ = closest_obstacle
-            
-            # Calcula ângulo para o obstáculo
-            angle_to_obstacle = math.degrees(math.atan2(ox - self.rover_x, -(oy - self.rover_y))) % 360
-            
-            # Calcula a diferença de ângulo
-            angle_diff = (angle_to_obstacle - self.rover_angle) % 360
-            if angle_diff > 180:
-                angle_diff -= 360
-            
-            # Aplica uma força repulsiva proporcional à proximidade
-            repulsion = 1.0 - min_distance / 100.0
-            steering_adjust = -math.copysign(repulsion, angle_diff)
-            
-            # Limita o ajuste de direção
-            self.rover_steering = max(-1.0, min(1.0, self.rover_steering + steering_adjust * 0.2))
-            
-            # Reduz a velocidade perto de obstáculos
-            self.rover_speed *= (0.8 + 0.2 * (min_distance / 100.0))
-    
-    def update_autonomous_mode(self):
-        """Atualiza no modo autônomo"""
-        # No modo autônomo, o rover busca pontos de interesse por conta própria
-        
-        # Se não temos um alvo, seleciona o ponto de interesse mais próximo não visitado
-        if not self.autonomous_target:
-            min_distance = float('inf')
-            closest_poi = None
-            
-            for poi in self.poi:
-                # Verifica se o ponto já foi capturado
-                if poi in self.captured_poi:
-                    continue
-                
-                # Calcula a distância até o ponto
-                dist = math.sqrt((poi[0] - self.rover_x)**2 + (poi[1] - self.rover_y)**2)
-                if dist < min_distance:
-                    min_distance = dist
-                    closest_poi = poi
-            
-            # Se encontrou um POI não visitado, define como alvo
-            if closest_poi:
-                self.autonomous_target = closest_poi
-                print(f"Novo alvo: {closest_poi}")
-            else:
-                # Se todos os POIs foram visitados, seleciona um aleatório
-                if self.poi:
-                    # Tenta encontrar um ponto não capturado
-                    uncaptured = [p for p in self.poi if p not in self.captured_poi]
-                    if uncaptured:
-                        self.autonomous_target = random.choice(uncaptured)
-                    else:
-                        self.autonomous_target = random.choice(self.poi)
-        
-        # Se temos um alvo, navegamos até ele
-        if self.autonomous_target:
-            tx, ty = self.autonomous_target
-            
-            # Calcula a distância até o alvo
-            dist = math.sqrt((tx - self.rover_x)**2 + (ty - self.rover_y)**2)
-            
-            # Se chegamos ao alvo, tenta capturá-lo
-            if dist < 30:
-                # Se o alvo ainda não foi capturado, solicita captura
-                if self.autonomous_target not in self.captured_poi:
-                    self.capture_requested = True
-                
-                print(f"Alvo alcançado: {self.autonomous_target}")
-                self.autonomous_target = None
-                return
-            
-            # Calcula o ângulo para o alvo
-            target_angle = math.degrees(math.atan2(tx - self.rover_x, -(ty - self.rover_y))) % 360
-            
-            # Calcula a diferença de ângulo
-            angle_diff = (target_angle - self.rover_angle) % 360
-            if angle_diff > 180:
-                angle_diff -= 360
-            
-            # Ajusta a direção para apontar para o alvo
-            self.rover_steering = max(-1.0, min(1.0, angle_diff / 90.0))
-            
-            # Ajusta a velocidade com base na distância e ângulo
-            speed_factor = 1.0 - min(1.0, abs(angle_diff) / 90.0) * 0.8
-            self.rover_speed = MAX_SPEED * speed_factor * 0.8
-            
-            # Aplica a lógica de desvio de obstáculos do modo semi-autônomo
-            min_obstacle_dist = float('inf')
-            closest_obstacle = None
-            
-            for ox, oy, size in self.obstacles:
-                o_dist = math.sqrt((ox - self.rover_x)**2 + (oy - self.rover_y)**2) - size
-                if o_dist < min_obstacle_dist:
-                    min_obstacle_dist = o_dist
-                    closest_obstacle = (ox, oy, size)
-            
-            if min_obstacle_dist < 80:
-                # Há um obstáculo próximo, ajusta a rota
-                ox, oy, _ = closest_obstacle
-                
-                # Calcula ângulo para o obstáculo
-                obstacle_angle = math.degrees(math.atan2(ox - self.rover_x, -(oy - self.rover_y))) % 360
-                
-                # Calcula a diferença de ângulo
-                obstacle_diff = (obstacle_angle - self.rover_angle) % 360
-                if obstacle_diff > 180:
-                    obstacle_diff -= 360
-                
-                # Aplica uma força repulsiva proporcional à proximidade
-                repulsion = 1.0 - min_obstacle_dist / 80.0
-                avoid_dir = -math.copysign(repulsion, obstacle_diff)
-                
-                # Combina com a direção para o alvo
-                self.rover_steering = max(-1.0, min(1.0, self.rover_steering + avoid_dir))
-                
-                # Reduz a velocidade perto de obstáculos
-                self.rover_speed *= (0.5 + 0.5 * (min_obstacle_dist / 80.0))
-        else:
-            # Sem alvo, desacelera
-            self.rover_speed *= 0.9
-            
-    def check_collision(self, x, y):
-        """Verifica se há colisão com obstáculos"""
-        for ox, oy, size in self.obstacles:
-            # Calcula a distância entre o rover e o obstáculo
-            dist = math.sqrt((ox - x)**2 + (oy - y)**2)
-            
-            # Se a distância for menor que a soma dos raios, há colisão
-            if dist < (32 + size/2):  # 32 é metade do tamanho do rover
-                return True
-        
-        return False
-    
+
+    def add_poi(self, poi):
+        self.poi.append(poi)
+        self.poi_version += 1
+        self.poi_index.insert(poi, poi[0], poi[1])
+        self.free_poi_index.insert(poi, poi[0], poi[1])
+
+    def capture_poi(self, poi):
+        """Marca um ponto como capturado (conjunto + índice de pontos livres)"""
+        self.captured_poi.add(poi)
+        self.poi_version += 1
+        self.free_poi_index.remove(poi, poi[0], poi[1])
+
+    def add_obstacle(self, x, y, size):
+        """Coloca uma rocha durante a simulação; os caminhos são corrigidos incrementalmente"""
+        obstacle = (x, y, size)
+        self.obstacles.append(obstacle)
+        self.obstacle_index.insert(obstacle, x, y, size / 2)
+        changed = self.occupancy.add_obstacle(x, y, size)
+        if changed:
+            for rover in self.rovers:
+                rover.obstacles_changed(changed)
+        self.log(f"Obstáculo adicionado em ({x}, {y})")
+
+    def take_planner_budget(self, wanted):
+        """Reserva até `wanted` expansões do orçamento de planejamento deste passo"""
+        granted = min(wanted, self.planner_budget)
+        self.planner_budget -= granted
+        return granted
+
+    def return_planner_budget(self, unused):
+        self.planner_budget += unused
+
+    def update(self):
+        """Avança a simulação em um passo fixo de PHYSICS_DT"""
+        if self.paused:
+            return
+
+        # Entradas programadas/replay do instante atual
+        for driver in self.drivers:
+            driver.advance(self.sim_time)
+
+        self.sim_time += PHYSICS_DT
+        self.steps += 1
+        self.planner_budget = PLANNER_STEP_BUDGET
+        for rover in list(self.rovers):
+            rover.update(self)
+
+        # Verifica se perdemos a conexão com algum controlador
+        current_time = self.server.clock()
+        for session in list(self.server.sessions.values()):
+            lost = not session.link_ok(current_time)
+            if lost and session.key not in self.lost_sessions:
+                self.lost_sessions.add(session.key)
+                self.server.log(f"⚠️ {session.rover.name}: sem comunicação nos últimos "
+                      f"{session.link_timeout():.1f} segundos – aguardando novo HELLO")
+            elif not lost:
+                self.lost_sessions.discard(session.key)
+
+        # Sem a thread de rede os timers do servidor andam com a física
+        if self.offline:
+            self.server.service_timers(self.sim_time)
+
     def draw(self):
         """Desenha a simulação na tela"""
         # Limpa a tela
         self.screen.fill((50, 50, 50))
-        
+
         # Desenha um grid de referência
         grid_size = 50
         for x in range(0, WINDOW_WIDTH, grid_size):
             pygame.draw.line(self.screen, (70, 70, 70), (x, 0), (x, WINDOW_HEIGHT))
         for y in range(0, WINDOW_HEIGHT, grid_size):
             pygame.draw.line(self.screen, (70, 70, 70), (0, y), (WINDOW_WIDTH, y))
-        
-        # Desenha a trajetória
-        if len(self.trajectory) > 1:
-            pygame.draw.lines(self.screen, (100, 100, 255), False, self.trajectory, 2)
-        
-        # Desenha os obstáculos
+
+        rovers = list(self.rovers)
+        focus = self.focus_rover
+
+        # Desenha as trajetórias
+        for rover in rovers:
+            if len(rover.trajectory) > 1:
+                color = (100, 100, 255) if rover is focus else (80, 80, 160)
+                pygame.draw.lines(self.screen, color, False, rover.trajectory, 2)
+
+        # Desenha o caminho planejado do rover em foco (modo autônomo)
+        if focus and focus.rover_mode == MODE_AUTONOMOUS and len(focus.autonomous_path) > 1:
+            points = [self.occupancy.center(cell) for cell in focus.autonomous_path]
+            pygame.draw.lines(self.screen, (0, 180, 0), False, points, 1)
+
+        # Desenha os obstáculos (uma imagem escalada por tamanho, reaproveitada)
         for x, y, size in self.obstacles:
-            scaled_img = pygame.transform.scale(self.rock_img, (size, size))
+            scaled_img = self.rock_cache.get(size)
+            if scaled_img is None:
+                scaled_img = self.rock_cache[size] = pygame.transform.scale(self.rock_img, (size, size))
             self.screen.blit(scaled_img, (x - size/2, y - size/2))
-        
+
         # Desenha os pontos de interesse
         for x, y in self.poi:
             # Se o ponto já foi capturado, desenha diferente
@@ -804,44 +399,90 @@ class RoverSimulator:
                 self.screen.blit(self.captured_poi_img, (x - 15, y - 15))
             else:
                 self.screen.blit(self.poi_img, (x - 15, y - 15))
-            
+
             # Desenha um círculo ao redor do ponto alvo no modo autônomo
-            if self.autonomous_target and (x, y) == self.autonomous_target:
+            if focus and focus.autonomous_target and (x, y) == focus.autonomous_target:
                 pygame.draw.circle(self.screen, (0, 255, 0), (x, y), 20, 2)
-                
+
             # Desenha raio de captura ao redor do rover (para facilitar)
-            if not (x, y) in self.captured_poi:
-                dist = math.sqrt((x - self.rover_x)**2 + (y - self.rover_y)**2)
+            if focus and not (x, y) in self.captured_poi:
+                dist = math.sqrt((x - focus.rover_x)**2 + (y - focus.rover_y)**2)
                 if dist < CAPTURE_DISTANCE:
                     pygame.draw.circle(self.screen, (255, 255, 0), (x, y), 25, 1)
-        
+
+        for rover in rovers:
+            self.draw_rover(rover, rover is focus)
+
+        # Desenha o painel de informações
+        self.draw_info_panel()
+
+        # Desenha a visão da câmera se ativada
+        if focus and focus.rover_camera:
+            self.draw_camera_view()
+
+        # Se estiver pausado, desenha o indicador de pausa
+        if self.paused:
+            pause_text = self.big_font.render("SIMULAÇÃO PAUSADA", True, (255, 255, 255))
+            text_rect = pause_text.get_rect(center=(WINDOW_WIDTH//2, WINDOW_HEIGHT//2))
+
+            # Fundo semi-transparente
+            overlay = pygame.Surface((WINDOW_WIDTH, WINDOW_HEIGHT), pygame.SRCALPHA)
+            overlay.fill((0, 0, 0, 128))
+            self.screen.blit(overlay, (0, 0))
+
+            # Texto de pausa
+            self.screen.blit(pause_text, text_rect)
+
+        # Adiciona informação de pacotes recebidos
+        session = self.server_session(focus) if focus else None
+        if session and not session.link_ok(self.server.clock()):
+            warning_text = self.font.render("SEM COMUNICAÇÃO COM O PICO W", True, (255, 50, 50))
+            self.screen.blit(warning_text, (WINDOW_WIDTH - 350, 50))
+
+        # NOVO: Desenha o log de mensagens para depuração
+        self.draw_message_log()
+
+        # NOVO: Desenha o score e informações de captura
+        self.draw_score_info()
+
+        # Atualiza a tela
+        pygame.display.flip()
+
+    def draw_rover(self, rover, focused):
+        """Desenha um rover, suas luzes e a animação de captura"""
         # Rotaciona e desenha o rover
-        rotated_rover = pygame.transform.rotate(self.rover_img, -self.rover_angle)
-        rover_rect = rotated_rover.get_rect(center=(self.rover_x, self.rover_y))
+        rotated_rover = pygame.transform.rotate(self.rover_img, -rover.rover_angle)
+        rover_rect = rotated_rover.get_rect(center=(rover.rover_x, rover.rover_y))
         self.screen.blit(rotated_rover, rover_rect.topleft)
-        
+
         # NOVO: Desenha a área de captura ao redor do rover
-        pygame.draw.circle(self.screen, (100, 100, 250, 40), 
-                          (int(self.rover_x), int(self.rover_y)), 
-                          CAPTURE_DISTANCE, 1)
-        
+        if focused:
+            pygame.draw.circle(self.screen, (100, 100, 250, 40),
+                              (int(rover.rover_x), int(rover.rover_y)),
+                              CAPTURE_DISTANCE, 1)
+
+        # Nome do rover quando há mais de um na tela
+        if len(self.rovers) > 1:
+            name_text = self.font.render(rover.name, True, (255, 255, 255) if focused else (170, 170, 170))
+            self.screen.blit(name_text, name_text.get_rect(center=(rover.rover_x, rover.rover_y + 42)))
+
         # Desenha luzes do rover quando ativadas
-        if self.rover_lights:
+        if rover.rover_lights:
             # Calcula as posições das luzes com base no ângulo
-            angle_rad = math.radians(self.rover_angle)
+            angle_rad = math.radians(rover.rover_angle)
             light_dist = 40
             light_spread = 20
-            
+
             # Luz esquerda
             left_angle = angle_rad + math.radians(light_spread)
-            lx = self.rover_x + math.sin(left_angle) * light_dist
-            ly = self.rover_y - math.cos(left_angle) * light_dist
-            
+            lx = rover.rover_x + math.sin(left_angle) * light_dist
+            ly = rover.rover_y - math.cos(left_angle) * light_dist
+
             # Luz direita
             right_angle = angle_rad - math.radians(light_spread)
-            rx = self.rover_x + math.sin(right_angle) * light_dist
-            ry = self.rover_y - math.cos(right_angle) * light_dist
-            
+            rx = rover.rover_x + math.sin(right_angle) * light_dist
+            ry = rover.rover_y - math.cos(right_angle) * light_dist
+
             # Desenha os feixes de luz
             for i in range(5, 100, 5):
                 alpha = max(0, 255 - i * 2.5)
@@ -849,106 +490,80 @@ class RoverSimulator:
                 left_surf = pygame.Surface((radius * 2, radius * 2), pygame.SRCALPHA)
                 pygame.draw.circle(left_surf, (255, 255, 200, alpha), (radius, radius), radius)
                 self.screen.blit(left_surf, (lx - radius, ly - radius))
-                
+
                 right_surf = pygame.Surface((radius * 2, radius * 2), pygame.SRCALPHA)
                 pygame.draw.circle(right_surf, (255, 255, 200, alpha), (radius, radius), radius)
                 self.screen.blit(right_surf, (rx - radius, ry - radius))
-        
+
         # NOVO: Desenha a animação de captura se estiver ativa
-        if self.capture_animation_time > 0 and self.capture_animation_pos:
+        if rover.capture_animation_time > 0 and rover.capture_animation_pos:
             # Calcula o tempo desde o início da animação
-            elapsed = time.time() - self.capture_animation_time
+            elapsed = self.sim_time - rover.capture_animation_time
             # A animação dura 2 segundos, o tamanho cresce e depois diminui
             if elapsed < 1.0:
                 size = int(30 + 20 * elapsed)  # Cresce
             else:
                 size = int(50 - 50 * (elapsed - 1.0))  # Diminui
-            
+
             # Desenha círculos concêntricos
-            x, y = self.capture_animation_pos
+            x, y = rover.capture_animation_pos
             pygame.draw.circle(self.screen, (255, 255, 0), (x, y), size, 2)
             pygame.draw.circle(self.screen, (255, 200, 0), (x, y), size - 10, 2)
             pygame.draw.circle(self.screen, (255, 150, 0), (x, y), size - 20, 2)
-            
+
             # Mostra texto "Capturado!"
             if elapsed < 1.5:
                 text = self.big_font.render("+100", True, (255, 255, 0))
                 text_rect = text.get_rect(center=(x, y - 40))
                 self.screen.blit(text, text_rect)
-        
-        # Desenha o painel de informações
-        self.draw_info_panel()
-        
-        # Desenha a visão da câmera se ativada
-        if self.rover_camera:
-            self.draw_camera_view()
-        
-        # Se estiver pausado, desenha o indicador de pausa
-        if self.paused:
-            pause_text = self.big_font.render("SIMULAÇÃO PAUSADA", True, (255, 255, 255))
-            text_rect = pause_text.get_rect(center=(WINDOW_WIDTH//2, WINDOW_HEIGHT//2))
-            
-            # Fundo semi-transparente
-            overlay = pygame.Surface((WINDOW_WIDTH, WINDOW_HEIGHT), pygame.SRCALPHA)
-            overlay.fill((0, 0, 0, 128))
-            self.screen.blit(overlay, (0, 0))
-            
-            # Texto de pausa
-            self.screen.blit(pause_text, text_rect)
-        
-        # Adiciona informação de pacotes recebidos
-        if time.time() - self.last_packet_time > 5.0:
-            warning_text = self.font.render("SEM COMUNICAÇÃO COM O PICO W", True, (255, 50, 50))
-            self.screen.blit(warning_text, (WINDOW_WIDTH - 350, 50))
-        
-        # NOVO: Desenha o log de mensagens para depuração
-        self.draw_message_log()
-        
-        # NOVO: Desenha o score e informações de captura
-        self.draw_score_info()
-        
-        # Atualiza a tela
-        pygame.display.flip()
-    
+
     # NOVO: Desenha informações de score e pontos capturados
     def draw_score_info(self):
         """Desenha o score e informações sobre pontos capturados"""
+        focus = self.focus_rover
+        score = focus.capture_score if focus else 0
+
         # Desenha o score no canto superior direito
-        score_text = self.big_font.render(f"SCORE: {self.capture_score}", True, (255, 255, 100))
+        score_text = self.big_font.render(f"SCORE: {score}", True, (255, 255, 100))
         self.screen.blit(score_text, (WINDOW_WIDTH - 180, 50))
-        
+
         # Desenha contador de pontos capturados/total
         count_text = self.font.render(f"Pontos: {len(self.captured_poi)}/{len(self.poi)}", True, (200, 255, 200))
         self.screen.blit(count_text, (WINDOW_WIDTH - 180, 80))
-        
+
+        # Tamanho da frota conectada
+        fleet_text = self.font.render(f"Rovers: {len(self.rovers)}  Sessões: {len(self.server.sessions)}",
+                                      True, (200, 200, 255))
+        self.screen.blit(fleet_text, (WINDOW_WIDTH - 180, 105))
+
         # Desenha instrução para o botão de captura
-        if self.connected:
+        if self.server.sessions:
             help_text = self.font.render("Pressione o botão A no Pico W para capturar pontos", True, (200, 200, 255))
             self.screen.blit(help_text, (WINDOW_WIDTH // 2 - 180, WINDOW_HEIGHT - 30))
-    
+
     def draw_message_log(self):
         """Desenha o log de mensagens para depuração"""
         if not self.message_log:
             return
-            
+
         # Desenha no canto inferior esquerdo
         log_x = 10
         log_y = WINDOW_HEIGHT - 20 * len(self.message_log) - 10
-        
+
         # Fundo semitransparente
         log_height = 20 * len(self.message_log)
         log_width = 400
         log_bg = pygame.Surface((log_width, log_height), pygame.SRCALPHA)
         log_bg.fill((0, 0, 0, 128))
         self.screen.blit(log_bg, (log_x-5, log_y-5))
-        
+
         # Desenha as mensagens
         for i, message in enumerate(self.message_log):
             if message.startswith("TX:"):
                 color = (100, 255, 100)  # Verde para mensagens enviadas
             else:
                 color = (255, 200, 100)  # Laranja para mensagens recebidas
-            
+
             # CORREÇÃO: Protege contra caracteres nulos
             try:
                 msg_text = self.font.render(message, True, color)
@@ -958,116 +573,153 @@ class RoverSimulator:
                 print(f"Erro ao renderizar mensagem: {e}")
                 err_text = self.font.render("[Mensagem não renderizável]", True, (255, 100, 100))
                 self.screen.blit(err_text, (log_x, log_y + i * 20))
-    
+
     def draw_info_panel(self):
-        """Desenha o painel de informações"""
+        """Desenha o painel de informações do rover em foco"""
+        rover = self.focus_rover
+        session = self.server_session(rover) if rover else None
+
         # Painel de fundo
-        panel_rect = pygame.Rect(10, 10, 250, 180)
+        panel_rect = pygame.Rect(10, 10, 250, 280)
         pygame.draw.rect(self.screen, (30, 30, 30), panel_rect)
         pygame.draw.rect(self.screen, (100, 100, 100), panel_rect, 2)
-        
+
         # Título
-        title = self.big_font.render("ROVER STATUS", True, (255, 255, 255))
+        title = self.big_font.render(rover.name.upper() if rover else "ROVER STATUS", True, (255, 255, 255))
         self.screen.blit(title, (20, 15))
-        
+
         # Linha separadora
         pygame.draw.line(self.screen, (100, 100, 100), (20, 45), (240, 45), 2)
-        
-        # Informações do rover
-        y_pos = 55
-        
-        # Velocidade
-        speed_text = self.font.render(f"Velocidade: {abs(self.rover_speed/MAX_SPEED*100):.1f}%", True, (255, 255, 255))
-        self.screen.blit(speed_text, (20, y_pos))
-        y_pos += 25
-        
-        # Direção
-        dir_text = self.font.render(f"Direção: {self.rover_steering*100:.1f}%", True, (255, 255, 255))
-        self.screen.blit(dir_text, (20, y_pos))
-        y_pos += 25
-        
-        # Bateria
-        bat_text = self.font.render(f"Bateria: {self.rover_battery:.1f}%", True, (255, 255, 255))
-        bat_color = (0, 255, 0) if self.rover_battery > 50 else (255, 255, 0) if self.rover_battery > 20 else (255, 0, 0)
-        
-        # Barra de bateria
-        bat_rect = pygame.Rect(130, y_pos + 5, 100, 10)
-        bat_fill = pygame.Rect(130, y_pos + 5, self.rover_battery, 10)
-        pygame.draw.rect(self.screen, (50, 50, 50), bat_rect)
-        pygame.draw.rect(self.screen, bat_color, bat_fill)
-        pygame.draw.rect(self.screen, (200, 200, 200), bat_rect, 1)
-        
-        self.screen.blit(bat_text, (20, y_pos))
-        y_pos += 25
-        
-        # Temperatura
-        temp_text = self.font.render(f"Temp: {self.rover_temperature:.1f}°C", True, (255, 255, 255))
-        self.screen.blit(temp_text, (20, y_pos))
-        y_pos += 25
-        
-        # Modo
-        mode_names = ["Manual", "Semi-Auto", "Autônomo"]
-        mode_text = self.font.render(f"Modo: {mode_names[self.rover_mode]}", True, (255, 255, 255))
-        self.screen.blit(mode_text, (20, y_pos))
-        y_pos += 25
-        
-        # Luzes e câmera
-        light_img = self.light_on_img if self.rover_lights else self.light_off_img
-        self.screen.blit(light_img, (20, y_pos))
-        
-        lights_text = self.font.render("Luzes", True, (255, 255, 255))
-        self.screen.blit(lights_text, (45, y_pos))
-        
-        camera_img = self.light_on_img if self.rover_camera else self.light_off_img
-        self.screen.blit(camera_img, (120, y_pos))
-        
-        camera_text = self.font.render("Câmera", True, (255, 255, 255))
-        self.screen.blit(camera_text, (145, y_pos))
-        
-        # Conectividade
-        if self.connected:
-            # Verifica se a conexão está ativa (último pacote recebido nos últimos 2 segundos)
-            if time.time() - self.last_packet_time < 2.0:
-                status_text = self.font.render("Conectado", True, (50, 255, 50))
+
+        if rover is not None:
+            # Informações do rover
+            y_pos = 55
+
+            # Velocidade
+            speed_text = self.font.render(f"Velocidade: {abs(rover.rover_speed/MAX_SPEED*100):.1f}%", True, (255, 255, 255))
+            self.screen.blit(speed_text, (20, y_pos))
+            y_pos += 25
+
+            # Direção
+            dir_text = self.font.render(f"Direção: {rover.rover_steering*100:.1f}%", True, (255, 255, 255))
+            self.screen.blit(dir_text, (20, y_pos))
+            y_pos += 25
+
+            # Bateria
+            bat_text = self.font.render(f"Bateria: {rover.rover_battery:.1f}%", True, (255, 255, 255))
+            bat_color = (0, 255, 0) if rover.rover_battery > 50 else (255, 255, 0) if rover.rover_battery > 20 else (255, 0, 0)
+
+            # Barra de bateria
+            bat_rect = pygame.Rect(130, y_pos + 5, 100, 10)
+            bat_fill = pygame.Rect(130, y_pos + 5, rover.rover_battery, 10)
+            pygame.draw.rect(self.screen, (50, 50, 50), bat_rect)
+            pygame.draw.rect(self.screen, bat_color, bat_fill)
+            pygame.draw.rect(self.screen, (200, 200, 200), bat_rect, 1)
+
+            self.screen.blit(bat_text, (20, y_pos))
+            y_pos += 25
+
+            # Temperatura
+            temp_text = self.font.render(f"Temp: {rover.rover_temperature:.1f}°C", True, (255, 255, 255))
+            self.screen.blit(temp_text, (20, y_pos))
+            y_pos += 25
+
+            # Modo
+            mode_names = ["Manual", "Semi-Auto", "Autônomo"]
+            mode_text = self.font.render(f"Modo: {mode_names[rover.rover_mode]}", True, (255, 255, 255))
+            self.screen.blit(mode_text, (20, y_pos))
+            y_pos += 25
+
+            # Luzes e câmera
+            light_img = self.light_on_img if rover.rover_lights else self.light_off_img
+            self.screen.blit(light_img, (20, y_pos))
+
+            lights_text = self.font.render("Luzes", True, (255, 255, 255))
+            self.screen.blit(lights_text, (45, y_pos))
+
+            camera_img = self.light_on_img if rover.rover_camera else self.light_off_img
+            self.screen.blit(camera_img, (120, y_pos))
+
+            camera_text = self.font.render("Câmera", True, (255, 255, 255))
+            self.screen.blit(camera_text, (145, y_pos))
+            y_pos += 25
+
+            # Qualidade do enlace (RTT suavizado, jitter, perda de PINGs)
+            if session and session.link_stats.samples > 0:
+                ls = session.link_stats
+                rtt_str = f"RTT: {ls.srtt_us/1000:.1f} ms ±{ls.rttvar_us/1000:.1f} perda {ls.loss_pct()}%"
+            else:
+                rtt_str = "RTT: --"
+            rtt_text = self.font.render(rtt_str, True, (200, 200, 255))
+            self.screen.blit(rtt_text, (20, y_pos))
+            y_pos += 25
+
+            # Offset de relógio e atrasos estimados de ida/volta
+            if session and session.link_stats.samples > 0:
+                ls = session.link_stats
+                owd_str = f"Ida {ls.owd_up_us/1000:.1f} / volta {ls.owd_down_us/1000:.1f} ms"
+                owd_text = self.font.render(owd_str, True, (200, 200, 255))
+                self.screen.blit(owd_text, (20, y_pos))
+            y_pos += 25
+
+            # Fluxo de comandos: watchdog, failsafe e latência joystick -> movimento
+            motion = rover.motion
+            if motion.active:
+                if motion.failsafe:
+                    cmd_str, cmd_color = f"Cmd: FAILSAFE ({motion.failsafes}x)", (255, 200, 50)
+                else:
+                    lat = f"{motion.latency[-1] * 1000:.0f} ms" if motion.latency else "--"
+                    cmd_str, cmd_color = f"Cmd: wd {motion.watchdog() * 1000:.0f} ms, lat {lat}", (200, 200, 255)
+                cmd_text = self.font.render(cmd_str, True, cmd_color)
+                self.screen.blit(cmd_text, (20, y_pos))
+
+        # Conectividade do rover em foco
+        if session:
+            if session.link_ok(self.server.clock()):
+                watchers = len(self.server.spectators.get(rover, ()))
+                label = f"Conectado (+{watchers})" if watchers else "Conectado"
+                status_text = self.font.render(label, True, (50, 255, 50))
             else:
                 status_text = self.font.render("Sem resposta...", True, (255, 200, 50))
         else:
             status_text = self.font.render("Desconectado", True, (255, 50, 50))
-        
+
         # Mostra o status de conexão no canto superior direito
         self.screen.blit(status_text, (WINDOW_WIDTH - 150, 15))
-        
+
         # Instruções
-        if not self.connected:
+        if not self.server.sessions:
             help_text = self.font.render("Aguardando conexão do Pico W...", True, (255, 255, 255))
             self.screen.blit(help_text, (WINDOW_WIDTH//2 - 150, WINDOW_HEIGHT - 30))
-        
+
     def draw_camera_view(self):
         """Desenha a visão da câmera simulada"""
+        rover = self.focus_rover
+
         # Posição da câmera no canto inferior direito
         x, y = WINDOW_WIDTH - 330, WINDOW_HEIGHT - 250
-        
+
         # Fundo da câmera
         pygame.draw.rect(self.screen, (20, 20, 20), (x, y, 320, 240))
         pygame.draw.rect(self.screen, (100, 100, 100), (x, y, 320, 240), 2)
-        
+
         # Captura uma seção da tela na frente do rover para simular a câmera
         # Calcula a posição para a captura baseada na direção do rover
-        rad_angle = math.radians(self.rover_angle)
-        cam_x = self.rover_x + math.sin(rad_angle) * 100
-        cam_y = self.rover_y - math.cos(rad_angle) * 100
-        
+        rad_angle = math.radians(rover.rover_angle)
+        cam_x = rover.rover_x + math.sin(rad_angle) * 100
+        cam_y = rover.rover_y - math.cos(rad_angle) * 100
+
         # Região de captura
         capture_x = int(cam_x - 160)
         capture_y = int(cam_y - 120)
-        
+
         # Certifica-se de que a região está dentro dos limites da tela
         if capture_x >= 0 and capture_y >= 0 and capture_x + 320 <= WINDOW_WIDTH and capture_y + 240 <= WINDOW_HEIGHT:
             try:
                 # Captura a região
                 capture_rect = pygame.Rect(capture_x, capture_y, 320, 240)
                 capture = self.screen.subsurface(capture_rect).copy()
-                
+
                 # Aplica efeitos de câmera (podem ser ajustados para parecer mais realistas)
                 # Adiciona ruído para simular uma câmera de baixa qualidade
                 for _ in range(1000):
@@ -1075,7 +727,7 @@ class RoverSimulator:
                     noise_y = random.randint(0, 239)
                     color = random.randint(0, 255)
                     capture.set_at((noise_x, noise_y), (color, color, color))
-                
+
                 # Desenha a imagem capturada
                 self.screen.blit(capture, (x, y))
             except ValueError:
@@ -1084,16 +736,16 @@ class RoverSimulator:
         else:
             # Fora dos limites da tela, mostra estática
             self.draw_camera_static(x, y)
-        
+
         # Adiciona overlay com informações da câmera
-        overlay_text = self.font.render("CAM01 - ROVER", True, (0, 255, 0))
+        overlay_text = self.font.render(f"CAM01 - {rover.name.upper()}", True, (0, 255, 0))
         self.screen.blit(overlay_text, (x + 10, y + 10))
-        
+
         # Data e hora
         time_str = time.strftime("%d/%m/%Y %H:%M:%S")
         time_text = self.font.render(time_str, True, (0, 255, 0))
         self.screen.blit(time_text, (x + 10, y + 210))
-    
+
     def draw_camera_static(self, x, y):
         """Desenha estática para a câmera quando fora do alcance"""
         for _ in range(5000):
@@ -1104,65 +756,107 @@ class RoverSimulator:
                 self.screen.set_at((x + noise_x, y + noise_y), (color, color, color))
             except IndexError:
                 pass  # Ignora erros de índice
-    
+
+    def cycle_focus(self):
+        """Passa o foco (painel, câmera e teclado) para o próximo rover"""
+        rovers = list(self.rovers)
+        if not rovers:
+            return
+        try:
+            index = (rovers.index(self.focus_rover) + 1) % len(rovers)
+        except ValueError:
+            index = 0
+        self.focus_rover = rovers[index]
+        self.message_log = []
+        print(f"Foco em {self.focus_rover.name}")
+
     def handle_events(self):
         """Processa eventos do pygame"""
-        global USAR_PROTOCOLO_SIMPLES  # Declaração global adicionada
-        
         for event in pygame.event.get():
             if event.type == QUIT:
                 self.running = False
                 return False
-            
+
             elif event.type == KEYDOWN:
+                rover = self.focus_rover
+
                 # Tecla P pausa/despausa a simulação
                 if event.key == K_p:
                     self.paused = not self.paused
                     print(f"Simulação {'pausada' if self.paused else 'retomada'}")
-                
-                # Tecla R recarrega a bateria
-                elif event.key == K_r:
-                    self.rover_battery = 100.0
-                    print("Bateria recarregada")
-                
+
                 # Tecla ESC sai da aplicação
                 elif event.key == K_ESCAPE:
                     self.running = False
                     return False
-                
+
+                # Tecla TAB alterna o rover em foco
+                elif event.key == K_TAB:
+                    self.cycle_focus()
+
+                # Tecla M para alternar entre protocolo simples e binário
+                elif event.key == K_m:
+                    self.server.text_status = not self.server.text_status
+                    print(f"Usando protocolo {'simples (texto)' if self.server.text_status else 'binário'}")
+
+                # Tecla I para mostrar informações sobre o formato dos pacotes
+                elif event.key == K_i:
+                    print("\n=== INFORMAÇÕES DE FORMATO DOS PACOTES ===")
+                    print(f"Formato JOYSTICK: {JOYSTICK_FORMAT}, Tamanho: {JOYSTICK_SIZE} bytes")
+                    print(f"Formato ROVER: {ROVER_FORMAT}, Tamanho: {ROVER_SIZE} bytes")
+                    print(f"Tamanho total do pacote esperado: {4 + JOYSTICK_SIZE + ROVER_SIZE} bytes")
+                    print("Pressione T para simular recepção de um pacote")
+                    print("=======================================\n")
+
+                # As demais teclas atuam sobre o rover em foco
+                elif rover is None:
+                    continue
+
+                # Tecla R recarrega a bateria
+                elif event.key == K_r:
+                    rover.rover_battery = 100.0
+                    print("Bateria recarregada")
+
                 # NOVO: Tecla C para simular captura (para testes)
                 elif event.key == K_SPACE:
                     print("Simulando captura manual")
-                    self.capture_requested = True
-                
+                    rover.capture_requested = True
+
                 # Teclas de função para modos
                 elif event.key == K_F1:
-                    self.rover_mode = MODE_MANUAL
+                    rover.rover_mode = MODE_MANUAL
                     print("Modo Manual ativado")
                 elif event.key == K_F2:
-                    self.rover_mode = MODE_SEMI_AUTO
+                    rover.rover_mode = MODE_SEMI_AUTO
                     print("Modo Semi-Autônomo ativado")
                 elif event.key == K_F3:
-                    self.rover_mode = MODE_AUTONOMOUS
+                    rover.rover_mode = MODE_AUTONOMOUS
                     print("Modo Autônomo ativado")
-                
+
+                # Tecla O coloca uma rocha à frente do rover (testa o replanejamento)
+                elif event.key == K_o:
+                    angle = math.radians(rover.rover_angle)
+                    self.add_obstacle(int(rover.rover_x + math.sin(angle) * 120),
+                                      int(rover.rover_y - math.cos(angle) * 120),
+                                      self.rng.randint(20, 50))
+
                 # Teclas L e C para luzes e câmera
                 elif event.key == K_l:
-                    self.rover_lights = not self.rover_lights
-                    print(f"Luzes {'ligadas' if self.rover_lights else 'desligadas'}")
+                    rover.rover_lights = not rover.rover_lights
+                    print(f"Luzes {'ligadas' if rover.rover_lights else 'desligadas'}")
                 elif event.key == K_c:
-                    self.rover_camera = not self.rover_camera
-                    print(f"Câmera {'ligada' if self.rover_camera else 'desligada'}")
-                
+                    rover.rover_camera = not rover.rover_camera
+                    print(f"Câmera {'ligada' if rover.rover_camera else 'desligada'}")
+
                 # Tecla T para simular recepção de pacote (para testes)
                 elif event.key == K_t:
                     print("Simulando recepção de pacote do Pico W")
-                    
-                    if USAR_PROTOCOLO_SIMPLES:
+
+                    if self.server.text_status:
                         # Simula um pacote de texto
                         test_packet = "speed=50.0,steering=25.0,mode=0,lights=on,camera=off"
                         self.add_to_message_log(f"RX (sim): {test_packet}")
-                        
+
                         # Extrai valores
                         values = {}
                         pairs = test_packet.split(",")
@@ -1174,107 +868,294 @@ class RoverSimulator:
                                 values[key] = int(value)
                             elif key in ["lights", "camera"]:
                                 values[key] = value == "on"
-                        
+
                         # Atualiza o rover
-                        self.rover_speed = values["speed"] / 100.0 * MAX_SPEED
-                        self.rover_steering = values["steering"] / 100.0
-                        self.rover_mode = values["mode"]
-                        self.rover_lights = values["lights"]
-                        self.rover_camera = values["camera"]
+                        rover.motion.release()
+                        rover.rover_speed = values["speed"] / 100.0 * MAX_SPEED
+                        rover.rover_steering = values["steering"] / 100.0
+                        rover.rover_mode = values["mode"]
+                        rover.rover_lights = values["lights"]
+                        rover.rover_camera = values["camera"]
                     else:
                         # Simula dados do joystick
                         fake_joystick_data = (0.5, -0.5, False, False, False, 0)
                         # Simula dados do rover
                         fake_rover_data = (50.0, 25.0, 80.0, 30.0, MODE_MANUAL, True, False, 0)
                         # Atualiza o estado do rover
-                        self.update_from_controller(fake_joystick_data, fake_rover_data)
-                    
-                    # Atualiza timestamp
-                    self.last_packet_time = time.time()
-                    self.connected = True
+                        apply_controller_data(rover, fake_joystick_data, fake_rover_data)
+
                     print("Pacote simulado processado!")
-                    
-                    # Envia uma resposta
-                    if USAR_PROTOCOLO_SIMPLES:
-                        self.send_status_text()
-                    else:
-                        self.send_status()
-                
-                # Tecla I para mostrar informações sobre o formato dos pacotes
-                elif event.key == K_i:
-                    print("\n=== INFORMAÇÕES DE FORMATO DOS PACOTES ===")
-                    print(f"Formato JOYSTICK: {JOYSTICK_FORMAT}, Tamanho: {JOYSTICK_SIZE} bytes")
-                    print(f"Formato ROVER: {ROVER_FORMAT}, Tamanho: {ROVER_SIZE} bytes")
-                    print(f"Tamanho total do pacote esperado: {4 + JOYSTICK_SIZE + ROVER_SIZE} bytes")
-                    print("Pressione T para simular recepção de um pacote")
-                    print("=======================================\n")
-                
-                # Tecla M para alternar entre protocolo simples e binário
-                elif event.key == K_m:
-                    USAR_PROTOCOLO_SIMPLES = not USAR_PROTOCOLO_SIMPLES
-                    print(f"Usando protocolo {'simples (texto)' if USAR_PROTOCOLO_SIMPLES else 'binário'}")
-        
+
+                    # Envia uma resposta ao controlador do rover, se houver
+                    session = self.server_session(rover)
+                    if session:
+                        self.server.send_status(session)
+
         return True
-    
+
     def run(self):
         """Loop principal da simulação"""
-        global LINK_OK, LAST_RX  # Declaração global adicionada
+        accumulator = 0.0
+        last = time.perf_counter()
         try:
             while self.running:
                 # Processa eventos
                 if not self.handle_events():
                     break
-                
-                # Atualiza a simulação
-                self.update()
-                
+
+                # Atualiza a simulação em passos fixos, quantos couberem no
+                # tempo real decorrido (limitado para não espiralar após travadas)
+                now = time.perf_counter()
+                accumulator += min(now - last, 0.25)
+                last = now
+                while accumulator >= PHYSICS_DT:
+                    self.update()
+                    accumulator -= PHYSICS_DT
+
                 # Desenha a tela
                 self.draw()
-                
-                # Limita a taxa de quadros
-                self.clock.tick(60)
 
-                if LINK_OK and time.time() - LAST_RX > HELLO_TIMEOUT:
-                    print("Link perdido – aguardando novo HELLO")
-                    LINK_OK = False
+                # Limita a taxa de quadros
+                self.clock.tick(FPS)
 
         finally:
             # CORREÇÃO: Marca o programa como não executando para threads
             self.running = False
-            
-            # CORREÇÃO: Fecha o socket com segurança
-            with self.socket_lock:
-                try:
-                    self.udp_socket.close()
-                except:
-                    pass
-            
+            self.server.stop()
+
             # Limpa recursos
             pygame.quit()
             print("Simulação encerrada")
 
+    def run_headless(self, duration=None):
+        """Loop sem janela em tempo real: física em passo fixo e rede, com relatório da frota"""
+        start = time.time()
+        next_step = start
+        last_report = start
+        last_rx = last_tx = 0
+        try:
+            while self.running:
+                now = time.time()
+                if duration is not None and now - start >= duration:
+                    break
+                # Replay em tempo real: termina com o log
+                if self.offline and duration is None and all(d.done() for d in self.drivers):
+                    break
+
+                self.update()
+
+                if now - last_report >= HEADLESS_REPORT_INTERVAL:
+                    self.print_fleet_report(now - last_report, last_rx, last_tx)
+                    last_report = now
+                    last_rx, last_tx = self.server.rx_packets, self.server.tx_packets
+
+                next_step += PHYSICS_DT
+                delay = next_step - time.time()
+                if delay > 0:
+                    time.sleep(delay)
+                elif delay < -0.25:
+                    next_step = time.time()   # Muito atrasado: não tenta recuperar passos
+        except KeyboardInterrupt:
+            pass
+        finally:
+            self.running = False
+            self.server.stop()
+            print("Simulação encerrada")
+
+    def run_deterministic(self, steps):
+        """Executa N passos o mais rápido possível, sem rede nem relógio de parede"""
+        start = time.perf_counter()
+        for _ in range(steps):
+            self.update()
+        wall = time.perf_counter() - start
+        self.running = False
+        self.server.stop()
+        return self.collect_metrics(wall)
+
+    def state_hash(self):
+        """Resumo do estado final; igual entre execuções com a mesma entrada"""
+        h = hashlib.sha256()
+        for rover in self.rovers:
+            h.update(f"{rover.name}:{rover.rover_x:.6f},{rover.rover_y:.6f},{rover.rover_angle:.6f},"
+                     f"{rover.rover_battery:.6f},{rover.capture_score};".encode())
+        h.update(repr(sorted(self.captured_poi)).encode())
+        return h.hexdigest()[:16]
+
+    def collect_metrics(self, wall):
+        server = self.server
+        sim_seconds = self.sim_time
+        proc = sorted(server.proc_samples)
+
+        def pct(p):
+            return proc[min(len(proc) - 1, int(p / 100.0 * len(proc)))] * 1e6 if proc else 0.0
+
+        captures = len(self.captured_poi)
+        return {
+            "seed": self.seed,
+            "steps": self.steps,
+            "sim_seconds": round(sim_seconds, 3),
+            "wall_seconds": round(wall, 3),
+            "steps_per_second": round(self.steps / wall, 1) if wall > 0 else 0.0,
+            "rovers": len(self.rovers),
+            "captures": captures,
+            "captures_per_minute": round(captures * 60.0 / sim_seconds, 2) if sim_seconds else 0.0,
+            "score": sum(r.capture_score for r in self.rovers),
+            "packets": server.rx_packets,
+            "packet_proc_us": {
+                "mean": round(server.proc_time_total / server.rx_packets * 1e6, 2) if server.rx_packets else 0.0,
+                "p50": round(pct(50), 2),
+                "p99": round(pct(99), 2),
+                "max": round(proc[-1] * 1e6, 2) if proc else 0.0,
+            },
+            "planner": self.planner_stats.summary(),
+            "arbitration": {
+                "spectators": sum(len(w) for w in server.spectators.values()),
+                "rejected_commands": server.rejected,
+                "status_encodes": server.status_encodes,
+                "fanout_packets": server.fanout_packets,
+            },
+            "motion": {
+                "latency_ms": latency_summary(r.motion for r in self.rovers),
+                "failsafes": sum(r.motion.failsafes for r in self.rovers),
+            },
+            "state_hash": self.state_hash(),
+        }
+
+    def print_fleet_report(self, elapsed, last_rx, last_tx):
+        server = self.server
+        sessions = list(server.sessions.values())
+        now = server.clock()
+        online = sum(1 for s in sessions if s.link_ok(now))
+        rtts = sorted(s.link_stats.srtt_us for s in sessions if s.link_stats.samples)
+        rtt_str = f"RTT med {rtts[len(rtts)//2]/1000:.1f} ms, max {rtts[-1]/1000:.1f} ms" if rtts else "RTT --"
+        proc_us = server.proc_time_total / server.rx_packets * 1e6 if server.rx_packets else 0
+        rovers = {id(s.rover): s.rover for s in sessions}.values()    # Divididos contam uma vez
+        lat = latency_summary(r.motion for r in rovers)
+        lat_str = f"cmd->mov med {lat['p50']:.0f} ms, p99 {lat['p99']:.0f} ms" if lat["count"] else "cmd->mov --"
+        failsafes = sum(r.motion.failsafes for r in rovers)
+        watchers = sum(len(w) for w in server.spectators.values())
+        print(f"Frota: {len(sessions)} sessões ({online} ativas), "
+              f"rx {(server.rx_packets - last_rx) / elapsed:.0f} pkt/s, "
+              f"tx {(server.tx_packets - last_tx) / elapsed:.0f} pkt/s, "
+              f"descartes {server.tx_dropped}, proc {proc_us:.0f} us/pkt, {rtt_str}, "
+              f"{lat_str}, failsafes {failsafes}, espectadores {watchers} "
+              f"(leque {server.fanout_packets} pkt/{server.status_encodes} cod., "
+              f"{server.rejected} cmds descartados), pontos {len(self.captured_poi)}")
+
+
+def print_metrics(metrics):
+    proc = metrics["packet_proc_us"]
+    print("===== Métricas =====")
+    print(f"Semente: {metrics['seed']}  Rovers: {metrics['rovers']}")
+    print(f"Passos: {metrics['steps']} ({metrics['sim_seconds']:.1f} s simulados) em "
+          f"{metrics['wall_seconds']:.2f} s -> {metrics['steps_per_second']:.0f} passos/s")
+    print(f"Capturas: {metrics['captures']} ({metrics['captures_per_minute']:.2f}/min), score {metrics['score']}")
+    print(f"Pacotes: {metrics['packets']}, processamento médio {proc['mean']:.1f} us "
+          f"(p50 {proc['p50']:.1f}, p99 {proc['p99']:.1f}, máx {proc['max']:.1f})")
+    planner = metrics["planner"]
+    plan, repair = planner["plan_ms"], planner["repair_ms"]
+    print(f"Planejador: {plan['count']} buscas, {plan['mean']:.2f} ms (p99 {plan['p99']:.2f}, "
+          f"máx {plan['max']:.2f}); {repair['count']} correções, {repair['mean']:.3f} ms "
+          f"(p99 {repair['p99']:.3f}); caminho/linha reta {planner['path_ratio_mean']:.3f} "
+          f"(máx {planner['path_ratio_max']:.3f}), inalcançáveis {planner['unreachable']}")
+    motion = metrics["motion"]
+    lat = motion["latency_ms"]
+    print(f"Movimento: {lat['count']} degraus, latência cmd->mov {lat['p50']:.1f} ms "
+          f"(p99 {lat['p99']:.1f}, máx {lat['max']:.1f}), failsafes {motion['failsafes']}")
+    arb = metrics["arbitration"]
+    print(f"Arbitragem: {arb['spectators']} espectadores, leque {arb['fanout_packets']} pacotes em "
+          f"{arb['status_encodes']} codificações, {arb['rejected_commands']} comandos descartados")
+    print(f"Estado final: {metrics['state_hash']}")
+
+
 if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Simulador de rovers para o controle BitDogLab")
+    parser.add_argument("--headless", action="store_true",
+                        help="roda sem janela (servidor da frota para testes de carga)")
+    parser.add_argument("--deterministic", action="store_true",
+                        help="sem janela e sem rede, passo fixo o mais rápido possível (CI)")
+    parser.add_argument("--port", type=int, default=UDP_PORT, help="porta UDP do simulador")
+    parser.add_argument("--duration", type=float, default=None,
+                        help="encerra após N segundos (reais no headless, simulados no determinístico)")
+    parser.add_argument("--steps", type=int, default=None, help="passos de física (modo determinístico)")
+    parser.add_argument("--seed", type=int, default=None, help="semente do mundo (obstáculos, pontos, física)")
+    parser.add_argument("--obstacles", type=int, default=15, help="número de obstáculos no mundo")
+    parser.add_argument("--rovers", type=int, default=0,
+                        help="cria N rovers locais em modo autônomo (cenário de benchmark)")
+    parser.add_argument("--script", help="arquivo de comandos programados (drivers.ScriptDriver)")
+    parser.add_argument("--replay", help="log gravado com --record para reinjetar (em tempo real; "
+                                         "com --deterministic, o mais rápido possível)")
+    parser.add_argument("--replay-from", type=float, default=0.0,
+                        help="começa o replay neste instante do log (s), pelo índice")
+    parser.add_argument("--record", help="grava os datagramas recebidos e enviados (session_log; "
+                                         ".txt no formato de texto antigo)")
+    parser.add_argument("--metrics-json", help="salva as métricas do modo determinístico em JSON")
+    parser.add_argument("--quiet", action="store_true", help="não imprime cada pacote recebido")
+    args = parser.parse_args()
+
+    if args.deterministic:
+        seed = 0 if args.seed is None else args.seed
+        simulator = RoverSimulator(headless=True, port=None, verbose=not args.quiet, seed=seed,
+                                   obstacles=args.obstacles)
+        for i in range(args.rovers):
+            simulator.rover_by_name(f"auto-{i + 1}", create=True).rover_mode = MODE_AUTONOMOUS
+        if args.script:
+            simulator.drivers.append(ScriptDriver(args.script, simulator))
+        if args.replay:
+            simulator.drivers.append(ReplayDriver(args.replay, simulator.server, args.replay_from))
+        if args.steps is not None:
+            steps = args.steps
+        else:
+            steps = int(round((args.duration or DETERMINISTIC_DURATION) / PHYSICS_DT))
+
+        metrics = simulator.run_deterministic(steps)
+        print_metrics(metrics)
+        if args.metrics_json:
+            with open(args.metrics_json, "w") as f:
+                json.dump(metrics, f, indent=2)
+        sys.exit(0)
+
     # Exibe informações de inicialização
     print("===== Rover Simulator =====")
     print("Iniciando simulação...")
     print("Aguardando conexão do Raspberry Pi Pico W...")
     print("")
-    print("Controles:")
-    print("P - Pausa/Despausa")
-    print("R - Recarrega bateria")
-    print("L - Liga/Desliga luzes")
-    print("C - Liga/Desliga câmera")
-    print("ESPAÇO - Simula captura de ponto (teste)")
-    print("F1 - Modo Manual")
-    print("F2 - Modo Semi-Autônomo")
-    print("F3 - Modo Autônomo")
-    print("T - Simula recepção de pacote (para testes)")
-    print("I - Mostra informações de formato dos pacotes")
-    print("M - Alterna entre protocolo simples (texto) e binário")
-    print("ESC - Sair")
-    print(f"Usando inicialmente protocolo {'simples (texto)' if USAR_PROTOCOLO_SIMPLES else 'binário'}")
+    if not args.headless:
+        print("Controles:")
+        print("P - Pausa/Despausa")
+        print("TAB - Alterna o rover em foco")
+        print("R - Recarrega bateria")
+        print("L - Liga/Desliga luzes")
+        print("C - Liga/Desliga câmera")
+        print("O - Coloca uma rocha à frente do rover (replanejamento)")
+        print("ESPAÇO - Simula captura de ponto (teste)")
+        print("F1 - Modo Manual")
+        print("F2 - Modo Semi-Autônomo")
+        print("F3 - Modo Autônomo")
+        print("T - Simula recepção de pacote (para testes)")
+        print("I - Mostra informações de formato dos pacotes")
+        print("M - Alterna entre protocolo simples (texto) e binário")
+        print("ESC - Sair")
+        print(f"Usando inicialmente protocolo {'simples (texto)' if USAR_PROTOCOLO_SIMPLES else 'binário'}")
     print("=========================")
-    
+
     # Inicia o simulador
-    simulator = RoverSimulator()
-    simulator.run()
\ No newline at end of file
+    # Replay em tempo real: servidor offline alimentado pelo log, sem rede
+    record = open_writer(args.record) if args.record else None
+    simulator = RoverSimulator(headless=args.headless, port=None if args.replay else args.port,
+                               verbose=not (args.quiet or args.headless), seed=args.seed, record=record,
+                               obstacles=args.obstacles)
+    for i in range(args.rovers):
+        simulator.rover_by_name(f"auto-{i + 1}", create=True).rover_mode = MODE_AUTONOMOUS
+    if args.script:
+        simulator.drivers.append(ScriptDriver(args.script, simulator))
+    if args.replay:
+        simulator.drivers.append(ReplayDriver(args.replay, simulator.server, args.replay_from))
+    try:
+        if args.headless:
+            simulator.run_headless(args.duration)
+        else:
+            simulator.run()
+    finally:
+        if record:
+            record.close()
@@ -0,0 +1,387 @@
+"""Log binário de sessões de controle (gravação e replay).
+
+O servidor da frota grava cada datagrama recebido (RX) e enviado (TX) com
+carimbo em microssegundos, num arquivo só de acréscimo:
+
+    cabeçalho  b"RVRL" | versão u8 | 3 bytes reservados | início u64 (us desde a época)
+    registro   tamanho varint | tipo u8 | par varint | dt varint (us) | dados
+
+`tamanho` cobre o resto do registro, então um leitor pula registros sem
+decodificá-los e um registro cortado no fim (queda no meio da escrita) é
+ignorado. `dt` conta do registro anterior. Os tipos:
+
+    RX    datagrama do controlador `par`
+    TX    datagrama para o controlador `par`
+    PEER  define o número `par` (dados: "ip:porta"), antes do primeiro uso
+    SYNC  dados: tempo absoluto u64 (us); o próximo dt conta dele
+
+A cada INDEX_INTERVAL o gravador escreve um SYNC e acrescenta ao índice
+(`<arquivo>.idx`: b"RVRI" + pares u64 tempo, u64 posição) onde ele está.
+Buscar um instante é ler o índice e decodificar dali; sem índice (ou com
+índice atrasado) ele é refeito varrendo os SYNC.
+
+O formato de texto antigo (`<t> <ip>:<porta> <hex>` por linha, só RX)
+continua sendo lido e gravado para arquivos .txt.
+
+Uso:
+    python session_log.py info sessao.rvrl
+    python session_log.py dump sessao.rvrl --from 12.5 --to 14
+    python session_log.py index sessao.rvrl          # refaz o .idx
+    python session_log.py convert antiga.txt nova.rvrl
+"""
+import argparse
+import os
+import struct
+import threading
+import time
+
+MAGIC = b"RVRL"
+INDEX_MAGIC = b"RVRI"
+VERSION = 1
+HEADER = struct.Struct("<4sB3xQ")
+INDEX_ENTRY = struct.Struct("<QQ")
+SYNC_TIME = struct.Struct("<Q")
+
+RX, TX, PEER, SYNC = range(4)
+KIND_NAMES = ("RX", "TX", "PEER", "SYNC")
+
+INDEX_INTERVAL = 1.0      # s entre pontos de busca
+
+
+def put_varint(out, value):
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+
+
+def get_varint(buf, pos):
+    value = shift = 0
+    while True:
+        if pos >= len(buf):
+            raise EOFError
+        byte = buf[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        if byte < 0x80:
+            return value, pos
+        shift += 7
+
+
+class SessionLogWriter:
+    """Gravador do log binário; rx()/tx() podem vir de threads diferentes"""
+
+    def __init__(self, path, start=None):
+        self.path = path
+        self.file = open(path, "wb")
+        self.index = open(path + ".idx", "wb")
+        self.index.write(INDEX_MAGIC)
+        start = time.time() if start is None else start
+        self.file.write(HEADER.pack(MAGIC, VERSION, int(start * 1e6)))
+        self.lock = threading.Lock()
+        self.peers = {}
+        self.last_us = 0
+        self.next_sync_us = 0
+        self.records = 0
+
+    def _record(self, kind, peer, t_us, data):
+        body = bytearray([kind])
+        put_varint(body, peer)
+        put_varint(body, max(0, t_us - self.last_us))
+        body += data
+        out = bytearray()
+        put_varint(out, len(body))
+        self.file.write(out + body)
+        self.last_us = max(self.last_us, t_us)
+        self.records += 1
+
+    def _write(self, kind, t, addr, data):
+        t_us = int(round(t * 1e6))
+        with self.lock:
+            if t_us >= self.next_sync_us:
+                self.index.write(INDEX_ENTRY.pack(t_us, self.file.tell()))
+                self.last_us = t_us
+                self._record(SYNC, 0, t_us, SYNC_TIME.pack(t_us))
+                self.next_sync_us = t_us + int(INDEX_INTERVAL * 1e6)
+            peer = self.peers.get(addr)
+            if peer is None:
+                peer = self.peers[addr] = len(self.peers)
+                self._record(PEER, peer, t_us, f"{addr[0]}:{addr[1]}".encode())
+            self._record(kind, peer, t_us, data)
+
+    def rx(self, t, addr, data):
+        """Datagrama recebido de `addr` no instante t (s desde o início)"""
+        self._write(RX, t, addr, data)
+
+    def tx(self, t, addr, data):
+        self._write(TX, t, addr, data)
+
+    def flush(self):
+        with self.lock:
+            self.file.flush()
+            self.index.flush()
+
+    def close(self):
+        with self.lock:
+            self.file.close()
+            self.index.close()
+
+
+class TextLogWriter:
+    """Formato de texto antigo: só os datagramas recebidos"""
+
+    def __init__(self, path):
+        self.file = open(path, "w")
+        self.lock = threading.Lock()
+
+    def rx(self, t, addr, data):
+        with self.lock:
+            self.file.write(f"{t:.6f} {addr[0]}:{addr[1]} {data.hex()}\n")
+
+    def tx(self, t, addr, data):
+        pass
+
+    def flush(self):
+        self.file.flush()
+
+    def close(self):
+        self.file.close()
+
+
+def open_writer(path):
+    """Gravador pelo nome: .txt no formato antigo, o resto em binário"""
+    return TextLogWriter(path) if path.endswith(".txt") else SessionLogWriter(path)
+
+
+class SessionLogReader:
+    """Leitura do log binário: registros (t, tipo, endereço, dados) com t em s"""
+
+    def __init__(self, path):
+        self.path = path
+        with open(path, "rb") as f:
+            self.buf = f.read()
+        if len(self.buf) < HEADER.size:
+            raise ValueError(f"{path}: arquivo curto demais")
+        magic, version, self.start_us = HEADER.unpack_from(self.buf)
+        if magic != MAGIC or version != VERSION:
+            raise ValueError(f"{path}: não é um log RVRL v{VERSION}")
+        self.truncated = False
+        self._index = None
+
+    def _scan(self, pos):
+        """Registros crus a partir de `pos`: (posição, tipo, par, dt, dados)"""
+        buf = self.buf
+        while pos < len(buf):
+            try:
+                size, body = get_varint(buf, pos)
+                end = body + size
+                if end > len(buf):
+                    raise EOFError
+                kind = buf[body]
+                peer, p = get_varint(buf, body + 1)
+                dt, p = get_varint(buf, p)
+            except (EOFError, IndexError):
+                self.truncated = True       # Último registro cortado
+                return
+            yield pos, kind, peer, dt, buf[p:end]
+            pos = end
+
+    def _peers_before(self, offset):
+        """Tabela de pares definida antes de `offset` (só cabeçalhos)"""
+        peers = {}
+        for pos, kind, peer, _, data in self._scan(HEADER.size):
+            if pos >= offset:
+                break
+            if kind == PEER:
+                peers[peer] = _parse_addr(data.decode())
+        return peers
+
+    def index(self):
+        """Pontos de busca (t_us, posição): do .idx, refeito se faltar ou estiver atrás"""
+        if self._index is None:
+            entries = read_index(self.path + ".idx")
+            last = entries[-1][1] if entries else HEADER.size
+            if not entries or last >= len(self.buf):
+                entries = []
+                last = HEADER.size
+            # Completa com os SYNC gravados depois do último ponto do índice
+            entries += [e for e in self.sync_points(last) if not entries or e[1] > entries[-1][1]]
+            self._index = entries
+        return self._index
+
+    def sync_points(self, pos=HEADER.size):
+        """Pontos de busca (t_us, posição) varrendo os SYNC a partir de `pos`"""
+        return [(SYNC_TIME.unpack(data)[0], p) for p, kind, _, _, data in self._scan(pos) if kind == SYNC]
+
+    def records(self, start=None, end=None, kinds=(RX, TX)):
+        """Registros com start <= t < end (s), a partir do ponto de busca anterior"""
+        offset = HEADER.size
+        if start is not None:
+            for t_us, pos in self.index():
+                if t_us > start * 1e6:
+                    break
+                offset = pos
+        peers = self._peers_before(offset)
+        t_us = 0
+        for _, kind, peer, dt, data in self._scan(offset):
+            if kind == SYNC:
+                t_us = SYNC_TIME.unpack(data)[0]
+                continue
+            t_us += dt
+            if kind == PEER:
+                peers[peer] = _parse_addr(data.decode())
+                continue
+            t = t_us / 1e6
+            if start is not None and t < start:
+                continue
+            if end is not None and t >= end:
+                return
+            if kind in kinds:
+                yield t, kind, peers.get(peer), data
+
+
+class TextLogReader:
+    """Formato de texto antigo: cada linha é um RX"""
+
+    def __init__(self, path):
+        self.path = path
+        self.start_us = 0
+        self.truncated = False
+        self.packets = []
+        with open(path, encoding="utf-8") as f:
+            for lineno, line in enumerate(f, 1):
+                line = line.strip()
+                if not line or line.startswith("#"):
+                    continue
+                try:
+                    t, addr, payload = line.split()
+                    self.packets.append((float(t), _parse_addr(addr), bytes.fromhex(payload)))
+                except ValueError:
+                    raise ValueError(f"{path}:{lineno}: esperado '<t> <ip>:<porta> <hex>'")
+
+    def index(self):
+        return []
+
+    def records(self, start=None, end=None, kinds=(RX, TX)):
+        if RX not in kinds:
+            return
+        for t, addr, data in self.packets:
+            if start is not None and t < start:
+                continue
+            if end is not None and t >= end:
+                return
+            yield t, RX, addr, data
+
+
+def open_reader(path):
+    """Leitor pelo conteúdo: binário (RVRL) ou texto antigo"""
+    with open(path, "rb") as f:
+        magic = f.read(len(MAGIC))
+    return SessionLogReader(path) if magic == MAGIC else TextLogReader(path)
+
+
+def read_index(path):
+    try:
+        with open(path, "rb") as f:
+            raw = f.read()
+    except FileNotFoundError:
+        return []
+    if raw[:len(INDEX_MAGIC)] != INDEX_MAGIC:
+        return []
+    body = raw[len(INDEX_MAGIC):]
+    body = body[:len(body) - len(body) % INDEX_ENTRY.size]   # Entrada cortada
+    return [INDEX_ENTRY.unpack_from(body, i) for i in range(0, len(body), INDEX_ENTRY.size)]
+
+
+def write_index(path, entries):
+    with open(path, "wb") as f:
+        f.write(INDEX_MAGIC)
+        for t_us, pos in entries:
+            f.write(INDEX_ENTRY.pack(t_us, pos))
+
+
+def _parse_addr(text):
+    ip, port = text.rsplit(":", 1)
+    return ip, int(port)
+
+
+# ----------------------------------------------------------------------
+# Ferramenta de linha de comando
+# ----------------------------------------------------------------------
+def cmd_info(args):
+    log = open_reader(args.log)
+    counts = [0, 0]
+    size = [0, 0]
+    peers = set()
+    first = last = None
+    for t, kind, addr, data in log.records():
+        counts[kind] += 1
+        size[kind] += len(data)
+        peers.add(addr)
+        first = t if first is None else first
+        last = t
+    total = sum(counts)
+    disk = os.path.getsize(args.log)
+    print(f"{args.log}: {type(log).__name__}, {disk} bytes")
+    if log.start_us:
+        print(f"Início: {time.strftime('%Y-%m-%d %H:%M:%S', time.localtime(log.start_us / 1e6))}")
+    if total:
+        print(f"Duração: {last - first:.3f} s, {len(peers)} controladores")
+    print(f"RX: {counts[RX]} datagramas ({size[RX]} bytes), TX: {counts[TX]} ({size[TX]} bytes)")
+    if total:
+        print(f"Custo do log: {(disk - sum(size)) / total:.1f} bytes por datagrama")
+    print(f"Pontos de busca: {len(log.index())}")
+    if log.truncated:
+        print("Último registro cortado (ignorado)")
+
+
+def cmd_dump(args):
+    log = open_reader(args.log)
+    for t, kind, addr, data in log.records(args.start, args.end):
+        # Mensagens de texto como estão; quadros binários em hex
+        text = data.decode() if data.isascii() and data.decode().isprintable() else data.hex()
+        print(f"{t:12.6f} {KIND_NAMES[kind]} {addr[0]}:{addr[1]} {text}")
+
+
+def cmd_index(args):
+    log = open_reader(args.log)
+    if not isinstance(log, SessionLogReader):
+        raise SystemExit("índice só existe no formato binário")
+    entries = log.sync_points()
+    write_index(args.log + ".idx", entries)
+    print(f"{len(entries)} pontos de busca em {args.log}.idx")
+
+
+def cmd_convert(args):
+    src = open_reader(args.log)
+    dst = open_writer(args.out)
+    for t, kind, addr, data in src.records():
+        (dst.rx if kind == RX else dst.tx)(t, addr, data)
+    dst.close()
+    print(f"{args.log} ({os.path.getsize(args.log)} bytes) -> {args.out} ({os.path.getsize(args.out)} bytes)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Logs de sessão do simulador (RVRL)")
+    sub = parser.add_subparsers(dest="command", required=True)
+    p = sub.add_parser("info", help="resumo do log")
+    p.add_argument("log")
+    p.set_defaults(func=cmd_info)
+    p = sub.add_parser("dump", help="lista os datagramas")
+    p.add_argument("log")
+    p.add_argument("--from", dest="start", type=float, help="a partir deste instante (s)")
+    p.add_argument("--to", dest="end", type=float, help="até este instante (s)")
+    p.set_defaults(func=cmd_dump)
+    p = sub.add_parser("index", help="refaz o índice (.idx)")
+    p.add_argument("log")
+    p.set_defaults(func=cmd_index)
+    p = sub.add_parser("convert", help="converte entre os formatos (pela extensão da saída)")
+    p.add_argument("log")
+    p.add_argument("out")
+    p.set_defaults(func=cmd_convert)
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
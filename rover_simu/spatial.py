@@ -0,0 +1,146 @@
+"""Índice espacial em grade uniforme (spatial hash) para o mundo simulado.
+
+Cada item é guardado na célula que contém o seu centro, junto com um raio
+(metade do tamanho de um obstáculo, 0 para pontos). Uma consulta só visita
+as células que podem conter algo ao alcance: o quadrado de lado
+2·(alcance + maior raio) ao redor do ponto. Todas as comparações usam
+distância ao quadrado; a raiz fica para quem precisa do valor em si.
+
+Com células do tamanho do rover, colisão, desvio, captura e escolha de
+posições custam O(itens próximos) em vez de O(todos os itens).
+"""
+import math
+
+
+class SpatialHash:
+    def __init__(self, cell_size=64):
+        self.cell = float(cell_size)
+        self.cells = {}          # (cx, cy) -> [(x, y, raio, item), ...]
+        self.entries = []        # Todas as entradas (consultas em mundos esparsos)
+        self.max_radius = 0.0    # Maior raio inserido (alarga as consultas)
+        self.count = 0
+        self.bounds = None       # (cx_min, cy_min, cx_max, cy_max) das células ocupadas
+
+    def key(self, x, y):
+        return (int(math.floor(x / self.cell)), int(math.floor(y / self.cell)))
+
+    def insert(self, item, x, y, radius=0.0):
+        cx, cy = self.key(x, y)
+        entry = (x, y, radius, item)
+        self.cells.setdefault((cx, cy), []).append(entry)
+        self.entries.append(entry)
+        self.count += 1
+        if radius > self.max_radius:
+            self.max_radius = radius
+        if self.bounds is None:
+            self.bounds = (cx, cy, cx, cy)
+        else:
+            x0, y0, x1, y1 = self.bounds
+            self.bounds = (min(x0, cx), min(y0, cy), max(x1, cx), max(y1, cy))
+
+    def remove(self, item, x, y):
+        k = self.key(x, y)
+        bucket = self.cells.get(k)
+        if not bucket:
+            return False
+        for i, entry in enumerate(bucket):
+            if entry[3] == item:
+                del bucket[i]
+                if not bucket:
+                    del self.cells[k]
+                self.entries.remove(entry)
+                self.count -= 1
+                return True
+        return False
+
+    def candidates(self, x, y, reach):
+        """Entradas das células que cobrem o quadrado (x, y) ± (reach + maior raio)
+
+        Retorna uma lista que não deve ser modificada (pode ser self.entries).
+        """
+        reach += self.max_radius
+        c = self.cell
+        cx0 = int(math.floor((x - reach) / c))
+        cx1 = int(math.floor((x + reach) / c))
+        cy0 = int(math.floor((y - reach) / c))
+        cy1 = int(math.floor((y + reach) / c))
+        cells = self.cells
+        # Mundo esparso: percorrer todas as entradas sai mais barato
+        if (cx1 - cx0 + 1) * (cy1 - cy0 + 1) >= len(cells):
+            return self.entries
+        out = []
+        for cx in range(cx0, cx1 + 1):
+            for cy in range(cy0, cy1 + 1):
+                bucket = cells.get((cx, cy))
+                if bucket:
+                    out.extend(bucket)
+        return out
+
+    def within(self, x, y, r, pad=False):
+        """Lista de (d², item) com centro a menos de r (r + raio do item, se pad)"""
+        out = []
+        for ex, ey, er, item in self.candidates(x, y, r):
+            dx = ex - x
+            dy = ey - y
+            lim = r + er if pad else r
+            d2 = dx * dx + dy * dy
+            if d2 < lim * lim:
+                out.append((d2, item))
+        return out
+
+    def any_within(self, x, y, r, pad=False):
+        """Como within(), mas para no primeiro item encontrado"""
+        for ex, ey, er, item in self.candidates(x, y, r):
+            dx = ex - x
+            dy = ey - y
+            lim = r + er if pad else r
+            if dx * dx + dy * dy < lim * lim:
+                return True
+        return False
+
+    def nearest(self, x, y, max_dist=math.inf):
+        """(d², item) do item de centro mais próximo a menos de max_dist, ou None
+
+        Percorre anéis de células a partir da célula do ponto; para assim que
+        o anel seguinte não puder conter nada mais perto que o melhor achado.
+        """
+        if not self.count:
+            return None
+        c = self.cell
+        kx, ky = self.key(x, y)
+        x0, y0, x1, y1 = self.bounds
+        ring_max = max(kx - x0, x1 - kx, ky - y0, y1 - ky, 0)
+        if max_dist != math.inf:
+            ring_max = min(ring_max, int(max_dist // c) + 1)
+        best = None
+        best_d2 = max_dist * max_dist
+        cells = self.cells
+        if (2 * ring_max + 1) ** 2 >= len(cells):
+            # Poucas células ocupadas: varredura direta das entradas
+            for ex, ey, _, item in self.entries:
+                dx = ex - x
+                dy = ey - y
+                d2 = dx * dx + dy * dy
+                if d2 < best_d2:
+                    best_d2 = d2
+                    best = item
+            return (best_d2, best) if best is not None else None
+        for ring in range(ring_max + 1):
+            # Células do anel estão a pelo menos (ring - 1)·cell do ponto
+            if ring > 1 and ((ring - 1) * c) ** 2 >= best_d2:
+                break
+            for cx in range(kx - ring, kx + ring + 1):
+                edge = cx == kx - ring or cx == kx + ring
+                step = 1 if edge else 2 * ring
+                for cy in range(ky - ring, ky + ring + 1, step if ring else 1):
+                    bucket = cells.get((cx, cy))
+                    if not bucket:
+                        continue
+                    for ex, ey, _, item in bucket:
+                        dx = ex - x
+                        dy = ey - y
+                        d2 = dx * dx + dy * dy
+                        if d2 < best_d2:
+                            best_d2 = d2
+                            best = item
+        return (best_d2, best) if best is not None else None
@@ -0,0 +1,185 @@
+// Testes da máquina de estados do provisionamento (lib/provisao.c) no PC.
+//
+// Cada caso dirige provisao_evento/provisao_varredura/provisao_avaliar com
+// eventos simulados (AP no ar ou não, formulário, enlace, falhas, botão) e
+// confere estados, tentativas e prazos. Roda com ctest (alvo
+// test-provisao); código de saída 1 se algum caso falhar.
+#include <stdio.h>
+#include <stdint.h>
+
+#include "lib/provisao.h"
+
+static int falhas;
+
+#define CONFERIR(cond) do { \
+        if (!(cond)) { \
+            printf("  FALHOU %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+            falhas++; \
+        } \
+    } while (0)
+
+#define ESTADO(p, e) do { \
+        if ((p)->estado != (e)) { \
+            printf("  FALHOU %s:%d: estado %s, esperado %s\n", __FILE__, __LINE__, \
+                   provisao_nomes_estado[(p)->estado], provisao_nomes_estado[e]); \
+            falhas++; \
+        } \
+    } while (0)
+
+// Sem redes conhecidas: AP que não sobe, nova tentativa pelo prazo e pelo
+// botão, portal no ar sem prazo
+static void caso_ap(void) {
+  provisao_t p;
+  provisao_iniciar(&p, 0, 1000);
+  ESTADO(&p, PROVISAO_AP_SUBINDO);
+  CONFERIR(provisao_proxima_ms(&p, 1000) == PROVISAO_AP_MS);
+
+  CONFERIR(provisao_evento(&p, PROVISAO_EV_AP_FALHA, 1100));
+  ESTADO(&p, PROVISAO_FALHA_AP);
+  CONFERIR(provisao_proxima_ms(&p, 1100 + 4000) == PROVISAO_FALHA_MS - 4000);
+  CONFERIR(!provisao_avaliar(&p, 1100 + PROVISAO_FALHA_MS - 1));
+  CONFERIR(provisao_avaliar(&p, 1100 + PROVISAO_FALHA_MS));
+  ESTADO(&p, PROVISAO_AP_SUBINDO);
+
+  // AP que não responde no prazo também é falha; o botão reabre na hora
+  uint32_t t = 1100 + PROVISAO_FALHA_MS;
+  CONFERIR(provisao_avaliar(&p, t + PROVISAO_AP_MS));
+  ESTADO(&p, PROVISAO_FALHA_AP);
+  CONFERIR(provisao_evento(&p, PROVISAO_EV_BOTAO, t + PROVISAO_AP_MS + 10));
+  ESTADO(&p, PROVISAO_AP_SUBINDO);
+
+  CONFERIR(provisao_evento(&p, PROVISAO_EV_AP_PRONTO, t + PROVISAO_AP_MS + 20));
+  ESTADO(&p, PROVISAO_AGUARDANDO);
+  CONFERIR(provisao_proxima_ms(&p, t + PROVISAO_AP_MS + 20) == UINT32_MAX);
+  CONFERIR(!provisao_avaliar(&p, t + 10 * PROVISAO_FALHA_MS));
+  CONFERIR(!provisao_evento(&p, PROVISAO_EV_BOTAO, t + 10 * PROVISAO_FALHA_MS));
+  ESTADO(&p, PROVISAO_AGUARDANDO);
+}
+
+// Formulário: entrega sem confirmação, senha errada até acabarem as
+// tentativas, botão para tentar de novo e então a conexão
+static void caso_formulario(void) {
+  provisao_t p;
+  provisao_iniciar(&p, 0, 0);
+  provisao_evento(&p, PROVISAO_EV_AP_PRONTO, 10);
+  CONFERIR(provisao_evento(&p, PROVISAO_EV_CREDENCIAIS, 20));
+  ESTADO(&p, PROVISAO_ESCOANDO);
+
+  // Navegador sumiu sem confirmar a página de sucesso: associa assim mesmo
+  CONFERIR(provisao_avaliar(&p, 20 + PROVISAO_ESCOAR_MS));
+  ESTADO(&p, PROVISAO_ASSOCIANDO);
+  CONFERIR(p.tentativa == 0);
+
+  // Recusa na hora, depois timeout, depois recusa: acabam as tentativas
+  uint32_t t = 20 + PROVISAO_ESCOAR_MS;
+  CONFERIR(provisao_evento(&p, PROVISAO_EV_ENLACE_FALHA, t + 100));
+  ESTADO(&p, PROVISAO_ASSOCIANDO);
+  CONFERIR(p.tentativa == 1);
+  CONFERIR(provisao_proxima_ms(&p, t + 100) == PROVISAO_ASSOCIAR_MS);
+  CONFERIR(!provisao_avaliar(&p, t + 100 + PROVISAO_ASSOCIAR_MS - 1));
+  CONFERIR(provisao_avaliar(&p, t + 100 + PROVISAO_ASSOCIAR_MS));
+  CONFERIR(p.tentativa == 2);
+  t += 100 + PROVISAO_ASSOCIAR_MS;
+  CONFERIR(PROVISAO_TENTATIVAS == 3);
+  CONFERIR(provisao_evento(&p, PROVISAO_EV_ENLACE_FALHA, t + 50));
+  ESTADO(&p, PROVISAO_FALHA_REDE);
+  CONFERIR(p.falhas == 1);
+
+  // Botão: portal de novo, sem esperar o erro sair da tela
+  CONFERIR(provisao_evento(&p, PROVISAO_EV_BOTAO, t + 60));
+  ESTADO(&p, PROVISAO_AP_SUBINDO);
+  provisao_evento(&p, PROVISAO_EV_AP_PRONTO, t + 70);
+  provisao_evento(&p, PROVISAO_EV_CREDENCIAIS, t + 80);
+  CONFERIR(provisao_evento(&p, PROVISAO_EV_ENTREGUE, t + 90));
+  ESTADO(&p, PROVISAO_ASSOCIANDO);
+  CONFERIR(p.tentativa == 0);
+
+  // Enlace com IP: verificado (rede do formulário), então operando
+  CONFERIR(provisao_evento(&p, PROVISAO_EV_ENLACE, t + 500));
+  ESTADO(&p, PROVISAO_VERIFICADO);
+  CONFERIR(!p.conhecida);
+  CONFERIR(provisao_proxima_ms(&p, t + 500) == PROVISAO_VERIFICADO_MS);
+  CONFERIR(provisao_avaliar(&p, t + 500 + PROVISAO_VERIFICADO_MS));
+  ESTADO(&p, PROVISAO_OPERANDO);
+  CONFERIR(provisao_proxima_ms(&p, t + 600 + PROVISAO_VERIFICADO_MS) == UINT32_MAX);
+  CONFERIR(!provisao_evento(&p, PROVISAO_EV_BOTAO, t + 700 + PROVISAO_VERIFICADO_MS));
+  ESTADO(&p, PROVISAO_OPERANDO);
+}
+
+// Redes conhecidas: uma candidata por vez até uma conectar; sem nenhuma
+// no ar, na varredura que não termina ou com o botão, o portal
+static void caso_conhecidas(void) {
+  provisao_t p;
+  provisao_iniciar(&p, 3, 0);
+  ESTADO(&p, PROVISAO_VARRENDO);
+  CONFERIR(provisao_varredura(&p, 2, 1200));
+  ESTADO(&p, PROVISAO_CONHECIDA);
+  CONFERIR(p.candidatas == 2 && p.tentativa == 0);
+
+  // Primeira candidata não associa no prazo, a segunda conecta
+  CONFERIR(provisao_avaliar(&p, 1200 + PROVISAO_CONHECIDA_MS));
+  ESTADO(&p, PROVISAO_CONHECIDA);
+  CONFERIR(p.tentativa == 1);
+  CONFERIR(provisao_evento(&p, PROVISAO_EV_ENLACE, 1200 + PROVISAO_CONHECIDA_MS + 300));
+  ESTADO(&p, PROVISAO_VERIFICADO);
+  CONFERIR(p.conhecida && p.tentativa == 1);
+
+  // Todas recusam: portal
+  provisao_iniciar(&p, 2, 0);
+  provisao_varredura(&p, 2, 100);
+  CONFERIR(provisao_evento(&p, PROVISAO_EV_ENLACE_FALHA, 200));
+  CONFERIR(provisao_evento(&p, PROVISAO_EV_ENLACE_FALHA, 300));
+  ESTADO(&p, PROVISAO_AP_SUBINDO);
+  CONFERIR(p.falhas == 0);
+
+  // Nenhuma conhecida no ar
+  provisao_iniciar(&p, 2, 0);
+  CONFERIR(provisao_varredura(&p, 0, 100));
+  ESTADO(&p, PROVISAO_AP_SUBINDO);
+
+  // Varredura que não termina
+  provisao_iniciar(&p, 2, 0);
+  CONFERIR(!provisao_avaliar(&p, PROVISAO_VARREDURA_MS - 1));
+  CONFERIR(provisao_avaliar(&p, PROVISAO_VARREDURA_MS));
+  ESTADO(&p, PROVISAO_AP_SUBINDO);
+  CONFERIR(!provisao_varredura(&p, 2, PROVISAO_VARREDURA_MS + 10));
+
+  // Botão durante a varredura e durante uma associação
+  provisao_iniciar(&p, 1, 0);
+  CONFERIR(provisao_evento(&p, PROVISAO_EV_BOTAO, 50));
+  ESTADO(&p, PROVISAO_AP_SUBINDO);
+  provisao_iniciar(&p, 1, 0);
+  provisao_varredura(&p, 1, 100);
+  CONFERIR(provisao_evento(&p, PROVISAO_EV_BOTAO, 150));
+  ESTADO(&p, PROVISAO_AP_SUBINDO);
+}
+
+// Prazos atravessando a volta do relógio de 32 bits em ms
+static void caso_relogio(void) {
+  provisao_t p;
+  uint32_t t = UINT32_MAX - 1000;
+  provisao_iniciar(&p, 0, t);
+  CONFERIR(provisao_proxima_ms(&p, t + 2000) == PROVISAO_AP_MS - 2000);
+  CONFERIR(!provisao_avaliar(&p, t + PROVISAO_AP_MS - 1));
+  CONFERIR(provisao_avaliar(&p, t + PROVISAO_AP_MS));
+  ESTADO(&p, PROVISAO_FALHA_AP);
+  CONFERIR(provisao_proxima_ms(&p, t + PROVISAO_AP_MS + PROVISAO_FALHA_MS + 5) == 0);
+}
+
+int main(void) {
+  static const struct {
+    const char *nome;
+    void (*fn)(void);
+  } casos[] = {
+    { "ap", caso_ap },
+    { "formulario", caso_formulario },
+    { "conhecidas", caso_conhecidas },
+    { "relogio", caso_relogio },
+  };
+  for (size_t i = 0; i < sizeof(casos) / sizeof(casos[0]); i++) {
+    int antes = falhas;
+    casos[i].fn();
+    printf("%-12s %s\n", casos[i].nome, falhas == antes ? "ok" : "FALHOU");
+  }
+  return falhas ? 1 : 0;
+}
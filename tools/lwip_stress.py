@@ -0,0 +1,263 @@
+"""Teste de carga dos pools do lwIP no build de PC (wifi-portal-host).
+
+Sobe o firmware e faz o papel do navegador e do controlador ao mesmo tempo:
+
+  1. portal: rodadas de N conexões simultâneas pedindo a página (GET /);
+  2. envia as credenciais (POST /save) e espera o modo STA;
+  3. controle: responde DISCOVER/HELLO/PING, manda status a --rate Hz com
+     rajadas de --udp-burst datagramas e raspa /metrics e /status com
+     --scrapers conexões simultâneas durante --duration segundos;
+  4. lê /status: pico de uso e alocações recusadas de cada pool e do heap
+     do lwIP, e sugere o menor tamanho seguro (pico + --margin).
+
+O shim de host/ aplica os limites do lwipopts.h do perfil compilado
+(-DROVER_LWIP_PERFIL=portal|controle) e conta segmentos TCP e heap no pior
+caso do lwIP, então os números valem como teto para o Pico. O shim não vê
+os pcbs UDP do DHCP, DNS e mDNS nem os pbufs de recepção do cyw43: no Pico
+some 3 a udp_pcb e mantenha folga em pbuf_pool.
+
+Uso:
+    python tools/lwip_stress.py --firmware build-host/host/wifi-portal-host
+    python tools/lwip_stress.py --firmware ... --portal-burst 8 --rate 500 --json pools.json
+
+Código de saída 1 se algum pool recusou alocações.
+"""
+import argparse
+import concurrent.futures
+import json
+import math
+import os
+import socket
+import subprocess
+import sys
+import threading
+import time
+
+# Recurso em /status -> opção do lwipopts.h
+POOLS = [
+    ("pbuf_pool", "PBUF_POOL_SIZE"),
+    ("udp_pcb", "MEMP_NUM_UDP_PCB"),
+    ("tcp_pcb", "MEMP_NUM_TCP_PCB"),
+    ("tcp_pcb_listen", "MEMP_NUM_TCP_PCB_LISTEN"),
+    ("tcp_seg", "MEMP_NUM_TCP_SEG"),
+]
+
+STATUS_LINE = ("speed=10.0,steering=0.0,battery=99.0,temp=25.0,mode=0,"
+               "lights=off,camera=off,score=0,evack=0")
+
+
+def http(port, request, timeout=5.0):
+    """Faz uma requisição crua e devolve (status, corpo) ou levanta OSError."""
+    with socket.create_connection(("127.0.0.1", port), timeout=timeout) as s:
+        s.sendall(request.encode())
+        data = b""
+        while True:
+            chunk = s.recv(4096)
+            if not chunk:
+                break
+            data += chunk
+    head, _, body = data.partition(b"\r\n\r\n")
+    if not head:
+        raise OSError("resposta vazia")
+    status = int(head.split(b" ", 2)[1])
+    return status, body
+
+
+def get(port, path, timeout=5.0):
+    return http(port, f"GET {path} HTTP/1.1\r\nHost: rover\r\n\r\n", timeout)
+
+
+def wait_for(cond, timeout, interval=0.2):
+    end = time.monotonic() + timeout
+    while time.monotonic() < end:
+        try:
+            if cond():
+                return True
+        except OSError:
+            pass
+        time.sleep(interval)
+    return False
+
+
+class Controller(threading.Thread):
+    """Controlador mínimo: OFFER, ACK, PONG e status em alta taxa."""
+
+    def __init__(self, port, rate, burst):
+        super().__init__(daemon=True)
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.bind(("0.0.0.0", port))
+        self.sock.settimeout(0.005)
+        self.port = port
+        self.period = 1.0 / rate if rate > 0 else None
+        self.burst = burst
+        self.rover = None
+        self.sent = 0
+        self.received = 0
+        self.stop = threading.Event()
+
+    def handle(self, data, addr):
+        self.received += 1
+        t = int(time.monotonic() * 1e6) & 0xFFFFFFFF
+        if data.startswith(b"DISCOVER"):
+            self.sock.sendto(f"OFFER,port={self.port}".encode(), addr)
+            self.rover = addr
+        elif data.startswith(b"HELLO"):
+            self.rover = addr
+            self.sock.sendto(b"ACK", addr)
+        elif data.startswith(b"PING,"):
+            fields = dict(kv.split("=", 1) for kv in data.decode().split(",")[1:] if "=" in kv)
+            self.sock.sendto(f"PONG,seq={fields.get('seq', 0)},t1={fields.get('t1', 0)},"
+                             f"t2={t},t3={t}".encode(), addr)
+
+    def run(self):
+        next_send = time.monotonic()
+        next_burst = next_send + 1.0
+        while not self.stop.is_set():
+            try:
+                data, addr = self.sock.recvfrom(2048)
+                self.handle(data, addr)
+            except socket.timeout:
+                pass
+            except OSError:
+                break
+            now = time.monotonic()
+            if self.rover and self.period and now >= next_send:
+                next_send = now + self.period
+                self.sock.sendto(STATUS_LINE.encode(), self.rover)
+                self.sent += 1
+            if self.rover and self.burst and now >= next_burst:
+                next_burst = now + 1.0
+                for _ in range(self.burst):
+                    self.sock.sendto(STATUS_LINE.encode(), self.rover)
+                self.sent += self.burst
+        self.sock.close()
+
+
+def portal_phase(port, rounds, burst):
+    ok = failed = 0
+    with concurrent.futures.ThreadPoolExecutor(max_workers=burst) as pool:
+        for _ in range(rounds):
+            futures = [pool.submit(get, port, "/") for _ in range(burst)]
+            for f in futures:
+                try:
+                    status, body = f.result()
+                    ok += status == 200 and b"<form" in body
+                    failed += not (status == 200 and b"<form" in body)
+                except OSError:
+                    failed += 1
+    return ok, failed
+
+
+def scrape_phase(port, duration, scrapers):
+    ok = refused = 0
+    end = time.monotonic() + duration
+    lock = threading.Lock()
+
+    def worker(i):
+        nonlocal ok, refused
+        path = "/metrics" if i % 2 == 0 else "/status"
+        while time.monotonic() < end:
+            try:
+                status, _ = get(port, path)
+                with lock:
+                    ok += status == 200
+            except OSError:
+                # Slots do servidor ocupados: conexão recusada/abortada
+                with lock:
+                    refused += 1
+                time.sleep(0.01)
+
+    with concurrent.futures.ThreadPoolExecutor(max_workers=scrapers) as pool:
+        list(pool.map(worker, range(scrapers)))
+    return ok, refused
+
+
+def suggest(peak, margin):
+    return max(1, peak + 1, math.ceil(peak * (1.0 + margin)))
+
+
+def report(status, margin):
+    rows = []
+    mem = {"recurso": "heap (bytes)", "opcao": "MEM_SIZE",
+           "atual": status["lwip_mem_size_bytes"], "pico": status["lwip_mem_peak_bytes"],
+           "erros": status.get("lwip_mem_errors_total", 0)}
+    rows.append(mem)
+    for name, option in POOLS:
+        p = status["lwip_pools"].get(name)
+        if p is None:
+            continue
+        rows.append({"recurso": name, "opcao": option, "atual": p["size"],
+                     "pico": p["peak"], "erros": p["errors"]})
+    for r in rows:
+        r["sugerido"] = suggest(r["pico"], margin)
+    return rows
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Carga no portal e no UDP; pico dos pools do lwIP")
+    parser.add_argument("--firmware", default="build-host/host/wifi-portal-host")
+    parser.add_argument("--http-port", type=int, default=8880, help="ROVER_HTTP_PORT do firmware")
+    parser.add_argument("--udp-port", type=int, default=8080, help="porta do controlador")
+    parser.add_argument("--portal-rounds", type=int, default=5)
+    parser.add_argument("--portal-burst", type=int, default=6, help="conexões simultâneas ao portal")
+    parser.add_argument("--rate", type=float, default=200.0, help="status por segundo ao rover")
+    parser.add_argument("--udp-burst", type=int, default=20, help="datagramas de uma vez, a cada 1 s")
+    parser.add_argument("--scrapers", type=int, default=4, help="raspagens simultâneas de /metrics")
+    parser.add_argument("--duration", type=float, default=10.0, help="segundos da fase de controle")
+    parser.add_argument("--margin", type=float, default=0.25, help="folga sobre o pico (0.25 = +25%%)")
+    parser.add_argument("--json", help="grava o resultado neste arquivo")
+    parser.add_argument("--verbose", action="store_true", help="mostra a saída do firmware")
+    args = parser.parse_args()
+
+    controller = Controller(args.udp_port, args.rate, args.udp_burst)
+    controller.start()
+
+    env = dict(os.environ, ROVER_HTTP_PORT=str(args.http_port))
+    env.pop("ROVER_SSID", None)
+    out = None if args.verbose else subprocess.DEVNULL
+    fw = subprocess.Popen([args.firmware], env=env, stdout=out, stderr=out)
+    try:
+        if not wait_for(lambda: get(args.http_port, "/")[0] == 200, 10):
+            sys.exit("portal não respondeu")
+
+        print(f"Portal: {args.portal_rounds} rodadas de {args.portal_burst} conexões...")
+        ok, failed = portal_phase(args.http_port, args.portal_rounds, args.portal_burst)
+        print(f"  {ok} páginas completas, {failed} falhas")
+
+        http(args.http_port, "POST /save HTTP/1.1\r\nHost: rover\r\nContent-Length: 27\r\n\r\n"
+                             "ssid=stress&password=stress")
+        print("Credenciais enviadas; aguardando o modo STA...")
+        # O portal continua respondendo (com o formulário) até fechar o AP
+        if not wait_for(lambda: get(args.http_port, "/status")[1].startswith(b"{"), 30, 0.5):
+            sys.exit("servidor de status não respondeu")
+
+        print(f"Controle: {args.duration:.0f} s a {args.rate:.0f} datagramas/s "
+              f"(+{args.udp_burst}/s em rajada), {args.scrapers} raspagens simultâneas...")
+        ok, refused = scrape_phase(args.http_port, args.duration, args.scrapers)
+        print(f"  {ok} respostas, {refused} recusadas; {controller.sent} datagramas enviados, "
+              f"{controller.received} recebidos")
+
+        _, body = get(args.http_port, "/status")
+        status = json.loads(body)
+    finally:
+        controller.stop.set()
+        fw.terminate()
+        fw.wait(timeout=5)
+
+    rows = report(status, args.margin)
+    print(f"\n{'recurso':<16} {'lwipopts.h':<24} {'atual':>6} {'pico':>6} {'erros':>6} {'sugerido':>9}")
+    for r in rows:
+        print(f"{r['recurso']:<16} {r['opcao']:<24} {r['atual']:>6} {r['pico']:>6} "
+              f"{r['erros']:>6} {r['sugerido']:>9}")
+    print("MEMP_NUM_TCP_SEG também precisa cobrir TCP_SND_QUEUELEN (checagem do lwIP).")
+    print("No Pico: +3 em udp_pcb (DHCP, DNS, mDNS) e folga em pbuf_pool (recepção do cyw43).")
+
+    if args.json:
+        with open(args.json, "w", encoding="utf-8") as f:
+            json.dump({"pools": rows, "status": status}, f, indent=2)
+    sys.exit(1 if any(r["erros"] for r in rows) else 0)
+
+
+if __name__ == "__main__":
+    main()
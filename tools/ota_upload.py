@@ -0,0 +1,93 @@
+"""Atualiza o firmware de um rover pela rede (POST /ota do servidor de status).
+
+Pergunta ao rover qual slot está inativo (GET /ota), escolhe a imagem ligada
+para ele (wifi-portal.bin para o slot A, wifi-portal-b.bin para o B) e envia
+em fluxo, com Content-Length e X-OTA-CRC32. O rover grava setor a setor
+enquanto recebe, confere o CRC e reinicia na imagem nova, que fica em teste
+até chegar de novo ao servidor de status.
+
+Uso:
+    python tools/ota_upload.py rover-1a2b.local --build build
+    python tools/ota_upload.py localhost:8880 --image firmware.bin   # build de PC
+
+Código de saída 1 se o rover recusar a imagem.
+"""
+import argparse
+import json
+import os
+import socket
+import sys
+import time
+import zlib
+
+IMAGES = {"a": "wifi-portal.bin", "b": "wifi-portal-b.bin"}
+CHUNK = 4096
+
+
+def address(target):
+    host, _, port = target.partition(":")
+    return host, int(port) if port else 80
+
+
+def request(target, head, body=b"", timeout=30.0, progress=None):
+    """Envia o pedido (o corpo em pedaços) e devolve (status, corpo)."""
+    with socket.create_connection(address(target), timeout=timeout) as s:
+        s.sendall(head.encode())
+        sent = 0
+        for i in range(0, len(body), CHUNK):
+            s.sendall(body[i:i + CHUNK])
+            sent += len(body[i:i + CHUNK])
+            if progress:
+                progress(sent)
+        data = b""
+        while True:
+            chunk = s.recv(4096)
+            if not chunk:
+                break
+            data += chunk
+    head, _, payload = data.partition(b"\r\n\r\n")
+    return int(head.split(b" ", 2)[1]), payload
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Envia uma imagem nova ao rover (OTA)")
+    parser.add_argument("rover", help="host[:porta] do servidor de status (p.ex. rover-1a2b.local)")
+    parser.add_argument("--build", default="build", help="diretório com wifi-portal.bin e wifi-portal-b.bin")
+    parser.add_argument("--image", help="imagem a enviar (ignora --build e o slot)")
+    args = parser.parse_args()
+
+    status, body = request(args.rover, "GET /ota HTTP/1.0\r\nHost: rover\r\n\r\n")
+    if status != 200:
+        sys.exit(f"GET /ota respondeu {status} (firmware sem ROVER_OTA?)")
+    state = json.loads(body)
+    print(f"Rover no slot {state['slot']} ({state['estado']}); destino: slot {state['destino']}")
+
+    path = args.image or os.path.join(args.build, IMAGES[state["destino"]])
+    with open(path, "rb") as f:
+        image = f.read()
+    if len(image) > state["max_bytes"]:
+        sys.exit(f"{path}: {len(image)} B não cabem no slot ({state['max_bytes']} B)")
+    crc = zlib.crc32(image) & 0xFFFFFFFF
+    print(f"Enviando {path}: {len(image)} B, crc32 {crc:08x}")
+
+    start = time.monotonic()
+    last = [0.0]
+
+    def progress(sent):
+        now = time.monotonic()
+        if now - last[0] >= 0.5 or sent == len(image):
+            last[0] = now
+            rate = sent / max(now - start, 1e-6) / 1024
+            print(f"\r  {sent * 100 // len(image):3d}%  {rate:7.1f} KB/s", end="", flush=True)
+
+    head = (f"POST /ota HTTP/1.0\r\nHost: rover\r\nContent-Type: application/octet-stream\r\n"
+            f"Content-Length: {len(image)}\r\nX-OTA-CRC32: {crc:08x}\r\n\r\n")
+    status, body = request(args.rover, head, image, timeout=60.0, progress=progress)
+    elapsed = time.monotonic() - start
+    print(f"\n{status} em {elapsed:.1f} s ({len(image) / elapsed / 1024:.1f} KB/s): "
+          f"{body.decode(errors='replace').strip()}")
+    sys.exit(0 if status == 200 else 1)
+
+
+if __name__ == "__main__":
+    main()
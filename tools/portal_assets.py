@@ -0,0 +1,84 @@
+"""Gera portal_assets.c com as páginas do portal minificadas e comprimidas.
+
+Cada arquivo vira um `portal_asset_t` (lib/portal.h) guardado na flash, com
+o corpo minificado, a versão gzip e uma ETag forte por representação. O nome
+vem do arquivo: portal/setup.html vira `portal_pagina_setup`.
+
+A minificação é conservadora: junta espaços, tira os que ficam entre tags e,
+dentro de <style>, os que ficam em volta de { } : ; ,. O gzip sai sem data
+no cabeçalho, então a mesma página gera sempre os mesmos bytes e a mesma
+ETag (o navegador só baixa de novo quando a página muda).
+
+Uso (chamado pelo lib/CMakeLists.txt):
+    python tools/portal_assets.py -o build/lib/portal_assets.c portal/setup.html portal/sucesso.html
+"""
+import argparse
+import gzip
+import hashlib
+import os
+import re
+
+TYPES = {".html": "text/html; charset=utf-8", ".css": "text/css", ".js": "application/javascript"}
+
+
+def minify_css(css):
+    css = re.sub(r"\s+", " ", css)
+    css = re.sub(r"\s*([{}:;,])\s*", r"\1", css)
+    return css.replace(";}", "}").strip()
+
+
+def minify_html(html):
+    parts = re.split(r"(<style>.*?</style>)", html, flags=re.S)
+    out = []
+    for part in parts:
+        if part.startswith("<style>"):
+            out.append("<style>" + minify_css(part[7:-8]) + "</style>")
+        else:
+            part = re.sub(r"\s+", " ", part)
+            out.append(re.sub(r">\s+<", "><", part))
+    return re.sub(r">\s+<", "><", "".join(out)).strip()
+
+
+def c_bytes(data, indent="  "):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append(indent + ", ".join(f"0x{b:02x}" for b in data[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Embute as páginas do portal (minificadas + gzip)")
+    parser.add_argument("-o", "--output", required=True, help="arquivo .c gerado")
+    parser.add_argument("pages", nargs="+", help="páginas do portal")
+    args = parser.parse_args()
+
+    out = ["// Gerado por tools/portal_assets.py: não edite.", '#include "lib/portal.h"', ""]
+    for path in args.pages:
+        stem, ext = os.path.splitext(os.path.basename(path))
+        with open(path, encoding="utf-8") as f:
+            text = f.read()
+        body = (minify_html(text) if ext == ".html" else text).encode("utf-8")
+        gz = gzip.compress(body, compresslevel=9, mtime=0)
+        tag = hashlib.sha1(body).hexdigest()[:16]
+        name = f"portal_pagina_{re.sub(r'[^0-9A-Za-z]', '_', stem)}"
+        out += [
+            f"// {os.path.basename(path)}: {len(text.encode())} B -> {len(body)} B minificado, {len(gz)} B gzip",
+            f"static const uint8_t {name}_corpo[] = {{", c_bytes(body), "};",
+            f"static const uint8_t {name}_gz[] = {{", c_bytes(gz), "};",
+            f"const portal_asset_t {name} = {{",
+            f'  .tipo = "{TYPES.get(ext, "application/octet-stream")}",',
+            f"  .corpo = {name}_corpo,",
+            f"  .tam = sizeof({name}_corpo),",
+            f"  .gz = {name}_gz,",
+            f"  .tam_gz = sizeof({name}_gz),",
+            f'  .etag = "\\"{tag}\\"",',
+            f'  .etag_gz = "\\"{tag}-gz\\"",',
+            "};",
+            "",
+        ]
+    with open(args.output, "w", encoding="utf-8") as f:
+        f.write("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,177 @@
+"""Coletor e conversor do trace do firmware (lib/trace.h) para o Chrome.
+
+O firmware compilado com -DROVER_TRACE=ON envia pacotes RVRT por UDP para a
+porta 8083 do controlador. Este script recebe esses pacotes (ou lê uma
+captura gravada antes) e gera um JSON no formato Trace Event, que abre em
+chrome://tracing ou https://ui.perfetto.dev.
+
+Cada zona vira um par B/E e cada contador um evento C. Os rótulos vêm da
+lista TRACE_IDS de lib/trace.h. Carimbos de 32 bits em us são desdobrados
+quando dão a volta (~71 min).
+
+Uso:
+    python trace2chrome.py --listen 8083 --duration 10 -o trace.json
+    python trace2chrome.py --listen 8083 --duration 10 --raw captura.bin
+    python trace2chrome.py captura.bin -o trace.json
+"""
+import argparse
+import json
+import os
+import re
+import socket
+import struct
+import sys
+import time
+
+HEADER = struct.Struct("<4sHHII")     # magic, seq, n, perdidos, t_envio
+RECORD = struct.Struct("<IBBH")       # ts, tipo, id, valor
+KIND_BEGIN, KIND_END, KIND_COUNTER = 0, 1, 2
+
+DEFAULT_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "lib", "trace.h")
+
+
+def load_labels(path):
+    """Mapeia id -> rótulo a partir das entradas X(nome, id, "rótulo")."""
+    with open(path, encoding="utf-8") as f:
+        text = f.read()
+    return {int(m.group(2)): m.group(3)
+            for m in re.finditer(r'X\((\w+),\s*(\d+),\s*"([^"]+)"\)', text)}
+
+
+def read_capture(path):
+    """Captura bruta: cada pacote prefixado pelo tamanho (u16 little-endian)."""
+    packets = []
+    with open(path, "rb") as f:
+        data = f.read()
+    pos = 0
+    while pos + 2 <= len(data):
+        (size,) = struct.unpack_from("<H", data, pos)
+        packets.append(data[pos + 2:pos + 2 + size])
+        pos += 2 + size
+    return packets
+
+
+def listen(port, duration, raw_path=None):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(("0.0.0.0", port))
+    sock.settimeout(0.2)
+    raw = open(raw_path, "wb") if raw_path else None
+    packets = []
+    end = time.monotonic() + duration
+    print(f"Recebendo trace na porta UDP {port} por {duration:.0f} s...", file=sys.stderr)
+    try:
+        while time.monotonic() < end:
+            try:
+                data, _ = sock.recvfrom(2048)
+            except socket.timeout:
+                continue
+            if not data.startswith(b"RVRT"):
+                continue
+            packets.append(data)
+            if raw:
+                raw.write(struct.pack("<H", len(data)) + data)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        sock.close()
+        if raw:
+            raw.close()
+    return packets
+
+
+def convert(packets, labels):
+    """Retorna (eventos, estatísticas) no formato Trace Event."""
+    events = []
+    open_zones = {}
+    last_seq = None
+    missing_packets = 0
+    overwritten = 0
+    last_ts = None
+    wraps = 0
+
+    for pkt in packets:
+        if len(pkt) < HEADER.size:
+            continue
+        magic, seq, n, lost, _ = HEADER.unpack_from(pkt)
+        if magic != b"RVRT":
+            continue
+        if last_seq is not None:
+            missing_packets += (seq - last_seq - 1) & 0xFFFF
+        last_seq = seq
+        overwritten = lost
+
+        for i in range(n):
+            off = HEADER.size + i * RECORD.size
+            if off + RECORD.size > len(pkt):
+                break
+            ts, kind, ident, value = RECORD.unpack_from(pkt, off)
+            if last_ts is not None and ts < last_ts and last_ts - ts > 0x80000000:
+                wraps += 1
+            last_ts = ts
+            t = ts + wraps * 0x100000000
+            name = labels.get(ident, f"id{ident}")
+
+            if kind == KIND_BEGIN:
+                open_zones[ident] = open_zones.get(ident, 0) + 1
+                events.append({"name": name, "ph": "B", "ts": t, "pid": 1, "tid": 1})
+            elif kind == KIND_END:
+                # Fim sem início (começo da captura ou registro perdido): descarta
+                if not open_zones.get(ident):
+                    continue
+                open_zones[ident] -= 1
+                events.append({"name": name, "ph": "E", "ts": t, "pid": 1, "tid": 1})
+            elif kind == KIND_COUNTER:
+                events.append({"name": name, "ph": "C", "ts": t, "pid": 1,
+                               "args": {name: value}})
+
+    stats = {"pacotes": len(packets), "pacotes_perdidos": missing_packets,
+             "registros_sobrescritos": overwritten, "eventos": len(events)}
+    return events, stats
+
+
+def summarize(events):
+    """Tempo total e máximo por zona, para um resumo no terminal."""
+    stacks = {}
+    totals = {}
+    for ev in events:
+        if ev["ph"] == "B":
+            stacks.setdefault(ev["name"], []).append(ev["ts"])
+        elif ev["ph"] == "E" and stacks.get(ev["name"]):
+            dur = ev["ts"] - stacks[ev["name"]].pop()
+            count, total, worst = totals.get(ev["name"], (0, 0, 0))
+            totals[ev["name"]] = (count + 1, total + dur, max(worst, dur))
+    return totals
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Trace RVRT do firmware -> JSON do Chrome")
+    parser.add_argument("captures", nargs="*", help="capturas gravadas com --raw")
+    parser.add_argument("--listen", type=int, metavar="PORTA", help="recebe ao vivo nesta porta UDP")
+    parser.add_argument("--duration", type=float, default=10.0, help="segundos de captura ao vivo")
+    parser.add_argument("--raw", help="grava os pacotes recebidos neste arquivo")
+    parser.add_argument("--header", default=DEFAULT_HEADER, help="lib/trace.h com os rótulos")
+    parser.add_argument("-o", "--output", default="trace.json")
+    args = parser.parse_args()
+
+    packets = []
+    if args.listen:
+        packets += listen(args.listen, args.duration, args.raw)
+    for path in args.captures:
+        packets += read_capture(path)
+    if not packets:
+        parser.error("nenhum pacote RVRT (use --listen ou passe uma captura)")
+
+    events, stats = convert(packets, load_labels(args.header))
+    with open(args.output, "w", encoding="utf-8") as f:
+        json.dump({"traceEvents": events, "displayTimeUnit": "ms", "otherData": stats}, f)
+
+    print(f"{stats['pacotes']} pacotes ({stats['pacotes_perdidos']} perdidos), "
+          f"{stats['registros_sobrescritos']} registros sobrescritos no anel, "
+          f"{stats['eventos']} eventos -> {args.output}")
+    for name, (count, total, worst) in sorted(summarize(events).items(), key=lambda kv: -kv[1][1]):
+        print(f"  {name:<24} {count:>6}x  média {total / count:>8.1f} us  máx {worst:>8} us")
+
+
+if __name__ == "__main__":
+    main()
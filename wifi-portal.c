@@ -1,14 +1,23 @@
-// compile com: PICO_CYW43_ARCH_POLL=1
+// compile com: pico_cyw43_arch_lwip_threadsafe_background (CMakeLists.txt).
+// A rede roda na IRQ do cyw43; o controle, os LEDs e o RSSI em tarefas do
+// async_context; o laço principal provisiona a rede (lib/provisao.h),
+// redesenha o display, escoa o log e dorme em __wfe entre os eventos.
 #include "pico/stdlib.h"
 #include "pico/cyw43_arch.h"
+#include "pico/async_context.h"
+#include "pico/rand.h"
 #include "hardware/adc.h"
+#include "hardware/clocks.h"
 #include "hardware/gpio.h"
 #include "hardware/irq.h"
+#include "hardware/sync.h"
 #include "lwip/pbuf.h"
 #include "lwip/udp.h"
 #include "lwip/tcp.h"
 #include "lwip/netif.h"
 #include "lwip/ip4_addr.h"
+#include "lwip/apps/mdns.h"
+#include "lwip/stats.h"
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
@@ -21,13 +30,123 @@
 #include "lib/ssd1306.h"    // Biblioteca do SSD1306
 #include "lib/font.h"       // Fonte para o OLED
 
+// Medição de RTT/offset do enlace (PING/PONG)
+#include "lib/link_stats.h"
+// Quadros de comando com redundância (histórico + paridade XOR)
+#include "lib/cmd_frame.h"
+
+// Protocolo de texto, joystick e portal (compartilhados com o build de PC)
+#include "lib/proto_texto.h"
+#include "lib/controle.h"
+#include "lib/portal.h"
+#include "lib/redes.h"
+#include "lib/matriz.h"
+
+// Zonas de trace (só com ROVER_TRACE)
+#include "lib/trace.h"
+// Log adiado (RLOG): formatado no laço principal, nunca nos callbacks
+#include "lib/rlog.h"
+// Contadores e histogramas do servidor de status (/metrics, /status)
+#include "lib/metricas.h"
+// Política de energia: ATIVO, OCIOSO e DORMINDO por inatividade
+#include "lib/energia.h"
+// Redes conhecidas na flash, escolhidas pela varredura no boot e no roaming
+#include "lib/credenciais.h"
+#include "lib/provisao.h"
+// Supervisor de saúde: batimentos, watchdog e motivo do último reset
+#include "lib/supervisor.h"
+#include "hardware/watchdog.h"
+#include "hardware/flash.h"
+#include "pico/flash.h"
+#if ROVER_OTA
+// Atualização pela rede (POST /ota): slots A/B na flash e seletor de boot
+#include "lib/ota.h"
+#endif
+
 // Biblioteca para Matriz RGB 
 #include "ws2812.pio.h"
 
-// Configurações de rede - AJUSTE CONFORME SUA REDE
-#define PC_IP      "192.168.2.110"   // ← ajuste ao IP do computador
-#define PC_PORT    8080              // porta em que o PC escuta
+// Configurações de rede
+// O controlador (PC/simulador) é descoberto na sub-rede: o Pico envia
+// DISCOVER em broadcast e trava no primeiro controlador que responder OFFER.
+// Para fixar o controlador sem descoberta, defina PC_IP (ex.: -DPC_IP=\"192.168.2.110\").
+#define PC_PORT    8080              // porta padrão em que o PC escuta
 #define PICO_PORT  8081              // porta local do Pico
+#ifndef DESCOBERTA_ENDERECO
+#define DESCOBERTA_ENDERECO "255.255.255.255"  // destino do DISCOVER (127.0.0.1 em testes locais)
+#endif
+#define DESCOBERTA_INTERVALO_MS 500  // Período de DISCOVER enquanto sem controlador
+#define REDESCOBERTA_MS     3000     // Sem resposta do controlador travado -> volta a descobrir
+#define MDNS_SERVICO        "_rover" // Serviço anunciado via mDNS (_rover._udp)
+// Para dividir um rover já existente no simulador (dono ou espectador),
+// defina ROVER_ALVO (ex.: -DROVER_ALVO=\"rover-1\"); sem ele o rover é próprio
+#ifndef ROVER_ALVO
+#define ROVER_ALVO          NULL
+#endif
+
+// Temporização do enlace de controle
+#define CMD_INTERVALO_MS    100      // Período de envio com o joystick fora do centro
+#define CMD_AMOSTRA_MS      20       // Leitura do joystick com o enlace ativo
+#define CMD_KEEPALIVE_MS    1000     // Período de envio em repouso
+#define CMD_LIMIAR          0.05f    // Mudança de eixo (fração do curso) que sai na hora
+#ifndef CMD_INTERVALO_MIN_MS
+#define CMD_INTERVALO_MIN_MS 20      // Teto de taxa dos envios por mudança (50 Hz)
+#endif
+#define HELLO_INTERVALO_MS  1000     // Período de HELLO enquanto desconectado
+#define PING_INTERVALO_MS   1000     // Período de PING para medir RTT
+
+// Redundância do fluxo de comandos
+#define CMD_REDUNDANCIA     3        // Amostras anteriores repetidas em cada quadro
+#define CMD_PARIDADE_N      4        // Quadro de paridade a cada N quadros (0 = desligado)
+
+// Trace (ROVER_TRACE): pacotes RVRT para o controlador, lidos por tools/trace2chrome.py
+#define TRACE_PORTA         8083     // porta do coletor no controlador
+#define TRACE_INTERVALO_MS  100      // Período de drenagem do anel
+
+// Log adiado: bytes de saída formatados por volta do laço principal
+#define RLOG_ESCOAR_BYTES   256
+
+// Servidor de status (modo STA): /metrics (Prometheus) e /status (JSON)
+#define STATUS_PORTA        80
+#define STATUS_CONEXOES     2        // Respostas simultâneas
+#define STATUS_BLOCO        256      // Bytes por tcp_write
+#define RSSI_INTERVALO_MS   1000     // Período de leitura do RSSI
+#define OTA_REINICIO_MS     500      // Espera a resposta do POST /ota sair antes do reboot
+#define OTA_CABECALHO_MAX   512      // Pedido e cabeçalhos do POST /ota (primeiro segmento)
+
+// Slot em que esta imagem foi ligada (opção ROVER_OTA do CMake)
+#ifndef ROVER_OTA_SLOT
+#define ROVER_OTA_SLOT      0
+#endif
+
+// Núcleo em __wfe entre eventos; acorda ao menos a cada NUCLEO_SONO_MAX_MS
+// para escoar registros de log gravados nas IRQs
+#define NUCLEO_SONO_MAX_MS  50
+#define CAPTURA_ANIMACAO_MS 500      // Padrão de captura na matriz e LED verde
+
+// Supervisor de saúde (lib/supervisor.h): prazos dos batimentos e do watchdog
+#define WATCHDOG_MS             5000   // Sem alimentação, o RP2040 reinicia sozinho
+#define SUPERVISOR_INTERVALO_MS 250    // Conferência dos batimentos (e alimentação)
+#define PRAZO_LACO_MS           2000   // Laço principal (acorda a cada NUCLEO_SONO_MAX_MS)
+#define PRAZO_CONTROLE_MS       3000   // Tarefa do enlace (no máximo HELLO_INTERVALO_MS entre passadas)
+#define PRAZO_REDE_MS           10000  // Leituras de RSSI recusadas seguidas pelo cyw43
+#define I2C_RECUPERAR_MS        1000   // Intervalo mínimo entre recuperações do barramento do OLED
+
+// Zona do trace que também deixa rastro no scratch do watchdog: depois de
+// um reset, a trilha diz por onde o firmware passou por último. Uma IRQ no
+// meio do ler-modificar-escrever pode apagar uma zona; para rastro, basta
+// a última zona gravada, e a próxima ZONA_INICIO regrava a trilha.
+#define ZONA_INICIO(zona) do { \
+        TRACE_INICIO(zona); \
+        watchdog_hw->scratch[SUPERVISOR_REG_TRILHA] = \
+            supervisor_trilha(watchdog_hw->scratch[SUPERVISOR_REG_TRILHA], (zona)); \
+    } while (0)
+
+// Gerente de energia: perfil inicial (opção ROVER_ENERGIA do CMake)
+#ifndef ENERGIA_PERFIL
+#define ENERGIA_PERFIL      "equilibrado"
+#endif
+#define BOOT_ESPERA_USB_MS  1000     // Espera máxima pelo terminal USB no boot
 
 // Configurações dos pinos para joystick analógico
 #define ADC_X_PIN  26  // Pino 26 para eixo X do joystick (ADC0)
@@ -69,29 +188,77 @@ const uint8_t SCL = 15;
 #define ESTADO_CONECTANDO 2
 #define ESTADO_CONFIGURANDO 3  //Estado para fase de configuração Wi-Fi
 
-// ====== ESTRUTURA PARA CONFIGURAÇÃO WI-FI ======
-typedef struct {
-    char ssid[32];
-    char password[64];
-    bool received;
-} wifi_config_t;
-
+// ====== CONFIGURAÇÃO WI-FI (wifi_config_t em lib/portal.h) ======
 wifi_config_t new_wifi_config = {0};
 
 // Variáveis globais para comunicação UDP
 static struct udp_pcb *pcb;
-static ip4_addr_t pc_addr;
+static ip_addr_t pc_addr;                  // Controlador travado
+static u16_t pc_port = PC_PORT;
+static bool controlador_travado = false;
+static uint32_t travado_em = 0;            // Instante do travamento (ms)
+static volatile bool rede_mudou = false;   // IP/enlace mudou (DHCP): redescobrir
+static char nome_host[16];                 // rover-XXXX (mDNS e DISCOVER)
+static uint32_t sessao_id;                 // Aleatório a cada boot; identifica a sessão no simulador
+static char sessao_token[PROTO_TOKEN_MAX]; // Do ACK; retoma a sessão e pede o rover (TAKE)
+static bool espectador = false;            // Outro controlador dirige o rover
+static volatile bool pedir_posse = false;  // Botão A como espectador: TAKE
 static uint32_t last_sent;
 static bool link_ok = false;
 static uint32_t last_rx = 0;
 static bool conexao_ok = false;
 
+// Qualidade do enlace (RTT, jitter, offset de relógio, perda)
+static link_stats_t link_stats;
+static uint32_t ping_seq = 0;
+static uint32_t last_ping = 0;
+
+// Métricas de execução (lib/metricas.h)
+static metricas_t metricas;
+static int32_t rssi_dbm = 0;               // Lido na tarefa_rssi (não nos callbacks de TCP)
+static uint32_t ultimo_cmd_us = 0;         // Envio do quadro anterior (0 = sem fluxo)
+static volatile uint32_t botao_us = 0;     // Toque ainda sem quadro (0 = nenhum)
+
+// Tarefas do async_context do cyw43 (rodam na IRQ do contexto, com a trava
+// do lwIP já tomada)
+static async_context_t *contexto;
+static async_at_time_worker_t tarefa_enlace;   // descoberta, HELLO, comandos, PING
+static async_at_time_worker_t tarefa_visual;   // fim da animação de captura
+static async_at_time_worker_t tarefa_rssi;
+#if ROVER_TRACE
+static async_at_time_worker_t tarefa_trace;
+#endif
+static async_when_pending_worker_t evento_enlace;  // roda o enlace já (RX, botão, DHCP)
+static uint32_t enlace_previsto_us;        // Instante agendado da tarefa do enlace
+static volatile bool display_pendente;     // Redesenho pedido ao laço principal (I2C)
+
+// Gerente de energia (lib/energia.h): a tarefa_energia decide o nível e
+// aplica rádio e LEDs; relógio e OLED são trocados no laço principal
+static energia_t energia;
+static async_at_time_worker_t tarefa_energia;     // amostra o joystick, conta a inatividade
+static async_when_pending_worker_t evento_energia; // borda de botão
+static volatile uint32_t despertar_us;     // Evento que tirou do OCIOSO/DORMINDO (0 = nenhum)
+static volatile bool energia_pendente;     // Relógio/OLED a trocar no laço principal
+static uint32_t clk_sys_khz;               // clk_sys em vigor
+static uint8_t contraste_oled = 0xFF;      // Contraste em vigor (0 = apagado)
+static uint8_t wifi_pm = 0xFF;             // energia_wifi_t em vigor (0xFF = nenhum ainda)
+static bool leds_acesos = true;
+static uint8_t cor_rgb[3];                 // Últimas cores pedidas, repostas ao acender
+static uint8_t cor_matriz[3];
+
 // Estado do rover
 static int rover_mode = 0;           // 0=Manual (fixo)
 static bool lights_on = false;
 static bool camera_on = false;
-static bool capture_active = false;  // Flag para captura de ponto
-static uint32_t capture_time = 0;    // Tempo de início da captura
+// Eventos de captura: cada toque no botão A incrementa capture_evt_seq, que é
+// repetido em todos os quadros até o simulador confirmá-lo com "evack="
+static volatile uint16_t capture_evt_seq = 0;
+static volatile uint16_t capture_evt_ack = 0;
+static uint16_t capture_evt_enviado = 0;   // Último evento já transmitido num quadro
+
+// Fluxo de comandos com redundância, enviado por evento e mudança (lib/controle.h)
+static cmd_stream_t cmd_stream;
+static controle_envio_t cmd_envio;
 
 // Variáveis para debounce de botões
 static uint32_t last_btn_capture_time = 0;
@@ -138,245 +305,471 @@ void ler_joystick(float *x, float *y);
 void gpio_callback(uint gpio, uint32_t events);
 static void rx_cb(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port);
 void enviar_hello(void);
-void enviar_comandos_rover(float joy_x, float joy_y);
+void enviar_descoberta(void);
+void reiniciar_descoberta(const char *motivo);
+void iniciar_mdns(void);
+void enviar_ping(void);
+static void enviar_mensagem(const char *msg);
+static void enviar_dados(const void *dados, size_t len);
+static controle_motivo_t enviar_comandos_rover(float joy_x, float joy_y, uint32_t now);
 void configurar_gpio(void);
-bool setup_wifi_portal(void);
+static void pedir_display(void);
+static void acordar_enlace(void);
+static void agendar(async_at_time_worker_t *tarefa, uint32_t ms);
+static void acordar_energia(void);
 static err_t tcp_server_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
 static err_t tcp_server_accept(void *arg, struct tcp_pcb *newpcb, err_t err);
 struct tcp_pcb* start_http_server(void);
-void parse_form_data(char* data, wifi_config_t* config);
-
-// ====== PÁGINAS HTML DO PORTAL DE CONFIGURAÇÃO ======
-// Página HTML do formulário de configuração
-const char* setup_html = 
-    "<!DOCTYPE html>"
-    "<html>"
-    "<head>"
-    "    <meta charset='UTF-8'>"
-    "    <meta name='viewport' content='width=device-width, initial-scale=1.0'>"
-    "    <title>Configuração Wi-Fi - Rover</title>"
-    "    <style>"
-    "        body { "
-    "            font-family: -apple-system, BlinkMacSystemFont, sans-serif; "
-    "            max-width: 500px; "
-    "            margin: 40px auto; "
-    "            padding: 20px; "
-    "            background-color: #f5f5f5; "
-    "        }"
-    "        .container { "
-    "            background: white; "
-    "            border-radius: 10px; "
-    "            padding: 30px; "
-    "            box-shadow: 0 2px 10px rgba(0,0,0,0.1); "
-    "        }"
-    "        h1 { "
-    "            text-align: center; "
-    "            color: #333; "
-    "            margin-bottom: 30px; "
-    "        }"
-    "        .form-group { "
-    "            margin-bottom: 20px; "
-    "        }"
-    "        label { "
-    "            display: block; "
-    "            margin-bottom: 5px; "
-    "            color: #555; "
-    "            font-weight: bold; "
-    "        }"
-    "        input[type='text'], input[type='password'] { "
-    "            width: 100%; "
-    "            padding: 10px; "
-    "            border: 1px solid #ddd; "
-    "            border-radius: 5px; "
-    "            box-sizing: border-box; "
-    "            font-size: 16px; "
-    "        }"
-    "        button { "
-    "            width: 100%; "
-    "            padding: 12px; "
-    "            background-color: #007AFF; "
-    "            color: white; "
-    "            border: none; "
-    "            border-radius: 5px; "
-    "            font-size: 16px; "
-    "            cursor: pointer; "
-    "            transition: background-color 0.3s; "
-    "        }"
-    "        button:hover { "
-    "            background-color: #0051D5; "
-    "        }"
-    "        .info { "
-    "            margin-top: 30px; "
-    "            text-align: center; "
-    "            color: #666; "
-    "            font-size: 14px; "
-    "        }"
-    "    </style>"
-    "</head>"
-    "<body>"
-    "    <div class='container'>"
-    "        <h1>Configuração Wi-Fi do Rover</h1>"
-    "        <form method='POST' action='/save'>"
-    "            <div class='form-group'>"
-    "                <label for='ssid'>Nome da Rede (SSID):</label>"
-    "                <input type='text' id='ssid' name='ssid' required>"
-    "            </div>"
-    "            <div class='form-group'>"
-    "                <label for='password'>Senha:</label>"
-    "                <input type='password' id='password' name='password' required>"
-    "            </div>"
-    "            <button type='submit'>Conectar</button>"
-    "        </form>"
-    "        <div class='info'>"
-    "            Após enviar, o rover tentará se conectar<br>"
-    "            à rede especificada e iniciará sua operação."
-    "        </div>"
-    "    </div>"
-    "</body>"
-    "</html>";
-
-// Página de confirmação após receber os dados
-const char* success_html = 
-    "<!DOCTYPE html>"
-    "<html>"
-    "<head>"
-    "    <meta charset='UTF-8'>"
-    "    <title>Configuração Enviada</title>"
-    "    <style>"
-    "        body { "
-    "            font-family: sans-serif; "
-    "            text-align: center; "
-    "            margin-top: 100px; "
-    "        }"
-    "        .success { "
-    "            color: #4CAF50; "
-    "            font-size: 24px; "
-    "            margin-bottom: 20px; "
-    "        }"
-    "    </style>"
-    "</head>"
-    "<body>"
-    "    <div class='success'>✓ Configuração Recebida!</div>"
-    "    <p>O rover agora tentará se conectar à sua rede.</p>"
-    "    <p>Esta página será fechada automaticamente...</p>"
-    "    <script>"
-    "        setTimeout(function() { window.close(); }, 5000);"
-    "    </script>"
-    "</body>"
-    "</html>";
+bool iniciar_servidor_status(void);
 
-// ====== FUNÇÕES DO PORTAL WI-FI ======
-// Função para fazer parse dos dados do formulário
-void parse_form_data(char* data, wifi_config_t* config) {
-    char* token;
-    char* temp_data = strdup(data);  // Cria uma cópia para parsing
-    
-    // Separa por '&' para obter cada campo
-    token = strtok(temp_data, "&");
-    
-    while (token != NULL) {
-        char* equal_pos = strchr(token, '=');
-        if (equal_pos != NULL) {
-            *equal_pos = '\0';  // Divide em nome e valor
-            char* name = token;
-            char* value = equal_pos + 1;
-            
-            // URL decode simples (substitui + por espaço)
-            char* pos = value;
-            while (*pos) {
-                if (*pos == '+') *pos = ' ';
-                pos++;
-            }
-            
-            // Armazena os valores na estrutura
-            if (strcmp(name, "ssid") == 0) {
-                strcpy(config->ssid, value);
-            } else if (strcmp(name, "password") == 0) {
-                strcpy(config->password, value);
-            }
+// ====== SUPERVISOR DE SAÚDE (lib/supervisor.h) ======
+// O laço principal, a tarefa do enlace e a leitura de RSSI batem a cada
+// passada; a tarefa_supervisor confere os prazos e só com todos em dia
+// alimenta o watchdog. Tarefa atrasada reinicia na hora, com o motivo no
+// scratch; o contexto inteiro parado (IRQ presa, trava esquecida) deixa o
+// watchdog vencer sozinho. O motivo do boot anterior vai para o log e para
+// o /status e o /metrics
+static supervisor_t supervisor;
+static async_at_time_worker_t tarefa_supervisor;
+static supervisor_falha_t reinicio;        // Motivo deste boot (registro do anterior)
+static uint32_t i2c_recuperacoes;
+static uint32_t i2c_recuperado_em;         // Última recuperação do barramento (ms)
+
+static void supervisor_gravar(const supervisor_falha_t *f) {
+    uint32_t reg[SUPERVISOR_REGISTROS];
+    supervisor_codificar(f, reg);
+    for (int i = 0; i < SUPERVISOR_REGISTROS; i++)
+        watchdog_hw->scratch[i] = reg[i];
+}
+
+// Lê e relata o registro do boot anterior e começa o deste
+static void supervisor_boot(void) {
+    uint32_t reg[SUPERVISOR_REGISTROS];
+    for (int i = 0; i < SUPERVISOR_REGISTROS; i++)
+        reg[i] = watchdog_hw->scratch[i];
+    supervisor_decodificar(reg, &reinicio);
+    supervisor_classificar(&reinicio, watchdog_caused_reboot());
+    
+    char texto[128];
+    supervisor_descrever(&reinicio, texto, sizeof(texto));
+    printf("Reinicio: %s\n", texto);
+    if (reinicio.motivo == SUPERVISOR_WATCHDOG || reinicio.motivo == SUPERVISOR_ATRASO)
+        RLOG(RLOG_ERRO, RLOG_SISTEMA, "reinicio por %s (tarefas 0x%x) apos %lu ms, trilha %08lx, %u seguido(s)",
+             RLOG_S(supervisor_nomes_motivo[reinicio.motivo]), reinicio.atrasadas,
+             reinicio.uptime_ms, reinicio.trilha, reinicio.reinicios);
+    
+    supervisor_falha_t atual = { .motivo = SUPERVISOR_EXECUTANDO, .reinicios = reinicio.reinicios };
+    supervisor_gravar(&atual);
+}
+
+#if ROVER_OTA
+// Reinício pedido (OTA): o próximo boot não conta como falha
+static void supervisor_reiniciar(void) {
+    supervisor_falha_t pedido = { .motivo = SUPERVISOR_PEDIDO };
+    supervisor_gravar(&pedido);
+    watchdog_reboot(0, 0, 0);
+}
+#endif
+
+static void supervisor_cb(async_context_t *ctx, async_at_time_worker_t *tarefa) {
+    uint32_t agora = to_ms_since_boot(get_absolute_time());
+    watchdog_hw->scratch[SUPERVISOR_REG_UPTIME] = agora;
+    
+    uint8_t atrasadas = supervisor_atrasadas(&supervisor, agora);
+    if (atrasadas) {
+        supervisor_falha_t f = {
+            .motivo = SUPERVISOR_ATRASO,
+            .atrasadas = atrasadas,
+            .reinicios = reinicio.reinicios,
+            .uptime_ms = agora,
+            .trilha = watchdog_hw->scratch[SUPERVISOR_REG_TRILHA],
+        };
+        supervisor_gravar(&f);
+        watchdog_reboot(0, 0, 0);
+        return;
+    }
+    watchdog_update();
+    agendar(tarefa, SUPERVISOR_INTERVALO_MS);
+}
+
+// Laço principal supervisionado desde já; o controle e a rede entram em
+// iniciar_tarefas
+static void iniciar_supervisor(void) {
+    supervisor_iniciar(&supervisor);
+    supervisor_registrar(&supervisor, SUPERVISOR_LACO, PRAZO_LACO_MS,
+                         to_ms_since_boot(get_absolute_time()));
+    watchdog_enable(WATCHDOG_MS, true);
+    cyw43_arch_lwip_begin();
+    tarefa_supervisor.do_work = supervisor_cb;
+    agendar(&tarefa_supervisor, SUPERVISOR_INTERVALO_MS);
+    cyw43_arch_lwip_end();
+}
+
+// ====== VARREDURA DE REDES ======
+// O cyw43 varre em segundo plano (com o AP no ar, o rádio volta ao canal do
+// AP entre os canais varridos) e entrega um resultado por BSSID na IRQ; a
+// tabela nova só substitui a publicada quando a varredura termina, o que
+// quem a pediu percebe por cyw43_wifi_scan_active(). A publicada serve o
+// /redes.json do portal e a escolha da rede conhecida (boot e roaming)
+#define VARREDURA_VALIDADE_MS  30000   // /redes.json com tabela mais velha pede outra
+#define VARREDURA_MIN_MS       5000    // "Atualizar" não varre mais que isto
+
+static redes_t redes;                  // última varredura completa
+static redes_t redes_novas;            // enchida pelo callback do cyw43
+static bool varrendo;
+static volatile bool varredura_pedida = true;
+static uint32_t varredura_ms;          // fim da última varredura
+
+static int varredura_resultado(void *env, const cyw43_ev_scan_result_t *r) {
+    redes_adicionar(&redes_novas, r->ssid, r->ssid_len, r->bssid, r->rssi, (uint8_t)r->channel, r->auth_mode);
+    return 0;
+}
+
+// Começa uma varredura (com a trava); false se o cyw43 recusou
+static bool varredura_iniciar(void) {
+    cyw43_wifi_scan_options_t opcoes = {0};
+    redes_limpar(&redes_novas);
+    int e = cyw43_wifi_scan(&cyw43_state, &opcoes, NULL, varredura_resultado);
+    if (e) {
+        RLOG(RLOG_AVISO, RLOG_REDE, "varredura recusada (%d)", e);
+        return false;
+    }
+    varrendo = true;
+    return true;
+}
+
+// Publica a varredura que acabou de terminar (com a trava); false enquanto
+// ela corre ou se não havia nenhuma
+static bool varredura_concluir(void) {
+    if (!varrendo || cyw43_wifi_scan_active(&cyw43_state))
+        return false;
+    redes = redes_novas;
+    varrendo = false;
+    varredura_ms = to_ms_since_boot(get_absolute_time());
+    RLOG(RLOG_INFO, RLOG_REDE, "varredura: %u redes", redes.n);
+    return true;
+}
+
+// GET /redes.json: a tabela atual; velha (ou "?varrer" com folga) pede outra
+static size_t varredura_json(const char *requisicao, char *buf, size_t tam) {
+    uint32_t idade = to_ms_since_boot(get_absolute_time()) - varredura_ms;
+    bool forcar = strncmp(requisicao, "GET /redes.json?varrer", 22) == 0;
+    if (!varrendo && (idade >= VARREDURA_VALIDADE_MS || (forcar && idade >= VARREDURA_MIN_MS))) {
+        varredura_pedida = true;
+        __sev();
+    }
+    // Sem espaço (SSIDs cheios de escapes) saem as redes mais fracas
+    redes_t copia = redes;
+    size_t n;
+    while (!(n = redes_json(&copia, varrendo || varredura_pedida, idade, buf, tam)) && copia.n)
+        copia.n--;
+    return n;
+}
+
+// Autenticação do cyw43 para a segurança vista na varredura
+static uint32_t varredura_autenticacao(uint8_t seguranca) {
+    if ((seguranca & REDES_WPA2) && (seguranca & REDES_WPA))
+        return CYW43_AUTH_WPA2_MIXED_PSK;
+    if (seguranca & REDES_WPA2)
+        return CYW43_AUTH_WPA2_AES_PSK;
+    if (seguranca & REDES_WPA)
+        return CYW43_AUTH_WPA_TKIP_PSK;
+    return seguranca ? CYW43_AUTH_WPA2_AES_PSK : CYW43_AUTH_OPEN;   // WEP: o cyw43 não tem
+}
+
+// ====== REDES CONHECIDAS E ROAMING (lib/credenciais.h) ======
+// No boot, uma varredura escolhe a melhor rede conhecida no ar (estados
+// VARRENDO e CONHECIDA do provisionamento, mais abaixo). Em operação
+// a tarefa_roaming acompanha o enlace e a média do RSSI: na queda, varre e
+// conecta à melhor candidata; com sinal fraco, varre e troca de AP (ou de
+// rede) só se a candidata ganhar por ROAMING_HISTERESE_DB
+#define ROAMING_INTERVALO_MS   1000
+#define ROAMING_LIMIAR_DBM     (-72)   // Média abaixo disto: procura AP melhor
+#define ROAMING_HISTERESE_DB   8
+#define ROAMING_ESPERA_MS      60000   // Entre varreduras por sinal fraco
+#define ROAMING_REPETIR_MS     10000   // Sem rede conhecida no ar: varre de novo
+#define ROAMING_VARREDURA_MS   10000   // Varredura que não termina
+#define ROAMING_ASSOCIAR_MS    15000
+
+typedef enum {
+    ROAMING_CONECTADO,
+    ROAMING_VARRENDO,
+    ROAMING_ASSOCIANDO,
+    ROAMING_ESPERANDO,
+} roaming_estado_t;
+
+static credenciais_t credenciais;
+static int8_t rede_atual = -1;                 // Credencial conectada
+static uint8_t bssid_atual[6];
+static async_at_time_worker_t tarefa_roaming;
+static roaming_estado_t roaming_estado;
+static uint32_t roaming_desde;                 // Entrada no estado atual
+static uint32_t roaming_ultima_varredura;
+static bool roaming_queda;                     // Varredura pela queda do enlace
+static int32_t rssi_media;                     // Média móvel (1/4) do RSSI
+static credencial_candidata_t candidatas[CREDENCIAIS_MAX];
+static uint8_t n_candidatas, candidata_atual;
+
+static const char *credencial_senha(const credencial_t *cr) {
+    return cr->seguranca ? cr->senha : NULL;
+}
+
+// Grava a lista com o XIP parado (flash_safe_execute)
+static void credenciais_gravar_cb(void *param) {
+    credenciais_gravar(param);
+}
+
+static void roaming_mudar(roaming_estado_t estado, uint32_t agora) {
+    roaming_estado = estado;
+    roaming_desde = agora;
+}
+
+static void roaming_varrer(uint32_t agora) {
+    roaming_ultima_varredura = agora;
+    if (varredura_iniciar())
+        roaming_mudar(ROAMING_VARRENDO, agora);
+    else
+        roaming_mudar(roaming_queda ? ROAMING_ESPERANDO : ROAMING_CONECTADO, agora);
+}
+
+// Associação assíncrona à candidata `i` (deixa a rede atual antes)
+static void roaming_associar(uint8_t i, uint32_t agora) {
+    const credencial_t *cr = &credenciais.c[candidatas[i].credencial];
+    const rede_t *rede = &redes.r[candidatas[i].rede];
+    candidata_atual = i;
+    RLOG(RLOG_INFO, RLOG_REDE, "associando a %s (%d dBm, %d pontos)",
+         RLOG_S(cr->ssid), rede->rssi, candidatas[i].pontos);
+    cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+    cyw43_arch_wifi_connect_bssid_async(cr->ssid, rede->bssid, credencial_senha(cr),
+                                        varredura_autenticacao(cr->seguranca));
+    roaming_mudar(ROAMING_ASSOCIANDO, agora);
+}
+
+// Varredura pronta: na queda, a melhor candidata; com sinal fraco, só se
+// ela ganhar da atual pela histerese (e for outro AP)
+static void roaming_avaliar(uint32_t agora) {
+    n_candidatas = (uint8_t)credenciais_candidatas(&credenciais, &redes, candidatas, CREDENCIAIS_MAX);
+    if (!n_candidatas) {
+        RLOG(RLOG_AVISO, RLOG_REDE, "nenhuma rede conhecida no ar (%u vistas)", redes.n);
+        roaming_mudar(roaming_queda ? ROAMING_ESPERANDO : ROAMING_CONECTADO, agora);
+        return;
+    }
+    if (!roaming_queda && rede_atual >= 0) {
+        const rede_t *melhor = &redes.r[candidatas[0].rede];
+        int16_t atual = credenciais_pontos(&credenciais.c[rede_atual], (int16_t)rssi_media);
+        if (candidatas[0].pontos < atual + ROAMING_HISTERESE_DB ||
+            memcmp(melhor->bssid, bssid_atual, sizeof(bssid_atual)) == 0) {
+            RLOG(RLOG_DEBUG, RLOG_REDE, "fica no AP atual (%d pontos, melhor %d)", atual, candidatas[0].pontos);
+            roaming_mudar(ROAMING_CONECTADO, agora);
+            return;
         }
-        token = strtok(NULL, "&");
     }
-    
-    free(temp_data);
-    config->received = true;
+    roaming_associar(0, agora);
+}
+
+static void roaming_cb(async_context_t *ctx, async_at_time_worker_t *tarefa) {
+    uint32_t agora = to_ms_since_boot(get_absolute_time());
+    int enlace = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+    
+    switch (roaming_estado) {
+    case ROAMING_CONECTADO:
+        // JOIN/NOIP: o próprio cyw43 está reassociando; só DOWN e erros contam
+        if (enlace <= CYW43_LINK_DOWN) {
+            RLOG(RLOG_AVISO, RLOG_REDE, "enlace Wi-Fi caiu (%d); procurando rede conhecida", enlace);
+            rede_atual = -1;
+            roaming_queda = true;
+            roaming_varrer(agora);
+            break;
+        }
+        rssi_media = (3 * rssi_media + rssi_dbm) / 4;
+        if (rssi_media < ROAMING_LIMIAR_DBM && credenciais.n &&
+            agora - roaming_ultima_varredura >= ROAMING_ESPERA_MS) {
+            RLOG(RLOG_INFO, RLOG_REDE, "sinal fraco (%ld dBm); procurando AP melhor", rssi_media);
+            roaming_queda = false;
+            roaming_varrer(agora);
+        }
+        break;
+        
+    case ROAMING_VARRENDO:
+        if (varredura_concluir())
+            roaming_avaliar(agora);
+        else if (agora - roaming_desde > ROAMING_VARREDURA_MS)
+            roaming_mudar(roaming_queda ? ROAMING_ESPERANDO : ROAMING_CONECTADO, agora);
+        break;
+        
+    case ROAMING_ASSOCIANDO:
+        if (enlace == CYW43_LINK_UP) {
+            const credencial_candidata_t *c = &candidatas[candidata_atual];
+            rede_atual = (int8_t)c->credencial;
+            credenciais_usar(&credenciais, (uint8_t)rede_atual);
+            memcpy(bssid_atual, redes.r[c->rede].bssid, sizeof(bssid_atual));
+            rssi_media = redes.r[c->rede].rssi;
+            RLOG(RLOG_INFO, RLOG_REDE, "conectado a %s", RLOG_S(credenciais.c[rede_atual].ssid));
+            // O IP pode não mudar (mesma rede, outro AP): redescobre assim mesmo
+            rede_mudou = true;
+            acordar_enlace();
+            roaming_mudar(ROAMING_CONECTADO, agora);
+        } else if (enlace < 0 || agora - roaming_desde > ROAMING_ASSOCIAR_MS) {
+            RLOG(RLOG_AVISO, RLOG_REDE, "falha ao associar (%d)", enlace);
+            if (candidata_atual + 1 < n_candidatas)
+                roaming_associar(candidata_atual + 1, agora);
+            else
+                roaming_mudar(ROAMING_ESPERANDO, agora);
+        }
+        break;
+        
+    case ROAMING_ESPERANDO:
+        if (agora - roaming_desde >= ROAMING_REPETIR_MS) {
+            roaming_queda = true;
+            roaming_varrer(agora);
+        }
+        break;
+    }
+    agendar(tarefa, ROAMING_INTERVALO_MS);
+}
+
+// ====== FUNÇÕES DO PORTAL WI-FI ======
+// O portal só aceita o formulário no estado AGUARDANDO do provisionamento.
+// A conexão que leva a página de sucesso fica aberta até o navegador
+// confirmar todos os bytes: só então o provisionamento derruba o AP
+static provisao_t provisao;
+static volatile bool provisao_botao;       // Botão A durante o provisionamento
+static struct tcp_pcb *portal_sucesso;     // Conexão com a página de sucesso a confirmar
+static u16_t portal_a_entregar;            // Bytes dela ainda sem ACK
+static volatile bool portal_entregue;      // Página de sucesso entregue (ou conexão perdida)
+
+static void portal_concluir_entrega(void) {
+    portal_sucesso = NULL;
+    portal_entregue = true;
+    __sev();
+}
+
+static err_t portal_sent(void *arg, struct tcp_pcb *tpcb, u16_t len) {
+    portal_a_entregar = len < portal_a_entregar ? portal_a_entregar - len : 0;
+    if (!portal_a_entregar) {
+        tcp_sent(tpcb, NULL);
+        tcp_err(tpcb, NULL);
+        tcp_close(tpcb);
+        portal_concluir_entrega();
+    }
+    return ERR_OK;
+}
+
+// Conexão resetada: o pcb já não existe, não há mais o que esperar
+static void portal_err(void *arg, err_t err) {
+    portal_concluir_entrega();
 }
 
-// Callback para processar requisições HTTP
+// Callback para processar requisições HTTP. As páginas vêm da flash
+// (lib/portal.h): só os cabeçalhos são copiados, o corpo vai por referência
 static err_t tcp_server_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
     if (!p) {
+        // FIN do navegador antes dos ACKs: ele já leu a página
+        if (tpcb == portal_sucesso) {
+            tcp_sent(tpcb, NULL);
+            tcp_err(tpcb, NULL);
+            portal_concluir_entrega();
+        }
         tcp_close(tpcb);
         return ERR_OK;
     }
+    ZONA_INICIO(TRACE_HTTP);
     
     // Confirma o recebimento dos dados
-    tcp_recved(tpcb, p->len);
+    tcp_recved(tpcb, p->tot_len);
     
     // Converte os dados recebidos em string
     char request[1024];
-    strncpy(request, (char*)p->payload, p->tot_len < 1024 ? p->tot_len : 1023);
-    request[p->tot_len < 1024 ? p->tot_len : 1023] = '\0';
-    
-    printf("=== Requisição Recebida ===\n%s\n", request);
-    
-    char response[4096];
+    u16_t n = pbuf_copy_partial(p, request, sizeof(request) - 1, 0);
+    request[n] = '\0';
+    
+    RLOG(RLOG_DEBUG, RLOG_PORTAL, "requisicao de %u B", p->tot_len);
+    
+    // Lista de redes da varredura (JSON gerado na hora, sem cache)
+    if (strncmp(request, "GET /redes.json", 15) == 0) {
+        char json[1536];
+        char cabecalho[160];
+        size_t tam_json = varredura_json(request, json, sizeof(json));
+        int tam = snprintf(cabecalho, sizeof(cabecalho),
+                           "HTTP/1.1 200 OK\r\n"
+                           "Content-Type: application/json\r\n"
+                           "Content-Length: %u\r\n"
+                           "Cache-Control: no-store\r\n"
+                           "Connection: close\r\n"
+                           "\r\n", (unsigned)tam_json);
+        if (tcp_write(tpcb, cabecalho, (u16_t)tam, TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE) != ERR_OK ||
+            tcp_write(tpcb, json, (u16_t)tam_json, TCP_WRITE_FLAG_COPY) != ERR_OK)
+            RLOG(RLOG_AVISO, RLOG_PORTAL, "resposta descartada: sem memoria no lwIP");
+        tcp_output(tpcb);
+        pbuf_free(p);
+        tcp_close(tpcb);
+        TRACE_FIM(TRACE_HTTP);
+        return ERR_OK;
+    }
     
-    // Verifica se é uma requisição POST para /save
-    if (strncmp(request, "POST /save", 10) == 0) {
-        printf("Processando dados do formulário...\n");
+    // Formulário enviado: página de sucesso (nunca em cache); qualquer outro
+    // pedido, inclusive as sondas de portal cativo, recebe o formulário
+    const portal_asset_t *pagina = &portal_pagina_setup;
+    bool cache = true;
+    bool sucesso = false;
+    if (strncmp(request, "POST /save", 10) == 0 &&
+        provisao.estado == PROVISAO_AGUARDANDO && !new_wifi_config.received) {
+        RLOG(RLOG_DEBUG, RLOG_PORTAL, "processando dados do formulario");
         
         // Encontra o corpo da requisição (após duas quebras de linha)
         char* body = strstr(request, "\r\n\r\n");
         if (body) {
             body += 4;  // Pula as quebras de linha
-            parse_form_data(body, &new_wifi_config);
+            portal_parse_form(body, &new_wifi_config);
             
-            printf("SSID recebido: %s\n", new_wifi_config.ssid);
-            printf("Senha recebida: %s\n", new_wifi_config.password);
+            RLOG(RLOG_INFO, RLOG_PORTAL, "SSID recebido: %s", RLOG_S(new_wifi_config.ssid));
+            RLOG(RLOG_INFO, RLOG_PORTAL, "senha recebida: %s", RLOG_SEGREDO(new_wifi_config.password));
+            __sev();   // O laço principal passa o provisionamento a ESCOANDO
             
-            // Responde com página de sucesso
-            sprintf(response,
-                "HTTP/1.1 200 OK\r\n"
-                "Content-Type: text/html\r\n"
-                "Content-Length: %d\r\n"
-                "Connection: close\r\n"
-                "\r\n"
-                "%s",
-                strlen(success_html),
-                success_html
-            );
+            pagina = &portal_pagina_sucesso;
+            cache = false;
+            sucesso = true;
         }
     }
-    else {
-        // Responde com o formulário HTML
-        sprintf(response,
-            "HTTP/1.1 200 OK\r\n"
-            "Content-Type: text/html\r\n"
-            "Content-Length: %d\r\n"
-            "Connection: close\r\n"
-            "\r\n"
-            "%s",
-            strlen(setup_html),
-            setup_html
-        );
-    }
-    
-    // Envia a resposta
-    tcp_write(tpcb, response, strlen(response), TCP_WRITE_FLAG_COPY);
+    
+    char cabecalho[256];
+    const uint8_t *corpo;
+    size_t tam_corpo;
+    size_t tam = portal_resposta(cabecalho, sizeof(cabecalho), pagina, request, cache, &corpo, &tam_corpo);
+    
+    // Envia a resposta (ERR_MEM: heap ou segmentos do lwIP esgotados)
+    err_t e = tcp_write(tpcb, cabecalho, (u16_t)tam, TCP_WRITE_FLAG_COPY | (tam_corpo ? TCP_WRITE_FLAG_MORE : 0));
+    if (e == ERR_OK && tam_corpo)
+        e = tcp_write(tpcb, corpo, (u16_t)tam_corpo, 0);
+    if (e != ERR_OK)
+        RLOG(RLOG_AVISO, RLOG_PORTAL, "resposta descartada: sem memoria no lwIP");
+    else
+        RLOG(RLOG_DEBUG, RLOG_PORTAL, "resposta de %u B (%u de corpo)",
+             (unsigned)(tam + tam_corpo), (unsigned)tam_corpo);
     tcp_output(tpcb);
     
     // Libera o buffer
     pbuf_free(p);
     
-    // Fecha a conexão
-    tcp_close(tpcb);
+    // A página de sucesso fecha a conexão no último ACK; as outras já
+    if (sucesso && e == ERR_OK) {
+        portal_sucesso = tpcb;
+        portal_a_entregar = (u16_t)(tam + tam_corpo);
+        tcp_sent(tpcb, portal_sent);
+        tcp_err(tpcb, portal_err);
+    } else {
+        if (sucesso)
+            portal_concluir_entrega();
+        tcp_close(tpcb);
+    }
     
+    TRACE_FIM(TRACE_HTTP);
     return ERR_OK;
 }
 
 // Callback para aceitar novas conexões
 static err_t tcp_server_accept(void *arg, struct tcp_pcb *newpcb, err_t err) {
-    printf("Nova conexão HTTP estabelecida!\n");
+    RLOG(RLOG_DEBUG, RLOG_PORTAL, "nova conexao HTTP");
     tcp_recv(newpcb, tcp_server_recv);
     return ERR_OK;
 }
@@ -405,335 +798,1777 @@ struct tcp_pcb* start_http_server(void) {
     return server_pcb;
 }
 
-void inicializar_display() {
-    // Inicialização do I2C 
-    i2c_init(I2C_PORT, 400 * 1000);
-    gpio_set_function(SDA, GPIO_FUNC_I2C);
-    gpio_set_function(SCL, GPIO_FUNC_I2C);
-    gpio_pull_up(SDA);
-    gpio_pull_up(SCL);
-    
-    // Inicialização do display usando a biblioteca ssd1306
-    ssd1306_init(&display, SSD1306_WIDTH, SSD1306_HEIGHT, false, I2C_ADDR, I2C_PORT);
-    ssd1306_config(&display);
-    ssd1306_fill(&display, 0);
-    
-    // Tela de boas-vindas
-    ssd1306_draw_string(&display, "Rover Controller", 10, 5);
-    ssd1306_draw_string(&display, "BitDogLab", 25, 25);
-    ssd1306_draw_string(&display, "Inicializando...", 10, 45);
-    ssd1306_send_data(&display);
-}
+// ====== PROVISIONAMENTO (lib/provisao.h) ======
+// A máquina de estados anda no laço principal, com a trava: trocar o modo
+// do cyw43, subir o servidor do portal e gravar a rede na flash bloqueiam
+// por alguns ms, mas nenhum passo espera a rede. O que chega nas IRQs
+// (formulário, entrega da resposta, botão) só marca um aviso e acorda o
+// laço; enlace e varredura são consultados a cada passada. Display, LEDs e
+// botões seguem vivos o tempo todo, e as falhas reabrem o portal sozinhas.
+#define PORTAL_SSID   "Rover-Setup"
+#define PORTAL_SENHA  "roverpass"
 
-void inicializar_led_rgb() {
-    gpio_set_function(R_LED_PIN, GPIO_FUNC_PWM);
-    gpio_set_function(B_LED_PIN, GPIO_FUNC_PWM);
-    
-    uint slice_r = pwm_gpio_to_slice_num(R_LED_PIN);
-    uint slice_b = pwm_gpio_to_slice_num(B_LED_PIN);
+static struct tcp_pcb *servidor_portal;
+static rede_t rede_formulario;             // Rede do formulário como vista na varredura
+static bool rede_formulario_vista;         // false: rede oculta ou SSID digitado
+
+// AP, IP fixo e servidor do portal; false se o servidor não subiu
+static bool portal_abrir(void) {
+    cyw43_arch_disable_sta_mode();
+    cyw43_arch_enable_ap_mode(PORTAL_SSID, PORTAL_SENHA, CYW43_AUTH_WPA2_AES_PSK);
     
-    pwm_set_wrap(slice_r, PWM_WRAP);
-    pwm_set_clkdiv(slice_r, 125.0f);
-    pwm_set_enabled(slice_r, true);
+    // Configuração de IP para o AP
+    ip4_addr_t ip, netmask, gateway;
+    IP4_ADDR(&ip, 192, 168, 4, 1);
+    IP4_ADDR(&netmask, 255, 255, 255, 0);
+    IP4_ADDR(&gateway, 192, 168, 4, 1);
+    netif_set_addr(netif_default, &ip, &netmask, &gateway);
     
-    if (slice_b != slice_r) {
-        pwm_set_wrap(slice_b, PWM_WRAP);
-        pwm_set_clkdiv(slice_b, 125.0f);
-        pwm_set_enabled(slice_b, true);
+    servidor_portal = start_http_server();
+    if (!servidor_portal) {
+        cyw43_arch_disable_ap_mode();
+        return false;
     }
     
-    // LED Verde como saída digital 
-    gpio_init(G_LED_PIN);
-    gpio_set_dir(G_LED_PIN, GPIO_OUT);
+    // Prioridade da rede nova quando o formulário não traz uma
+    new_wifi_config.received = false;
+    new_wifi_config.prioridade = CREDENCIAIS_PRIO_PADRAO;
+    portal_entregue = false;
+    varredura_pedida = true;
+    
+    printf("✓ Access Point %s (senha %s), portal em http://%s\n",
+           PORTAL_SSID, PORTAL_SENHA, ip4addr_ntoa(&ip));
+    return true;
 }
 
-void definir_cor_rgb(uint8_t r, uint8_t g, uint8_t b) {
-    pwm_set_chan_level(pwm_gpio_to_slice_num(R_LED_PIN), pwm_gpio_to_channel(R_LED_PIN), r);
-    gpio_put(G_LED_PIN, g > 10); // Digital on/off baseado na intensidade
-    pwm_set_chan_level(pwm_gpio_to_slice_num(B_LED_PIN), pwm_gpio_to_channel(B_LED_PIN), b);
+// Fecha o portal e passa o rádio a cliente
+static void portal_fechar(void) {
+    if (servidor_portal) {
+        tcp_close(servidor_portal);
+        servidor_portal = NULL;
+    }
+    cyw43_arch_disable_ap_mode();
+    cyw43_arch_enable_sta_mode();
+    printf("✓ Modo AP desativado, modo cliente ativado\n");
 }
 
-// Função auxiliar para formatar cores para a matriz de LEDs
-static inline uint32_t urgb_u32(uint8_t r, uint8_t g, uint8_t b) {
-    return ((uint32_t)r << 8) | ((uint32_t)g << 16) | (uint32_t)b;
+// Associação assíncrona à candidata conhecida da vez
+static bool provisao_conhecida(uint32_t agora) {
+    const credencial_candidata_t *c = &candidatas[provisao.tentativa];
+    const credencial_t *cr = &credenciais.c[c->credencial];
+    const rede_t *rede = &redes.r[c->rede];
+    printf("Tentando %s (%d dBm, prioridade %u)\n", cr->ssid, rede->rssi, cr->prioridade);
+    if (provisao.tentativa)
+        cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+    if (cyw43_arch_wifi_connect_bssid_async(cr->ssid, rede->bssid, credencial_senha(cr),
+                                            varredura_autenticacao(cr->seguranca)))
+        return provisao_evento(&provisao, PROVISAO_EV_ENLACE_FALHA, agora);
+    return false;
 }
 
-// Função auxiliar para enviar um pixel para a matriz
-static inline void enviar_pixel(uint32_t pixel_grb) {
-    pio_sm_put_blocking(pio0, 0, pixel_grb << 8u);
+// Associação assíncrona à rede do formulário; na primeira tentativa o
+// portal fecha e a segurança vista na varredura escolhe a autenticação
+static bool provisao_associar(uint32_t agora) {
+    if (!provisao.tentativa) {
+        portal_fechar();
+        const rede_t *rede = redes_buscar(&redes, new_wifi_config.ssid);
+        rede_formulario_vista = rede != NULL;
+        if (rede) {
+            rede_formulario = *rede;
+            printf("Rede vista: canal %u, %d dBm, %s\n", rede->canal, rede->rssi,
+                   redes_seguranca_nome(rede->seguranca));
+        } else if (redes.n) {
+            // Fora da varredura (rede oculta ou SSID digitado): WPA2 como antes
+            RLOG(RLOG_AVISO, RLOG_PORTAL, "SSID fora da varredura (%u redes); tentando WPA2", redes.n);
+        }
+    } else {
+        printf("Tentativa %u falhou. Tentando novamente...\n", provisao.tentativa);
+        cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
+    }
+    
+    uint32_t autenticacao = rede_formulario_vista ? varredura_autenticacao(rede_formulario.seguranca)
+                                                  : CYW43_AUTH_WPA2_AES_PSK;
+    printf("Conectando a %s (tentativa %u/%u)\n", new_wifi_config.ssid,
+           provisao.tentativa + 1, PROVISAO_TENTATIVAS);
+    if (cyw43_arch_wifi_connect_async(new_wifi_config.ssid,
+                                      autenticacao == CYW43_AUTH_OPEN ? NULL : new_wifi_config.password,
+                                      autenticacao))
+        return provisao_evento(&provisao, PROVISAO_EV_ENLACE_FALHA, agora);
+    return false;
 }
 
-// Define os LEDs da matriz com base no buffer
-void definir_leds(uint8_t r, uint8_t g, uint8_t b) {
-    uint32_t cor = urgb_u32(r, g, b);
-    for (int i = 0; i < NUM_PIXELS; i++) {
-        if (buffer_leds[i])
-            enviar_pixel(cor);
-        else
-            enviar_pixel(0);
+// Enlace com IP: a rede do formulário entra (ou é atualizada) na lista da
+// flash, a conhecida vira a rede atual do roaming, e as duas contam um uso.
+// A lista é gravada uma vez por boot; os usos do roaming vão junto
+static void provisao_verificar(void) {
+    if (provisao.conhecida) {
+        const credencial_candidata_t *c = &candidatas[provisao.tentativa];
+        rede_atual = (int8_t)c->credencial;
+        memcpy(bssid_atual, redes.r[c->rede].bssid, sizeof(bssid_atual));
+        rssi_media = redes.r[c->rede].rssi;
+    } else {
+        uint8_t seguranca = rede_formulario_vista ? rede_formulario.seguranca
+                          : new_wifi_config.password[0] ? REDES_WPA2 : 0;
+        credenciais_salvar(&credenciais, new_wifi_config.ssid, new_wifi_config.password,
+                           seguranca, new_wifi_config.prioridade);
+        rede_atual = (int8_t)(credenciais_buscar(&credenciais, new_wifi_config.ssid) - credenciais.c);
+        cyw43_wifi_get_bssid(&cyw43_state, bssid_atual);
+        rssi_media = rede_formulario_vista ? rede_formulario.rssi : 0;
     }
-    sleep_us(60);
+    credenciais_usar(&credenciais, (uint8_t)rede_atual);
+    int r = flash_safe_execute(credenciais_gravar_cb, &credenciais, UINT32_MAX);
+    if (r != PICO_OK)
+        printf("Rede não salva na flash (%d)\n", r);
+    printf("\n✓ CONECTADO A %s, IP %s\n", credenciais.c[rede_atual].ssid,
+           ipaddr_ntoa(&cyw43_state.netif[0].ip_addr));
 }
 
-// Atualiza o buffer com um padrão específico
-void atualizar_buffer_matriz(const bool padrao[5][5]) {
-    for (int linha = 0; linha < 5; linha++) {
-        for (int coluna = 0; coluna < 5; coluna++) {
-            int indice = linha * 5 + coluna;
-            buffer_leds[indice] = padrao[linha][coluna];
-        }
+// Entrada no estado atual; retorna true se ela mesma causou outra
+// transição (servidor que não subiu, associação recusada na hora)
+static bool provisao_entrar(uint32_t agora) {
+    RLOG(RLOG_INFO, RLOG_REDE, "provisionamento: %s", RLOG_S(provisao_nomes_estado[provisao.estado]));
+    pedir_display();
+    
+    switch (provisao.estado) {
+    case PROVISAO_VARRENDO:
+        printf("\n=== Redes conhecidas: %u ===\n", credenciais.n);
+        cyw43_arch_enable_sta_mode();
+        if (!varredura_iniciar())
+            return provisao_varredura(&provisao, 0, agora);
+        break;
+        
+    case PROVISAO_CONHECIDA:
+        return provisao_conhecida(agora);
+        
+    case PROVISAO_AP_SUBINDO:
+        printf("\n=== PORTAL DE CONFIGURAÇÃO WI-FI DO ROVER ===\n");
+        // Matriz de LEDs em modo configuração (azul claro)
+        atualizar_buffer_matriz(padrao_normal);
+        definir_leds(0, 150, 255);
+        return provisao_evento(&provisao, portal_abrir() ? PROVISAO_EV_AP_PRONTO : PROVISAO_EV_AP_FALHA, agora);
+        
+    case PROVISAO_AGUARDANDO:
+        printf("1. Conecte seu dispositivo ao Wi-Fi: %s\n", PORTAL_SSID);
+        printf("2. Abra o navegador e acesse: http://192.168.4.1\n");
+        printf("3. Insira as credenciais da sua rede\n");
+        break;
+        
+    case PROVISAO_ESCOANDO:
+        printf("\n=== Credenciais Recebidas! ===\n");
+        printf("SSID: %s\n", new_wifi_config.ssid);
+        break;
+        
+    case PROVISAO_ASSOCIANDO:
+        definir_leds(150, 150, 0);   // Amarelo: associando
+        return provisao_associar(agora);
+        
+    case PROVISAO_VERIFICADO:
+        provisao_verificar();
+        definir_leds(0, 150, 0);
+        break;
+        
+    case PROVISAO_FALHA_AP:
+        printf("❌ Erro ao iniciar o portal; nova tentativa em %u s\n", PROVISAO_FALHA_MS / 1000);
+        definir_leds(150, 0, 0);
+        break;
+        
+    case PROVISAO_FALHA_REDE:
+        printf("\n❌ Não foi possível conectar após %u tentativas\n", PROVISAO_TENTATIVAS);
+        printf("Verifique as credenciais: o portal reabre em %u s (ou com o botão A)\n",
+               PROVISAO_FALHA_MS / 1000);
+        cyw43_arch_disable_sta_mode();
+        // Apaga a matriz até o portal voltar
+        memset(buffer_leds, 0, sizeof(buffer_leds));
+        definir_leds(0, 0, 0);
+        break;
+        
+    default:
+        break;
     }
+    return false;
 }
 
-void inicializar_matriz_leds() {
-    PIO pio = pio0;
-    uint sm = 0;
-    uint offset = pio_add_program(pio, &ws2812_program);
-    ws2812_program_init(pio, sm, offset, WS2812_PIN, 800000, IS_RGBW);
-    
-    // Efeito de inicialização
-    for (int i = 0; i < NUM_PIXELS; i++) {
-        buffer_leds[i] = true;
-        definir_leds(20, 20, 20);
-        sleep_ms(20);
+// Uma passada no laço principal: avisos das IRQs, enlace, varredura e prazos
+static void provisao_processar(void) {
+    uint32_t agora = to_ms_since_boot(get_absolute_time());
+    bool mudou = false;
+    
+    cyw43_arch_lwip_begin();
+    if (provisao_botao) {
+        provisao_botao = false;
+        mudou = provisao_evento(&provisao, PROVISAO_EV_BOTAO, agora);
     }
     
-    for (int i = 0; i < NUM_PIXELS; i++) {
-        buffer_leds[i] = false;
-        definir_leds(0, 0, 0);
-        sleep_ms(20);
+    if (!mudou) {
+        switch (provisao.estado) {
+        case PROVISAO_VARRENDO:
+            if (varredura_concluir()) {
+                n_candidatas = (uint8_t)credenciais_candidatas(&credenciais, &redes, candidatas, CREDENCIAIS_MAX);
+                if (!n_candidatas)
+                    printf("Nenhuma rede conhecida no ar; abrindo o portal\n");
+                mudou = provisao_varredura(&provisao, n_candidatas, agora);
+            }
+            break;
+            
+        case PROVISAO_CONHECIDA:
+        case PROVISAO_ASSOCIANDO: {
+            // JOIN/NOIP: ainda associando ou esperando o DHCP
+            int enlace = cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA);
+            if (enlace == CYW43_LINK_UP) {
+                mudou = provisao_evento(&provisao, PROVISAO_EV_ENLACE, agora);
+            } else if (enlace < 0) {
+                RLOG(RLOG_AVISO, RLOG_REDE, "falha ao associar (%d)", enlace);
+                mudou = provisao_evento(&provisao, PROVISAO_EV_ENLACE_FALHA, agora);
+            }
+            break;
+        }
+            
+        case PROVISAO_AGUARDANDO:
+            // Varreduras pedidas pelo /redes.json enquanto o portal espera
+            varredura_concluir();
+            if (!varrendo && varredura_pedida) {
+                varredura_pedida = false;
+                varredura_iniciar();
+            }
+            if (new_wifi_config.received)
+                mudou = provisao_evento(&provisao, PROVISAO_EV_CREDENCIAIS, agora);
+            break;
+            
+        case PROVISAO_ESCOANDO:
+            varredura_concluir();
+            if (portal_entregue)
+                mudou = provisao_evento(&provisao, PROVISAO_EV_ENTREGUE, agora);
+            break;
+            
+        default:
+            break;
+        }
     }
     
-    // Define padrão inicial
-    atualizar_buffer_matriz(padrao_normal);
-    definir_leds(0, 0, 30); // Azul
+    if (!mudou)
+        mudou = provisao_avaliar(&provisao, agora);
+    while (mudou)
+        mudou = provisao_entrar(agora);
+    cyw43_arch_lwip_end();
 }
 
-void atualizar_display() {
-    // Limpa o display
-    ssd1306_fill(&display, 0);
-    
-    // Estado de Configuração Wi-Fi
-    if (rover_estado == ESTADO_CONFIGURANDO) {
-        ssd1306_draw_string(&display, "Config Wi-Fi", 20, 0);
+// Tela do provisionamento (atualizar_display, no laço principal)
+static void desenhar_provisao(void) {
+    char linha[24];
+    switch (provisao.estado) {
+    case PROVISAO_VARRENDO:
+        ssd1306_draw_string(&display, "Procurando redes", 0, 0);
+        ssd1306_draw_string(&display, "conhecidas...", 0, 16);
+        ssd1306_draw_string(&display, "A: abrir portal", 0, 52);
+        break;
+        
+    case PROVISAO_CONHECIDA:
+        ssd1306_draw_string(&display, "Conectando a:", 0, 0);
+        ssd1306_draw_string(&display, credenciais.c[candidatas[provisao.tentativa].credencial].ssid, 10, 16);
+        snprintf(linha, sizeof(linha), "Rede %u/%u", provisao.tentativa + 1, provisao.candidatas);
+        ssd1306_draw_string(&display, linha, 0, 32);
+        ssd1306_draw_string(&display, "A: abrir portal", 0, 52);
+        break;
+        
+    case PROVISAO_AP_SUBINDO:
+    case PROVISAO_AGUARDANDO:
+        ssd1306_draw_string(&display, "Portal Wi-Fi Ativo", 5, 0);
         ssd1306_draw_string(&display, "Conecte a:", 0, 16);
-        ssd1306_draw_string(&display, "Rover-Setup", 10, 28);
-        ssd1306_draw_string(&display, "Senha: roverpass", 0, 40);
+        ssd1306_draw_string(&display, PORTAL_SSID, 10, 28);
+        ssd1306_draw_string(&display, "Senha: " PORTAL_SENHA, 0, 40);
         ssd1306_draw_string(&display, "Acesse: 192.168.4.1", 0, 52);
-    }
-    // Estado Normal
-    else {
-        // Desenha título
-        ssd1306_draw_string(&display, "Rover Controller", 5, 0);
+        break;
         
-        // Status da conexão
-        if (!conexao_ok) {
-            ssd1306_draw_string(&display, "Status: Esperando", 0, 16);
-            ssd1306_draw_string(&display, "Conectando...", 10, 28);
-        } else {
-            ssd1306_draw_string(&display, "Status: Conectado", 0, 16);
-            
-            char linha_score[32];
-            sprintf(linha_score, "Score: %d", score_atual);
-            ssd1306_draw_string(&display, linha_score, 10, 28);
-            
-            char linha_pontos[32];
-            sprintf(linha_pontos, "Pontos: %d", pontos_capturados);
-            ssd1306_draw_string(&display, linha_pontos, 10, 40);
-        }
+    case PROVISAO_ESCOANDO:
+        ssd1306_draw_string(&display, "Configuracao OK!", 5, 0);
+        ssd1306_draw_string(&display, "Conectando a:", 0, 16);
+        ssd1306_draw_string(&display, new_wifi_config.ssid, 10, 28);
+        ssd1306_draw_string(&display, "Aguarde...", 10, 45);
+        break;
         
-        // Mostra controles na parte inferior
-        ssd1306_draw_string(&display, "A: Captura B: Luzes", 0, 52);
+    case PROVISAO_ASSOCIANDO:
+        ssd1306_draw_string(&display, "Conectando a:", 0, 0);
+        ssd1306_draw_string(&display, new_wifi_config.ssid, 10, 16);
+        snprintf(linha, sizeof(linha), "Tentativa: %u/%u", provisao.tentativa + 1, PROVISAO_TENTATIVAS);
+        ssd1306_draw_string(&display, linha, 0, 32);
+        ssd1306_draw_string(&display, "Aguarde...", 10, 48);
+        break;
+        
+    case PROVISAO_VERIFICADO:
+    case PROVISAO_OPERANDO:
+        ssd1306_draw_string(&display, "Conectado!", 25, 0);
+        ssd1306_draw_string(&display, "Rede: ", 0, 16);
+        if (rede_atual >= 0)
+            ssd1306_draw_string(&display, credenciais.c[rede_atual].ssid, 40, 16);
+        ssd1306_draw_string(&display, "IP: ", 0, 32);
+        ssd1306_draw_string(&display, ipaddr_ntoa(&cyw43_state.netif[0].ip_addr), 30, 32);
+        ssd1306_draw_string(&display, "Iniciando rover...", 0, 48);
+        break;
+        
+    case PROVISAO_FALHA_AP:
+        ssd1306_draw_string(&display, "Erro no portal", 5, 0);
+        ssd1306_draw_string(&display, "Nova tentativa", 10, 20);
+        ssd1306_draw_string(&display, "em instantes", 10, 32);
+        ssd1306_draw_string(&display, "A: tentar agora", 0, 52);
+        break;
+        
+    case PROVISAO_FALHA_REDE:
+        ssd1306_draw_string(&display, "Falha na Conexao", 5, 0);
+        ssd1306_draw_string(&display, "Verifique as", 10, 20);
+        ssd1306_draw_string(&display, "credenciais", 10, 32);
+        ssd1306_draw_string(&display, "A: abrir portal", 0, 52);
+        break;
+        
+    default:
+        break;
     }
-    
-    // Atualiza o display
-    ssd1306_send_data(&display);
 }
 
-// Função para ler os valores do joystick analógico
-void ler_joystick(float *x, float *y) {
-    // Lê ADC para eixo X
-    adc_select_input(0); // ADC0
-    uint16_t raw_x = adc_read();
-    
-    // Lê ADC para eixo Y
-    adc_select_input(1); // ADC1
-    uint16_t raw_y = adc_read();
-    
-    // Converte para faixa -1.0 a 1.0
-    // Assumindo valor de 12 bits (0-4095), onde 2048 é o centro
-    *x = ((float)raw_x - 2048.0f) / 2048.0f;
-    *y = ((float)raw_y - 2048.0f) / 2048.0f;
-    
-    // Inverte o eixo Y se necessário (para corresponder à direção esperada)
+// ====== SERVIDOR DE STATUS (modo STA) ======
+// Cada resposta é gerada aos pedaços de STATUS_BLOCO bytes direto para
+// tcp_write, enquanto houver espaço no buffer de envio, e continua no
+// callback tcp_sent: não existe buffer com a resposta inteira.
+typedef struct {
+    struct tcp_pcb *pcb;               // NULL = slot livre
+    bool respondendo;
+    bool ota;                          // Recebendo o corpo de um POST /ota
+    bool cabecalho_enviado;
+    metricas_formato_t formato;
+    metricas_cursor_t cursor;
+    metricas_snapshot_t snap;          // Valores congelados no pedido
+} status_conexao_t;
+
+static status_conexao_t status_conexoes[STATUS_CONEXOES];
+#if ROVER_OTA
+static void ota_cancelar(status_conexao_t *c);
+#endif
+
+// Copia os contadores e lê os valores instantâneos. Roda no callback do
+// lwIP: o RSSI vem da última leitura do laço, sem ioctl ao cyw43 aqui
+static void status_coletar(metricas_snapshot_t *s) {
+    memset(s, 0, sizeof(*s));
+    s->cont = metricas;
+    s->uptime_ms = to_ms_since_boot(get_absolute_time());
+    s->link_ok = conexao_ok;
+    s->pings = link_stats.pings_enviados;
+    s->pongs = link_stats.amostras;
+    s->perda_pct = link_stats_perda_pct(&link_stats);
+    s->rtt_us = link_stats.rtt_ultimo_us;
+    s->srtt_us = link_stats.srtt_us;
+    s->rttvar_us = link_stats.rttvar_us;
+    s->rssi_dbm = rssi_dbm;
+    metricas_heap(&s->heap_usado, &s->heap_pico);
+    s->log_descartados = rlog_descartados();
+    s->energia_estado = energia.estado;
+    s->clk_sys_khz = clk_sys_khz;
+    s->reinicio_motivo = reinicio.motivo;
+    s->reinicios_falha = reinicio.reinicios;
+    s->i2c_recuperacoes = i2c_recuperacoes;
+    s->cmd_quadros = controle_envio_total(&cmd_envio);
+    s->cmd_poupados = controle_envio_poupados(&cmd_envio);
+    s->cmd_eventos = cmd_envio.quadros[CONTROLE_EVENTO];
+    s->cmd_keepalives = cmd_envio.quadros[CONTROLE_KEEPALIVE];
+#if MEM_STATS
+    s->lwip_mem_usado = lwip_stats.mem.used;
+    s->lwip_mem_pico = lwip_stats.mem.max;
+    s->lwip_mem_total = lwip_stats.mem.avail;
+    s->lwip_mem_erros = lwip_stats.mem.err;
+#endif
+#if MEMP_STATS
+    static const struct { const char *nome; memp_t id; } pools[METRICAS_POOLS] = {
+        { "pbuf_pool",      MEMP_PBUF_POOL },
+        { "udp_pcb",        MEMP_UDP_PCB },
+        { "tcp_pcb",        MEMP_TCP_PCB },
+        { "tcp_pcb_listen", MEMP_TCP_PCB_LISTEN },
+        { "tcp_seg",        MEMP_TCP_SEG },
+    };
+    for (int i = 0; i < METRICAS_POOLS; i++) {
+        const struct stats_mem *m = lwip_stats.memp[pools[i].id];
+        s->pools[i] = (metricas_pool_t){ pools[i].nome, m->used, m->max, m->avail, m->err };
+    }
+    s->n_pools = METRICAS_POOLS;
+#endif
+}
+
+// Fecha a conexão e libera o slot; ERR_ABRT se foi preciso abortar
+static err_t status_fechar(status_conexao_t *c) {
+    struct tcp_pcb *tpcb = c->pcb;
+#if ROVER_OTA
+    ota_cancelar(c);
+#endif
+    c->pcb = NULL;
+    c->respondendo = false;
+    if (!tpcb)
+        return ERR_OK;
+    tcp_arg(tpcb, NULL);
+    tcp_recv(tpcb, NULL);
+    tcp_sent(tpcb, NULL);
+    tcp_err(tpcb, NULL);
+    if (tcp_close(tpcb) != ERR_OK) {
+        tcp_abort(tpcb);
+        return ERR_ABRT;
+    }
+    return ERR_OK;
+}
+
+// Escreve blocos enquanto couberem no buffer de envio; fecha ao terminar
+static err_t status_enviar(status_conexao_t *c) {
+    char bloco[STATUS_BLOCO];
+    if (!c->cabecalho_enviado) {
+        int n = snprintf(bloco, sizeof(bloco),
+                         "HTTP/1.0 200 OK\r\nContent-Type: %s\r\nConnection: close\r\n\r\n",
+                         c->formato == METRICAS_JSON ? "application/json" : "text/plain; version=0.0.4");
+        if (tcp_write(c->pcb, bloco, (u16_t)n, TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE) != ERR_OK)
+            return ERR_OK;   // tenta de novo no próximo tcp_sent
+        c->cabecalho_enviado = true;
+    }
+    while (tcp_sndbuf(c->pcb) >= sizeof(bloco)) {
+        metricas_cursor_t antes = c->cursor;
+        size_t n = metricas_gerar(&c->snap, c->formato, &c->cursor, bloco, sizeof(bloco));
+        if (n == 0)
+            return status_fechar(c);
+        
+        // Fila do lwIP cheia (TCP_SND_QUEUELEN): refaz o bloco no próximo tcp_sent
+        if (tcp_write(c->pcb, bloco, (u16_t)n, TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE) != ERR_OK) {
+            c->cursor = antes;
+            break;
+        }
+    }
+    tcp_output(c->pcb);
+    return ERR_OK;
+}
+
+static err_t status_sent(void *arg, struct tcp_pcb *tpcb, u16_t len) {
+    status_conexao_t *c = arg;
+    if (!c || !c->respondendo)
+        return ERR_OK;
+    return status_enviar(c);
+}
+
+static void status_err(void *arg, err_t err) {
+    status_conexao_t *c = arg;
+    // O pcb já foi liberado pelo lwIP
+    if (c) {
+#if ROVER_OTA
+        ota_cancelar(c);
+#endif
+        c->pcb = NULL;
+        c->respondendo = false;
+    }
+}
+
+#if ROVER_OTA
+// ====== ATUALIZAÇÃO PELA REDE (POST /ota) ======
+// O corpo vai do tcp_recv para os buffers de setor do receptor (lib/ota.h);
+// o que não couber espera numa fila de pbufs e a janela TCP só reabre
+// (tcp_recved) com os bytes aceitos, então o emissor anda no ritmo da
+// flash. O laço principal grava os setores cheios e realimenta a fila.
+static ota_receptor_t ota;
+static status_conexao_t *ota_conexao;      // Conexão enviando a imagem (NULL = nenhuma)
+static struct pbuf *ota_fila;              // Corpo recebido que ainda não coube nos setores
+static u16_t ota_fila_off;                 // Bytes já consumidos do primeiro pbuf da fila
+static volatile bool ota_pendente;         // Setor cheio esperando o laço principal
+static bool ota_destino_marcado;           // Registro já diz que o slot inativo está sendo regravado
+static async_at_time_worker_t tarefa_reiniciar;
+
+// Solta a conexão e a fila; o que já foi para a flash fica no slot inativo
+static void ota_liberar(void) {
+    if (ota_fila)
+        pbuf_free(ota_fila);
+    ota_fila = NULL;
+    ota_fila_off = 0;
+    if (ota_conexao)
+        ota_conexao->ota = false;
+    ota_conexao = NULL;
+}
+
+// Conexão caiu ou fechou no meio da imagem
+static void ota_cancelar(status_conexao_t *c) {
+    if (c != ota_conexao)
+        return;
+    RLOG(RLOG_AVISO, RLOG_REDE, "ota: conexao encerrada com %lu de %lu B",
+         ota.recebido, ota.tamanho);
+    ota_liberar();
+}
+
+// Resposta curta e fim da conexão
+static err_t ota_responder(status_conexao_t *c, const char *status, const char *corpo) {
+    char resposta[192];
+    int n = snprintf(resposta, sizeof(resposta),
+                     "HTTP/1.0 %s\r\nContent-Type: application/json\r\nConnection: close\r\n\r\n%s\n",
+                     status, corpo);
+    if (c == ota_conexao)
+        ota_liberar();
+    c->ota = false;
+    tcp_write(c->pcb, resposta, (u16_t)n, TCP_WRITE_FLAG_COPY);
+    return status_fechar(c);
+}
+
+// Passa a fila para os setores livres e reabre a janela do que foi aceito
+static void ota_alimentar(void) {
+    while (ota_fila) {
+        struct pbuf *q = ota_fila;
+        if (ota_fila_off < q->len) {
+            size_t n = ota_receber(&ota, (const uint8_t *)q->payload + ota_fila_off,
+                                   q->len - ota_fila_off);
+            if (n)
+                tcp_recved(ota_conexao->pcb, (u16_t)n);
+            ota_fila_off += (u16_t)n;
+            // Setores cheios: continua quando o laço gravar um
+            if (ota_fila_off < q->len && ota.recebido < ota.tamanho)
+                break;
+        }
+        // pbuf consumido (ou bytes além do anunciado): sai da cadeia sozinho
+        ota_fila = q->next;
+        q->next = NULL;
+        pbuf_free(q);
+        ota_fila_off = 0;
+    }
+    if (ota_setor_pronto(&ota)) {
+        ota_pendente = true;
+        __sev();
+    }
+}
+
+// Corpo do POST /ota; o FIN só encerra se a imagem não vai mais completar
+static err_t ota_recv(status_conexao_t *c, struct pbuf *p) {
+    if (!p) {
+        u32_t na_fila = ota_fila ? ota_fila->tot_len - ota_fila_off : 0;
+        if (ota.recebido + na_fila < ota.tamanho)
+            return status_fechar(c);
+        return ERR_OK;
+    }
+    if (ota_fila)
+        pbuf_cat(ota_fila, p);
+    else
+        ota_fila = p;
+    ota_alimentar();
+    return ERR_OK;
+}
+
+// POST /ota: valida os cabeçalhos e passa o resto do segmento para o corpo
+static err_t ota_iniciar(status_conexao_t *c, struct pbuf *p) {
+    char cabecalho[OTA_CABECALHO_MAX];
+    u16_t len = pbuf_copy_partial(p, cabecalho, sizeof(cabecalho) - 1, 0);
+    cabecalho[len] = '\0';
+    char *fim = strstr(cabecalho, "\r\n\r\n");
+    if (!fim) {
+        tcp_recved(c->pcb, p->tot_len);
+        pbuf_free(p);
+        return ota_responder(c, "400 Bad Request", "{\"erro\":\"cabecalhos fora do primeiro segmento\"}");
+    }
+    u16_t corpo = (u16_t)(fim + 4 - cabecalho);
+    tcp_recved(c->pcb, corpo);
+    
+    char valor[16];
+    uint32_t tamanho = portal_cabecalho(cabecalho, "Content-Length", valor, sizeof(valor))
+                       ? strtoul(valor, NULL, 10) : 0;
+    bool tem_crc = portal_cabecalho(cabecalho, "X-OTA-CRC32", valor, sizeof(valor));
+    uint32_t crc = tem_crc ? strtoul(valor, NULL, 16) : 0;
+    
+    ota_controle_t ctl;
+    ota_controle_ler(&ctl);
+    const char *erro = NULL, *status = NULL;
+    if (ota_conexao) {
+        status = "409 Conflict";
+        erro = "{\"erro\":\"atualizacao em andamento\"}";
+    } else if (ctl.estado == OTA_TESTANDO && ctl.slot == ROVER_OTA_SLOT) {
+        // O slot inativo é o caminho de volta desta imagem ainda não confirmada
+        status = "409 Conflict";
+        erro = "{\"erro\":\"imagem atual ainda em teste\"}";
+    } else if (!tamanho || !tem_crc) {
+        status = "400 Bad Request";
+        erro = "{\"erro\":\"Content-Length e X-OTA-CRC32 obrigatorios\"}";
+    } else if (!ota_receptor_iniciar(&ota, ROVER_OTA_SLOT ^ 1, tamanho, crc)) {
+        status = "413 Payload Too Large";
+        erro = "{\"erro\":\"imagem maior que o slot\"}";
+    }
+    if (erro) {
+        tcp_recved(c->pcb, p->tot_len - corpo);
+        pbuf_free(p);
+        return ota_responder(c, status, erro);
+    }
+    
+    RLOG(RLOG_INFO, RLOG_REDE, "ota: %lu B para o slot %c (crc %08lx)",
+         tamanho, 'a' + (ROVER_OTA_SLOT ^ 1), crc);
+    c->ota = true;
+    ota_conexao = c;
+    ota_destino_marcado = false;
+    ota_fila = p;
+    ota_fila_off = corpo;
+    // Cabeçalho em mais de um pbuf: o deslocamento atravessa a cadeia
+    while (ota_fila && ota_fila_off >= ota_fila->len) {
+        struct pbuf *q = ota_fila;
+        ota_fila_off -= q->len;
+        ota_fila = q->next;
+        q->next = NULL;
+        pbuf_free(q);
+    }
+    ota_alimentar();
+    return ERR_OK;
+}
+
+// GET /ota: slot em execução, destino e andamento
+static err_t ota_estado(status_conexao_t *c) {
+    ota_controle_t ctl;
+    ota_controle_ler(&ctl);
+    char json[160];
+    snprintf(json, sizeof(json),
+             "{\"slot\":\"%c\",\"destino\":\"%c\",\"estado\":\"%s\",\"tentativas\":%u,"
+             "\"max_bytes\":%lu,\"recebido\":%lu,\"tamanho\":%lu}",
+             'a' + ROVER_OTA_SLOT, 'a' + (ROVER_OTA_SLOT ^ 1),
+             ctl.estado == OTA_TESTANDO ? "testando" : "confirmado", ctl.tentativas,
+             (unsigned long)OTA_SLOT_TAM, (unsigned long)(ota_conexao ? ota.recebido : 0),
+             (unsigned long)(ota_conexao ? ota.tamanho : 0));
+    return ota_responder(c, "200 OK", json);
+}
+
+static void ota_gravar_setor_cb(void *param) {
+    ota_gravar_setor(&ota);
+}
+
+static void ota_gravar_controle_cb(void *param) {
+    ota_controle_gravar(param);
+}
+
+static void reiniciar_cb(async_context_t *ctx, async_at_time_worker_t *tarefa) {
+    supervisor_reiniciar();
+}
+
+// Imagem inteira na flash: aponta o registro para o slot novo em teste
+static void ota_concluir(ota_resultado_t resultado) {
+    if (resultado == OTA_ERRO_FLASH) {
+        ota_responder(ota_conexao, "500 Internal Server Error", "{\"erro\":\"setor gravado nao confere\"}");
+        return;
+    }
+    if (resultado == OTA_ERRO_CRC) {
+        char json[80];
+        snprintf(json, sizeof(json), "{\"erro\":\"crc\",\"crc32\":\"%08lx\"}", (unsigned long)ota.crc);
+        ota_responder(ota_conexao, "422 Unprocessable Entity", json);
+        return;
+    }
+    
+    ota_controle_t ctl;
+    ota_controle_ler(&ctl);
+    ctl.slot = ota.slot;
+    ctl.estado = OTA_TESTANDO;
+    ctl.tentativas = OTA_TENTATIVAS;
+    ctl.tamanho[ota.slot] = ota.tamanho;
+    ctl.crc[ota.slot] = ota.crc;
+    flash_safe_execute(ota_gravar_controle_cb, &ctl, UINT32_MAX);
+    
+    char json[80];
+    snprintf(json, sizeof(json), "{\"ok\":true,\"slot\":\"%c\",\"crc32\":\"%08lx\"}",
+             'a' + ota.slot, (unsigned long)ota.crc);
+    RLOG(RLOG_INFO, RLOG_REDE, "ota: slot %c gravado, reiniciando", 'a' + ota.slot);
+    ota_responder(ota_conexao, "200 OK", json);
+    tarefa_reiniciar.do_work = reiniciar_cb;
+    agendar(&tarefa_reiniciar, OTA_REINICIO_MS);
+}
+
+// Laço principal: grava os setores cheios com o XIP parado e realimenta a
+// fila; a trava do contexto segura os callbacks do lwIP enquanto isso
+static void ota_processar(void) {
+    cyw43_arch_lwip_begin();
+    // Antes do primeiro setor: o slot de destino deixa de valer como volta
+    if (ota_conexao && !ota_destino_marcado) {
+        ota_controle_t ctl;
+        ota_controle_ler(&ctl);
+        ctl.tamanho[ota.slot] = OTA_TAMANHO_INVALIDO;
+        flash_safe_execute(ota_gravar_controle_cb, &ctl, UINT32_MAX);
+        ota_destino_marcado = true;
+    }
+    while (ota_conexao && ota_setor_pronto(&ota)) {
+        ZONA_INICIO(TRACE_FLASH);
+        int r = flash_safe_execute(ota_gravar_setor_cb, NULL, UINT32_MAX);
+        TRACE_FIM(TRACE_FLASH);
+        if (r != PICO_OK) {
+            ota_responder(ota_conexao, "503 Service Unavailable", "{\"erro\":\"flash ocupada\"}");
+            break;
+        }
+        ota_alimentar();
+    }
+    if (ota_conexao && ota_resultado(&ota) != OTA_INCOMPLETO)
+        ota_concluir(ota_resultado(&ota));
+    cyw43_arch_lwip_end();
+}
+
+// Chegou ao servidor de status (rede e TCP funcionando, pronto para a
+// próxima atualização): a imagem em teste se confirma
+static void ota_confirmar(void) {
+    ota_controle_t ctl;
+    ota_controle_ler(&ctl);
+    if (ctl.estado != OTA_TESTANDO || ctl.slot != ROVER_OTA_SLOT)
+        return;
+    ctl.estado = OTA_CONFIRMADO;
+    ctl.tentativas = 0;
+    flash_safe_execute(ota_gravar_controle_cb, &ctl, UINT32_MAX);
+    RLOG(RLOG_INFO, RLOG_SISTEMA, "ota: slot %c confirmado", 'a' + ROVER_OTA_SLOT);
+}
+#endif
+
+static err_t status_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
+    status_conexao_t *c = arg;
+#if ROVER_OTA
+    if (c->ota)
+        return ota_recv(c, p);
+#endif
+    if (!p)
+        return status_fechar(c);
+    
+    // Só a linha do pedido interessa; o resto dos cabeçalhos é descartado
+    char linha[48];
+    u16_t len = pbuf_copy_partial(p, linha, sizeof(linha) - 1, 0);
+    linha[len] = '\0';
+#if ROVER_OTA
+    if (!c->respondendo && strncmp(linha, "POST /ota ", 10) == 0)
+        return ota_iniciar(c, p);
+#endif
+    tcp_recved(tpcb, p->tot_len);
+    pbuf_free(p);
+    if (c->respondendo)
+        return ERR_OK;
+    
+    char *caminho = strncmp(linha, "GET ", 4) == 0 ? linha + 4 : NULL;
+    if (caminho)
+        caminho[strcspn(caminho, " ?\r\n")] = '\0';
+    
+    if (caminho && strcmp(caminho, "/metrics") == 0) {
+        c->formato = METRICAS_PROMETHEUS;
+    } else if (caminho && (strcmp(caminho, "/") == 0 || strcmp(caminho, "/status") == 0)) {
+        c->formato = METRICAS_JSON;
+#if ROVER_OTA
+    } else if (caminho && strcmp(caminho, "/ota") == 0) {
+        return ota_estado(c);
+#endif
+    } else {
+        static const char nao_encontrado[] =
+            "HTTP/1.0 404 Not Found\r\nConnection: close\r\n\r\n/metrics ou /status\n";
+        tcp_write(tpcb, nao_encontrado, sizeof(nao_encontrado) - 1, 0);
+        return status_fechar(c);
+    }
+    RLOG(RLOG_DEBUG, RLOG_REDE, "status: %s", RLOG_S(c->formato == METRICAS_JSON ? "json" : "prometheus"));
+    
+    status_coletar(&c->snap);
+    c->cursor = (metricas_cursor_t){ 0, 0 };
+    c->cabecalho_enviado = false;
+    c->respondendo = true;
+    return status_enviar(c);
+}
+
+static err_t status_accept(void *arg, struct tcp_pcb *newpcb, err_t err) {
+    for (int i = 0; i < STATUS_CONEXOES; i++) {
+        status_conexao_t *c = &status_conexoes[i];
+        if (c->pcb)
+            continue;
+        c->pcb = newpcb;
+        c->respondendo = false;
+        c->ota = false;
+        tcp_arg(newpcb, c);
+        tcp_recv(newpcb, status_recv);
+        tcp_sent(newpcb, status_sent);
+        tcp_err(newpcb, status_err);
+        return ERR_OK;
+    }
+    // Todos os slots ocupados: recusa (o coletor tenta de novo)
+    tcp_abort(newpcb);
+    return ERR_ABRT;
+}
+
+// Abre o servidor de status na porta do portal, já fechado em modo STA
+bool iniciar_servidor_status(void) {
+    struct tcp_pcb *server_pcb = tcp_new();
+    if (!server_pcb)
+        return false;
+    if (tcp_bind(server_pcb, IP_ADDR_ANY, STATUS_PORTA) != ERR_OK) {
+        tcp_close(server_pcb);
+        return false;
+    }
+    server_pcb = tcp_listen(server_pcb);
+    if (!server_pcb)
+        return false;
+    tcp_accept(server_pcb, status_accept);
+    return true;
+}
+
+void inicializar_display() {
+    // Inicialização do I2C 
+    i2c_init(I2C_PORT, 400 * 1000);
+    gpio_set_function(SDA, GPIO_FUNC_I2C);
+    gpio_set_function(SCL, GPIO_FUNC_I2C);
+    gpio_pull_up(SDA);
+    gpio_pull_up(SCL);
+    
+    // Inicialização do display usando a biblioteca ssd1306
+    ssd1306_init(&display, SSD1306_WIDTH, SSD1306_HEIGHT, false, I2C_ADDR, I2C_PORT);
+    ssd1306_config(&display);
+    ssd1306_fill(&display, 0);
+    
+    // Tela de boas-vindas
+    ssd1306_draw_string(&display, "Rover Controller", 10, 5);
+    ssd1306_draw_string(&display, "BitDogLab", 25, 25);
+    ssd1306_draw_string(&display, "Inicializando...", 10, 45);
+    ssd1306_send_data(&display);
+}
+
+void inicializar_led_rgb() {
+    gpio_set_function(R_LED_PIN, GPIO_FUNC_PWM);
+    gpio_set_function(B_LED_PIN, GPIO_FUNC_PWM);
+    
+    uint slice_r = pwm_gpio_to_slice_num(R_LED_PIN);
+    uint slice_b = pwm_gpio_to_slice_num(B_LED_PIN);
+    
+    pwm_set_wrap(slice_r, PWM_WRAP);
+    pwm_set_clkdiv(slice_r, 125.0f);
+    pwm_set_enabled(slice_r, true);
+    
+    if (slice_b != slice_r) {
+        pwm_set_wrap(slice_b, PWM_WRAP);
+        pwm_set_clkdiv(slice_b, 125.0f);
+        pwm_set_enabled(slice_b, true);
+    }
+    
+    // LED Verde como saída digital 
+    gpio_init(G_LED_PIN);
+    gpio_set_dir(G_LED_PIN, GPIO_OUT);
+}
+
+void definir_cor_rgb(uint8_t r, uint8_t g, uint8_t b) {
+    cor_rgb[0] = r; cor_rgb[1] = g; cor_rgb[2] = b;
+    if (!leds_acesos)
+        r = g = b = 0;
+    pwm_set_chan_level(pwm_gpio_to_slice_num(R_LED_PIN), pwm_gpio_to_channel(R_LED_PIN), r);
+    gpio_put(G_LED_PIN, g > 10); // Digital on/off baseado na intensidade
+    pwm_set_chan_level(pwm_gpio_to_slice_num(B_LED_PIN), pwm_gpio_to_channel(B_LED_PIN), b);
+}
+
+// Função auxiliar para formatar cores para a matriz de LEDs
+static inline uint32_t urgb_u32(uint8_t r, uint8_t g, uint8_t b) {
+    return ((uint32_t)r << 8) | ((uint32_t)g << 16) | (uint32_t)b;
+}
+
+// Função auxiliar para enviar um pixel para a matriz
+static inline void enviar_pixel(uint32_t pixel_grb) {
+    pio_sm_put_blocking(pio0, 0, pixel_grb << 8u);
+}
+
+// Define os LEDs da matriz com base no buffer
+void definir_leds(uint8_t r, uint8_t g, uint8_t b) {
+    ZONA_INICIO(TRACE_LEDS);
+    cor_matriz[0] = r; cor_matriz[1] = g; cor_matriz[2] = b;
+    uint32_t cor = urgb_u32(r, g, b);
+    for (int i = 0; i < NUM_PIXELS; i++) {
+        if (buffer_leds[i] && leds_acesos)
+            enviar_pixel(cor);
+        else
+            enviar_pixel(0);
+    }
+    sleep_us(60);
+    TRACE_FIM(TRACE_LEDS);
+}
+
+// Atualiza o buffer com um padrão específico
+void atualizar_buffer_matriz(const bool padrao[5][5]) {
+    matriz_carregar(buffer_leds, padrao);
+}
+
+void inicializar_matriz_leds() {
+    PIO pio = pio0;
+    uint sm = 0;
+    uint offset = pio_add_program(pio, &ws2812_program);
+    ws2812_program_init(pio, sm, offset, WS2812_PIN, 800000, IS_RGBW);
+    
+    // Efeito de inicialização
+    for (int i = 0; i < NUM_PIXELS; i++) {
+        buffer_leds[i] = true;
+        definir_leds(20, 20, 20);
+        sleep_ms(20);
+    }
+    
+    for (int i = 0; i < NUM_PIXELS; i++) {
+        buffer_leds[i] = false;
+        definir_leds(0, 0, 0);
+        sleep_ms(20);
+    }
+    
+    // Define padrão inicial
+    atualizar_buffer_matriz(padrao_normal);
+    definir_leds(0, 0, 30); // Azul
+}
+
+void atualizar_display() {
+    // Apagado pelo gerente de energia: redesenha ao acender
+    if (!contraste_oled)
+        return;
+    ZONA_INICIO(TRACE_DISPLAY);
+    
+    // Limpa o display
+    ssd1306_fill(&display, 0);
+    
+    // Provisionamento da rede (portal, conexão, falhas)
+    if (rover_estado == ESTADO_CONFIGURANDO) {
+        desenhar_provisao();
+    }
+    // Estado Normal
+    else {
+        // Desenha título
+        ssd1306_draw_string(&display, "Rover Controller", 5, 0);
+        
+        // Status da conexão
+        if (!controlador_travado) {
+            ssd1306_draw_string(&display, "Status: Buscando", 0, 16);
+            ssd1306_draw_string(&display, nome_host, 10, 28);
+        } else if (!conexao_ok) {
+            ssd1306_draw_string(&display, "Status: Esperando", 0, 16);
+            ssd1306_draw_string(&display, "Conectando...", 10, 28);
+        } else {
+            ssd1306_draw_string(&display, espectador ? "Status: Assistindo" : "Status: Conectado", 0, 16);
+            
+            char linha_score[32];
+            sprintf(linha_score, "Score:%d P:%d", score_atual, pontos_capturados);
+            ssd1306_draw_string(&display, linha_score, 0, 28);
+            
+            // Qualidade do enlace: RTT suavizado, jitter (RTTVAR) e perda
+            char linha_rtt[32];
+            if (link_stats.amostras > 0) {
+                sprintf(linha_rtt, "RTT%ld J%ld %d%%",
+                        (long)(link_stats.srtt_us / 1000),
+                        (long)(link_stats.rttvar_us / 1000),
+                        link_stats_perda_pct(&link_stats));
+            } else {
+                sprintf(linha_rtt, "RTT: --");
+            }
+            ssd1306_draw_string(&display, linha_rtt, 0, 40);
+        }
+        
+        // Mostra controles na parte inferior
+        ssd1306_draw_string(&display, espectador ? "A: Assumir rover" : "A: Captura B: Luzes", 0, 52);
+    }
+    
+    // Atualiza o display
+    ssd1306_send_data(&display);
+    TRACE_FIM(TRACE_DISPLAY);
+}
+
+// Linha do I2C como dreno aberto: em baixo conduz, em alto solta para o pull-up
+static void linha_i2c(uint pino, bool alto) {
+    gpio_set_dir(pino, alto ? GPIO_IN : GPIO_OUT);
+    sleep_us(5);
+}
+
+// Escrita no OLED falhou (sem ACK ou barramento preso, com o escravo
+// segurando o SDA no meio de um byte): solta o barramento com até 9 pulsos
+// de SCL, gera um STOP, refaz o I2C e reconfigura o display, sem reiniciar
+// o rover. No laço principal, no máximo uma vez por I2C_RECUPERAR_MS
+static void recuperar_i2c(void) {
+    uint32_t agora = to_ms_since_boot(get_absolute_time());
+    if (i2c_recuperacoes && agora - i2c_recuperado_em < I2C_RECUPERAR_MS)
+        return;
+    i2c_recuperado_em = agora;
+    i2c_recuperacoes++;
+    
+    i2c_deinit(I2C_PORT);
+    gpio_init(SDA);
+    gpio_init(SCL);
+    gpio_put(SDA, 0);
+    gpio_put(SCL, 0);
+    for (int i = 0; i < 9 && !gpio_get(SDA); i++) {
+        linha_i2c(SCL, false);
+        linha_i2c(SCL, true);
+    }
+    // STOP: SDA sobe com SCL em alto
+    linha_i2c(SCL, false);
+    linha_i2c(SDA, false);
+    linha_i2c(SCL, true);
+    linha_i2c(SDA, true);
+    
+    i2c_init(I2C_PORT, 400 * 1000);
+    gpio_set_function(SDA, GPIO_FUNC_I2C);
+    gpio_set_function(SCL, GPIO_FUNC_I2C);
+    ssd1306_config(&display);
+    // O config acende com contraste máximo: volta ao nível de energia
+    if (!contraste_oled)
+        ssd1306_power(&display, false);
+    else if (contraste_oled != 0xFF)
+        ssd1306_contrast(&display, contraste_oled);
+    
+    if (display.falha) {
+        RLOG(RLOG_ERRO, RLOG_SISTEMA, "I2C do OLED continua sem resposta (recuperacao %lu)", i2c_recuperacoes);
+    } else {
+        RLOG(RLOG_AVISO, RLOG_SISTEMA, "I2C do OLED recuperado (recuperacao %lu)", i2c_recuperacoes);
+        display_pendente = true;
+    }
+}
+
+// Função para ler os valores do joystick analógico
+void ler_joystick(float *x, float *y) {
+    // Lê ADC para eixo X
+    adc_select_input(0); // ADC0
+    uint16_t raw_x = adc_read();
+    
+    // Lê ADC para eixo Y
+    adc_select_input(1); // ADC1
+    uint16_t raw_y = adc_read();
+    
+    // Converte para faixa -1.0 a 1.0 com zona morta (12 bits, centro 2048)
+    *x = controle_eixo(raw_x, DEADZONE);
+    *y = controle_eixo(raw_y, DEADZONE);
+    
+    // Inverte o eixo Y se necessário (para corresponder à direção esperada)
     // Descomente esta linha se o movimento estiver invertido
     // *y = -*y;
+}
+
+// Callback para interrupções GPIO
+void gpio_callback(uint gpio, uint32_t events) {
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    
+    // Qualquer botão é atividade (e acorda do OCIOSO/DORMINDO)
+    acordar_energia();
+    
+    // Verifica qual GPIO gerou a interrupção
+    if (gpio == BUTTON_CAPTURE) {
+        // Debounce para botão de captura
+        if (now - last_btn_capture_time > DEBOUNCE_TIME) {
+            if (events & GPIO_IRQ_EDGE_FALL) {  // Botão pressionado (falling edge)
+                if (provisao.estado != PROVISAO_OPERANDO) {
+                    // Provisionando: abre o portal (ou tenta de novo) já
+                    provisao_botao = true;
+                    __sev();
+                } else if (espectador) {
+                    // Sem o rover, o botão A pede a posse (TAKE)
+                    pedir_posse = true;
+                    acordar_enlace();
+                } else {
+                    capture_evt_seq++;
+                    RLOG(RLOG_INFO, RLOG_BOTOES, "captura pressionada (evento %u)", capture_evt_seq);
+                    botao_us = time_us_32();
+                    acordar_enlace();   // Quadro com o evento sai já, sem esperar o período
+                }
+            }
+            last_btn_capture_time = now;
+        }
+    }
+    else if (gpio == BUTTON_LIGHTS) {
+        // Debounce para botão de luzes
+        if (now - last_btn_lights_time > DEBOUNCE_TIME) {
+            if (events & GPIO_IRQ_EDGE_FALL) {  // Botão pressionado (falling edge)
+                lights_on = !lights_on;
+                RLOG(RLOG_INFO, RLOG_BOTOES, "luzes %s", RLOG_S(lights_on ? "ON" : "OFF"));
+                botao_us = time_us_32();
+                acordar_enlace();
+                // Atualiza LED RGB conforme estado das luzes
+                if (lights_on)
+                    definir_cor_rgb(255, 255, 150); // Amarelo claro
+                else
+                    definir_cor_rgb(0, 0, 255); // Azul
+            }
+            last_btn_lights_time = now;
+        }
+    }
+    else if (gpio == BUTTON_CAMERA) {
+        // Debounce para botão de câmera
+        if (now - last_btn_camera_time > DEBOUNCE_TIME) {
+            if (events & GPIO_IRQ_EDGE_FALL) {  // Botão pressionado (falling edge)
+                camera_on = !camera_on;
+                RLOG(RLOG_INFO, RLOG_BOTOES, "camera %s", RLOG_S(camera_on ? "ON" : "OFF"));
+                botao_us = time_us_32();
+                acordar_enlace();
+            }
+            last_btn_camera_time = now;
+        }
+    }
+}
+
+// Responde a um PING do simulador com os carimbos t2 (recepção) e t3 (envio)
+static void responder_ping(const char *msg, uint32_t t2) {
+    uint32_t seq, t1;
+    if (!proto_campo_u32(msg, ",seq=", &seq) || !proto_campo_u32(msg, ",t1=", &t1)) return;
+
+    char pong[80];
+    if (proto_pong(pong, sizeof(pong), seq, t1, t2, time_us_32()))
+        enviar_mensagem(pong);
+}
+
+// Fecha uma troca iniciada por enviar_ping() e atualiza as estatísticas
+static void processar_pong(const char *msg, uint32_t t4) {
+    uint32_t seq, t1, t2, t3;
+    if (!proto_campo_u32(msg, ",seq=", &seq) || !proto_campo_u32(msg, ",t1=", &t1) ||
+        !proto_campo_u32(msg, ",t2=", &t2) || !proto_campo_u32(msg, ",t3=", &t3)) return;
+
+    if (link_stats_amostra(&link_stats, seq, t1, t2, t3, t4)) {
+        TRACE_CONTADOR(TRACE_CONT_SRTT, link_stats.srtt_us / 1000);
+        RLOG(RLOG_DEBUG, RLOG_LINK, "PONG #%lu: RTT=%ld us, SRTT=%ld us, RTTVAR=%ld us, offset=%ld us",
+             seq, link_stats.rtt_ultimo_us, link_stats.srtt_us,
+             link_stats.rttvar_us, link_stats.offset_us);
+    }
+}
+
+// Trata um datagrama recebido (chamado por rx_cb)
+static void rx_processar(struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+    
+    // Carimbo de recepção o mais cedo possível (t2 de um PING, t4 de um PONG)
+    uint32_t t_rx = time_us_32();
+    
+    // Extrai a mensagem como texto e libera o buffer imediatamente
+    char msg[256] = {0};
+    u16_t len = pbuf_copy_partial(p, msg, sizeof(msg) - 1, 0);
+    msg[len] = 0; // Garante que termine com nulo
+    pbuf_free(p);
+    
+    // Resposta de descoberta: trava no primeiro controlador que oferecer
+    if (strncmp(msg, "OFFER", 5) == 0) {
+        if (!controlador_travado) {
+            uint32_t porta;
+            ip_addr_copy(pc_addr, *addr);
+            pc_port = proto_campo_u32(msg, ",port=", &porta) ? (u16_t)porta : port;
+            controlador_travado = true;
+            travado_em = to_ms_since_boot(get_absolute_time());
+            last_sent = 0;   // Envia HELLO imediatamente
+            acordar_enlace();
+            RLOG(RLOG_INFO, RLOG_REDE, "controlador descoberto em %u.%u.%u.%u:%u",
+                 RLOG_IP(&pc_addr), pc_port);
+        }
+        return;
+    }
+    
+    // Ignora tráfego de qualquer host que não seja o controlador travado
+    if (!controlador_travado || !ip_addr_cmp(addr, &pc_addr))
+        return;
+    
+    // Atualiza o timestamp da última recepção
+    last_rx = to_ms_since_boot(get_absolute_time());
+    link_ok = true;
+    conexao_ok = true;
+    
+    // PING/PONG são respondidos antes de qualquer registro para não
+    // contaminar a medida de RTT
+    if (strncmp(msg, "PING,", 5) == 0) {
+        responder_ping(msg, t_rx);
+        return;
+    }
+    if (strncmp(msg, "PONG,", 5) == 0) {
+        processar_pong(msg, t_rx);
+        return;
+    }
+    
+    // `msg` é temporário: o log guarda só tamanho e origem
+    RLOG(RLOG_DEBUG, RLOG_REDE, "RX %u B de %u.%u.%u.%u:%u", len, RLOG_IP(addr), port);
+    
+    // Ajuste de níveis de log pelo controlador: "LOG,rede=debug,*=aviso"
+    if (strncmp(msg, "LOG,", 4) == 0) {
+        if (!rlog_config(msg + 4))
+            RLOG(RLOG_AVISO, RLOG_SISTEMA, "especificacao de log invalida");
+        return;
+    }
+    
+    // Perfil de energia pelo controlador: "ENERGIA,economia"
+    if (strncmp(msg, "ENERGIA,", 8) == 0) {
+        const energia_perfil_t *perfil = energia_perfil(msg + 8);
+        if (perfil) {
+            energia_trocar_perfil(&energia, perfil, last_rx);
+            RLOG(RLOG_INFO, RLOG_ENERGIA, "perfil %s", RLOG_S(perfil->nome));
+            agendar(&tarefa_energia, 0);
+        } else {
+            RLOG(RLOG_AVISO, RLOG_ENERGIA, "perfil de energia desconhecido");
+        }
+        return;
+    }
+    
+    // Verifica se é um ACK (resposta ao HELLO): "ACK,token=..,rover=..,role=.."
+    // (simuladores antigos mandam só "ACK")
+    if (strcmp(msg, "ACK") == 0 || strncmp(msg, "ACK,", 4) == 0) {
+        if (!proto_campo_texto(msg, ",token=", sessao_token, sizeof(sessao_token)))
+            sessao_token[0] = '\0';
+        espectador = proto_ler_papel(msg) == PROTO_PAPEL_ESPECTADOR;
+        RLOG(RLOG_INFO, RLOG_REDE, "ACK recebido, conexao estabelecida (%s)",
+             RLOG_S(espectador ? "espectador" : "dono"));
+        // Atualizar estado
+        rover_estado = ESTADO_NORMAL;
+        pedir_display();
+        // Primeiro quadro de comando já, sem esperar o período do HELLO
+        last_sent = 0;
+        acordar_enlace();
+        return;
+    }
+    // Troca de dono do rover: "LEASE,role=spectator,rover=..,by=<sid>"
+    if (strncmp(msg, "LEASE,", 6) == 0) {
+        proto_papel_t papel = proto_ler_papel(msg);
+        if (papel == PROTO_PAPEL_NENHUM) {
+            RLOG(RLOG_AVISO, RLOG_REDE, "pedido de posse recusado pelo simulador");
+            return;
+        }
+        espectador = papel == PROTO_PAPEL_ESPECTADOR;
+        RLOG(RLOG_INFO, RLOG_REDE, "%s", RLOG_S(espectador ? "outro controlador assumiu o rover"
+                                                           : "rover assumido"));
+        pedir_display();
+        acordar_enlace();       // Dono de novo: o primeiro quadro sai já
+        return;
+    }
+    
+    // Confirmação explícita de evento de captura pelo número de sequência.
+    // Só o evento mais recente importa: confirmações antigas são ignoradas.
+    proto_status_t status;
+    if (!proto_ler_status(msg, &status))
+        return;
+    if (status.tem_evack && (uint16_t)status.evack == capture_evt_seq &&
+        capture_evt_ack != capture_evt_seq) {
+        capture_evt_ack = (uint16_t)status.evack;
+        RLOG(RLOG_INFO, RLOG_COMANDOS, "captura %u confirmada pelo simulador", capture_evt_ack);
+    }
+    
+    // Processa o score da mensagem
+    if (status.tem_score) {
+        int novo_score = (int)status.score;
+        
+        // Verifica se o score aumentou (capturou ponto)
+        if (novo_score > score_atual) {
+            rover_estado = ESTADO_CAPTURANDO;
+            ultima_captura = to_ms_since_boot(get_absolute_time());
+            pontos_capturados++;
+            
+            // Atualiza matriz de LEDs com padrão de captura
+            atualizar_buffer_matriz(padrao_captura);
+            definir_leds(0, 255, 0); // Verde brilhante
+            
+            // LED RGB em verde
+            definir_cor_rgb(0, 255, 0);
+            
+            // Volta ao padrão normal ao fim da animação
+            agendar(&tarefa_visual, CAPTURA_ANIMACAO_MS);
+        }
+        
+        score_atual = novo_score;
+        pedir_display();
+    }
+}
+
+// Callback chamado quando recebemos pacotes UDP
+static void rx_cb(void *arg, struct udp_pcb *pcb, 
+                  struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+    if (!p) return;
     
-    // Aplica zona morta para eliminar ruído
-    if (fabs(*x) < DEADZONE) *x = 0.0f;
-    if (fabs(*y) < DEADZONE) *y = 0.0f;
+    ZONA_INICIO(TRACE_RX);
+#if ROVER_TRACE
+    static uint16_t datagramas_rx = 0;
+    TRACE_CONTADOR(TRACE_CONT_RX, ++datagramas_rx);
+#endif
+    metricas.udp_rx++;
+    metricas.udp_rx_bytes += p->tot_len;
+    rx_processar(p, addr, port);
+    TRACE_FIM(TRACE_RX);
+}
+
+// Envia um datagrama e o conta nas métricas
+static void enviar_para(const void *dados, size_t len, const ip_addr_t *destino, u16_t porta) {
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+    if (!p) {
+        metricas.udp_tx_erros++;
+        return;
+    }
+    memcpy(p->payload, dados, len);
+    if (udp_sendto(pcb, p, destino, porta) == ERR_OK) {
+        metricas.udp_tx++;
+        metricas.udp_tx_bytes += len;
+    } else {
+        metricas.udp_tx_erros++;
+    }
+    pbuf_free(p);
+}
+
+// Envia um datagrama para o simulador
+static void enviar_dados(const void *dados, size_t len) {
+    enviar_para(dados, len, &pc_addr, pc_port);
+}
+
+// Envia uma mensagem de texto para o simulador
+static void enviar_mensagem(const char *msg) {
+    enviar_dados(msg, strlen(msg));
+}
+
+// Envia mensagem HELLO para estabelecer conexão. O ID de sessão permite ao
+// simulador distinguir vários rovers e detectar um reinício deste
+void enviar_hello() {
+    char msg[80];
+    proto_hello(msg, sizeof(msg), sessao_id, sessao_token, ROVER_ALVO);
+    enviar_mensagem(msg);
+    RLOG(RLOG_DEBUG, RLOG_REDE, "HELLO enviado para %u.%u.%u.%u:%u", RLOG_IP(&pc_addr), pc_port);
+}
+
+// Anuncia o rover na sub-rede; controladores respondem com OFFER
+void enviar_descoberta() {
+    char msg[64];
+    size_t len = proto_descoberta(msg, sizeof(msg), nome_host, PICO_PORT);
+    if (!len) return;
+    
+    ip_addr_t destino;
+    ipaddr_aton(DESCOBERTA_ENDERECO, &destino);
+    enviar_para(msg, len, &destino, PC_PORT);
+}
+
+// Esquece o controlador atual e volta a procurá-lo imediatamente
+void reiniciar_descoberta(const char *motivo) {
+#ifndef PC_IP
+    RLOG(RLOG_INFO, RLOG_REDE, "redescobrindo controlador (%s)", RLOG_S(motivo));
+    controlador_travado = false;
+#endif
+    conexao_ok = false;
+    last_sent = 0;
+}
+
+// Mudanças de endereço/enlace (novo lease DHCP, reconexão) disparam redescoberta
+static void rede_ext_cb(struct netif *netif, netif_nsc_reason_t reason,
+                        const netif_ext_callback_args_t *args) {
+    if (reason & (LWIP_NSC_IPV4_ADDRESS_CHANGED | LWIP_NSC_LINK_CHANGED | LWIP_NSC_STATUS_CHANGED)) {
+        rede_mudou = true;
+        acordar_enlace();
+    }
+}
+NETIF_DECLARE_EXT_CALLBACK(rede_callback)
+
+// Itens TXT do serviço mDNS: protocolo e porta de comandos
+static void mdns_txt_cb(struct mdns_service *service, void *txt_userdata) {
+    mdns_resp_add_service_txtitem(service, "proto=rvrf", 10);
+}
+
+// Anuncia o rover como <nome_host>.local com o serviço _rover._udp
+void iniciar_mdns() {
+    mdns_resp_init();
+    mdns_resp_add_netif(netif_default, nome_host);
+    mdns_resp_add_service(netif_default, nome_host, MDNS_SERVICO, DNSSD_PROTO_UDP,
+                          PICO_PORT, mdns_txt_cb, NULL);
+    printf("mDNS: %s.local, serviço %s._udp porta %d\n", nome_host, MDNS_SERVICO, PICO_PORT);
+}
+
+// Envia um PING com o carimbo t1; o simulador devolve PONG com t1, t2 e t3
+void enviar_ping() {
+    char ping[48];
+    uint32_t t1 = time_us_32();
+    proto_ping(ping, sizeof(ping), ++ping_seq, t1);
+    enviar_mensagem(ping);
+    link_stats_ping_enviado(&link_stats, ping_seq, t1);
+}
+
+#if ROVER_TRACE
+// Envia os registros de trace pendentes para o coletor (tools/trace2chrome.py)
+static void enviar_trace() {
+    static uint8_t pacote[TRACE_PACOTE_MAX];
+    size_t len = trace_drenar(pacote, sizeof(pacote));
+    if (!len) return;
+    enviar_para(pacote, len, &pc_addr, TRACE_PORTA);
+}
+#endif
+
+// Envia a amostra do joystick ao simulador se a política de envio mandar;
+// retorna o motivo (CONTROLE_NADA = nada saiu)
+static controle_motivo_t enviar_comandos_rover(float joy_x, float joy_y, uint32_t now) {
+    // Amostra atual do fluxo de comandos (décimos de unidade); modo fixo em 0 = Manual
+    // Velocidade vem do eixo Y, direção do eixo X
+    uint16_t evt_seq = capture_evt_seq;
+    cmd_amostra_t amostra = controle_amostra(joy_x, joy_y, MAX_SPEED, (uint8_t)rover_mode,
+                                             (lights_on ? CMD_FLAG_LUZES : 0) |
+                                             (camera_on ? CMD_FLAG_CAMERA : 0) |
+                                             (evt_seq != capture_evt_ack ? CMD_FLAG_CAPTURA : 0));
+    controle_motivo_t motivo = controle_envio_decidir(&cmd_envio, &amostra, evt_seq, now);
+    if (motivo == CONTROLE_NADA)
+        return motivo;
+    
+    ZONA_INICIO(TRACE_COMANDOS);
+    capture_evt_enviado = evt_seq;
+    
+    // Do toque no botão ao quadro que o leva
+    uint32_t toque = botao_us;
+    if (toque && motivo == CONTROLE_EVENTO) {
+        metricas_hist_registrar(&metricas.botao, time_us_32() - toque);
+        botao_us = 0;
+    }
     
-    // Limita os valores entre -1.0 e 1.0 (por segurança)
-    *x = (*x > 1.0f) ? 1.0f : (*x < -1.0f) ? -1.0f : *x;
-    *y = (*y > 1.0f) ? 1.0f : (*y < -1.0f) ? -1.0f : *y;
+    // Quadro com a amostra atual e as CMD_REDUNDANCIA anteriores
+    uint8_t quadro[CMD_FRAME_MAX];
+    size_t len = cmd_stream_encode(&cmd_stream, &amostra, evt_seq, quadro, sizeof(quadro));
+    if (len) enviar_dados(quadro, len);
+    
+    // Fecha o grupo de paridade quando completo
+    len = cmd_stream_paridade(&cmd_stream, quadro, sizeof(quadro));
+    if (len) enviar_dados(quadro, len);
+    
+    // Cada quadro enviado (para depuração; nível debug)
+    RLOG(RLOG_DEBUG, RLOG_COMANDOS, "TX #%u (%s): speed=%.1f,steering=%.1f,flags=%x,evt=%u",
+         (uint16_t)(cmd_stream.seq - 1), RLOG_S(controle_nomes_motivo[motivo]),
+         RLOG_F(joy_y * MAX_SPEED), RLOG_F(joy_x * 100.0f), amostra.flags, evt_seq);
+    TRACE_FIM(TRACE_COMANDOS);
+    return motivo;
 }
 
-// Callback para interrupções GPIO
-void gpio_callback(uint gpio, uint32_t events) {
+// ====== TAREFAS (async_context do cyw43) ======
+// Com o cyw43 em segundo plano, rx_cb e os callbacks de TCP rodam na IRQ do
+// cyw43 e estas tarefas na IRQ de baixa prioridade do mesmo contexto, ambos
+// com a trava do lwIP: podem enviar direto. O que bloqueia (I2C do display,
+// printf do log) é pedido ao laço principal.
+
+// Pede ao laço principal um redesenho do display
+static void pedir_display(void) {
+    display_pendente = true;
+    __sev();
+}
+
+// Roda a tarefa do enlace o quanto antes. Segura em qualquer IRQ (a de GPIO
+// inclusive): só marca o trabalho pendente no contexto
+static void acordar_enlace(void) {
+    if (contexto)
+        async_context_set_work_pending(contexto, &evento_enlace);
+}
+
+// (Re)agenda uma tarefa para daqui a `ms`; só dentro do contexto ou com a
+// trava do lwIP
+static void agendar(async_at_time_worker_t *tarefa, uint32_t ms) {
+    async_context_remove_at_time_worker(contexto, tarefa);
+    async_context_add_at_time_worker_in_ms(contexto, tarefa, ms);
+}
+
+// Descoberta, HELLO, comandos e PING; retorna em quantos ms precisa rodar de novo
+static uint32_t enlace_processar(void) {
+    // Obtém o tempo atual
     uint32_t now = to_ms_since_boot(get_absolute_time());
+    supervisor_batimento(&supervisor, SUPERVISOR_CONTROLE, now);
+    
+    // Timeout adaptativo: intervalo entre respostas + SRTT + K·RTTVAR. Em
+    // repouso só o keepalive e o PING trazem resposta: tolera um perdido
+    uint32_t link_timeout = link_stats_timeout_ms(&link_stats, 2 * controle_envio_intervalo_ms(&cmd_envio));
+    
+    // Novo endereço (DHCP) ou enlace reconectado: procura o controlador de novo
+    if (rede_mudou) {
+        rede_mudou = false;
+        mdns_resp_announce(netif_default);
+        reiniciar_descoberta("rede mudou");
+        pedir_display();
+    }
     
-    // Verifica qual GPIO gerou a interrupção
-    if (gpio == BUTTON_CAPTURE) {
-        // Debounce para botão de captura
-        if (now - last_btn_capture_time > DEBOUNCE_TIME) {
-            if (events & GPIO_IRQ_EDGE_FALL) {  // Botão pressionado (falling edge)
-                capture_active = true;
-                capture_time = now;
-                printf("Botão de CAPTURA pressionado!\n");
-            }
-            last_btn_capture_time = now;
+#ifndef PC_IP
+    // Controlador travado mas mudo por muito tempo: pode ter mudado de IP
+    if (controlador_travado && now - last_rx > REDESCOBERTA_MS &&
+        now - travado_em > REDESCOBERTA_MS) {
+        reiniciar_descoberta("controlador sem resposta");
+    }
+#endif
+    
+    uint32_t intervalo;
+    uint32_t base = last_sent;      // O intervalo conta daqui
+    // Sem controlador: anuncia o rover na sub-rede
+    if (!controlador_travado) {
+        ultimo_cmd_us = 0;
+        controle_envio_parar(&cmd_envio);
+        intervalo = DESCOBERTA_INTERVALO_MS;
+        if (now - last_sent >= DESCOBERTA_INTERVALO_MS) {
+            last_sent = now;
+            enviar_descoberta();
         }
     }
-    else if (gpio == BUTTON_LIGHTS) {
-        // Debounce para botão de luzes
-        if (now - last_btn_lights_time > DEBOUNCE_TIME) {
-            if (events & GPIO_IRQ_EDGE_FALL) {  // Botão pressionado (falling edge)
-                lights_on = !lights_on;
-                printf("Luzes %s\n", lights_on ? "ON" : "OFF");
-                // Atualiza LED RGB conforme estado das luzes
-                if (lights_on)
-                    definir_cor_rgb(255, 255, 150); // Amarelo claro
-                else
-                    definir_cor_rgb(0, 0, 255); // Azul
+    // Se não estabelecemos conexão ainda, envia HELLO a cada segundo
+    else if (!conexao_ok || (now - last_rx > link_timeout)) {
+        ultimo_cmd_us = 0;
+        controle_envio_parar(&cmd_envio);
+        intervalo = HELLO_INTERVALO_MS;
+        if (now - last_sent >= HELLO_INTERVALO_MS) {
+            last_sent = now;
+            enviar_hello();
+            
+            // Se perdemos conexão, reporta
+            if (conexao_ok && now - last_rx > link_timeout) {
+                RLOG(RLOG_AVISO, RLOG_LINK, "sem resposta do simulador por %lu ms, enviando HELLO",
+                     link_timeout);
+                conexao_ok = false;
+                pedir_display();
             }
-            last_btn_lights_time = now;
         }
-    }
-    else if (gpio == BUTTON_CAMERA) {
-        // Debounce para botão de câmera
-        if (now - last_btn_camera_time > DEBOUNCE_TIME) {
-            if (events & GPIO_IRQ_EDGE_FALL) {  // Botão pressionado (falling edge)
-                camera_on = !camera_on;
-                printf("Câmera %s\n", camera_on ? "ON" : "OFF");
+    } 
+    // Se já temos conexão, amostra o joystick a cada CMD_AMOSTRA_MS e envia
+    // por evento, por mudança, a cada CMD_INTERVALO_MS fora do centro ou
+    // no keepalive em repouso (lib/controle.h)
+    else {
+        controle_motivo_t motivo = CONTROLE_NADA;
+        if (espectador) {
+            // Assistindo: o simulador descartaria os comandos
+            controle_envio_parar(&cmd_envio);
+            if (pedir_posse) {
+                pedir_posse = false;
+                char msg[32];
+                if (proto_tomar(msg, sizeof(msg), sessao_token)) {
+                    enviar_mensagem(msg);
+                    RLOG(RLOG_INFO, RLOG_REDE, "pedindo a posse do rover");
+                }
             }
-            last_btn_camera_time = now;
+        } else {
+            float joy_x, joy_y;
+            ler_joystick(&joy_x, &joy_y);
+            motivo = enviar_comandos_rover(joy_x, joy_y, now);
+        }
+        if (motivo != CONTROLE_NADA) {
+            last_sent = now;
+            
+            // Jitter do fluxo de comandos: desvio do período nos envios
+            // periódicos (evento, mudança e keepalive ficam fora)
+            uint32_t agora_us = time_us_32();
+            if (ultimo_cmd_us && motivo == CONTROLE_PERIODO) {
+                int32_t desvio = (int32_t)(agora_us - ultimo_cmd_us) - CMD_INTERVALO_MS * 1000;
+                metricas_hist_registrar(&metricas.cmd, (uint32_t)abs(desvio));
+            }
+            ultimo_cmd_us = agora_us;
+        }
+        
+        // Fora do ATIVO o joystick está parado: o gerente de energia o
+        // amostra e acorda o enlace quando ele mexe
+        base = now;
+        intervalo = controle_envio_espera_ms(&cmd_envio, now);
+        if (energia.estado == ENERGIA_ATIVO && intervalo > CMD_AMOSTRA_MS)
+            intervalo = CMD_AMOSTRA_MS;
+        
+        // Mede o RTT periodicamente
+        if (now - last_ping >= PING_INTERVALO_MS) {
+            last_ping = now;
+            enviar_ping();
         }
+        if (intervalo > PING_INTERVALO_MS - (now - last_ping))
+            intervalo = PING_INTERVALO_MS - (now - last_ping);
+    }
+    
+    // Se perdemos conexão, atualiza estado visual
+    if (conexao_ok && now - last_rx > link_timeout) {
+        rover_estado = ESTADO_CONECTANDO;
+        definir_cor_rgb(255, 0, 0); // Vermelho para indicar falha
+        pedir_display();
+        conexao_ok = false;
     }
+    
+    uint32_t decorrido = now - base;
+    return decorrido < intervalo ? intervalo - decorrido : 1;
 }
 
-// Callback chamado quando recebemos pacotes UDP
-static void rx_cb(void *arg, struct udp_pcb *pcb, 
-                  struct pbuf *p, const ip_addr_t *addr, u16_t port)
-{
-    if (!p) return;
+static void agendar_enlace(uint32_t ms) {
+    enlace_previsto_us = time_us_32() + ms * 1000u;
+    agendar(&tarefa_enlace, ms);
+}
+
+// Timer da tarefa do enlace
+static void enlace_cb(async_context_t *ctx, async_at_time_worker_t *tarefa) {
+    // Latência do timer: quanto a tarefa rodou depois do instante agendado
+    int32_t atraso = (int32_t)(time_us_32() - enlace_previsto_us);
+    metricas_hist_registrar(&metricas.laco, atraso > 0 ? (uint32_t)atraso : 0);
+    
+    ZONA_INICIO(TRACE_ENLACE);
+    agendar_enlace(enlace_processar());
+    TRACE_FIM(TRACE_ENLACE);
+}
+
+// Evento (OFFER, ACK, botão de captura, rede): roda o enlace fora do período
+static void evento_enlace_cb(async_context_t *ctx, async_when_pending_worker_t *worker) {
+    ZONA_INICIO(TRACE_ENLACE);
+    agendar_enlace(enlace_processar());
+    TRACE_FIM(TRACE_ENLACE);
+}
+
+// Fim da animação de captura: matriz e LED RGB voltam ao padrão normal
+static void visual_cb(async_context_t *ctx, async_at_time_worker_t *tarefa) {
+    if (rover_estado != ESTADO_CAPTURANDO)
+        return;
+    rover_estado = ESTADO_NORMAL;
     
-    // Atualiza o timestamp da última recepção
-    last_rx = to_ms_since_boot(get_absolute_time());
-    link_ok = true;
-    conexao_ok = true;
+    // Retorna matriz de LEDs para o padrão normal
+    atualizar_buffer_matriz(padrao_normal);
+    definir_leds(0, 0, 30); // Azul
     
-    // Extrai a mensagem como texto
-    char msg[256] = {0};
-    if (p->len < sizeof(msg) - 1) {
-        memcpy(msg, p->payload, p->len);
-        msg[p->len] = 0; // Garante que termine com nulo
+    // Retorna LED RGB para azul
+    definir_cor_rgb(0, 0, 255);
+    
+    pedir_display();
+}
+
+// RSSI para o servidor de status (ioctl ao cyw43, que precisa da trava)
+// e batimento da rede: o cyw43 respondeu, ou está sem enlace (aí é com o
+// roaming, não com o supervisor)
+static void rssi_cb(async_context_t *ctx, async_at_time_worker_t *tarefa) {
+    if (cyw43_wifi_get_rssi(&cyw43_state, &rssi_dbm) == 0 ||
+        cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) != CYW43_LINK_UP)
+        supervisor_batimento(&supervisor, SUPERVISOR_REDE, to_ms_since_boot(get_absolute_time()));
+    agendar(tarefa, RSSI_INTERVALO_MS);
+}
+
+#if ROVER_TRACE
+// Drena o anel de trace para o controlador (um datagrama por vez)
+static void trace_cb(async_context_t *ctx, async_at_time_worker_t *tarefa) {
+    if (controlador_travado)
+        enviar_trace();
+    agendar(tarefa, TRACE_INTERVALO_MS);
+}
+#endif
+
+// ===== GERENTE DE ENERGIA =====
+
+// energia_wifi_t -> modo de economia do cyw43
+static const uint32_t modos_wifi[] = {
+    [ENERGIA_WIFI_LIGADO] = CYW43_NONE_PM,
+    [ENERGIA_WIFI_PADRAO] = CYW43_DEFAULT_PM,
+    [ENERGIA_WIFI_AGRESSIVO] = CYW43_AGGRESSIVE_PM,
+};
+
+// Borda de botão (IRQ de GPIO): atividade já, sem esperar a amostragem
+static void acordar_energia(void) {
+    if (!contexto)
+        return;
+    if (energia.estado != ENERGIA_ATIVO && !despertar_us)
+        despertar_us = time_us_32();
+    async_context_set_work_pending(contexto, &evento_energia);
+}
+
+// Fecha a medida do despertar quando o nível ATIVO está todo aplicado
+static void registrar_despertar(void) {
+    if (!despertar_us || energia.estado != ENERGIA_ATIVO || energia_pendente)
+        return;
+    metricas_hist_registrar(&metricas.despertar, time_us_32() - despertar_us);
+    despertar_us = 0;
+}
+
+// Liga ou apaga o LED RGB e a matriz, repondo as últimas cores
+static void acender_leds(bool acesos) {
+    leds_acesos = acesos;
+    definir_cor_rgb(cor_rgb[0], cor_rgb[1], cor_rgb[2]);
+    definir_leds(cor_matriz[0], cor_matriz[1], cor_matriz[2]);
+}
+
+// Aplica o nível atual no que pode mudar na IRQ do contexto (rádio e LEDs);
+// relógio e OLED ficam para o laço principal
+static void energia_aplicar(void) {
+    const energia_nivel_t *n = energia_nivel(&energia);
+    
+    // Sem controlador não há comando a entregar rápido: no mínimo PM2
+    uint8_t wifi = n->wifi;
+    if (!conexao_ok && wifi < ENERGIA_WIFI_PADRAO)
+        wifi = ENERGIA_WIFI_PADRAO;
+    if (wifi != wifi_pm) {
+        cyw43_wifi_pm(&cyw43_state, modos_wifi[wifi]);
+        wifi_pm = wifi;
     }
     
-    printf("RX %d B de %s:%u → %s\n", p->len,
-           ipaddr_ntoa(addr), port, msg);
+    if (n->leds != leds_acesos)
+        acender_leds(n->leds);
     
-    // Verifica se é um ACK (resposta ao HELLO)
-    if (strcmp(msg, "ACK") == 0) {
-        printf("Recebido ACK - conexão estabelecida!\n");
-        // Atualizar estado
-        rover_estado = ESTADO_NORMAL;
-        atualizar_display();
-        return;
+    if (n->clk_khz != clk_sys_khz || n->contraste != contraste_oled) {
+        energia_pendente = true;
+        __sev();
     }
-    // Processa a mensagem para extrair o score
-    if (strstr(msg, "score=") != NULL) {
-        char *score_str = strstr(msg, "score=");
-        if (score_str) {
-            int novo_score = atoi(score_str + 6); // Pula "score="
-            
-            // Verifica se o score aumentou (capturou ponto)
-            if (novo_score > score_atual) {
-                rover_estado = ESTADO_CAPTURANDO;
-                ultima_captura = to_ms_since_boot(get_absolute_time());
-                pontos_capturados++;
-                
-                // Atualiza matriz de LEDs com padrão de captura
-                atualizar_buffer_matriz(padrao_captura);
-                definir_leds(0, 255, 0); // Verde brilhante
-                
-                // LED RGB em verde
-                definir_cor_rgb(0, 255, 0);
-            }
-            
-            score_atual = novo_score;
-            atualizar_display();
-        }
+    registrar_despertar();
+}
+
+// Uma passada do gerente: joystick, transição por inatividade e nível
+static void energia_processar(bool atividade) {
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    energia_estado_t antes = energia.estado;
+    
+    float x, y;
+    ler_joystick(&x, &y);
+    if (energia_joystick(&energia, x, y)) {
+        if (antes != ENERGIA_ATIVO && !despertar_us)
+            despertar_us = time_us_32();
+        atividade = true;
     }
     
-    pbuf_free(p);
+    if (atividade)
+        energia_atividade(&energia, now);
+    else
+        energia_avaliar(&energia, now);
+    if (energia.estado != antes) {
+        RLOG(RLOG_INFO, RLOG_ENERGIA, "%s -> %s", RLOG_S(energia_nomes_estado[antes]),
+             RLOG_S(energia_nomes_estado[energia.estado]));
+        // De volta ao ATIVO: o enlace volta a amostrar o joystick a cada CMD_AMOSTRA_MS
+        if (energia.estado == ENERGIA_ATIVO)
+            acordar_enlace();
+    }
+    
+    energia_aplicar();
+    agendar(&tarefa_energia, energia_proxima_ms(&energia, now));
 }
 
-// Envia mensagem HELLO para estabelecer conexão
-void enviar_hello() {
-    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, 6, PBUF_RAM);
-    memcpy(p->payload, "HELLO", 6);
-    udp_sendto(pcb, p, &pc_addr, PC_PORT);
-    pbuf_free(p);
-    printf("HELLO enviado para %s:%d\n", PC_IP, PC_PORT);
+static void energia_cb(async_context_t *ctx, async_at_time_worker_t *tarefa) {
+    energia_processar(false);
 }
 
-// Envia comandos do joystick para o simulador
-void enviar_comandos_rover(float joy_x, float joy_y) {
-    // Transforma os valores do joystick em comandos para o rover
-    // Velocidade vem do eixo Y, direção do eixo X
-    float speed = joy_y * MAX_SPEED;      // Converte para a faixa desejada (-MAX_SPEED a MAX_SPEED)
-    float steering = joy_x * 100.0f;      // Converte para a faixa (-100 a 100)
-    
-    // Formata a mensagem de controle incluindo o comando de captura
-    char cmd[128];
-    if (capture_active) {
-        snprintf(cmd, sizeof(cmd), 
-                "speed=%.1f,steering=%.1f,mode=%d,lights=%s,camera=%s,capture=1",
-                speed,              // Velocidade do eixo Y
-                steering,           // Direção do eixo X
-                rover_mode,         // Modo (fixo em 0 = Manual)
-                lights_on ? "on" : "off", 
-                camera_on ? "on" : "off");
-        
-        // Desativa a captura após envio (para não ficar enviando constantemente)
-        uint32_t now = to_ms_since_boot(get_absolute_time());
-        if (now - capture_time > 500) {  // Mantém ativo por 500ms
-            capture_active = false;
-            printf("Comando de captura enviado\n");
+static void evento_energia_cb(async_context_t *ctx, async_when_pending_worker_t *worker) {
+    energia_processar(true);
+}
+
+// clk_peri e o PIO seguem o clk_sys: refaz o baud do I2C, o tempo de bit
+// da matriz WS2812 e o contador de 1 MHz do PWM do LED RGB
+static void ajustar_divisores(void) {
+    float mhz = clock_get_hz(clk_sys) / 1e6f;
+    i2c_set_baudrate(I2C_PORT, 400 * 1000);
+    pio_sm_set_clkdiv(pio0, 0, clock_get_hz(clk_sys) /
+                      (800000.0f * (ws2812_T1 + ws2812_T2 + ws2812_T3)));
+    pwm_set_clkdiv(pwm_gpio_to_slice_num(R_LED_PIN), mhz);
+    pwm_set_clkdiv(pwm_gpio_to_slice_num(B_LED_PIN), mhz);
+}
+
+// Relógio e OLED (I2C): no laço principal. A troca do clk_sys segura a
+// trava do contexto para nenhuma transferência do cyw43 cruzar a mudança
+static void energia_aplicar_nucleo(void) {
+    const energia_nivel_t *n = energia_nivel(&energia);
+    
+    if (n->clk_khz != clk_sys_khz) {
+        cyw43_arch_lwip_begin();
+        if (set_sys_clock_khz(n->clk_khz, false)) {
+            clk_sys_khz = n->clk_khz;
+            ajustar_divisores();
+        } else {
+            RLOG(RLOG_AVISO, RLOG_ENERGIA, "clk_sys de %lu kHz indisponivel", n->clk_khz);
         }
-    } else {
-        snprintf(cmd, sizeof(cmd), 
-                "speed=%.1f,steering=%.1f,mode=%d,lights=%s,camera=%s",
-                speed,              // Velocidade do eixo Y
-                steering,           // Direção do eixo X
-                rover_mode,         // Modo (fixo em 0 = Manual)
-                lights_on ? "on" : "off", 
-                camera_on ? "on" : "off");
-    }
-    
-    // Envia o comando
-    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, strlen(cmd) + 1, PBUF_RAM);
-    memcpy(p->payload, cmd, strlen(cmd) + 1);
-    udp_sendto(pcb, p, &pc_addr, PC_PORT);
-    pbuf_free(p);
+        cyw43_arch_lwip_end();
+    }
     
-    // Mostra a mensagem enviada (para depuração)
-    static uint32_t last_print = 0;
-    uint32_t now = to_ms_since_boot(get_absolute_time());
-    if (now - last_print > 500) { // Limita impressão a cada 500ms
-        printf("TX: %s\n", cmd);
-        last_print = now;
+    if (n->contraste != contraste_oled) {
+        if (!n->contraste) {
+            ssd1306_power(&display, false);
+        } else {
+            if (!contraste_oled) {
+                ssd1306_power(&display, true);
+                display_pendente = true;
+            }
+            ssd1306_contrast(&display, n->contraste);
+        }
+        contraste_oled = n->contraste;
     }
+    
+    cyw43_arch_lwip_begin();
+    registrar_despertar();
+    cyw43_arch_lwip_end();
+}
+
+// Registra as tarefas no contexto do cyw43 e dispara o enlace
+static void iniciar_tarefas(void) {
+    tarefa_enlace.do_work = enlace_cb;
+    tarefa_visual.do_work = visual_cb;
+    tarefa_rssi.do_work = rssi_cb;
+    uint32_t inicio = to_ms_since_boot(get_absolute_time());
+    supervisor_registrar(&supervisor, SUPERVISOR_CONTROLE, PRAZO_CONTROLE_MS, inicio);
+    supervisor_registrar(&supervisor, SUPERVISOR_REDE, PRAZO_REDE_MS, inicio);
+    evento_enlace.do_work = evento_enlace_cb;
+    async_context_add_when_pending_worker(contexto, &evento_enlace);
+    agendar_enlace(0);
+    agendar(&tarefa_rssi, 0);
+    tarefa_energia.do_work = energia_cb;
+    evento_energia.do_work = evento_energia_cb;
+    async_context_add_when_pending_worker(contexto, &evento_energia);
+    energia_atividade(&energia, to_ms_since_boot(get_absolute_time()));
+    agendar(&tarefa_energia, 0);
+    tarefa_roaming.do_work = roaming_cb;
+    uint32_t agora = to_ms_since_boot(get_absolute_time());
+    roaming_ultima_varredura = agora - ROAMING_ESPERA_MS;   // sinal fraco já no início: varre
+    roaming_mudar(rede_atual >= 0 ? ROAMING_CONECTADO : ROAMING_ESPERANDO, agora);
+    agendar(&tarefa_roaming, ROAMING_INTERVALO_MS);
+#if ROVER_TRACE
+    tarefa_trace.do_work = trace_cb;
+    agendar(&tarefa_trace, TRACE_INTERVALO_MS);
+#endif
 }
 
 // Configura os pinos GPIO para botões e ADC
@@ -770,171 +2605,99 @@ void configurar_gpio() {
     printf("ADCs configurados: X=%d, Y=%d\n", ADC_X_PIN, ADC_Y_PIN);
 }
 
-// Função para configurar o Pico W como AP e receber credenciais Wi-Fi
-bool setup_wifi_portal(void) {
-    printf("\n=== PORTAL DE CONFIGURAÇÃO WI-FI DO ROVER ===\n");
-    printf("Iniciando sistema...\n");
-    
-    // Atualiza o display durante a configuração
-    rover_estado = ESTADO_CONFIGURANDO;
-    atualizar_display();
-    
-    // Passo 1: Criação do Access Point
-    printf("\n=== Fase 1: Modo Access Point ===\n");
-    cyw43_arch_enable_ap_mode("Rover-Setup", "roverpass", CYW43_AUTH_WPA2_AES_PSK);
-    
-    // Configuração de IP para o AP
-    ip4_addr_t ip, netmask, gateway;
-    IP4_ADDR(&ip, 192, 168, 4, 1);
-    IP4_ADDR(&netmask, 255, 255, 255, 0);
-    IP4_ADDR(&gateway, 192, 168, 4, 1);
-    netif_set_addr(netif_default, &ip, &netmask, &gateway);
-    
-    printf("✓ Access Point criado!\n");
-    printf("SSID: Rover-Setup\n");
-    printf("Senha: roverpass\n");
-    printf("IP: %s\n", ip4addr_ntoa(&ip));
-    
-    // Atualiza display com instruções
-    ssd1306_fill(&display, 0);
-    ssd1306_draw_string(&display, "Portal Wi-Fi Ativo", 5, 0);
-    ssd1306_draw_string(&display, "Conecte a:", 0, 16);
-    ssd1306_draw_string(&display, "Rover-Setup", 10, 28);
-    ssd1306_draw_string(&display, "Senha: roverpass", 0, 40);
-    ssd1306_draw_string(&display, "Acesse: 192.168.4.1", 0, 52);
-    ssd1306_send_data(&display);
-    
-    // Passo 2: Inicia o servidor HTTP
-    printf("\n=== Fase 2: Servidor Web ===\n");
-    struct tcp_pcb *server = start_http_server();
-    if (!server) {
-        printf("❌ Erro ao iniciar servidor HTTP\n");
-        return false;
-    }
-    printf("✓ Servidor HTTP iniciado na porta 80\n");
-    printf("Acesse: http://192.168.4.1\n");
+// Provisionamento em OPERANDO: UDP, mDNS, servidor de status e as tarefas
+// do contexto sobem uma vez
+static void iniciar_operacao(void) {
+    // Daqui em diante a rede já roda na IRQ do cyw43: chamadas ao lwIP
+    // fora dos callbacks só com a trava
+    cyw43_arch_lwip_begin();
     
-    printf("\n=== Sistema Pronto ===\n");
-    printf("1. Conecte seu dispositivo ao Wi-Fi: Rover-Setup\n");
-    printf("2. Abra o navegador e acesse: http://192.168.4.1\n");
-    printf("3. Insira as credenciais da sua rede\n");
-    printf("4. Aguarde a conexão...\n\n");
+    // Configura socket UDP
+    pcb = udp_new();
+    udp_bind(pcb, IP_ADDR_ANY, PICO_PORT);
+    udp_recv(pcb, rx_cb, NULL);
+    printf("Socket UDP configurado\n");
     
-    // Matriz de LEDs em modo configuração (azul claro)
-    atualizar_buffer_matriz(padrao_normal);
-    definir_leds(0, 150, 255);
+    // Nome do rover derivado do MAC (rover-XXXX)
+    snprintf(nome_host, sizeof(nome_host), "rover-%02x%02x",
+             netif_default->hwaddr[4], netif_default->hwaddr[5]);
+    netif_set_hostname(netif_default, nome_host);
+    sessao_id = get_rand_32();
     
-    // Loop principal - Aguarda configuração
-    while (!new_wifi_config.received) {
-        cyw43_arch_poll();  // Processa eventos de rede
-        sleep_ms(10);
+#ifdef PC_IP
+    // Controlador fixo em tempo de compilação: sem descoberta
+    ipaddr_aton(PC_IP, &pc_addr);
+    controlador_travado = true;
+#endif
+    iniciar_mdns();
+    netif_add_ext_callback(&rede_callback, rede_ext_cb);
+    
+    // Métricas para a monitoração da frota
+    if (iniciar_servidor_status()) {
+        printf("Status em http://%s.local/metrics e /status\n", nome_host);
+#if ROVER_OTA
+        ota_confirmar();
+#endif
+    } else {
+        printf("Erro ao iniciar o servidor de status\n");
     }
     
-    printf("\n=== Credenciais Recebidas! ===\n");
-    printf("SSID: %s\n", new_wifi_config.ssid);
-    printf("Senha: %s\n", new_wifi_config.password);
-    
-    // Atualiza display com informação de transição
-    ssd1306_fill(&display, 0);
-    ssd1306_draw_string(&display, "Configuracao OK!", 5, 0);
-    ssd1306_draw_string(&display, "Conectando a:", 0, 16);
-    ssd1306_draw_string(&display, new_wifi_config.ssid, 10, 28);
-    ssd1306_draw_string(&display, "Aguarde...", 10, 45);
-    ssd1306_send_data(&display);
-    
-    // Aguarda um pouco para a página de confirmação ser enviada
-    sleep_ms(5000);
-    
-    // Passo 3: Para o servidor e fecha o AP
-    printf("\n=== Fase 3: Mudança de Modo ===\n");
-    tcp_close(server);
-    
-    // Desativa modo AP
-    cyw43_arch_disable_ap_mode();
-    
-    // Muda para modo cliente
-    cyw43_arch_enable_sta_mode();
-    
-    printf("✓ Modo AP desativado\n");
-    printf("✓ Modo cliente ativado\n");
+    // Inicializa variáveis de tempo
+    last_sent = 0;
+    last_rx = 0;
+    link_stats_init(&link_stats);
+    cmd_stream_init(&cmd_stream, CMD_REDUNDANCIA, CMD_PARIDADE_N);
+    controle_envio_cfg_t envio = {
+        .periodo_ms = CMD_INTERVALO_MS,
+        .keepalive_ms = CMD_KEEPALIVE_MS,
+        .intervalo_min_ms = CMD_INTERVALO_MIN_MS,
+        .limiar = CMD_LIMIAR,
+        .vel_max = MAX_SPEED,
+    };
+    controle_envio_iniciar(&cmd_envio, &envio);
+    
+    // Enlace, LEDs, RSSI e trace passam a rodar nas tarefas do contexto
+    iniciar_tarefas();
+    cyw43_arch_lwip_end();
     
-    // Passo 4: Conecta à rede especificada
-    printf("\n=== Fase 4: Conexão à Nova Rede ===\n");
-    printf("Tentando conectar a: %s\n", new_wifi_config.ssid);
+    printf("Iniciando comunicação com o simulador...\n");
+    printf("Controles:\n");
+    printf("- Joystick eixo Y: Movimento para frente/trás\n");
+    printf("- Joystick eixo X: Direção esquerda/direita\n");
+    printf("- Botão %d (A): CAPTURAR ponto verde\n", BUTTON_CAPTURE);
+    printf("- Botão %d: Ligar/Desligar luzes\n", BUTTON_LIGHTS);
+    printf("- Botão %d: Ligar/Desligar câmera\n", BUTTON_CAMERA);
     
-    // Atualiza estado do rover
+    // Atualiza o display para o modo de operação normal
     rover_estado = ESTADO_CONECTANDO;
-    
-    int connection_attempts = 0;
-    while (cyw43_arch_wifi_connect_timeout_ms(new_wifi_config.ssid, 
-                                            new_wifi_config.password, 
-                                            CYW43_AUTH_WPA2_AES_PSK, 
-                                            15000)) {
-        connection_attempts++;
-        printf("Tentativa %d falhou. Tentando novamente...\n", connection_attempts);
-        
-        ssd1306_fill(&display, 0);
-        ssd1306_draw_string(&display, "Falha na Conexao", 5, 0);
-        ssd1306_draw_string(&display, "Tentativa: ", 0, 16);
-        char temp[10];
-        sprintf(temp, "%d/3", connection_attempts);
-        ssd1306_draw_string(&display, temp, 70, 16);
-        ssd1306_draw_string(&display, "Tentando novamente...", 0, 32);
-        ssd1306_send_data(&display);
-        
-        if (connection_attempts >= 3) {
-            printf("\n❌ Não foi possível conectar após %d tentativas\n", connection_attempts);
-            printf("Verifique as credenciais e tente novamente\n");
-            
-            ssd1306_fill(&display, 0);
-            ssd1306_draw_string(&display, "Falha na Conexao", 5, 0);
-            ssd1306_draw_string(&display, "Verifique as", 10, 20);
-            ssd1306_draw_string(&display, "credenciais e", 10, 32);
-            ssd1306_draw_string(&display, "reinicie o rover", 5, 44);
-            ssd1306_send_data(&display);
-            
-            // Mata o padrão da matriz
-            for (int i = 0; i < NUM_PIXELS; i++) {
-                buffer_leds[i] = false;
-            }
-            definir_leds(0, 0, 0);
-            
-            return false;
-        }
-    }
-    
-    // Sucesso! Conexão estabelecida
-    printf("\n✓ CONECTADO COM SUCESSO!\n");
-    printf("IP obtido: %s\n", ipaddr_ntoa(&cyw43_state.netif[0].ip_addr));
-    
-    // Atualiza display com info de sucesso
-    ssd1306_fill(&display, 0);
-    ssd1306_draw_string(&display, "Conectado!", 25, 0);
-    ssd1306_draw_string(&display, "Rede: ", 0, 16);
-    ssd1306_draw_string(&display, new_wifi_config.ssid, 40, 16);
-    ssd1306_draw_string(&display, "IP: ", 0, 32);
-    ssd1306_draw_string(&display, ipaddr_ntoa(&cyw43_state.netif[0].ip_addr), 30, 32);
-    ssd1306_draw_string(&display, "Iniciando rover...", 0, 48);
-    ssd1306_send_data(&display);
-    
-    // Retorna para o estado normal do rover
-    rover_estado = ESTADO_NORMAL;
-    
-    printf("\n=== Sistema Wi-Fi Configurado ===\n");
-    printf("O Rover agora está conectado à sua rede e pronto para operação!\n");
-    
-    // Espera um momento para exibir a mensagem
-    sleep_ms(3000);
-    
-    return true;
+    pedir_display();
 }
 
 int main()
 {
     // Inicializa UART para debug
     stdio_init_all();
-    sleep_ms(1000);  // Aguarda a estabilização do sistema
+#if LIB_PICO_STDIO_USB
+    // Espera o terminal USB para não perder o boot, mas só até ele enumerar
+    for (uint32_t t = 0; t < BOOT_ESPERA_USB_MS && !stdio_usb_connected(); t += 10)
+        sleep_ms(10);
+#else
+    sleep_ms(BOOT_ESPERA_USB_MS);  // Aguarda a estabilização do sistema
+#endif
+    clk_sys_khz = clock_get_hz(clk_sys) / 1000;
+    const energia_perfil_t *perfil = energia_perfil(ENERGIA_PERFIL);
+    energia_iniciar(&energia, perfil ? perfil : &energia_perfis[1],
+                    to_ms_since_boot(get_absolute_time()));
     printf("\n\n=== Controlador Rover com Portal de Configuração Wi-Fi ===\n");
+#if ROVER_OTA
+    printf("Imagem do slot %c (atualização em POST /ota)\n", 'a' + ROVER_OTA_SLOT);
+#endif
+#ifdef RLOG_CONFIG
+    // Níveis de log iniciais (opção ROVER_LOG do CMake)
+    rlog_config(RLOG_CONFIG);
+#endif
+    // Motivo do reset anterior (scratch do watchdog)
+    supervisor_boot();
     
     // Configura GPIO para botões e ADC
     configurar_gpio();
@@ -950,105 +2713,64 @@ int main()
         printf("Falha na inicialização do Wi-Fi\n"); 
         return 1; 
     }
+    contexto = cyw43_arch_async_context();
+    iniciar_supervisor();
     
-    // ===== NOVO CÓDIGO: PORTAL DE CONFIGURAÇÃO WI-FI =====
-    // Inicializa o portal de configuração Wi-Fi
-    if (!setup_wifi_portal()) {
-        printf("Falha na configuração do Wi-Fi. O rover não pode iniciar.\n");
-        
-        // Mensagem de erro no display
-        ssd1306_fill(&display, 0);
-        ssd1306_draw_string(&display, "Erro Wi-Fi", 25, 10);
-        ssd1306_draw_string(&display, "Reinicie o", 20, 30);
-        ssd1306_draw_string(&display, "dispositivo", 20, 45);
-        ssd1306_send_data(&display);
-        
-        // Loop infinito em caso de falha
-        while (true) {
-            sleep_ms(1000);
-        }
-    }
-    
-    // ===== CONTINUAÇÃO DO CÓDIGO ORIGINAL =====
-    // Configura socket UDP
-    pcb = udp_new();
-    ipaddr_aton(PC_IP, &pc_addr);
-    udp_bind(pcb, IP_ADDR_ANY, PICO_PORT);
-    udp_recv(pcb, rx_cb, NULL);
-    printf("Socket UDP configurado\n");
-    
-    // Inicializa variáveis de tempo
-    last_sent = 0;
-    last_rx = 0;
-    
-    printf("Iniciando comunicação com o simulador...\n");
-    printf("Controles:\n");
-    printf("- Joystick eixo Y: Movimento para frente/trás\n");
-    printf("- Joystick eixo X: Direção esquerda/direita\n");
-    printf("- Botão %d (A): CAPTURAR ponto verde\n", BUTTON_CAPTURE);
-    printf("- Botão %d: Ligar/Desligar luzes\n", BUTTON_LIGHTS);
-    printf("- Botão %d: Ligar/Desligar câmera\n", BUTTON_CAMERA);
-    
-    // Atualiza o display para o modo de operação normal
-    rover_estado = ESTADO_CONECTANDO;
-    atualizar_display();
-    
+    // ===== PORTAL DE CONFIGURAÇÃO WI-FI (lib/provisao.h) =====
+    // Rede conhecida no ar (lib/credenciais.h); sem nenhuma, o portal. O
+    // provisionamento anda no laço principal até OPERANDO
+    credenciais_ler(&credenciais);
+    rover_estado = ESTADO_CONFIGURANDO;
+    provisao_iniciar(&provisao, credenciais.n, to_ms_since_boot(get_absolute_time()));
+    cyw43_arch_lwip_begin();
+    while (provisao_entrar(to_ms_since_boot(get_absolute_time())))
+        ;
+    cyw43_arch_lwip_end();
+    
+    // Laço principal: só o que não cabe numa IRQ. Sem pedidos, o núcleo
+    // dorme em __wfe até a próxima interrupção (rede, timer ou botão)
     while (true) {
-        // Processa eventos Wi-Fi
-        cyw43_arch_poll();
+        supervisor_batimento(&supervisor, SUPERVISOR_LACO, to_ms_since_boot(get_absolute_time()));
         
-        // Obtém o tempo atual
-        uint32_t now = to_ms_since_boot(get_absolute_time());
+        // Portal e conexão até a rede estar de pé; então o controle sobe
+        if (provisao.estado != PROVISAO_OPERANDO) {
+            provisao_processar();
+            if (provisao.estado == PROVISAO_OPERANDO)
+                iniciar_operacao();
+        }
         
-        // Se não estabelecemos conexão ainda, envia HELLO a cada segundo
-        if (!conexao_ok || (now - last_rx > 5000)) {
-            if (now - last_sent >= 1000) {
-                last_sent = now;
-                enviar_hello();
-                
-                // Se perdemos conexão, reporta
-                if (conexao_ok && now - last_rx > 5000) {
-                    printf("Sem resposta do simulador por 5s, enviando HELLO...\n");
-                    conexao_ok = false;
-                    atualizar_display();
-                }
-            }
-        } 
-        // Se já temos conexão, envia comandos a cada 100ms
-        else if (now - last_sent >= 100) {
-            last_sent = now;
-            
-            // Lê os valores do joystick
-            float joy_x, joy_y;
-            ler_joystick(&joy_x, &joy_y);
-            
-            // Envia comando para o simulador
-            enviar_comandos_rover(joy_x, joy_y);
+        if (energia_pendente) {
+            energia_pendente = false;
+            energia_aplicar_nucleo();
         }
         
-        // Retorna ao estado normal após 500ms de animação de captura
-        if (rover_estado == ESTADO_CAPTURANDO && now - ultima_captura > 500) {
-            rover_estado = ESTADO_NORMAL;
-            
-            // Retorna matriz de LEDs para o padrão normal
-            atualizar_buffer_matriz(padrao_normal);
-            definir_leds(0, 0, 30); // Azul
-            
-            // Retorna LED RGB para azul
-            definir_cor_rgb(0, 0, 255);
-            
-            atualizar_display();
+#if ROVER_OTA
+        if (ota_pendente) {
+            ota_pendente = false;
+            ota_processar();
         }
+#endif
         
-        // Se perdemos conexão, atualiza estado visual
-        if (conexao_ok && now - last_rx > 5000) {
-            rover_estado = ESTADO_CONECTANDO;
-            definir_cor_rgb(255, 0, 0); // Vermelho para indicar falha
+        if (display_pendente) {
+            display_pendente = false;
             atualizar_display();
-            conexao_ok = false;
         }
+        if (display.falha)
+            recuperar_i2c();
         
-        // Pequena pausa para não sobrecarregar a CPU
-        sleep_ms(10);
+        // Formata o log pendente fora dos callbacks, com orçamento de bytes
+        rlog_escoar(RLOG_ESCOAR_BYTES);
+        
+        // Durante o provisionamento o sono também termina no próximo prazo
+        // do estado, para o timeout valer na hora e não até 50 ms depois
+        if (!display_pendente && !energia_pendente && !rlog_pendente()) {
+            uint32_t sono = NUCLEO_SONO_MAX_MS;
+            if (provisao.estado != PROVISAO_OPERANDO) {
+                uint32_t prazo = provisao_proxima_ms(&provisao, to_ms_since_boot(get_absolute_time()));
+                if (prazo < sono)
+                    sono = prazo;
+            }
+            best_effort_wfe_or_timeout(make_timeout_time_ms(sono));
+        }
     }
 }
\ No newline at end of file